@@ -6,22 +6,76 @@
 #include <gui/modules/submenu.h>
 #include <gui/modules/text_input.h>
 #include <gui/modules/widget.h>
+#include <gui/modules/text_box.h>
 #include <gui/modules/variable_item_list.h>
 #include <notification/notification.h>
 #include <notification/notification_messages.h>
+#include <storage/storage.h>
+#include <stdio.h>
 #include "dra.h"
+#include "dra_host.h"
+#include "dra_mem.h"
+#include "dra_port.h"
+#include "dra_power.h"
+#include "dra_radio.h"
+#include "dra_rec.h"
+#include "dra_settings.h"
+#include "dra_stats.h"
+#include "dra_tone.h"
+#include "dra_waterfall.h"
 //#include "dra_flipper_app_icons.h"
 
 #define TAG          "DRA_Flipper"
+#define SETTINGS_PATH APP_DATA_PATH("settings.bin")
+#define MEMORIES_DIR  APP_DATA_PATH("memories")
+#define MEMORIES_CSV  APP_DATA_PATH("memories.csv") // CHIRP or RepeaterBook export to import
+#define RECORDINGS_DIR APP_DATA_PATH("recordings")
+#define HOST_UPLOAD_CSV APP_DATA_PATH("upload.csv") // Memories uploaded over the host link
 //test
 // Change this to BACKLIGHT_AUTO if you don't want the backlight to be continuously on.
 #define BACKLIGHT_ON 1
 
+// Upper bound on main screen redraws per second.  Changes arriving faster than this are
+// coalesced into a single redraw.
+#define MAIN_VIEW_MAX_FPS 10
+
+// Length of the tone played when OK is pressed on the main screen.
+#define MAIN_VIEW_TONE_MS 100
+
+// How often RSSI is read while the squelch is open.
+#define MAIN_VIEW_RSSI_PERIOD_MS 250
+
+// How often the driver statistics are written to the log (DRA_STATS builds only).
+#define DIAGNOSTICS_LOG_PERIOD_MS 10000
+
+// Memories held in RAM while browsing; the next page is read from SD when the user scrolls past.
+#define MEMORY_PAGE_SIZE    8
+#define MEMORY_IMPORT_STACK 2048
+
+// The waterfall sweeps channels around the receive frequency as fast as the module retunes;
+// each sweep adds a row below the header line.
+#define WATERFALL_CHANNELS     32
+#define WATERFALL_TOP          10
+#define WATERFALL_ROWS         (64 - WATERFALL_TOP)
+#define WATERFALL_DWELL_MS     20 // Squelch settle time per channel
+#define WATERFALL_RSSI_FLOOR   20 // RSSI readings from floor to ceiling map onto the 16 shades
+#define WATERFALL_RSSI_CEILING 120
+
+// Received audio is recorded while the squelch is open.  ADPCM at 8 kHz is 4 KB/s, so the
+// recorder's buffers ride out SD stalls of several seconds.
+#define RECORDING_SAMPLE_RATE 8000
+#define RECORDING_FORMAT      Dra818RecFormatAdpcm
+
 // Our application menu has 3 items.  You can add more items if you want.
 typedef enum {
     dra_flipperSubmenuIndexConfigure,
     dra_flipperSubmenuIndexGame,
     dra_flipperSubmenuIndexAbout,
+    dra_flipperSubmenuIndexDiagnostics,
+    dra_flipperSubmenuIndexImport,
+    dra_flipperSubmenuIndexWaterfall,
+    dra_flipperSubmenuIndexRecord,
+    dra_flipperSubmenuIndexHost,
 } dra_flipperSubmenuIndex;
 
 // Each view is a screen we show the user.
@@ -31,69 +85,133 @@ typedef enum {
     dra_flipperViewConfigure, // The configuration screen
     dra_flipperViewMain, // The main screen
     dra_flipperViewAbout, // The about screen with directions, link to social channel, etc.
+    dra_flipperViewWaterfall, // Band activity over time
+    dra_flipperViewDiagnostics, // Driver latency and error statistics
 } dra_flipperView;
 
 typedef enum {
     dra_flipperEventIdRedrawScreen = 0, // Custom event to redraw the screen
     dra_flipperEventIdOkPressed = 42, // Custom event to process OK button getting pressed down
+    dra_flipperEventIdReleaseViews, // Free the transient views that are no longer showing
+    dra_flipperEventIdImportDone, // The memory import thread has finished
+    dra_flipperEventIdHostImport, // Memories uploaded over the host link are ready to import
 } dra_flipperEventId;
 
 typedef struct {
     ViewDispatcher* view_dispatcher; // Switches between our views
+    dra_flipperView current_view; // The view last switched to
     NotificationApp* notifications; // Used for controlling the backlight
+    // Only the submenu exists at startup.  The other screens are allocated on first use; the
+    // transient ones (text input, about, diagnostics) are freed again once the user leaves them.
     Submenu* submenu; // The application menu
     TextInput* text_input; // The text input screen
     VariableItemList* variable_item_list_config; // The configuration screen
     View* view_main; // The main screen
     Widget* widget_about; // The about screen
+    View* view_waterfall; // The waterfall screen
+#ifdef DRA_STATS
+    TextBox* text_box_diagnostics; // The diagnostics screen
+    FuriString* diagnostics_text; // Text shown on the diagnostics screen
+    FuriTimer* diagnostics_timer; // Periodically dumps the statistics to the log
+#endif
 
+    Dra818SettingsStore* settings; // Persistent settings (saved a moment after each edit)
+    VariableItem* setting_1_item; // The PL mode item (a memory can change it)
     VariableItem* setting_2_item; // The name setting item (so we can update the text)
+    VariableItem* memory_item; // The memory browser item
+    VariableItem* power_item; // The power save item
     char* temp_buffer; // Temporary buffer for text input
     uint32_t temp_buffer_size; // Size of temporary buffer
 
-    FuriTimer* timer; // Timer for redrawing the screen
+    FuriTimer* timer; // One-shot timer that delivers a coalesced redraw
+    FuriMutex* redraw_mutex; // Guards the redraw bookkeeping and squelch/RSSI state below
+    bool redraw_visible; // A screen with coalesced redraws (main or waterfall) is showing
+    bool main_visible; // The main screen is showing
+    bool redraw_pending; // A redraw is scheduled but not yet performed
+    uint32_t redraw_last_tick; // When the last redraw was performed
+    uint32_t redraws_requested; // State changes that asked for a redraw
+    uint32_t redraws_performed; // Redraws actually performed
+
+    FuriTimer* rssi_timer; // Polls RSSI while the squelch is open on the main screen
+    bool squelch_open; // Last squelch state reported by the radio
+    int16_t rssi; // Last RSSI reading (-1 if none)
+
+    Dra818Bus* bus; // SPI bus the module sits on
+    Dra818* dra; // The module (slot 0)
+    Dra818Radio* radio; // Service thread that owns the module; all radio work goes through it
+    volatile bool radio_ready; // Set once the module has answered and is configured
+    volatile bool bus_calibrated; // Bus speed came from settings or a calibration this run
+    uint32_t radio_start_tick; // When the init sequence was started
+
+    Dra818Mem* mem; // Memory bank on SD, opened with the configuration screen (NULL if none)
+    FuriThread* import_thread; // Imports import_csv while it runs
+    const char* import_csv; // MEMORIES_CSV, or HOST_UPLOAD_CSV for an upload
+    Dra818MemImportStats import_stats;
+    Dra818MemCursor mem_cursor; // Position of the page below in the bank
+    Dra818Memory mem_page[MEMORY_PAGE_SIZE];
+    uint8_t mem_page_count;
+    uint8_t mem_index; // Memory shown, within mem_page
+
+    Dra818Waterfall* waterfall; // History shown on the waterfall screen (NULL while it is freed)
+    FuriMutex* waterfall_mutex; // Guards waterfall between the radio thread and drawing
+
+    Dra818Rec* recorder; // Recording in progress (NULL if none)
+    FuriMutex* recorder_mutex; // Guards recorder between the radio thread and the menu
+    Dra818RecStats recorder_stats; // Totals of the last recording
+
+    Dra818Host* host; // Host link service (NULL while it is off)
+    FuriMutex* host_mutex; // Guards host between the radio thread and the menu
 } dra_flipperApp;
 
 typedef struct {
     uint32_t setting_1_index; // The team color setting index
     FuriString* setting_2_name; // The name setting
     uint8_t x; // The x coordinate
+
+    // Text for each line of the main screen.  Formatted only when the backing value
+    // changes, so the draw callback does no formatting and no heap work.
+    char x_text[24];
+    char status_text[24];
+    char team_text[24];
+    char name_text[40];
 } dra_flipperAppModel;
 
-/**
- * @brief      Callback for exiting the application.
- * @details    This function is called when user press back button.  We return VIEW_NONE to
- *            indicate that we want to exit the application.
- * @param      _context  The context - unused
- * @return     next view id
-*/
-static uint32_t dra_flipper_navigation_exit_callback(void* _context) {
-    UNUSED(_context);
-    return VIEW_NONE;
-}
+typedef struct {
+    dra_flipperApp* app;
+    char header[32]; // Swept range, formatted on entry
+} dra_flipperWaterfallModel;
 
-/**
- * @brief      Callback for returning to submenu.
- * @details    This function is called when user press back button.  We return VIEW_NONE to
- *            indicate that we want to navigate to the submenu.
- * @param      _context  The context - unused
- * @return     next view id
-*/
-static uint32_t dra_flipper_navigation_submenu_callback(void* _context) {
-    UNUSED(_context);
-    return dra_flipperViewSubmenu;
-}
+static void dra_flipper_model_format_x(dra_flipperAppModel* model);
+static void dra_flipper_model_format_status(dra_flipperAppModel* model, dra_flipperApp* app);
+static void dra_flipper_model_format_team(dra_flipperAppModel* model);
+static void dra_flipper_model_format_name(dra_flipperAppModel* model);
+
+static void dra_flipper_view_alloc(dra_flipperApp* app, dra_flipperView view);
+static void dra_flipper_radio_apply(dra_flipperApp* app, const Dra818Settings* settings);
+static void dra_flipper_switch_to_view(dra_flipperApp* app, dra_flipperView view);
+static void dra_flipper_memory_import(dra_flipperApp* app, const char* csv_path);
+static void dra_flipper_record_toggle(dra_flipperApp* app);
+static void dra_flipper_host_toggle(dra_flipperApp* app);
 
 /**
- * @brief      Callback for returning to configure screen.
- * @details    This function is called when user press back button.  We return VIEW_NONE to
- *            indicate that we want to navigate to the configure screen.
- * @param      _context  The context - unused
- * @return     next view id
+ * @brief      Callback for the BACK button.
+ * @details    This function is called when the user presses back on any of our views.  We switch to
+ *            the parent screen, or return false from the submenu to exit the application.
+ * @param      context  The context - dra_flipperApp object.
+ * @return     true if we navigated, false to exit.
 */
-static uint32_t dra_flipper_navigation_configure_callback(void* _context) {
-    UNUSED(_context);
-    return dra_flipperViewConfigure;
+static bool dra_flipper_navigation_event_callback(void* context) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    switch(app->current_view) {
+    case dra_flipperViewSubmenu:
+        return false;
+    case dra_flipperViewTextInput:
+        dra_flipper_switch_to_view(app, dra_flipperViewConfigure);
+        return true;
+    default:
+        dra_flipper_switch_to_view(app, dra_flipperViewSubmenu);
+        return true;
+    }
 }
 
 /**
@@ -106,13 +224,30 @@ static void dra_flipper_submenu_callback(void* context, uint32_t index) {
     dra_flipperApp* app = (dra_flipperApp*)context;
     switch(index) {
     case dra_flipperSubmenuIndexConfigure:
-        view_dispatcher_switch_to_view(app->view_dispatcher, dra_flipperViewConfigure);
+        dra_flipper_switch_to_view(app, dra_flipperViewConfigure);
         break;
     case dra_flipperSubmenuIndexGame:
-        view_dispatcher_switch_to_view(app->view_dispatcher, dra_flipperViewMain);
+        dra_flipper_switch_to_view(app, dra_flipperViewMain);
         break;
     case dra_flipperSubmenuIndexAbout:
-        view_dispatcher_switch_to_view(app->view_dispatcher, dra_flipperViewAbout);
+        dra_flipper_switch_to_view(app, dra_flipperViewAbout);
+        break;
+#ifdef DRA_STATS
+    case dra_flipperSubmenuIndexDiagnostics:
+        dra_flipper_switch_to_view(app, dra_flipperViewDiagnostics);
+        break;
+#endif
+    case dra_flipperSubmenuIndexImport:
+        dra_flipper_memory_import(app, MEMORIES_CSV);
+        break;
+    case dra_flipperSubmenuIndexWaterfall:
+        dra_flipper_switch_to_view(app, dra_flipperViewWaterfall);
+        break;
+    case dra_flipperSubmenuIndexRecord:
+        dra_flipper_record_toggle(app);
+        break;
+    case dra_flipperSubmenuIndexHost:
+        dra_flipper_host_toggle(app);
         break;
     default:
         break;
@@ -129,8 +264,17 @@ static void dra_flipper_setting_1_change(VariableItem* item) {
     dra_flipperApp* app = variable_item_get_context(item);
     uint8_t index = variable_item_get_current_value_index(item);
     variable_item_set_current_value_text(item, setting_1_names[index]);
-    dra_flipperAppModel* model = view_get_model(app->view_main);
-    model->setting_1_index = index;
+    if(app->view_main) {
+        dra_flipperAppModel* model = view_get_model(app->view_main);
+        model->setting_1_index = index;
+        dra_flipper_model_format_team(model);
+    }
+
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+    settings.pl_mode = index;
+    dra818_settings_set(app->settings, &settings);
+    dra_flipper_radio_apply(app, &settings);
 }
 
 /**
@@ -140,20 +284,354 @@ static void dra_flipper_setting_1_change(VariableItem* item) {
 */
 static const char* setting_2_config_label = "Callsign";
 static const char* setting_2_entry_text = "Enter Callsign";
-static const char* setting_2_default_value = "W1AW";
 static void dra_flipper_setting_2_text_updated(void* context) {
     dra_flipperApp* app = (dra_flipperApp*)context;
-    bool redraw = true;
-    with_view_model(
-        app->view_main,
-        dra_flipperAppModel * model,
-        {
-            furi_string_set(model->setting_2_name, app->temp_buffer);
-            variable_item_set_current_value_text(
-                app->setting_2_item, furi_string_get_cstr(model->setting_2_name));
-        },
-        redraw);
-    view_dispatcher_switch_to_view(app->view_dispatcher, dra_flipperViewConfigure);
+    if(app->view_main) {
+        bool redraw = true;
+        with_view_model(
+            app->view_main,
+            dra_flipperAppModel * model,
+            {
+                furi_string_set(model->setting_2_name, app->temp_buffer);
+                dra_flipper_model_format_name(model);
+            },
+            redraw);
+    }
+    variable_item_set_current_value_text(app->setting_2_item, app->temp_buffer);
+
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+    strlcpy(settings.callsign, app->temp_buffer, sizeof(settings.callsign));
+    dra818_settings_set(app->settings, &settings);
+
+    dra_flipper_switch_to_view(app, dra_flipperViewConfigure);
+}
+
+/**
+ * Our 3rd setting browses the memory bank.  LEFT/RIGHT step through the memories in frequency
+ * order and OK tunes to the one shown.  Only one page of memories is held in RAM; the item always
+ * sits on its middle value so both arrows stay active.
+*/
+static const char* memory_config_label = "Memory";
+
+/**
+ * @brief      Show the current memory on the configuration screen.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_memory_show(dra_flipperApp* app) {
+    if(!app->memory_item) {
+        return;
+    }
+    char text[DRA818_MEM_NAME_MAX];
+    if(app->import_thread) {
+        strlcpy(text, "Importing", sizeof(text));
+    } else if(app->mem_page_count == 0) {
+        strlcpy(text, "None", sizeof(text));
+    } else if(app->mem_page[app->mem_index].name[0]) {
+        strlcpy(text, app->mem_page[app->mem_index].name, sizeof(text));
+    } else {
+        text[dra818_plan_format_freq(text, app->mem_page[app->mem_index].rx_freq)] = '\0';
+    }
+    variable_item_set_current_value_index(app->memory_item, 1);
+    variable_item_set_current_value_text(app->memory_item, text);
+}
+
+/**
+ * @brief      Open the memory bank and load its first page.
+ * @details    Opening only reads the file headers, so this is cheap even for a large bank.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_memory_open(dra_flipperApp* app) {
+    app->mem_page_count = 0;
+    app->mem_index = 0;
+    if(!app->mem && !app->import_thread) {
+        app->mem = dra818_mem_alloc(MEMORIES_DIR);
+    }
+    if(app->mem) {
+        Dra818MemQuery query;
+        dra818_mem_query_all(&query);
+        dra818_mem_find(app->mem, &query, &app->mem_cursor);
+        app->mem_page_count =
+            dra818_mem_page(app->mem, &app->mem_cursor, true, app->mem_page, MEMORY_PAGE_SIZE);
+    }
+    dra_flipper_memory_show(app);
+}
+
+static void dra_flipper_memory_change(VariableItem* item) {
+    dra_flipperApp* app = variable_item_get_context(item);
+    bool forward = variable_item_get_current_value_index(item) > 1;
+    if(forward && app->mem_index + 1 < app->mem_page_count) {
+        app->mem_index++;
+    } else if(!forward && app->mem_index > 0) {
+        app->mem_index--;
+    } else if(app->mem) {
+        // Past the edge of the page: fetch the neighbouring one.
+        size_t count =
+            dra818_mem_page(app->mem, &app->mem_cursor, forward, app->mem_page, MEMORY_PAGE_SIZE);
+        if(count > 0) {
+            app->mem_page_count = count;
+            app->mem_index = forward ? 0 : count - 1;
+        }
+    }
+    dra_flipper_memory_show(app);
+}
+
+/**
+ * @brief      Tune to the memory shown.
+ * @details    The memory's frequencies and tones replace the channel settings, and the PL mode
+ *           follows from which tones it uses.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_memory_apply(dra_flipperApp* app) {
+    if(app->mem_page_count == 0) {
+        return;
+    }
+    const Dra818Memory* memory = &app->mem_page[app->mem_index];
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+    settings.rx_freq = memory->rx_freq;
+    settings.tx_freq = memory->tx_freq;
+    settings.rx_tone = memory->rx_tone;
+    settings.tx_tone = memory->tx_tone;
+    settings.wide = memory->wide;
+    settings.pl_mode = (memory->tx_tone != DRA818_TONE_NONE ? 1 : 0) |
+                       (memory->rx_tone != DRA818_TONE_NONE ? 2 : 0);
+    dra818_settings_set(app->settings, &settings);
+    dra_flipper_radio_apply(app, &settings);
+
+    variable_item_set_current_value_index(app->setting_1_item, settings.pl_mode);
+    variable_item_set_current_value_text(app->setting_1_item, setting_1_names[settings.pl_mode]);
+    if(app->view_main) {
+        dra_flipperAppModel* model = view_get_model(app->view_main);
+        model->setting_1_index = settings.pl_mode;
+        dra_flipper_model_format_team(model);
+    }
+    FURI_LOG_I(TAG, "Tuned to memory %lu", memory->number);
+}
+
+/**
+ * @brief      Thread that imports the memory CSV.
+ * @param      context  The context - dra_flipperApp object.
+ * @return     0
+*/
+static int32_t dra_flipper_memory_import_worker(void* context) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    dra818_mem_import(app->import_csv, MEMORIES_DIR, &app->import_stats);
+    view_dispatcher_send_custom_event(app->view_dispatcher, dra_flipperEventIdImportDone);
+    return 0;
+}
+
+/**
+ * @brief      Start importing a CSV into the memory bank.
+ * @details    A large list takes a while, so the import runs on its own thread.  The bank is
+ *           closed, here and for the host link, until it finishes (dra_flipperEventIdImportDone).
+ * @param      app       The dra_flipper application object.
+ * @param      csv_path  MEMORIES_CSV, or HOST_UPLOAD_CSV.
+*/
+static void dra_flipper_memory_import(dra_flipperApp* app, const char* csv_path) {
+    if(app->import_thread) {
+        return;
+    }
+    if(app->mem) {
+        dra818_mem_free(app->mem);
+        app->mem = NULL;
+    }
+    furi_mutex_acquire(app->host_mutex, FuriWaitForever);
+    if(app->host) {
+        dra818_host_set_bank_busy(app->host, true);
+    }
+    furi_mutex_release(app->host_mutex);
+    app->mem_page_count = 0;
+    app->import_csv = csv_path;
+    app->import_thread = furi_thread_alloc_ex(
+        "DraMemImport", MEMORY_IMPORT_STACK, dra_flipper_memory_import_worker, app);
+    furi_thread_start(app->import_thread);
+    dra_flipper_memory_show(app);
+}
+
+/**
+ * @brief      Start or stop recording received audio.
+ * @details    Each recording is a new WAV file in RECORDINGS_DIR, named after the time it started.
+ *           The recorder keeps only what arrives while the squelch is open (see the squelch
+ *           event), so long sessions hold just the traffic.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_record_toggle(dra_flipperApp* app) {
+    furi_mutex_acquire(app->recorder_mutex, FuriWaitForever);
+    Dra818Rec* recorder = app->recorder;
+    app->recorder = NULL;
+    furi_mutex_release(app->recorder_mutex);
+
+    if(recorder) {
+        dra818_rec_stop(recorder, &app->recorder_stats);
+        submenu_change_item_label(app->submenu, dra_flipperSubmenuIndexRecord, "Record");
+        return;
+    }
+
+    DateTime now;
+    furi_hal_rtc_get_datetime(&now);
+    char path[64];
+    snprintf(
+        path,
+        sizeof(path),
+        RECORDINGS_DIR "/rx_%04u%02u%02u_%02u%02u%02u.wav",
+        now.year,
+        now.month,
+        now.day,
+        now.hour,
+        now.minute,
+        now.second);
+    storage_simply_mkdir(furi_record_open(RECORD_STORAGE), RECORDINGS_DIR);
+    furi_record_close(RECORD_STORAGE);
+
+    furi_mutex_acquire(app->recorder_mutex, FuriWaitForever);
+    app->recorder = dra818_rec_start(
+        path, RECORDING_SAMPLE_RATE, RECORDING_FORMAT, dra818_radio_squelch_open(app->radio));
+    recorder = app->recorder;
+    furi_mutex_release(app->recorder_mutex);
+    if(recorder) {
+        submenu_change_item_label(app->submenu, dra_flipperSubmenuIndexRecord, "Stop recording");
+    } else {
+        FURI_LOG_W(TAG, "Cannot record to %s", path);
+    }
+}
+
+/**
+ * @brief      Tell the host link what the radio is doing.
+ * @details    This function runs on the radio thread after each status change, or on the GUI
+ *           thread when the link starts.  Call it with host_mutex held.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_host_status(dra_flipperApp* app) {
+    if(!app->host) {
+        return;
+    }
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    int16_t rssi = app->squelch_open ? app->rssi : -1;
+    furi_mutex_release(app->redraw_mutex);
+    Dra818HostStatus status = {
+        .init = dra818_radio_init_state(app->radio),
+        .squelch_open = dra818_radio_squelch_open(app->radio),
+        .rssi = rssi,
+        .rx_freq = settings.rx_freq,
+        .tx_freq = settings.tx_freq,
+        .power_duty = 1000,
+    };
+    Dra818PowerStats power_stats;
+    if(dra818_radio_get_power_stats(app->radio, &power_stats)) {
+        status.power_duty = dra818_power_duty(&power_stats);
+    }
+    dra818_host_set_status(app->host, &status);
+}
+
+/**
+ * @brief      Callback for a committed upload on the host link.
+ * @details    This function is called from the host link thread.  The import itself is started on
+ *           the GUI thread (dra_flipperEventIdHostImport), like one started from the menu.
+ * @param      csv_path  The uploaded memories - HOST_UPLOAD_CSV.
+ * @param      context   The context - dra_flipperApp object.
+ * @return     false if an import is already running.
+*/
+static bool dra_flipper_host_import(const char* csv_path, void* context) {
+    UNUSED(csv_path);
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    if(app->import_thread) {
+        return false;
+    }
+    view_dispatcher_send_custom_event(app->view_dispatcher, dra_flipperEventIdHostImport);
+    return true;
+}
+
+/**
+ * @brief      Start or stop the host link.
+ * @details    While it runs a computer can program memories, stream status and talk to the module
+ *           over the second USB serial port (see dra_host.h); the first stays with the CLI.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_host_toggle(dra_flipperApp* app) {
+    furi_mutex_acquire(app->host_mutex, FuriWaitForever);
+    Dra818Host* host = app->host;
+    app->host = NULL;
+    furi_mutex_release(app->host_mutex);
+
+    if(host) {
+        dra818_host_free(host);
+        submenu_change_item_label(app->submenu, dra_flipperSubmenuIndexHost, "Host link");
+        return;
+    }
+
+    Dra818HostConfig config = {
+        .radio = app->radio,
+        .memories_dir = MEMORIES_DIR,
+        .upload_path = HOST_UPLOAD_CSV,
+        .import = dra_flipper_host_import,
+        .context = app,
+    };
+    host = dra818_host_alloc(&config);
+    if(!host) {
+        FURI_LOG_W(TAG, "Host link unavailable");
+        return;
+    }
+    dra818_host_set_bank_busy(host, app->import_thread != NULL);
+    furi_mutex_acquire(app->host_mutex, FuriWaitForever);
+    app->host = host;
+    dra_flipper_host_status(app);
+    furi_mutex_release(app->host_mutex);
+    submenu_change_item_label(app->submenu, dra_flipperSubmenuIndexHost, "Stop host link");
+}
+
+/**
+ * Our 4th setting is power-save receive.  Each value is how long the module sleeps between
+ * listening windows; the longer it sleeps, the longer a transmission waits to be noticed.
+*/
+static const char* power_config_label = "Power save";
+static const uint16_t power_off_values[] = {0, 200, 500, 1000, 2000};
+static const char* power_off_names[] = {"Off", "0.2 s", "0.5 s", "1 s", "2 s"};
+
+/**
+ * @brief      Hand the power-save schedule to the radio.
+ * @details    With power save on the backlight is left to the system again, so an idle Flipper
+ *           can turn it off.
+ * @param      app       The dra_flipper application object.
+ * @param      settings  The settings holding the schedule.
+*/
+static void dra_flipper_power_apply(dra_flipperApp* app, const Dra818Settings* settings) {
+    Dra818PowerConfig config = {
+        .on_ms = settings->power_on_ms,
+        .off_ms = settings->power_off_ms,
+        .settle_ms = DRA818_POWER_SETTLE_MS,
+        .hang_ms = DRA818_POWER_HANG_MS,
+    };
+    dra818_radio_set_power_save(app->radio, &config);
+#ifdef BACKLIGHT_ON
+    notification_message(
+        app->notifications,
+        config.off_ms ? &sequence_display_backlight_enforce_auto :
+                        &sequence_display_backlight_enforce_on);
+#endif
+}
+
+static uint8_t dra_flipper_power_index(const Dra818Settings* settings) {
+    for(uint8_t i = 0; i < COUNT_OF(power_off_values); i++) {
+        if(power_off_values[i] == settings->power_off_ms) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static void dra_flipper_power_change(VariableItem* item) {
+    dra_flipperApp* app = variable_item_get_context(item);
+    uint8_t index = variable_item_get_current_value_index(item);
+    variable_item_set_current_value_text(item, power_off_names[index]);
+
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+    settings.power_off_ms = power_off_values[index];
+    dra818_settings_set(app->settings, &settings);
+    dra_flipper_power_apply(app, &settings);
 }
 
 /**
@@ -169,21 +647,16 @@ static void dra_flipper_setting_item_clicked(void* context, uint32_t index) {
 
     // Our configuration UI has the 2nd item as a text field.
     if(index == 2) {
+        // The text input is freed whenever it is left, so make sure it exists first.
+        dra_flipper_view_alloc(app, dra_flipperViewTextInput);
+
         // Header to display on the text input screen.
         text_input_set_header_text(app->text_input, setting_2_entry_text);
 
         // Copy the current name into the temporary buffer.
-        bool redraw = false;
-        with_view_model(
-            app->view_main,
-            dra_flipperAppModel * model,
-            {
-                strncpy(
-                    app->temp_buffer,
-                    furi_string_get_cstr(model->setting_2_name),
-                    app->temp_buffer_size);
-            },
-            redraw);
+        Dra818Settings settings;
+        dra818_settings_get(app->settings, &settings);
+        strlcpy(app->temp_buffer, settings.callsign, app->temp_buffer_size);
 
         // Configure the text input.  When user enters text and clicks OK, dra_flipper_setting_text_updated be called.
         bool clear_previous_text = false;
@@ -195,18 +668,62 @@ static void dra_flipper_setting_item_clicked(void* context, uint32_t index) {
             app->temp_buffer_size,
             clear_previous_text);
 
-        // Pressing the BACK button will reload the configure screen.
-        view_set_previous_callback(
-            text_input_get_view(app->text_input), dra_flipper_navigation_configure_callback);
+        // Show text input dialog.  Pressing the BACK button will reload the configure screen.
+        dra_flipper_switch_to_view(app, dra_flipperViewTextInput);
+    } else if(index == 3) {
+        dra_flipper_memory_apply(app);
+    }
+}
+
+/**
+ * Formatters for the cached main screen text.  Call the matching one whenever a
+ * backing value in the model changes.
+*/
+static void dra_flipper_model_format_x(dra_flipperAppModel* model) {
+    snprintf(model->x_text, sizeof(model->x_text), "x: %u  OK=play tone", model->x);
+}
 
-        // Show text input dialog.
-        view_dispatcher_switch_to_view(app->view_dispatcher, dra_flipperViewTextInput);
+static void dra_flipper_model_format_status(dra_flipperAppModel* model, dra_flipperApp* app) {
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    bool squelch_open = app->squelch_open;
+    int16_t rssi = app->rssi;
+    furi_mutex_release(app->redraw_mutex);
+    if(!app->radio_ready) {
+        snprintf(
+            model->status_text,
+            sizeof(model->status_text),
+            "radio: %s",
+            dra818_radio_init_state(app->radio) == Dra818InitStateFailed ? "no answer" : "starting");
+    } else if(!squelch_open) {
+        snprintf(model->status_text, sizeof(model->status_text), "radio: idle");
+    } else if(rssi < 0) {
+        snprintf(model->status_text, sizeof(model->status_text), "radio: RX");
+    } else {
+        snprintf(model->status_text, sizeof(model->status_text), "RX rssi: %d", rssi);
     }
 }
 
+static void dra_flipper_model_format_team(dra_flipperAppModel* model) {
+    snprintf(
+        model->team_text,
+        sizeof(model->team_text),
+        "team: %s (%u)",
+        setting_1_names[model->setting_1_index],
+        setting_1_values[model->setting_1_index]);
+}
+
+static void dra_flipper_model_format_name(dra_flipperAppModel* model) {
+    snprintf(
+        model->name_text,
+        sizeof(model->name_text),
+        "name: %s",
+        furi_string_get_cstr(model->setting_2_name));
+}
+
 /**
  * @brief      Callback for drawing the game screen.
  * @details    This function is called when the screen needs to be redrawn, like when the model gets updated.
+ *           All text is preformatted in the model, so this only draws.
  * @param      canvas  The canvas to draw on.
  * @param      model   The model - MyModel object.
 */
@@ -214,25 +731,16 @@ static void dra_flipper_view_main_draw_callback(Canvas* canvas, void* model) {
     dra_flipperAppModel* my_model = (dra_flipperAppModel*)model;
     //canvas_draw_icon(canvas, my_model->x, 20, &I_glyph_1_14x40);
     canvas_draw_str(canvas, 1, 10, "LEFT/RIGHT to change x");
-    FuriString* xstr = furi_string_alloc();
-    furi_string_printf(xstr, "x: %u  OK=play tone", my_model->x);
-    canvas_draw_str(canvas, 44, 24, furi_string_get_cstr(xstr));
-    furi_string_printf(xstr, "random: %u", (uint8_t)(furi_hal_random_get() % 256));
-    canvas_draw_str(canvas, 44, 36, furi_string_get_cstr(xstr));
-    furi_string_printf(
-        xstr,
-        "team: %s (%u)",
-        setting_1_names[my_model->setting_1_index],
-        setting_1_values[my_model->setting_1_index]);
-    canvas_draw_str(canvas, 44, 48, furi_string_get_cstr(xstr));
-    furi_string_printf(xstr, "name: %s", furi_string_get_cstr(my_model->setting_2_name));
-    canvas_draw_str(canvas, 44, 60, furi_string_get_cstr(xstr));
-    furi_string_free(xstr);
+    canvas_draw_str(canvas, 44, 24, my_model->x_text);
+    canvas_draw_str(canvas, 44, 36, my_model->status_text);
+    canvas_draw_str(canvas, 44, 48, my_model->team_text);
+    canvas_draw_str(canvas, 44, 60, my_model->name_text);
 }
 
 /**
  * @brief      Callback for timer elapsed.
- * @details    This function is called when the timer is elapsed.  We use this to queue a redraw event.
+ * @details    This function is called when the coalescing timer is elapsed.  We use this to queue
+ *           the pending redraw event.
  * @param      context  The context - dra_flipperApp object.
 */
 static void dra_flipper_view_main_timer_callback(void* context) {
@@ -240,31 +748,163 @@ static void dra_flipper_view_main_timer_callback(void* context) {
     view_dispatcher_send_custom_event(app->view_dispatcher, dra_flipperEventIdRedrawScreen);
 }
 
+/**
+ * @brief      Ask for the main screen to be redrawn.
+ * @details    This function is called whenever something shown on the main screen changes.  It may
+ *           be called from any thread except an interrupt.  Requests that arrive while a redraw is
+ *           already pending are folded into it, and redraws are spaced at least one frame
+ *           (1/MAIN_VIEW_MAX_FPS) apart.  Nothing happens while the main screen is hidden.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_request_redraw(dra_flipperApp* app) {
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    app->redraws_requested++;
+    bool send_now = false;
+    if(app->redraw_visible && !app->redraw_pending) {
+        app->redraw_pending = true;
+        uint32_t frame = furi_ms_to_ticks(1000 / MAIN_VIEW_MAX_FPS);
+        uint32_t elapsed = furi_get_tick() - app->redraw_last_tick;
+        if(elapsed >= frame) {
+            send_now = true;
+        } else {
+            furi_timer_start(app->timer, frame - elapsed);
+        }
+    }
+    furi_mutex_release(app->redraw_mutex);
+
+    if(send_now) {
+        view_dispatcher_send_custom_event(app->view_dispatcher, dra_flipperEventIdRedrawScreen);
+    }
+}
+
+/**
+ * @brief      Start delivering coalesced redraws to the screen being entered.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_redraw_begin(dra_flipperApp* app) {
+    furi_assert(app->timer == NULL);
+    app->timer = furi_timer_alloc(dra_flipper_view_main_timer_callback, FuriTimerTypeOnce, app);
+
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    app->redraw_visible = true;
+    app->redraw_pending = false;
+    app->redraws_requested = 0;
+    app->redraws_performed = 0;
+    furi_mutex_release(app->redraw_mutex);
+}
+
+/**
+ * @brief      Stop redraws when leaving a screen, and log how many were saved by coalescing.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_redraw_end(dra_flipperApp* app) {
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    app->redraw_visible = false;
+    app->redraw_pending = false;
+    furi_mutex_release(app->redraw_mutex);
+
+    furi_timer_stop(app->timer);
+    furi_timer_free(app->timer);
+    app->timer = NULL;
+
+    FURI_LOG_I(
+        TAG,
+        "Redraws: %lu requested, %lu performed",
+        app->redraws_requested,
+        app->redraws_performed);
+}
+
+/**
+ * @brief      Claim the pending redraw when dra_flipperEventIdRedrawScreen arrives.
+ * @param      app  The dra_flipper application object.
+ * @return     true if a redraw was pending.
+*/
+static bool dra_flipper_redraw_take(dra_flipperApp* app) {
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    bool pending = app->redraw_pending;
+    app->redraw_pending = false;
+    app->redraw_last_tick = furi_get_tick();
+    if(pending) {
+        app->redraws_performed++;
+    }
+    furi_mutex_release(app->redraw_mutex);
+    return pending;
+}
+
+/**
+ * @brief      Callback for the RSSI poll timer.
+ * @details    This function is called periodically while the squelch is open.
+ * @param      context  The context - dra_flipperApp object.
+*/
+static void dra_flipper_rssi_timer_callback(void* context) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    if(app->radio_ready) {
+        dra818_radio_read_rssi(app->radio); // Collapses with a read still waiting
+    }
+}
+
+/**
+ * @brief      Handle a squelch change.
+ * @details    This function runs on the radio thread, or on the GUI thread when the main screen
+ *           opens.  The poll timer lives as long as the app; redraw_mutex keeps the main screen
+ *           from closing between the visibility check and starting it.
+ * @param      app   The dra_flipper application object.
+ * @param      open  true if the squelch opened.
+*/
+static void dra_flipper_squelch_changed(dra_flipperApp* app, bool open) {
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    bool changed = app->main_visible && app->squelch_open != open;
+    if(changed) {
+        app->squelch_open = open;
+        app->rssi = -1;
+        if(open) {
+            furi_timer_start(app->rssi_timer, furi_ms_to_ticks(MAIN_VIEW_RSSI_PERIOD_MS));
+        } else {
+            furi_timer_stop(app->rssi_timer);
+        }
+    }
+    furi_mutex_release(app->redraw_mutex);
+
+    if(changed) {
+        if(open) {
+            dra_flipper_rssi_timer_callback(app);
+        }
+        dra_flipper_request_redraw(app);
+    }
+}
+
 /**
  * @brief      Callback when the user starts the game screen.
- * @details    This function is called when the user enters the game screen.  We start a timer to
- *           redraw the screen periodically (so the random number is refreshed).
+ * @details    This function is called when the user enters the game screen.  Nothing is redrawn on a
+ *           schedule; squelch edges, RSSI changes and input each request a (coalesced) redraw.
  * @param      context  The context - dra_flipperApp object.
 */
 static void dra_flipper_view_main_enter_callback(void* context) {
-    uint32_t period = furi_ms_to_ticks(200);
     dra_flipperApp* app = (dra_flipperApp*)context;
-    furi_assert(app->timer == NULL);
-    app->timer =
-        furi_timer_alloc(dra_flipper_view_main_timer_callback, FuriTimerTypePeriodic, context);
-    furi_timer_start(app->timer, period);
+    dra_flipper_redraw_begin(app);
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    app->main_visible = true;
+    app->squelch_open = false;
+    app->rssi = -1;
+    furi_mutex_release(app->redraw_mutex);
+    dra_flipper_squelch_changed(app, dra818_radio_squelch_open(app->radio));
+    dra_flipper_request_redraw(app);
 }
 
 /**
  * @brief      Callback when the user exits the game screen.
- * @details    This function is called when the user exits the game screen.  We stop the timer.
+ * @details    This function is called when the user exits the game screen.  We stop the timers and
+ *           log how many redraws were saved by coalescing.
  * @param      context  The context - dra_flipperApp object.
 */
 static void dra_flipper_view_main_exit_callback(void* context) {
     dra_flipperApp* app = (dra_flipperApp*)context;
-    furi_timer_stop(app->timer);
-    furi_timer_free(app->timer);
-    app->timer = NULL;
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    app->main_visible = false;
+    app->squelch_open = false;
+    furi_timer_stop(app->rssi_timer);
+    furi_mutex_release(app->redraw_mutex);
+    dra_flipper_redraw_end(app);
 }
 
 /**
@@ -277,27 +917,29 @@ static bool dra_flipper_view_main_custom_event_callback(uint32_t event, void* co
     dra_flipperApp* app = (dra_flipperApp*)context;
     switch(event) {
     case dra_flipperEventIdRedrawScreen:
-        // Redraw screen by passing true to last parameter of with_view_model.
+        // Redraw screen by passing true to last parameter of with_view_model.  The radio status
+        // comes from other threads, so its text is refreshed here on the GUI thread.
         {
-            bool redraw = true;
+            bool redraw = dra_flipper_redraw_take(app);
             with_view_model(
-                app->view_main, dra_flipperAppModel * _model, { UNUSED(_model); }, redraw);
+                app->view_main,
+                dra_flipperAppModel * model,
+                { dra_flipper_model_format_status(model, app); },
+                redraw);
             return true;
         }
     case dra_flipperEventIdOkPressed:
-        // Process the OK button.  We play a tone based on the x coordinate.
-        if(furi_hal_speaker_acquire(500)) {
-            float frequency;
+        // Process the OK button.  We play a tone based on the x coordinate into the module's
+        // audio input.  The tone engine runs in the background, so this returns at once.
+        {
+            uint32_t frequency;
             bool redraw = false;
             with_view_model(
                 app->view_main,
                 dra_flipperAppModel * model,
                 { frequency = model->x * 100 + 100; },
                 redraw);
-            furi_hal_speaker_start(frequency, 1.0);
-            furi_delay_ms(100);
-            furi_hal_speaker_stop();
-            furi_hal_speaker_release();
+            dra818_tone_play_tone(frequency * 10, MAIN_VIEW_TONE_MS, NULL, NULL);
         }
         return true;
     default:
@@ -317,27 +959,31 @@ static bool dra_flipper_view_main_input_callback(InputEvent* event, void* contex
     if(event->type == InputTypeShort) {
         if(event->key == InputKeyLeft) {
             // Left button clicked, reduce x coordinate.
-            bool redraw = true;
+            bool redraw = false;
             with_view_model(
                 app->view_main,
                 dra_flipperAppModel * model,
                 {
                     if(model->x > 0) {
                         model->x--;
+                        dra_flipper_model_format_x(model);
                     }
                 },
                 redraw);
+            dra_flipper_request_redraw(app);
         } else if(event->key == InputKeyRight) {
             // Right button clicked, increase x coordinate.
-            bool redraw = true;
+            bool redraw = false;
             with_view_model(
                 app->view_main,
                 dra_flipperAppModel * model,
                 {
                     // Should we have some maximum value?
                     model->x++;
+                    dra_flipper_model_format_x(model);
                 },
                 redraw);
+            dra_flipper_request_redraw(app);
         }
     } else if(event->type == InputTypePress) {
         if(event->key == InputKeyOk) {
@@ -352,6 +998,685 @@ static bool dra_flipper_view_main_input_callback(InputEvent* event, void* contex
     return false;
 }
 
+/**
+ * @brief      Build the module's channel parameters from the settings.
+ * @param      settings  The settings.
+ * @param      group     The group to fill in.
+*/
+static void dra_flipper_settings_group(const Dra818Settings* settings, Dra818AtGroup* group) {
+    bool pl_tx = settings->pl_mode == 1 || settings->pl_mode == 3;
+    bool pl_rx = settings->pl_mode == 2 || settings->pl_mode == 3;
+    *group = (Dra818AtGroup){
+        .wide = settings->wide,
+        .tx_freq = settings->tx_freq,
+        .rx_freq = settings->rx_freq,
+        .tx_tone = pl_tx ? settings->tx_tone : DRA818_TONE_NONE,
+        .squelch = settings->squelch,
+        .rx_tone = pl_rx ? settings->rx_tone : DRA818_TONE_NONE,
+    };
+}
+
+/**
+ * @brief      Callback for drawing the waterfall screen.
+ * @details    The history is kept rendered as a bitmap ring, so no row is dithered here.  The
+ *           canvas starts blank each frame, so the whole ring is blitted in two pieces: the
+ *           rows from the newest down to the end of the ring, then the rest.
+ * @param      canvas  The canvas to draw on.
+ * @param      model   The model - dra_flipperWaterfallModel object.
+*/
+static void dra_flipper_view_waterfall_draw_callback(Canvas* canvas, void* model) {
+    dra_flipperWaterfallModel* my_model = (dra_flipperWaterfallModel*)model;
+    dra_flipperApp* app = my_model->app;
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_str(canvas, 0, WATERFALL_TOP - 2, my_model->header);
+
+    furi_mutex_acquire(app->waterfall_mutex, FuriWaitForever);
+    if(app->waterfall) {
+        size_t head;
+        size_t rows = dra818_waterfall_rows(app->waterfall);
+        const uint8_t* bitmap = dra818_waterfall_bitmap(app->waterfall, &head);
+        canvas_draw_xbm(
+            canvas,
+            0,
+            WATERFALL_TOP,
+            DRA818_WATERFALL_WIDTH,
+            rows - head,
+            bitmap + head * (DRA818_WATERFALL_WIDTH / 8));
+        if(head > 0) {
+            canvas_draw_xbm(
+                canvas, 0, WATERFALL_TOP + rows - head, DRA818_WATERFALL_WIDTH, head, bitmap);
+        }
+    }
+    furi_mutex_release(app->waterfall_mutex);
+}
+
+/**
+ * @brief      Add a scan sample to the waterfall.
+ * @details    This function runs on the radio thread.  A redraw is requested once per sweep,
+ *           when a row is complete, and is coalesced to MAIN_VIEW_MAX_FPS like the main screen.
+ * @param      app     The dra_flipper application object.
+ * @param      sample  The sample.
+*/
+static void dra_flipper_waterfall_sample(dra_flipperApp* app, const Dra818ScanSample* sample) {
+    uint8_t level = 0;
+    if(sample->active) {
+        level = DRA818_WATERFALL_LEVELS - 1;
+    } else if(sample->has_rssi) {
+        level = dra818_waterfall_level(sample->rssi, WATERFALL_RSSI_FLOOR, WATERFALL_RSSI_CEILING);
+    }
+    furi_mutex_acquire(app->waterfall_mutex, FuriWaitForever);
+    bool row = app->waterfall && dra818_waterfall_put(app->waterfall, sample->channel, level);
+    furi_mutex_release(app->waterfall_mutex);
+    if(row) {
+        dra_flipper_request_redraw(app);
+    }
+}
+
+/**
+ * @brief      Callback when the user enters the waterfall screen.
+ * @details    This function starts a scan of WATERFALL_CHANNELS channels centred on the receive
+ *           frequency (kept inside its band).  The scanner does not park on busy channels, so
+ *           every sweep takes the same time.
+ * @param      context  The context - dra_flipperApp object.
+*/
+static void dra_flipper_view_waterfall_enter_callback(void* context) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+
+    Dra818ScanConfig config;
+    memset(&config, 0, sizeof(config));
+    config.step = settings.wide ? DRA818_STEP_WIDE : DRA818_STEP_NARROW;
+    Dra818Freq span = config.step * (WATERFALL_CHANNELS - 1);
+    Dra818Freq below = config.step * (WATERFALL_CHANNELS / 2);
+    config.start = settings.rx_freq - MIN(settings.rx_freq, below);
+    for(size_t i = 0; i < DRA818_BAND_COUNT; i++) {
+        const Dra818Band* band = &dra818_bands[i];
+        if(settings.rx_freq >= band->min && settings.rx_freq <= band->max) {
+            config.start = CLAMP(config.start, band->max - span, band->min);
+        }
+    }
+    config.stop = config.start + span;
+    dra_flipper_settings_group(&settings, &config.group);
+    config.dwell_ms = WATERFALL_DWELL_MS;
+    config.hang_ms = 0;
+    config.priority = DRA818_SCAN_NO_PRIORITY;
+    config.sample_rssi = true;
+
+    dra_flipperWaterfallModel* model = view_get_model(app->view_waterfall);
+    char start[10];
+    char stop[10];
+    start[dra818_plan_format_freq(start, config.start)] = '\0';
+    stop[dra818_plan_format_freq(stop, config.stop)] = '\0';
+    snprintf(model->header, sizeof(model->header), "%s - %s MHz", start, stop);
+
+    furi_mutex_acquire(app->waterfall_mutex, FuriWaitForever);
+    dra818_waterfall_clear(app->waterfall);
+    furi_mutex_release(app->waterfall_mutex);
+    dra_flipper_redraw_begin(app);
+    dra818_radio_scan_start(app->radio, &config);
+}
+
+/**
+ * @brief      Callback when the user exits the waterfall screen.
+ * @details    This function stops the scan; the radio then returns to the configured channel.
+ * @param      context  The context - dra_flipperApp object.
+*/
+static void dra_flipper_view_waterfall_exit_callback(void* context) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    dra818_radio_scan_stop(app->radio);
+    dra_flipper_redraw_end(app);
+}
+
+/**
+ * @brief      Callback for custom events on the waterfall screen.
+ * @param      event    The event id - dra_flipperEventId value.
+ * @param      context  The context - dra_flipperApp object.
+ * @return     true if the event was handled, false otherwise.
+*/
+static bool dra_flipper_view_waterfall_custom_event_callback(uint32_t event, void* context) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    if(event != dra_flipperEventIdRedrawScreen) {
+        return false;
+    }
+    bool redraw = dra_flipper_redraw_take(app);
+    with_view_model(
+        app->view_waterfall, dra_flipperWaterfallModel * model, { UNUSED(model); }, redraw);
+    return true;
+}
+
+/**
+ * @brief      Callback for radio events.
+ * @details    This function is called from the radio thread.  It only records what changed and asks
+ *           for a redraw, so the radio is never held up by the GUI.  The menu is usable while the
+ *           module is still starting.
+ * @param      event    The event - Dra818RadioEvent object.
+ * @param      context  The context - dra_flipperApp object.
+*/
+static void dra_flipper_radio_event_callback(const Dra818RadioEvent* event, void* context) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    furi_mutex_acquire(app->host_mutex, FuriWaitForever);
+    if(event->type == Dra818RadioEventPass && app->host) {
+        dra818_host_pass_done(app->host, event->value, &event->pass);
+    } else if(event->type != Dra818RadioEventScan) {
+        dra_flipper_host_status(app);
+    }
+    furi_mutex_release(app->host_mutex);
+
+    switch(event->type) {
+    case Dra818RadioEventReady:
+        app->radio_ready = event->value;
+        FURI_LOG_I(
+            TAG,
+            "Radio %s after %lu ms",
+            event->value ? "ready" : "not answering",
+            furi_get_tick() - app->radio_start_tick);
+        if(event->value && !app->bus_calibrated) {
+            dra818_radio_calibrate(app->radio);
+        }
+        dra_flipper_request_redraw(app);
+        break;
+    case Dra818RadioEventSquelch:
+        furi_mutex_acquire(app->recorder_mutex, FuriWaitForever);
+        if(app->recorder) {
+            dra818_rec_set_gate(app->recorder, event->value);
+        }
+        furi_mutex_release(app->recorder_mutex);
+        dra_flipper_squelch_changed(app, event->value);
+        break;
+    case Dra818RadioEventRssi: {
+        furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+        bool changed = app->squelch_open && event->rssi != app->rssi;
+        if(changed) {
+            app->rssi = event->rssi;
+        }
+        furi_mutex_release(app->redraw_mutex);
+        if(changed) {
+            dra_flipper_request_redraw(app);
+        }
+        break;
+    }
+    case Dra818RadioEventApplied:
+        FURI_LOG_D(TAG, "Radio configuration %s", event->value ? "applied" : "rejected");
+        break;
+    case Dra818RadioEventScan:
+        dra_flipper_waterfall_sample(app, &event->sample);
+        break;
+    case Dra818RadioEventCalibrated:
+        if(event->value) {
+            Dra818Settings settings;
+            dra818_settings_get(app->settings, &settings);
+            settings.bus_speed = event->speed;
+            dra818_settings_set(app->settings, &settings);
+            app->bus_calibrated = true;
+        }
+        break;
+    case Dra818RadioEventPass:
+        break;
+    }
+}
+
+/**
+ * @brief      Send the channel settings to the radio.
+ * @details    This function only posts a command, so it returns at once however slow the module is.
+ *           If the user changes settings faster than the module takes them, only the last change
+ *           is sent.
+ * @param      app       The dra_flipper application object.
+ * @param      settings  The settings to apply.
+*/
+static void dra_flipper_radio_apply(dra_flipperApp* app, const Dra818Settings* settings) {
+    Dra818AtGroup group;
+    dra_flipper_settings_group(settings, &group);
+    dra818_radio_set_group(app->radio, &group);
+}
+
+/**
+ * @brief      Start the radio module.
+ * @details    This function starts the radio thread and asks it for the non-blocking reset and init
+ *           sequence.  If the UART is available the module is probed with DMOCONNECT, otherwise we
+ *           fall back to the fixed worst-case boot delay.
+ * @param      app  The dra_flipper application object.
+*/
+static void dra_flipper_radio_start(dra_flipperApp* app) {
+    app->bus = dra818_bus_alloc();
+    app->dra = dra818_alloc(app->bus, 0);
+
+    // The bus speed found on an earlier run is reused; otherwise calibrate once the module is up.
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+    app->bus_calibrated = settings.bus_speed != DRA818_SETTINGS_BUS_SPEED_NONE &&
+                          dra818_bus_set_speed(app->bus, settings.bus_speed);
+
+    Dra818At* at = dra818_at_alloc(FuriHalSerialIdUsart, DRA818_AT_BAUD);
+    app->radio = dra818_radio_alloc(app->dra, at, dra_flipper_radio_event_callback, app);
+    app->radio_ready = false;
+    app->radio_start_tick = furi_get_tick();
+
+    // Staged now, sent by the init sequence once the module answers.
+    dra_flipper_radio_apply(app, &settings);
+    dra818_radio_set_volume(app->radio, settings.volume);
+    dra818_radio_start(app->radio);
+    dra_flipper_power_apply(app, &settings);
+}
+
+#ifdef DRA_STATS
+/**
+ * @brief      Callback for the diagnostics log timer.
+ * @details    This function is called periodically to dump the driver statistics to the log.
+ * @param      context  The context - unused
+*/
+static void dra_flipper_diagnostics_timer_callback(void* context) {
+    UNUSED(context);
+    dra818_stats_log();
+}
+#endif
+
+/**
+ * @brief      Check whether a view is freed when the user leaves it.
+ * @details    Screens that are rarely visited, or whose state is rebuilt on entry anyway, are not
+ *           kept resident.  The submenu, configuration and main screens stay once allocated.
+ * @param      view  The view.
+ * @return     true if the view is transient.
+*/
+static bool dra_flipper_view_is_transient(dra_flipperView view) {
+    return view == dra_flipperViewTextInput || view == dra_flipperViewAbout ||
+           view == dra_flipperViewWaterfall || view == dra_flipperViewDiagnostics;
+}
+
+/**
+ * @brief      Allocate a view if it does not exist yet.
+ * @details    This function builds the view from the current settings and adds it to the view
+ *           dispatcher.  The heap used by each view is logged so the savings can be checked.
+ * @param      app   The dra_flipper application object.
+ * @param      view  The view to allocate.
+*/
+static void dra_flipper_view_alloc(dra_flipperApp* app, dra_flipperView view) {
+    size_t heap_before = memmgr_get_free_heap();
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+
+    switch(view) {
+    case dra_flipperViewTextInput:
+        if(app->text_input) {
+            return;
+        }
+        app->text_input = text_input_alloc();
+        view_dispatcher_add_view(
+            app->view_dispatcher, dra_flipperViewTextInput, text_input_get_view(app->text_input));
+        app->temp_buffer_size = DRA818_SETTINGS_CALLSIGN_MAX;
+        app->temp_buffer = (char*)malloc(app->temp_buffer_size);
+        break;
+    case dra_flipperViewConfigure: {
+        if(app->variable_item_list_config) {
+            return;
+        }
+        app->variable_item_list_config = variable_item_list_alloc();
+        variable_item_list_reset(app->variable_item_list_config);
+        app->setting_1_item = variable_item_list_add(
+            app->variable_item_list_config,
+            setting_1_config_label,
+            COUNT_OF(setting_1_values),
+            dra_flipper_setting_1_change,
+            app);
+        variable_item_set_current_value_index(app->setting_1_item, settings.pl_mode);
+        variable_item_set_current_value_text(
+            app->setting_1_item, setting_1_names[settings.pl_mode]);
+
+        app->setting_2_item = variable_item_list_add(
+            app->variable_item_list_config, setting_2_config_label, 1, NULL, NULL);
+        variable_item_set_current_value_text(app->setting_2_item, settings.callsign);
+        app->memory_item = variable_item_list_add(
+            app->variable_item_list_config,
+            memory_config_label,
+            3,
+            dra_flipper_memory_change,
+            app);
+        dra_flipper_memory_open(app);
+        app->power_item = variable_item_list_add(
+            app->variable_item_list_config,
+            power_config_label,
+            COUNT_OF(power_off_values),
+            dra_flipper_power_change,
+            app);
+        uint8_t power_index = dra_flipper_power_index(&settings);
+        variable_item_set_current_value_index(app->power_item, power_index);
+        variable_item_set_current_value_text(app->power_item, power_off_names[power_index]);
+        variable_item_list_set_enter_callback(
+            app->variable_item_list_config, dra_flipper_setting_item_clicked, app);
+
+        view_dispatcher_add_view(
+            app->view_dispatcher,
+            dra_flipperViewConfigure,
+            variable_item_list_get_view(app->variable_item_list_config));
+        break;
+    }
+    case dra_flipperViewMain: {
+        if(app->view_main) {
+            return;
+        }
+        app->view_main = view_alloc();
+        view_set_draw_callback(app->view_main, dra_flipper_view_main_draw_callback);
+        view_set_input_callback(app->view_main, dra_flipper_view_main_input_callback);
+        view_set_enter_callback(app->view_main, dra_flipper_view_main_enter_callback);
+        view_set_exit_callback(app->view_main, dra_flipper_view_main_exit_callback);
+        view_set_context(app->view_main, app);
+        view_set_custom_callback(app->view_main, dra_flipper_view_main_custom_event_callback);
+        view_allocate_model(app->view_main, ViewModelTypeLockFree, sizeof(dra_flipperAppModel));
+        dra_flipperAppModel* model = view_get_model(app->view_main);
+        model->setting_1_index = settings.pl_mode;
+        model->setting_2_name = furi_string_alloc_set_str(settings.callsign);
+        model->x = 0;
+        dra_flipper_model_format_x(model);
+        dra_flipper_model_format_status(model, app);
+        dra_flipper_model_format_team(model);
+        dra_flipper_model_format_name(model);
+        view_dispatcher_add_view(app->view_dispatcher, dra_flipperViewMain, app->view_main);
+        break;
+    }
+    case dra_flipperViewAbout:
+        if(app->widget_about) {
+            return;
+        }
+        app->widget_about = widget_alloc();
+        widget_add_text_scroll_element(
+            app->widget_about,
+            0,
+            0,
+            128,
+            64,
+            "This is a sample application.\n---\nReplace code and message\nwith your content!\n\nauthor: @codeallnight\nhttps://discord.com/invite/NsjCvqwPAd\nhttps://youtube.com/@MrDerekJamison");
+        view_dispatcher_add_view(
+            app->view_dispatcher, dra_flipperViewAbout, widget_get_view(app->widget_about));
+        break;
+    case dra_flipperViewWaterfall: {
+        if(app->view_waterfall) {
+            return;
+        }
+        furi_mutex_acquire(app->waterfall_mutex, FuriWaitForever);
+        app->waterfall = dra818_waterfall_alloc(WATERFALL_CHANNELS, WATERFALL_ROWS);
+        furi_mutex_release(app->waterfall_mutex);
+        app->view_waterfall = view_alloc();
+        view_set_draw_callback(app->view_waterfall, dra_flipper_view_waterfall_draw_callback);
+        view_set_enter_callback(app->view_waterfall, dra_flipper_view_waterfall_enter_callback);
+        view_set_exit_callback(app->view_waterfall, dra_flipper_view_waterfall_exit_callback);
+        view_set_context(app->view_waterfall, app);
+        view_set_custom_callback(
+            app->view_waterfall, dra_flipper_view_waterfall_custom_event_callback);
+        view_allocate_model(
+            app->view_waterfall, ViewModelTypeLockFree, sizeof(dra_flipperWaterfallModel));
+        dra_flipperWaterfallModel* model = view_get_model(app->view_waterfall);
+        model->app = app;
+        model->header[0] = '\0';
+        view_dispatcher_add_view(
+            app->view_dispatcher, dra_flipperViewWaterfall, app->view_waterfall);
+        break;
+    }
+#ifdef DRA_STATS
+    case dra_flipperViewDiagnostics: {
+        if(app->text_box_diagnostics) {
+            return;
+        }
+        // Snapshot the counters on entry; the text box does not refresh itself.
+        app->diagnostics_text = furi_string_alloc();
+        dra818_stats_format(app->diagnostics_text);
+        furi_string_cat_printf(
+            app->diagnostics_text,
+            "redraws %lu/%lu\n",
+            app->redraws_performed,
+            app->redraws_requested);
+        Dra818SettingsStats settings_stats;
+        dra818_settings_get_stats(app->settings, &settings_stats);
+        furi_string_cat_printf(
+            app->diagnostics_text,
+            "settings load %lu ms, %lu writes/%lu changes\n",
+            settings_stats.load_ms,
+            settings_stats.writes,
+            settings_stats.changes);
+        Dra818RadioMetrics radio_metrics;
+        dra818_radio_get_metrics(app->radio, &radio_metrics);
+        furi_string_cat_printf(
+            app->diagnostics_text,
+            "radio cmds %lu (%lu merged), queue max %lu, lat max %lu ms\n",
+            radio_metrics.posted,
+            radio_metrics.coalesced,
+            radio_metrics.queue_depth_max,
+            radio_metrics.latency_max_ms);
+        Dra818BusStats bus_stats;
+        dra818_bus_get_stats(app->bus, &bus_stats);
+        furi_string_cat_printf(
+            app->diagnostics_text,
+            "bus %lu kHz, %lu errors, %lu fallbacks\n",
+            dra818_port_bus_hz(dra818_bus_get_speed(app->bus)) / 1000,
+            bus_stats.errors,
+            bus_stats.fallbacks);
+        Dra818PowerStats power_stats;
+        if(dra818_radio_get_power_stats(app->radio, &power_stats)) {
+            Dra818Settings settings;
+            dra818_settings_get(app->settings, &settings);
+            Dra818PowerConfig power_config = {
+                .on_ms = settings.power_on_ms,
+                .off_ms = settings.power_off_ms,
+                .settle_ms = DRA818_POWER_SETTLE_MS,
+            };
+            Dra818PowerModel power_model = {
+                .rx_ua = DRA818_POWER_RX_UA,
+                .sleep_ua = DRA818_POWER_SLEEP_UA,
+                .burst_ms = 1000,
+            };
+            Dra818PowerEstimate estimate;
+            dra818_power_estimate(&power_config, &power_model, &estimate);
+            uint16_t duty = dra818_power_duty(&power_stats);
+            furi_string_cat_printf(
+                app->diagnostics_text,
+                "power duty %u.%u%%, %lu windows, %lu wakes (%lu late)\n"
+                " idle est %lu uA, latency %lu/%lu ms, 1 s miss %u.%u%%\n",
+                duty / 10,
+                duty % 10,
+                power_stats.windows,
+                power_stats.wakes,
+                power_stats.late,
+                estimate.current_ua,
+                estimate.latency_mean_ms,
+                estimate.latency_max_ms,
+                estimate.miss_permille / 10,
+                estimate.miss_permille % 10);
+        }
+        Dra818RecStats recorder_stats = app->recorder_stats;
+        if(app->recorder) {
+            dra818_rec_get_stats(app->recorder, &recorder_stats);
+        }
+        furi_string_cat_printf(
+            app->diagnostics_text,
+            "rec %lu smp, %lu gated, %lu dropped, %lu adc ovr\n"
+            " buffers max %lu/%d, write max %lu ms, %lu err\n",
+            recorder_stats.samples,
+            recorder_stats.gated,
+            recorder_stats.dropped,
+            recorder_stats.adc_overruns,
+            recorder_stats.buffers_max,
+            DRA818_REC_BUFFERS,
+            recorder_stats.write_max_ms,
+            recorder_stats.write_errors);
+        furi_mutex_acquire(app->host_mutex, FuriWaitForever);
+        if(app->host) {
+            Dra818HostStats host_stats;
+            dra818_host_get_stats(app->host, &host_stats);
+            furi_string_cat_printf(
+                app->diagnostics_text,
+                "host %lu frames, %lu crc err, %lu in %lu xfers\n"
+                " batch max %lu, %lu tx timeouts, %lu dropped\n",
+                host_stats.parser.frames,
+                host_stats.parser.crc_errors,
+                host_stats.responses,
+                host_stats.transfers,
+                host_stats.batch_max,
+                host_stats.tx_timeouts,
+                host_stats.dropped);
+        }
+        furi_mutex_release(app->host_mutex);
+        app->text_box_diagnostics = text_box_alloc();
+        text_box_set_font(app->text_box_diagnostics, TextBoxFontText);
+        text_box_set_text(app->text_box_diagnostics, furi_string_get_cstr(app->diagnostics_text));
+        view_dispatcher_add_view(
+            app->view_dispatcher,
+            dra_flipperViewDiagnostics,
+            text_box_get_view(app->text_box_diagnostics));
+        break;
+    }
+#endif
+    default:
+        return;
+    }
+
+    FURI_LOG_D(
+        TAG, "View %d allocated, %d bytes", view, (int)(heap_before - memmgr_get_free_heap()));
+}
+
+/**
+ * @brief      Free a view if it exists.
+ * @details    This function removes the view from the view dispatcher and frees it.  It must not be
+ *           called for the view that is showing.
+ * @param      app   The dra_flipper application object.
+ * @param      view  The view to free.
+*/
+static void dra_flipper_view_free(dra_flipperApp* app, dra_flipperView view) {
+    size_t heap_before = memmgr_get_free_heap();
+
+    switch(view) {
+    case dra_flipperViewTextInput:
+        if(!app->text_input) {
+            return;
+        }
+        view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewTextInput);
+        text_input_free(app->text_input);
+        app->text_input = NULL;
+        free(app->temp_buffer);
+        app->temp_buffer = NULL;
+        break;
+    case dra_flipperViewConfigure:
+        if(!app->variable_item_list_config) {
+            return;
+        }
+        view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewConfigure);
+        variable_item_list_free(app->variable_item_list_config);
+        app->variable_item_list_config = NULL;
+        app->setting_1_item = NULL;
+        app->setting_2_item = NULL;
+        app->memory_item = NULL;
+        app->power_item = NULL;
+        break;
+    case dra_flipperViewMain: {
+        if(!app->view_main) {
+            return;
+        }
+        view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewMain);
+        dra_flipperAppModel* model = view_get_model(app->view_main);
+        furi_string_free(model->setting_2_name);
+        view_free(app->view_main);
+        app->view_main = NULL;
+        break;
+    }
+    case dra_flipperViewAbout:
+        if(!app->widget_about) {
+            return;
+        }
+        view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewAbout);
+        widget_free(app->widget_about);
+        app->widget_about = NULL;
+        break;
+    case dra_flipperViewWaterfall:
+        if(!app->view_waterfall) {
+            return;
+        }
+        view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewWaterfall);
+        view_free(app->view_waterfall);
+        app->view_waterfall = NULL;
+        furi_mutex_acquire(app->waterfall_mutex, FuriWaitForever);
+        dra818_waterfall_free(app->waterfall);
+        app->waterfall = NULL;
+        furi_mutex_release(app->waterfall_mutex);
+        break;
+#ifdef DRA_STATS
+    case dra_flipperViewDiagnostics:
+        if(!app->text_box_diagnostics) {
+            return;
+        }
+        view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewDiagnostics);
+        text_box_free(app->text_box_diagnostics);
+        app->text_box_diagnostics = NULL;
+        furi_string_free(app->diagnostics_text);
+        app->diagnostics_text = NULL;
+        break;
+#endif
+    default:
+        return;
+    }
+
+    FURI_LOG_D(
+        TAG, "View %d freed, %d bytes", view, (int)(memmgr_get_free_heap() - heap_before));
+}
+
+/**
+ * @brief      Switch to a view, allocating it first if needed.
+ * @details    Leaving a transient view queues dra_flipperEventIdReleaseViews instead of freeing it
+ *           here: we are usually inside that view's input handling, and the view dispatcher may
+ *           still deliver the matching key release to it.
+ * @param      app   The dra_flipper application object.
+ * @param      view  The view to show.
+*/
+static void dra_flipper_switch_to_view(dra_flipperApp* app, dra_flipperView view) {
+    dra_flipperView previous = app->current_view;
+    dra_flipper_view_alloc(app, view);
+    app->current_view = view;
+    view_dispatcher_switch_to_view(app->view_dispatcher, view);
+    if(previous != view && dra_flipper_view_is_transient(previous)) {
+        view_dispatcher_send_custom_event(app->view_dispatcher, dra_flipperEventIdReleaseViews);
+    }
+}
+
+/**
+ * @brief      Callback for custom events not handled by the current view.
+ * @details    This function frees the transient views the user has left.
+ * @param      context  The context - dra_flipperApp object.
+ * @param      event    The event id - dra_flipperEventId value.
+ * @return     true if the event was handled, false otherwise.
+*/
+static bool dra_flipper_custom_event_callback(void* context, uint32_t event) {
+    dra_flipperApp* app = (dra_flipperApp*)context;
+    if(event == dra_flipperEventIdImportDone) {
+        furi_thread_join(app->import_thread);
+        furi_thread_free(app->import_thread);
+        app->import_thread = NULL;
+        FURI_LOG_I(
+            TAG,
+            "Imported %lu memories (%lu skipped) in %lu ms",
+            app->import_stats.imported,
+            app->import_stats.skipped,
+            app->import_stats.duration_ms);
+        furi_mutex_acquire(app->host_mutex, FuriWaitForever);
+        if(app->host) {
+            dra818_host_set_bank_busy(app->host, false);
+        }
+        furi_mutex_release(app->host_mutex);
+        dra_flipper_memory_open(app);
+        return true;
+    }
+    if(event == dra_flipperEventIdHostImport) {
+        dra_flipper_memory_import(app, HOST_UPLOAD_CSV);
+        return true;
+    }
+    if(event != dra_flipperEventIdReleaseViews) {
+        return false;
+    }
+    for(dra_flipperView view = dra_flipperViewSubmenu; view <= dra_flipperViewDiagnostics;
+        view++) {
+        if(view != app->current_view && dra_flipper_view_is_transient(view)) {
+            dra_flipper_view_free(app, view);
+        }
+    }
+    return true;
+}
+
 /**
  * @brief      Allocate the dra_flipper application.
  * @details    This function allocates the dra_flipper application resources.
@@ -359,12 +1684,23 @@ static bool dra_flipper_view_main_input_callback(InputEvent* event, void* contex
 */
 static dra_flipperApp* dra_flipper_app_alloc() {
     dra_flipperApp* app = (dra_flipperApp*)malloc(sizeof(dra_flipperApp));
+    app->redraw_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    app->rssi_timer =
+        furi_timer_alloc(dra_flipper_rssi_timer_callback, FuriTimerTypePeriodic, app);
+    app->waterfall_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    app->recorder_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    app->host_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    app->settings = dra818_settings_alloc(SETTINGS_PATH);
 
     Gui* gui = furi_record_open(RECORD_GUI);
 
     app->view_dispatcher = view_dispatcher_alloc();
     view_dispatcher_attach_to_gui(app->view_dispatcher, gui, ViewDispatcherTypeFullscreen);
     view_dispatcher_set_event_callback_context(app->view_dispatcher, app);
+    view_dispatcher_set_navigation_event_callback(
+        app->view_dispatcher, dra_flipper_navigation_event_callback);
+    view_dispatcher_set_custom_event_callback(
+        app->view_dispatcher, dra_flipper_custom_event_callback);
 
     app->submenu = submenu_alloc();
     submenu_add_item(
@@ -375,76 +1711,45 @@ static dra_flipperApp* dra_flipper_app_alloc() {
         app);
     submenu_add_item(
         app->submenu, "Play", dra_flipperSubmenuIndexGame, dra_flipper_submenu_callback, app);
+    submenu_add_item(
+        app->submenu,
+        "Waterfall",
+        dra_flipperSubmenuIndexWaterfall,
+        dra_flipper_submenu_callback,
+        app);
     submenu_add_item(
         app->submenu, "About", dra_flipperSubmenuIndexAbout, dra_flipper_submenu_callback, app);
-    view_set_previous_callback(
-        submenu_get_view(app->submenu), dra_flipper_navigation_exit_callback);
+    submenu_add_item(
+        app->submenu,
+        "Import memories",
+        dra_flipperSubmenuIndexImport,
+        dra_flipper_submenu_callback,
+        app);
+    submenu_add_item(
+        app->submenu, "Record", dra_flipperSubmenuIndexRecord, dra_flipper_submenu_callback, app);
+    submenu_add_item(
+        app->submenu,
+        "Host link",
+        dra_flipperSubmenuIndexHost,
+        dra_flipper_submenu_callback,
+        app);
+#ifdef DRA_STATS
+    submenu_add_item(
+        app->submenu,
+        "Diagnostics",
+        dra_flipperSubmenuIndexDiagnostics,
+        dra_flipper_submenu_callback,
+        app);
+#endif
     view_dispatcher_add_view(
         app->view_dispatcher, dra_flipperViewSubmenu, submenu_get_view(app->submenu));
-    view_dispatcher_switch_to_view(app->view_dispatcher, dra_flipperViewSubmenu);
+    dra_flipper_switch_to_view(app, dra_flipperViewSubmenu);
 
-    app->text_input = text_input_alloc();
-    view_dispatcher_add_view(
-        app->view_dispatcher, dra_flipperViewTextInput, text_input_get_view(app->text_input));
-    app->temp_buffer_size = 32;
-    app->temp_buffer = (char*)malloc(app->temp_buffer_size);
-
-    app->variable_item_list_config = variable_item_list_alloc();
-    variable_item_list_reset(app->variable_item_list_config);
-    VariableItem* item = variable_item_list_add(
-        app->variable_item_list_config,
-        setting_1_config_label,
-        COUNT_OF(setting_1_values),
-        dra_flipper_setting_1_change,
-        app);
-    uint8_t setting_1_index = 0;
-    variable_item_set_current_value_index(item, setting_1_index);
-    variable_item_set_current_value_text(item, setting_1_names[setting_1_index]);
-
-    FuriString* setting_2_name = furi_string_alloc();
-    furi_string_set_str(setting_2_name, setting_2_default_value);
-    app->setting_2_item = variable_item_list_add(
-        app->variable_item_list_config, setting_2_config_label, 1, NULL, NULL);
-    variable_item_set_current_value_text(
-        app->setting_2_item, furi_string_get_cstr(setting_2_name));
-    variable_item_list_set_enter_callback(
-        app->variable_item_list_config, dra_flipper_setting_item_clicked, app);
-
-    view_set_previous_callback(
-        variable_item_list_get_view(app->variable_item_list_config),
-        dra_flipper_navigation_submenu_callback);
-    view_dispatcher_add_view(
-        app->view_dispatcher,
-        dra_flipperViewConfigure,
-        variable_item_list_get_view(app->variable_item_list_config));
-
-    app->view_main = view_alloc();
-    view_set_draw_callback(app->view_main, dra_flipper_view_main_draw_callback);
-    view_set_input_callback(app->view_main, dra_flipper_view_main_input_callback);
-    view_set_previous_callback(app->view_main, dra_flipper_navigation_submenu_callback);
-    view_set_enter_callback(app->view_main, dra_flipper_view_main_enter_callback);
-    view_set_exit_callback(app->view_main, dra_flipper_view_main_exit_callback);
-    view_set_context(app->view_main, app);
-    view_set_custom_callback(app->view_main, dra_flipper_view_main_custom_event_callback);
-    view_allocate_model(app->view_main, ViewModelTypeLockFree, sizeof(dra_flipperAppModel));
-    dra_flipperAppModel* model = view_get_model(app->view_main);
-    model->setting_1_index = setting_1_index;
-    model->setting_2_name = setting_2_name;
-    model->x = 0;
-    view_dispatcher_add_view(app->view_dispatcher, dra_flipperViewMain, app->view_main);
-
-    app->widget_about = widget_alloc();
-    widget_add_text_scroll_element(
-        app->widget_about,
-        0,
-        0,
-        128,
-        64,
-        "This is a sample application.\n---\nReplace code and message\nwith your content!\n\nauthor: @codeallnight\nhttps://discord.com/invite/NsjCvqwPAd\nhttps://youtube.com/@MrDerekJamison");
-    view_set_previous_callback(
-        widget_get_view(app->widget_about), dra_flipper_navigation_submenu_callback);
-    view_dispatcher_add_view(
-        app->view_dispatcher, dra_flipperViewAbout, widget_get_view(app->widget_about));
+#ifdef DRA_STATS
+    app->diagnostics_timer =
+        furi_timer_alloc(dra_flipper_diagnostics_timer_callback, FuriTimerTypePeriodic, app);
+    furi_timer_start(app->diagnostics_timer, furi_ms_to_ticks(DIAGNOSTICS_LOG_PERIOD_MS));
+#endif
 
     app->notifications = furi_record_open(RECORD_NOTIFICATION);
 
@@ -452,6 +1757,8 @@ static dra_flipperApp* dra_flipper_app_alloc() {
     notification_message(app->notifications, &sequence_display_backlight_enforce_on);
 #endif
 
+    dra_flipper_radio_start(app);
+
     return app;
 }
 
@@ -461,24 +1768,70 @@ static dra_flipperApp* dra_flipper_app_alloc() {
  * @param      app  The dra_flipper application object.
 */
 static void dra_flipper_app_free(dra_flipperApp* app) {
+#ifdef DRA_STATS
+    furi_timer_stop(app->diagnostics_timer);
+    furi_timer_free(app->diagnostics_timer);
+    dra818_stats_log();
+#endif
+    dra818_tone_stop();
+    furi_mutex_acquire(app->recorder_mutex, FuriWaitForever);
+    Dra818Rec* recorder = app->recorder;
+    app->recorder = NULL;
+    furi_mutex_release(app->recorder_mutex);
+    if(recorder) {
+        dra818_rec_stop(recorder, NULL);
+    }
+    // The host link posts to the radio, so it stops first.
+    furi_mutex_acquire(app->host_mutex, FuriWaitForever);
+    Dra818Host* host = app->host;
+    app->host = NULL;
+    furi_mutex_release(app->host_mutex);
+    if(host) {
+        dra818_host_free(host);
+    }
+    if(app->import_thread) {
+        furi_thread_join(app->import_thread); // An import cannot be cut short
+        furi_thread_free(app->import_thread);
+    }
+    if(app->mem) {
+        dra818_mem_free(app->mem);
+    }
+    // With the main screen marked hidden the radio thread no longer starts the RSSI poll.
+    furi_mutex_acquire(app->redraw_mutex, FuriWaitForever);
+    app->main_visible = false;
+    furi_timer_stop(app->rssi_timer);
+    furi_mutex_release(app->redraw_mutex);
+    dra818_radio_free(app->radio);
+    furi_timer_free(app->rssi_timer);
+
+    // Keep a speed the bus had to fall back from, so the next run starts there.
+    Dra818Settings settings;
+    dra818_settings_get(app->settings, &settings);
+    if(app->bus_calibrated && dra818_bus_get_speed(app->bus) < settings.bus_speed) {
+        settings.bus_speed = dra818_bus_get_speed(app->bus);
+        dra818_settings_set(app->settings, &settings);
+    }
+    dra818_free(app->dra);
+    dra818_bus_free(app->bus);
+
 #ifdef BACKLIGHT_ON
     notification_message(app->notifications, &sequence_display_backlight_enforce_auto);
 #endif
     furi_record_close(RECORD_NOTIFICATION);
 
-    view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewTextInput);
-    text_input_free(app->text_input);
-    free(app->temp_buffer);
-    view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewAbout);
-    widget_free(app->widget_about);
-    view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewMain);
-    view_free(app->view_main);
-    view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewConfigure);
-    variable_item_list_free(app->variable_item_list_config);
+    for(dra_flipperView view = dra_flipperViewTextInput; view <= dra_flipperViewDiagnostics;
+        view++) {
+        dra_flipper_view_free(app, view);
+    }
     view_dispatcher_remove_view(app->view_dispatcher, dra_flipperViewSubmenu);
     submenu_free(app->submenu);
     view_dispatcher_free(app->view_dispatcher);
     furi_record_close(RECORD_GUI);
+    furi_mutex_free(app->redraw_mutex);
+    furi_mutex_free(app->waterfall_mutex);
+    furi_mutex_free(app->recorder_mutex);
+    furi_mutex_free(app->host_mutex);
+    dra818_settings_free(app->settings);
 
     free(app);
 }
@@ -493,9 +1846,21 @@ static void dra_flipper_app_free(dra_flipperApp* app) {
 int32_t main_dra_flipper_app(void* _p) {
     UNUSED(_p);
 
+    size_t heap_start = memmgr_get_free_heap();
+    uint32_t start_tick = furi_get_tick();
     dra_flipperApp* app = dra_flipper_app_alloc();
+    // The first frame (the submenu) is drawn as soon as the dispatcher runs.
+    FURI_LOG_I(
+        TAG,
+        "Startup: %lu ms to first frame, %d bytes of heap",
+        furi_get_tick() - start_tick,
+        (int)(heap_start - memmgr_get_free_heap()));
     view_dispatcher_run(app->view_dispatcher);
 
     dra_flipper_app_free(app);
+    FURI_LOG_I(
+        TAG,
+        "Exit: peak %d bytes of heap",
+        (int)(heap_start - memmgr_get_minimum_free_heap()));
     return 0;
 }
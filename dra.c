@@ -4,110 +4,888 @@
  -- Tyler H. Jones - inquirewue@gmail.com
 */
 
-#include <flipper.h>
 #include <furi.h>
-#include <gpio.h>
-#include <spi.h>
+#include <string.h>
+#include "dra.h"
+#include "dra_port.h"
+#include "dra_ring.h"
+#include "dra_stats.h"
 
-#define DRA818_CS_PIN  GPIO_PIN_0 // Chip Select pin for DRA818
-#define DRA818_RST_PIN GPIO_PIN_1 // Reset pin for DRA818
-#define DRA818_INT_PIN GPIO_PIN_2 // Interrupt pin for DRA818 (if applicable)
+#define TAG "Dra818"
 
-#define SPI_SPEED 1000000 // SPI speed (1 MHz for example)
+#define SPI_TIMEOUT 100 // HAL timeout for one blocking transfer (ms)
 
-SPI_HandleTypeDef hspi1; // SPI handler
+#define DRA818_RX_RING_SIZE 256 // Received bytes buffered for the consumer (power of two)
+#define DRA818_RX_DRAIN_MAX 32 // Bytes read per INT before the bus is handed on
 
-void dra818_spi_init() {
-    // SPI configuration structure
-    hspi1.Instance = SPI1;
-    hspi1.Init.Mode = SPI_MODE_MASTER;
-    hspi1.Init.Direction = SPI_DIRECTION_2LINES;
-    hspi1.Init.DataSize = SPI_DATASIZE_8BIT;
-    hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
-    hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
-    hspi1.Init.NSS = SPI_NSS_SOFT;
-    hspi1.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16;
-    hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
-    hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
-    hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
-    hspi1.Init.CRCPolynomial = 10;
+struct Dra818Bus {
+    FuriSemaphore* lock; // Held for every frame, and by a DMA transfer until it completes
+    Dra818* devices[DRA818_PORT_SLOTS];
+    Dra818* volatile dma_owner; // Module whose DMA transfer is in flight (if any)
+    volatile bool dma_receive; // That transfer reads the receive register, not tx_buf
+    uint8_t speed; // Clock step (see dra_port.h)
+    uint8_t error_run; // Failed frames in a row
+    volatile bool slow_down; // Set by the error counter; applied on the next acquire
+    bool calibrating; // dra818_calibrate() is stepping the clock; no fallback
+    Dra818BusStats stats;
+};
 
-    if(HAL_SPI_Init(&hspi1) != HAL_OK) {
-        FURI_LOG(FURI_LOG_ERROR, "SPI Init failed!");
+struct Dra818 {
+    Dra818Bus* bus;
+    uint8_t slot;
+
+    // Frame buffers: address byte + up to two bytes per register.
+    uint8_t tx_buf[DRA818_BURST_MAX * 2 + 1];
+    uint8_t rx_buf[DRA818_BURST_MAX * 2 + 1];
+
+    // State of this module's DMA transfer.
+    uint8_t* dma_dest;
+    size_t dma_count;
+    Dra818TransferCallback dma_callback;
+    void* dma_context;
+    uint8_t dma_reg;
+
+    // Interrupt-driven receive path.  Reads go over DMA with their own frame buffers,
+    // so no interrupt handler waits for the SPI.
+    uint8_t rx_storage[DRA818_RX_RING_SIZE];
+    Dra818Ring rx_ring;
+    uint8_t rx_frame_tx[2];
+    uint8_t rx_frame_rx[2];
+    size_t rx_chain; // Bytes read since INT was answered
+    volatile bool rx_enabled;
+    volatile bool rx_deferred; // INT fired while the bus was held
+    Dra818RxCallback rx_callback;
+    void* rx_context;
+
+    // Squelch change notification.
+    Dra818SquelchCallback squelch_callback;
+    void* squelch_context;
+
+    // Shadow copy of the module registers.  A set bit in valid means the shadow
+    // value is known; in dirty it means it is staged but not yet sent.
+    uint8_t shadow[DRA818_REG_COUNT];
+    uint32_t valid;
+    uint32_t dirty;
+
+    // Non-blocking init sequence.  init_mutex serialises the timer and probe
+    // callbacks against dra818_init_cancel().
+    FuriMutex* init_mutex;
+    FuriTimer* init_timer;
+    volatile Dra818InitState init_current;
+    Dra818InitConfig init_config;
+    Dra818ReadyCallback init_callback;
+    void* init_context;
+    uint32_t init_probe_start;
+#ifdef DRA_STATS
+    uint32_t init_started;
+#endif
+};
+
+// The port reports DMA completion and pin interrupts without a context.
+static Dra818Bus* dra818_port_bus = NULL;
+
+// Default register image written by dra818_init_configure(), starting at register 0x00.
+static const uint8_t dra818_defaults[] = {
+    0x57, // 0x00: frequency registers according to datasheet (example: 433 MHz)
+    0x80, // 0x01: mode (transmit/receive, etc.)
+    0x02, // 0x02: modulation configuration
+    0x0F, // 0x03: power level
+    0x00, // 0x04: filters, squelch, etc.
+};
+
+static bool dra818_rx_receive(Dra818* dra);
+
+Dra818Bus* dra818_bus_alloc() {
+    furi_check(dra818_port_bus == NULL); // The port drives a single SPI bus
+    Dra818Bus* bus = malloc(sizeof(Dra818Bus));
+    memset(bus, 0, sizeof(Dra818Bus));
+    bus->lock = furi_semaphore_alloc(1, 1);
+    bus->speed = DRA818_PORT_SPEED_DEFAULT;
+    dra818_port_bus_init();
+    dra818_port_bus = bus;
+    return bus;
+}
+
+void dra818_bus_free(Dra818Bus* bus) {
+    for(size_t i = 0; i < DRA818_PORT_SLOTS; i++) {
+        furi_check(bus->devices[i] == NULL);
+    }
+    dra818_port_bus = NULL;
+    furi_semaphore_free(bus->lock);
+    free(bus);
+}
+
+void dra818_bus_get_stats(Dra818Bus* bus, Dra818BusStats* stats) {
+    *stats = bus->stats;
+}
+
+// Take the bus for one frame.  Threads wait for a frame or DMA transfer of another
+// module to finish; interrupt handlers never wait.
+static bool dra818_bus_acquire(Dra818Bus* bus) {
+    if(furi_semaphore_acquire(bus->lock, 0) != FuriStatusOk) {
+        bus->stats.contended++;
+        uint32_t timeout = FURI_IS_IRQ_MODE() ? 0 : furi_ms_to_ticks(DRA818_BUS_WAIT_MS);
+        if(timeout == 0 || furi_semaphore_acquire(bus->lock, timeout) != FuriStatusOk) {
+            bus->stats.timeouts++;
+            return false;
+        }
+    }
+    bus->stats.transfers++;
+    if(bus->slow_down && !FURI_IS_IRQ_MODE()) {
+        bus->slow_down = false;
+        if(bus->speed > 0) {
+            bus->speed--;
+            bus->stats.fallbacks++;
+            dra818_port_bus_set_speed(bus->speed);
+            FURI_LOG_W(TAG, "Bus errors, down to %lu Hz", dra818_port_bus_hz(bus->speed));
+        }
+    }
+    return true;
+}
+
+// Count a frame's outcome; too many failures in a row ask for a slower clock.
+static void dra818_bus_account(Dra818Bus* bus, bool ok) {
+    if(ok) {
+        bus->error_run = 0;
+        return;
+    }
+    bus->stats.errors++;
+    if(!bus->calibrating && ++bus->error_run >= DRA818_BUS_FALLBACK_ERRORS) {
+        bus->error_run = 0;
+        bus->slow_down = true;
+    }
+}
+
+static bool dra818_bus_deferred(Dra818Bus* bus) {
+    for(size_t i = 0; i < DRA818_PORT_SLOTS; i++) {
+        Dra818* dra = bus->devices[i];
+        if(dra && dra->rx_deferred) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Hand the bus to a module whose INT fired meanwhile, or let it go.  An INT can
+// still land between the last check and the release; look again once the bus is
+// free and, unless another frame took it (its release hands it on), go round again.
+// Starting a receive does not wait for the SPI, so any context may release.
+static void dra818_bus_release(Dra818Bus* bus) {
+    do {
+        for(size_t i = 0; i < DRA818_PORT_SLOTS; i++) {
+            Dra818* dra = bus->devices[i];
+            if(dra && dra->rx_deferred) {
+                dra->rx_deferred = false;
+                if(dra818_rx_receive(dra)) {
+                    return; // Its last completion releases the bus
+                }
+            }
+        }
+        furi_semaphore_release(bus->lock);
+    } while(dra818_bus_deferred(bus) && furi_semaphore_acquire(bus->lock, 0) == FuriStatusOk);
+}
+
+bool dra818_bus_set_speed(Dra818Bus* bus, uint8_t speed) {
+    if(speed >= DRA818_PORT_SPEEDS || !dra818_bus_acquire(bus)) {
+        return false;
+    }
+    bool ok = dra818_port_bus_set_speed(speed);
+    if(ok) {
+        bus->speed = speed;
+        bus->error_run = 0;
+        bus->slow_down = false;
+    }
+    dra818_bus_release(bus);
+    return ok;
+}
+
+uint8_t dra818_bus_get_speed(Dra818Bus* bus) {
+    return bus->speed;
+}
+
+// CS only moves with the bus held, so one module's frame never interleaves another's.
+static void dra818_select(Dra818* dra) {
+    dra818_port_pin_write(dra->slot, Dra818PinCs, 0); // Set CS low to select DRA818
+}
+
+static void dra818_deselect(Dra818* dra) {
+    dra818_port_pin_write(dra->slot, Dra818PinCs, 1); // Set CS high to deselect DRA818
+}
+
+Dra818* dra818_alloc(Dra818Bus* bus, uint8_t slot) {
+    if(slot >= DRA818_PORT_SLOTS || bus->devices[slot]) {
+        return NULL;
+    }
+    Dra818* dra = malloc(sizeof(Dra818));
+    memset(dra, 0, sizeof(Dra818));
+    dra->bus = bus;
+    dra->slot = slot;
+    dra->init_current = Dra818InitStateIdle;
+    dra->init_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    dra818_ring_init(&dra->rx_ring, dra->rx_storage, DRA818_RX_RING_SIZE);
+
+    // Configure GPIO pins for DRA818.  CS idles high so other modules can use the bus.
+    dra818_port_pin_mode(slot, Dra818PinCs, Dra818PinModeOutput);
+    dra818_deselect(dra);
+    dra818_port_pin_mode(slot, Dra818PinRst, Dra818PinModeOutput);
+    dra818_port_pin_mode(slot, Dra818PinInt, Dra818PinModeInput);
+    dra818_port_pin_mode(slot, Dra818PinSq, Dra818PinModeInput);
+    dra818_port_pin_mode(slot, Dra818PinPd, Dra818PinModeOutput);
+    dra818_sleep(dra, false);
+
+    FURI_CRITICAL_ENTER();
+    bus->devices[slot] = dra;
+    FURI_CRITICAL_EXIT();
+    return dra;
+}
+
+void dra818_free(Dra818* dra) {
+    Dra818Bus* bus = dra->bus;
+    dra818_init_cancel(dra);
+    dra818_rx_stop(dra);
+    dra818_squelch_set_callback(dra, NULL, NULL);
+    while(bus->dma_owner == dra) {
+        furi_delay_tick(1);
+    }
+    FURI_CRITICAL_ENTER();
+    bus->devices[dra->slot] = NULL;
+    FURI_CRITICAL_EXIT();
+    furi_mutex_free(dra->init_mutex);
+    free(dra);
+}
+
+void dra818_sleep(Dra818* dra, bool sleep) {
+    dra818_port_pin_write(dra->slot, Dra818PinPd, sleep ? 0 : 1); // PD low powers the module down
+}
+
+bool dra818_squelch_open(Dra818* dra) {
+    return !dra818_port_pin_read(dra->slot, Dra818PinSq);
+}
+
+void dra818_squelch_set_callback(Dra818* dra, Dra818SquelchCallback callback, void* context) {
+    dra->squelch_callback = NULL;
+    dra->squelch_context = context;
+    if(callback) {
+        dra818_port_pin_mode(dra->slot, Dra818PinSq, Dra818PinModeIrqBoth);
+        dra->squelch_callback = callback;
+    } else {
+        dra818_port_pin_mode(dra->slot, Dra818PinSq, Dra818PinModeInput);
+    }
+}
+
+// Move one whole frame from tx_buf with CS held low for its full length.
+static bool dra818_transfer(Dra818* dra, size_t size) {
+    if(dra818_dma_busy(dra) || !dra818_bus_acquire(dra->bus)) {
+        return false;
+    }
+    dra818_select(dra);
+    bool ok = dra818_port_spi_transfer(dra->tx_buf, dra->rx_buf, size, SPI_TIMEOUT);
+    dra818_deselect(dra);
+    dra818_bus_account(dra->bus, ok);
+    dra818_bus_release(dra->bus);
+    return ok;
+}
+
+// Record registers that now hold a known value on the module.
+static void dra818_shadow_store(Dra818* dra, uint8_t reg, const uint8_t* values, size_t count) {
+    for(size_t i = 0; i < count && reg + i < DRA818_REG_COUNT; i++) {
+        dra->shadow[reg + i] = values[i];
+        dra->valid |= 1UL << (reg + i);
+        dra->dirty &= ~(1UL << (reg + i));
+    }
+}
+
+static bool dra818_transfer_dma(
+    Dra818* dra,
+    uint8_t reg,
+    size_t size,
+    uint8_t* dest,
+    size_t count,
+    Dra818TransferCallback callback,
+    void* context) {
+    Dra818Bus* bus = dra->bus;
+    if(dra818_dma_busy(dra) || !dra818_bus_acquire(bus)) {
+        return false;
+    }
+    dra->dma_reg = reg & DRA818_REG_MASK;
+    dra->dma_dest = dest;
+    dra->dma_count = count;
+    dra->dma_callback = callback;
+    dra->dma_context = context;
+    bus->dma_owner = dra;
+
+    dra818_select(dra);
+    if(!dra818_port_spi_transfer_dma(dra->tx_buf, dra->rx_buf, size)) {
+        dra818_deselect(dra);
+        bus->dma_owner = NULL;
+        dra818_bus_release(bus);
+        return false;
+    }
+    return true;
+}
+
+static void dra818_rx_complete(Dra818* dra, bool success);
+
+static void dra818_dma_complete(Dra818* dra, bool success) {
+    if(dra->bus->dma_receive) {
+        dra818_rx_complete(dra, success);
+        return;
+    }
+    dra818_deselect(dra);
+    if(success && dra->dma_dest) {
+        memcpy(dra->dma_dest, &dra->rx_buf[1], dra->dma_count);
+        dra818_shadow_store(dra, dra->dma_reg, &dra->rx_buf[1], dra->dma_count);
+    } else if(success) {
+        dra818_shadow_store(dra, dra->dma_reg, &dra->tx_buf[1], dra->dma_count);
+    }
+    Dra818TransferCallback callback = dra->dma_callback;
+    void* context = dra->dma_context;
+    dra818_bus_account(dra->bus, success);
+    dra->bus->dma_owner = NULL;
+    dra818_bus_release(dra->bus);
+    if(callback) {
+        callback(success, context);
+    }
+}
+
+// Called by the port from the SPI DMA interrupt.
+void dra818_port_dma_done(bool success) {
+    Dra818Bus* bus = dra818_port_bus;
+    if(bus && bus->dma_owner) {
+        dra818_dma_complete(bus->dma_owner, success);
+    }
+}
+
+bool dra818_dma_busy(Dra818* dra) {
+    return dra->bus->dma_owner == dra && !dra->bus->dma_receive;
+}
+
+// Build a burst frame: flagged start address followed by consecutive register values.
+// Reads also carry DRA818_REG_READ, so their dummy bytes are not taken as data.
+static size_t
+    dra818_frame_burst_write(Dra818* dra, uint8_t reg, const uint8_t* values, size_t count) {
+    dra->tx_buf[0] = (reg & DRA818_REG_MASK) | DRA818_REG_BURST;
+    memcpy(&dra->tx_buf[1], values, count);
+    return count + 1;
+}
+
+static size_t dra818_frame_burst_read(Dra818* dra, uint8_t reg, size_t count) {
+    dra->tx_buf[0] = (reg & DRA818_REG_MASK) | DRA818_REG_BURST | DRA818_REG_READ;
+    memset(&dra->tx_buf[1], 0x00, count);
+    return count + 1;
+}
+
+bool dra818_write_burst(Dra818* dra, uint8_t reg, const uint8_t* values, size_t count) {
+    if(count == 0 || count > DRA818_BURST_MAX || dra818_dma_busy(dra)) {
+        return false;
+    }
+    DRA818_STATS_BEGIN(start);
+    bool ok = dra818_transfer(dra, dra818_frame_burst_write(dra, reg, values, count));
+    DRA818_STATS_END(start, Dra818StatBurst, ok);
+    if(!ok) {
+        return false;
+    }
+    dra818_shadow_store(dra, reg, values, count);
+    return true;
+}
+
+bool dra818_write_list(Dra818* dra, const Dra818RegValue* list, size_t count) {
+    if(count == 0 || count > DRA818_BURST_MAX || dra818_dma_busy(dra)) {
+        return false;
+    }
+    // Unflagged address/value pairs are accepted back to back within one chip-select.
+    for(size_t i = 0; i < count; i++) {
+        dra->tx_buf[i * 2] = list[i].reg & DRA818_REG_MASK;
+        dra->tx_buf[i * 2 + 1] = list[i].value;
+    }
+    DRA818_STATS_BEGIN(start);
+    bool ok = dra818_transfer(dra, count * 2);
+    DRA818_STATS_END(start, Dra818StatBurst, ok);
+    if(!ok) {
+        return false;
+    }
+    for(size_t i = 0; i < count; i++) {
+        dra818_shadow_store(dra, list[i].reg & DRA818_REG_MASK, &list[i].value, 1);
+    }
+    return true;
+}
+
+bool dra818_read_burst(Dra818* dra, uint8_t reg, uint8_t* values, size_t count) {
+    if(count == 0 || count > DRA818_BURST_MAX || dra818_dma_busy(dra)) {
+        return false;
+    }
+    DRA818_STATS_BEGIN(start);
+    bool ok = dra818_transfer(dra, dra818_frame_burst_read(dra, reg, count));
+    DRA818_STATS_END(start, Dra818StatBurst, ok);
+    if(!ok) {
+        return false;
+    }
+    memcpy(values, &dra->rx_buf[1], count);
+    dra818_shadow_store(dra, reg, values, count);
+    return true;
+}
+
+bool dra818_write_burst_dma(
+    Dra818* dra,
+    uint8_t reg,
+    const uint8_t* values,
+    size_t count,
+    Dra818TransferCallback callback,
+    void* context) {
+    if(count == 0 || count > DRA818_BURST_MAX || dra818_dma_busy(dra)) {
+        return false;
+    }
+    size_t size = dra818_frame_burst_write(dra, reg, values, count);
+    return dra818_transfer_dma(dra, reg, size, NULL, count, callback, context);
+}
+
+bool dra818_read_burst_dma(
+    Dra818* dra,
+    uint8_t reg,
+    uint8_t* values,
+    size_t count,
+    Dra818TransferCallback callback,
+    void* context) {
+    if(count == 0 || count > DRA818_BURST_MAX || dra818_dma_busy(dra)) {
+        return false;
+    }
+    size_t size = dra818_frame_burst_read(dra, reg, count);
+    return dra818_transfer_dma(dra, reg, size, values, count, callback, context);
+}
+
+static bool dra818_is_cached(Dra818* dra, uint8_t reg) {
+    return reg < DRA818_REG_COUNT && (dra->valid & (1UL << reg));
+}
+
+void dra818_write(Dra818* dra, uint8_t reg, uint8_t value) {
+    if(dra818_is_cached(dra, reg) && !(dra->dirty & (1UL << reg)) && dra->shadow[reg] == value) {
+        return; // Module already holds this value
+    }
+    dra->tx_buf[0] = reg & DRA818_REG_MASK; // Register address
+    dra->tx_buf[1] = value; // Value to write to the register
+    DRA818_STATS_BEGIN(start);
+    bool ok = dra818_transfer(dra, 2);
+    DRA818_STATS_END(start, Dra818StatWrite, ok);
+    if(ok) {
+        dra818_shadow_store(dra, reg, &value, 1);
+    }
+}
+
+uint8_t dra818_read(Dra818* dra, uint8_t reg) {
+    if(dra818_is_cached(dra, reg)) {
+        return dra->shadow[reg];
+    }
+    dra->tx_buf[0] = (reg & DRA818_REG_MASK) | DRA818_REG_READ; // Register address
+    dra->tx_buf[1] = 0x00; // Clock out the data from the register
+    DRA818_STATS_BEGIN(start);
+    bool ok = dra818_transfer(dra, 2);
+    DRA818_STATS_END(start, Dra818StatRead, ok);
+    if(!ok) {
+        return 0;
+    }
+    dra818_shadow_store(dra, reg, &dra->rx_buf[1], 1);
+    return dra->rx_buf[1];
+}
+
+void dra818_set(Dra818* dra, uint8_t reg, uint8_t value) {
+    furi_check(reg < DRA818_REG_COUNT);
+    if(dra818_is_cached(dra, reg) && dra->shadow[reg] == value) {
+        return; // Staged or applied already
+    }
+    dra->shadow[reg] = value;
+    dra->valid |= 1UL << reg;
+    dra->dirty |= 1UL << reg;
+}
+
+bool dra818_commit(Dra818* dra) {
+    if(!dra->dirty) {
+        return true;
+    }
+
+    uint8_t first = __builtin_ctz(dra->dirty);
+    uint8_t last = 31 - __builtin_clz(dra->dirty);
+    size_t span = last - first + 1;
+    size_t changed = __builtin_popcount(dra->dirty);
+
+    // One burst over the dirty range costs 1 + span bytes (clean registers in
+    // between are rewritten with their cached value); address/value pairs cost
+    // two bytes per changed register.  Pick whichever frame is shorter.
+    uint32_t span_mask = ((1UL << span) - 1) << first;
+    if((dra->valid & span_mask) == span_mask && span + 1 <= changed * 2) {
+        return dra818_write_burst(dra, first, &dra->shadow[first], span);
+    }
+
+    Dra818RegValue list[DRA818_REG_COUNT];
+    size_t count = 0;
+    for(uint8_t reg = first; reg <= last; reg++) {
+        if(dra->dirty & (1UL << reg)) {
+            list[count].reg = reg;
+            list[count].value = dra->shadow[reg];
+            count++;
+        }
+    }
+    return dra818_write_list(dra, list, count);
+}
+
+bool dra818_is_dirty(Dra818* dra) {
+    return dra->dirty != 0;
+}
+
+void dra818_invalidate(Dra818* dra) {
+    dra->valid = 0;
+    dra->dirty = 0;
+}
+
+bool dra818_resync(Dra818* dra) {
+    uint8_t values[DRA818_REG_COUNT];
+    dra818_invalidate(dra);
+    return dra818_read_burst(dra, 0x00, values, DRA818_REG_COUNT);
+}
+
+static void dra818_configure(Dra818* dra) {
+    // Frequency, mode, modulation, power and filter registers, sent as one burst.
+    for(size_t i = 0; i < COUNT_OF(dra818_defaults); i++) {
+        dra818_set(dra, i, dra818_defaults[i]);
+    }
+    dra818_commit(dra);
+}
+
+// Runs on the timer or AT worker thread with init_mutex held, so it leaves the
+// bus alone: the owner's thread configures the module in dra818_init_configure().
+static void dra818_init_finish(Dra818* dra, bool ready) {
+    dra->init_current = ready ? Dra818InitStateConfigure : Dra818InitStateFailed;
+    if(!ready) {
+        // Init only fails when the probe runs out of time.
+        DRA818_STATS_END_EX(dra->init_started, Dra818StatInit, false, true);
+    }
+    if(dra->init_callback) {
+        dra->init_callback(ready, dra->init_context);
+    }
+}
+
+static void
+    dra818_init_probe_callback(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(response);
+    Dra818* dra = context;
+    furi_mutex_acquire(dra->init_mutex, FuriWaitForever);
+    if(dra->init_current != Dra818InitStateProbe) {
+        // Cancelled meanwhile
+    } else if(result == Dra818AtResultOk) {
+        dra818_init_finish(dra, true);
+    } else if(furi_get_tick() - dra->init_probe_start >=
+              furi_ms_to_ticks(dra->init_config.probe_timeout_ms)) {
+        dra818_init_finish(dra, false);
+    } else {
+        // Not up yet (or still echoing boot noise); ask again on the next tick.
+        furi_timer_start(dra->init_timer, 1);
     }
+    furi_mutex_release(dra->init_mutex);
+}
 
-    // Configure GPIO pins for DRA818
-    gpio_init(DRA818_CS_PIN, GPIO_MODE_OUTPUT);
-    gpio_init(DRA818_RST_PIN, GPIO_MODE_OUTPUT);
-    gpio_init(DRA818_INT_PIN, GPIO_MODE_INPUT);
+static void dra818_init_probe(Dra818* dra) {
+    if(!dra818_at_submit(
+           dra->init_config.probe,
+           "AT+DMOCONNECT",
+           "+DMOCONNECT",
+           dra->init_config.probe_interval_ms,
+           dra818_init_probe_callback,
+           dra)) {
+        furi_timer_start(dra->init_timer, furi_ms_to_ticks(dra->init_config.probe_interval_ms));
+    }
 }
 
-void dra818_select() {
-    gpio_set(DRA818_CS_PIN, 0); // Set CS low to select DRA818
+static void dra818_init_timer_callback(void* context) {
+    Dra818* dra = context;
+    furi_mutex_acquire(dra->init_mutex, FuriWaitForever);
+    switch(dra->init_current) {
+    case Dra818InitStateReset:
+        dra818_port_pin_write(dra->slot, Dra818PinRst, 1); // Release reset (high)
+        if(dra->init_config.probe) {
+            dra->init_current = Dra818InitStateProbe;
+            dra->init_probe_start = furi_get_tick();
+            dra818_init_probe(dra);
+        } else {
+            dra->init_current = Dra818InitStateBoot;
+            furi_timer_start(dra->init_timer, furi_ms_to_ticks(dra->init_config.boot_ms));
+        }
+        break;
+    case Dra818InitStateBoot:
+        dra818_init_finish(dra, true);
+        break;
+    case Dra818InitStateProbe:
+        dra818_init_probe(dra);
+        break;
+    default:
+        break;
+    }
+    furi_mutex_release(dra->init_mutex);
 }
 
-void dra818_deselect() {
-    gpio_set(DRA818_CS_PIN, 1); // Set CS high to deselect DRA818
+bool dra818_init_async(
+    Dra818* dra,
+    const Dra818InitConfig* config,
+    Dra818ReadyCallback callback,
+    void* context) {
+    if(dra->init_current == Dra818InitStateReset || dra->init_current == Dra818InitStateBoot ||
+       dra->init_current == Dra818InitStateProbe ||
+       dra->init_current == Dra818InitStateConfigure) {
+        return false;
+    }
+    if(!dra->init_timer) {
+        dra->init_timer = furi_timer_alloc(dra818_init_timer_callback, FuriTimerTypeOnce, dra);
+    }
+    dra->init_config = *config;
+    dra->init_callback = callback;
+    dra->init_context = context;
+
+    dra818_invalidate(dra); // The module returns to its power-on defaults
+#ifdef DRA_STATS
+    dra->init_started = dra818_stats_now();
+#endif
+    dra->init_current = Dra818InitStateReset;
+    dra818_port_pin_write(dra->slot, Dra818PinRst, 0); // Reset DRA818 (low)
+    furi_timer_start(dra->init_timer, furi_ms_to_ticks(config->reset_ms));
+    return true;
 }
 
-void dra818_reset() {
-    gpio_set(DRA818_RST_PIN, 0); // Reset DRA818 (low)
-    furi_delay_ms(100); // Wait for reset to complete
-    gpio_set(DRA818_RST_PIN, 1); // Release reset (high)
-    furi_delay_ms(100);
+void dra818_init_cancel(Dra818* dra) {
+    furi_mutex_acquire(dra->init_mutex, FuriWaitForever);
+    Dra818At* probe = dra->init_current == Dra818InitStateProbe ? dra->init_config.probe : NULL;
+    dra->init_current = Dra818InitStateIdle;
+    furi_mutex_release(dra->init_mutex);
+    if(probe) {
+        // Drop the DMOCONNECT in flight; its callback must not outlive the timer.
+        dra818_at_cancel(probe, dra);
+    }
+    if(dra->init_timer) {
+        furi_timer_stop(dra->init_timer);
+        furi_timer_free(dra->init_timer);
+        dra->init_timer = NULL;
+    }
 }
 
-uint8_t dra818_send(uint8_t data) {
-    uint8_t received_data;
-    HAL_SPI_TransmitReceive(&hspi1, &data, &received_data, 1, 100);
-    return received_data;
+bool dra818_init_configure(Dra818* dra) {
+    if(dra->init_current != Dra818InitStateConfigure) {
+        return false; // Cancelled since the callback ran
+    }
+    dra818_configure(dra);
+    if(dra->init_config.probe) {
+        // The module forgot its channel; the owner's next commit resends everything.
+        dra818_at_invalidate(dra->init_config.probe);
+    }
+    furi_mutex_acquire(dra->init_mutex, FuriWaitForever);
+    bool ready = dra->init_current == Dra818InitStateConfigure;
+    if(ready) {
+        dra->init_current = Dra818InitStateReady;
+        DRA818_STATS_END_EX(dra->init_started, Dra818StatInit, true, false);
+    }
+    furi_mutex_release(dra->init_mutex);
+    return ready;
 }
 
-void dra818_write(uint8_t reg, uint8_t value) {
-    dra818_select();
-    dra818_send(reg); // Send the register address
-    dra818_send(value); // Send the value to write to the register
-    dra818_deselect();
+Dra818InitState dra818_init_state(Dra818* dra) {
+    return dra->init_current;
 }
 
-uint8_t dra818_read(uint8_t reg) {
-    dra818_select();
-    dra818_send(reg); // Send the register address
-    uint8_t data = dra818_send(0x00); // Read the data from the register
-    dra818_deselect();
-    return data;
+// The configuration registers dra818_configure() writes are the ones safe to write back.
+#define DRA818_CAL_REGS COUNT_OF(dra818_defaults)
+
+// One verification pass at the current speed: read, write back, read again.
+static bool dra818_calibrate_pass(Dra818Bus* bus, uint8_t reference[][DRA818_REG_COUNT]) {
+    uint8_t values[DRA818_REG_COUNT];
+    for(size_t i = 0; i < DRA818_PORT_SLOTS; i++) {
+        Dra818* dra = bus->devices[i];
+        if(!dra) {
+            continue;
+        }
+        if(!dra818_read_burst(dra, 0x00, values, DRA818_CAL_REGS) ||
+           memcmp(values, reference[i], DRA818_CAL_REGS) != 0 ||
+           !dra818_write_burst(dra, 0x00, reference[i], DRA818_CAL_REGS) ||
+           !dra818_read_burst(dra, 0x00, values, DRA818_CAL_REGS) ||
+           memcmp(values, reference[i], DRA818_CAL_REGS) != 0) {
+            return false;
+        }
+    }
+    return true;
 }
 
-void dra818_init() {
-    dra818_reset(); // Perform hardware reset
+bool dra818_calibrate(Dra818* dra, uint8_t* speed) {
+    Dra818Bus* bus = dra->bus;
+    uint8_t reference[DRA818_PORT_SLOTS][DRA818_REG_COUNT];
+    uint8_t check[DRA818_REG_COUNT];
 
-    // Set default frequency (example: 433 MHz)
-    dra818_write(0x00, 0x57); // Set frequency registers according to datasheet
+    // The reference image is whatever the modules hold, read twice at the default speed.
+    if(!dra818_bus_set_speed(bus, DRA818_PORT_SPEED_DEFAULT)) {
+        return false;
+    }
+    for(size_t i = 0; i < DRA818_PORT_SLOTS; i++) {
+        Dra818* device = bus->devices[i];
+        if(device && (!dra818_read_burst(device, 0x00, reference[i], DRA818_CAL_REGS) ||
+                      !dra818_read_burst(device, 0x00, check, DRA818_CAL_REGS) ||
+                      memcmp(reference[i], check, DRA818_CAL_REGS) != 0)) {
+            FURI_LOG_E(TAG, "Calibration: no stable readback at the default speed");
+            return false;
+        }
+    }
 
-    // Set mode (transmit/receive, etc.)
-    dra818_write(0x01, 0x80); // Example register for setting mode (check datasheet)
+    // Failures while probing are expected: keep them out of the counters and
+    // away from the runtime fallback.
+    Dra818BusStats stats = bus->stats;
+    bus->calibrating = true;
+    uint8_t best = DRA818_PORT_SPEED_DEFAULT;
+    for(uint8_t step = best + 1; step < DRA818_PORT_SPEEDS; step++) {
+        bool ok = dra818_bus_set_speed(bus, step);
+        for(size_t round = 0; ok && round < DRA818_CAL_ROUNDS; round++) {
+            ok = dra818_calibrate_pass(bus, reference);
+        }
+        if(!ok) {
+            break;
+        }
+        best = step;
+    }
 
-    // Set modulation, power, etc.
-    dra818_write(0x02, 0x02); // Example modulation configuration
+    // Back to the last good step; a failed step may have left a module with a bad
+    // register, so put the reference image back.
+    dra818_bus_set_speed(bus, best);
+    bus->calibrating = false;
+    bus->stats = stats;
+    for(size_t i = 0; i < DRA818_PORT_SLOTS; i++) {
+        if(bus->devices[i]) {
+            dra818_write_burst(bus->devices[i], 0x00, reference[i], DRA818_CAL_REGS);
+        }
+    }
+    FURI_LOG_I(TAG, "Calibrated bus to %lu Hz", dra818_port_bus_hz(best));
+    *speed = best;
+    return true;
+}
 
-    // Set power level
-    dra818_write(0x03, 0x0F); // Example power setting
+void dra818_transmit(Dra818* dra, uint8_t data) {
+    dra->tx_buf[0] = 0x00; // Transmit register address
+    dra->tx_buf[1] = data; // Transmit the data
+    dra818_transfer(dra, 2);
+}
 
-    // Enable or disable other features like filters, squelch, etc.
-    dra818_write(0x04, 0x00); // Example filter setting
+uint8_t dra818_receive(Dra818* dra) {
+    dra->tx_buf[0] = 0x01 | DRA818_REG_READ; // Receive register address
+    dra->tx_buf[1] = 0x00; // Read received data
+    if(!dra818_transfer(dra, 2)) {
+        return 0;
+    }
+    return dra->rx_buf[1];
+}
+
+// One read of the receive register over DMA, with the bus held.
+static bool dra818_rx_frame(Dra818* dra) {
+    Dra818Bus* bus = dra->bus;
+    dra->rx_frame_tx[0] = 0x01 | DRA818_REG_READ; // Receive register address
+    dra->rx_frame_tx[1] = 0x00; // Clock out the data
+    bus->dma_receive = true;
+    bus->dma_owner = dra;
+    dra818_select(dra);
+    if(!dra818_port_spi_transfer_dma(dra->rx_frame_tx, dra->rx_frame_rx, 2)) {
+        dra818_deselect(dra);
+        bus->dma_owner = NULL;
+        bus->dma_receive = false;
+        return false;
+    }
+    return true;
+}
+
+// Answer INT with the bus held: false (and the bus still ours) if there is nothing to read.
+static bool dra818_rx_receive(Dra818* dra) {
+    if(!dra->rx_enabled || dra818_port_pin_read(dra->slot, Dra818PinInt)) {
+        return false;
+    }
+    dra->rx_chain = 0;
+    return dra818_rx_frame(dra);
+}
+
+// DMA completion of a receive frame: push the byte and read on while INT stays low,
+// up to DRA818_RX_DRAIN_MAX bytes; dra818_rx_read() asks for the rest.
+static void dra818_rx_complete(Dra818* dra, bool success) {
+    Dra818Bus* bus = dra->bus;
+    dra818_deselect(dra);
+    dra818_bus_account(bus, success);
+    if(success) {
+        dra818_ring_push(&dra->rx_ring, dra->rx_frame_rx[1]);
+        dra->rx_chain++;
+    }
+    if(success && dra->rx_enabled && dra->rx_chain < DRA818_RX_DRAIN_MAX &&
+       !dra818_port_pin_read(dra->slot, Dra818PinInt) && dra818_rx_frame(dra)) {
+        return;
+    }
+    size_t received = dra->rx_chain;
+    Dra818RxCallback callback = dra->rx_callback;
+    bus->dma_owner = NULL;
+    bus->dma_receive = false;
+    dra818_bus_release(bus);
+    if(received && callback) {
+        callback(dra->rx_context);
+    }
+}
+
+// Called by the port from the EXTI interrupt.
+void dra818_port_pin_irq(uint8_t slot, Dra818Pin pin) {
+    Dra818Bus* bus = dra818_port_bus;
+    Dra818* dra = bus && slot < DRA818_PORT_SLOTS ? bus->devices[slot] : NULL;
+    if(!dra) {
+        return;
+    }
+    if(pin == Dra818PinSq) {
+        Dra818SquelchCallback callback = dra->squelch_callback;
+        if(callback) {
+            callback(dra818_squelch_open(dra), dra->squelch_context);
+        }
+        return;
+    }
+    if(pin != Dra818PinInt || !dra->rx_enabled) {
+        return;
+    }
+    // Only starts a DMA read; the bytes reach the ring from its completion.
+    if(furi_semaphore_acquire(bus->lock, 0) != FuriStatusOk) {
+        dra->rx_deferred = true; // Whoever holds the bus hands it over when it lets go
+        return;
+    }
+    if(!dra818_rx_receive(dra)) {
+        dra818_bus_release(bus);
+    }
+}
+
+void dra818_rx_start(Dra818* dra, Dra818RxCallback callback, void* context) {
+    dra818_ring_init(&dra->rx_ring, dra->rx_storage, DRA818_RX_RING_SIZE);
+    dra->rx_callback = callback;
+    dra->rx_context = context;
+    dra->rx_deferred = false;
+    dra->rx_enabled = true;
+    dra818_port_pin_mode(dra->slot, Dra818PinInt, Dra818PinModeIrqFalling); // INT is active low
+}
+
+void dra818_rx_stop(Dra818* dra) {
+    dra818_port_pin_mode(dra->slot, Dra818PinInt, Dra818PinModeInput);
+    dra->rx_enabled = false;
+    dra->rx_callback = NULL;
+}
+
+size_t dra818_rx_read(Dra818* dra, uint8_t* data, size_t size) {
+    // One INT reads at most DRA818_RX_DRAIN_MAX bytes and INT stays low after
+    // that, so no further edge comes: start on the rest here.  It arrives with the
+    // next callback.  If a frame holds the bus, its release starts it instead.
+    if(dra->rx_enabled && !dra818_port_pin_read(dra->slot, Dra818PinInt)) {
+        if(furi_semaphore_acquire(dra->bus->lock, 0) == FuriStatusOk) {
+            if(!dra818_rx_receive(dra)) {
+                dra818_bus_release(dra->bus);
+            }
+        } else {
+            dra->rx_deferred = true;
+        }
+    }
+    return dra818_ring_pop(&dra->rx_ring, data, size);
 }
 
-void dra818_transmit(uint8_t data) {
-    dra818_select();
-    dra818_send(0x00); // Send the transmit register address
-    dra818_send(data); // Transmit the data
-    dra818_deselect();
+size_t dra818_rx_available(Dra818* dra) {
+    return dra818_ring_count(&dra->rx_ring);
 }
 
-uint8_t dra818_receive() {
-    dra818_select();
-    dra818_send(0x01); // Send the receive register address
-    uint8_t data = dra818_send(0x00); // Read received data
-    dra818_deselect();
-    return data;
+uint32_t dra818_rx_overflows(Dra818* dra) {
+    return dra818_ring_overflows(&dra->rx_ring);
 }
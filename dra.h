@@ -2,4 +2,204 @@
  -- dra.h
  -- DRA818V/U Library for Flipper Zero
  -- Tyler H. Jones - inquirewue@gmail.com
-*/
\ No newline at end of file
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_at.h"
+
+#define DRA818_BURST_MAX 32 // Largest register payload moved in one chip-select cycle
+#define DRA818_REG_BURST 0x80 // Set on the address byte to auto-increment the register
+#define DRA818_REG_READ  0x40 // Set on the address byte to read; clear, the frame writes
+#define DRA818_REG_MASK  0x3F // Register number part of the address byte
+#define DRA818_REG_COUNT 16 // Registers mirrored by the driver's shadow cache
+
+#define DRA818_RESET_MS          100 // Time RST is held low
+#define DRA818_BOOT_MS           100 // Worst-case boot time after RST is released
+#define DRA818_PROBE_INTERVAL_MS 50 // Time allowed for each DMOCONNECT probe
+#define DRA818_PROBE_TIMEOUT_MS  2000 // Give up on a module that never answers
+#define DRA818_BUS_WAIT_MS       100 // Longest a blocking transfer waits for the bus
+#define DRA818_BUS_FALLBACK_ERRORS 3 // Failed frames in a row before the bus slows down a step
+#define DRA818_CAL_ROUNDS        8  // Verification passes at each speed step
+
+// A single register/value pair for scattered writes.
+typedef struct {
+    uint8_t reg;
+    uint8_t value;
+} Dra818RegValue;
+
+typedef enum {
+    Dra818InitStateIdle, // No init sequence running
+    Dra818InitStateReset, // RST held low
+    Dra818InitStateBoot, // Waiting out the fixed boot delay
+    Dra818InitStateProbe, // Polling the module with AT+DMOCONNECT
+    Dra818InitStateConfigure, // Module answered; waiting for dra818_init_configure()
+    Dra818InitStateReady, // Module answered and is configured
+    Dra818InitStateFailed, // Module never answered
+} Dra818InitState;
+
+typedef struct {
+    uint32_t reset_ms; // Time RST is held low
+    uint32_t boot_ms; // Fixed wait after reset, used when probe is NULL
+    Dra818At* probe; // Poll this engine with DMOCONNECT instead of waiting boot_ms
+    uint32_t probe_interval_ms; // Answer timeout of each probe
+    uint32_t probe_timeout_ms; // Overall time allowed for the module to answer
+} Dra818InitConfig;
+
+// Called from the timer or AT worker thread once the init sequence has finished.  It must
+// not touch the bus: hand `ready` to the thread that owns the module instead.
+typedef void (*Dra818ReadyCallback)(bool ready, void* context);
+
+// Called from interrupt context when new bytes were added to the receive ring.
+typedef void (*Dra818RxCallback)(void* context);
+
+// Called from interrupt context when the squelch output changes.
+typedef void (*Dra818SquelchCallback)(bool open, void* context);
+
+// Called from the SPI DMA completion interrupt once a transfer has finished.
+typedef void (*Dra818TransferCallback)(bool success, void* context);
+
+typedef struct {
+    uint32_t transfers; // Times the bus was taken (blocking frames and DMA)
+    uint32_t contended; // Times a module had to wait for another to finish
+    uint32_t timeouts; // Blocking transfers that gave up waiting for the bus
+    uint32_t errors; // Frames the SPI peripheral failed
+    uint32_t fallbacks; // Times repeated errors dropped the bus a speed step
+} Dra818BusStats;
+
+/**
+ * The SPI bus shared by all modules.  Every frame, including a DMA transfer in
+ * flight, holds the bus; a blocking transfer from another module waits for it
+ * (up to DRA818_BUS_WAIT_MS) instead of failing.  INT interrupts that arrive
+ * while the bus is held are deferred; whoever releases it hands it to that receive.
+ * Each module has its own UART, so AT commands to different modules never
+ * wait on each other.
+*/
+typedef struct Dra818Bus Dra818Bus;
+
+// One module: its chip select, reset, INT, squelch and power-down lines, caches and state.
+typedef struct Dra818 Dra818;
+
+Dra818Bus* dra818_bus_alloc();
+// All modules on the bus must be freed first.
+void dra818_bus_free(Dra818Bus* bus);
+void dra818_bus_get_stats(Dra818Bus* bus, Dra818BusStats* stats);
+
+/**
+ * Bus clock.  The bus starts at DRA818_PORT_SPEED_DEFAULT; a speed found by
+ * dra818_calibrate() can be stored and restored with dra818_bus_set_speed().
+ * DRA818_BUS_FALLBACK_ERRORS failed frames in a row drop it one step.
+*/
+bool dra818_bus_set_speed(Dra818Bus* bus, uint8_t speed);
+uint8_t dra818_bus_get_speed(Dra818Bus* bus);
+
+/**
+ * @brief      Attach the module wired to `slot` (see dra_port.h) and configure its lines.
+ * @return     Dra818 object, or NULL if the slot is taken or does not exist.
+*/
+Dra818* dra818_alloc(Dra818Bus* bus, uint8_t slot);
+// Cancels init and receive and detaches the module.
+void dra818_free(Dra818* dra);
+
+// Power the module down (PD low) or back up; it keeps its configuration while asleep.
+void dra818_sleep(Dra818* dra, bool sleep);
+bool dra818_squelch_open(Dra818* dra);
+// Arm (or, with NULL, disarm) an edge interrupt on the squelch output.
+void dra818_squelch_set_callback(Dra818* dra, Dra818SquelchCallback callback, void* context);
+
+/**
+ * Non-blocking reset and init.  Returns at once; a FuriTimer steps through
+ * reset and boot (or DMOCONNECT probing), then calls `callback`.  The timer
+ * never touches the bus: once `callback` reported ready, the thread that
+ * drives the module calls dra818_init_configure() to write the register
+ * defaults and invalidate the probe engine's AT shadow (the caller commits
+ * it), which makes it Ready.
+ * Returns false if a sequence is already running.  dra818_init_cancel() stops
+ * it, drops the probe in flight and releases the timer.  Each module runs its
+ * own sequence, so several modules can come up at the same time.
+*/
+bool dra818_init_async(
+    Dra818* dra,
+    const Dra818InitConfig* config,
+    Dra818ReadyCallback callback,
+    void* context);
+void dra818_init_cancel(Dra818* dra);
+// Returns false if the sequence was cancelled or failed; blocks on the bus.
+bool dra818_init_configure(Dra818* dra);
+Dra818InitState dra818_init_state(Dra818* dra);
+
+/**
+ * @brief      Find the fastest reliable clock for the bus `dra` sits on.  Starting at the
+ *           default, the clock is raised one step at a time; each step must read back the
+ *           configuration registers of every module on the bus, write them and read them again
+ *           DRA818_CAL_ROUNDS times without a difference.  The bus is left at the last step that
+ *           passed.  Blocks for a few ms; run it with the modules otherwise idle, after init.
+ * @param      speed  Receives the chosen speed step.
+ * @return     false if the modules could not be read at the default speed.
+*/
+bool dra818_calibrate(Dra818* dra, uint8_t* speed);
+
+void dra818_write(Dra818* dra, uint8_t reg, uint8_t value);
+uint8_t dra818_read(Dra818* dra, uint8_t reg);
+void dra818_transmit(Dra818* dra, uint8_t data);
+uint8_t dra818_receive(Dra818* dra);
+
+/**
+ * Multi-register transactions.  Each call holds CS low once and moves the whole
+ * payload with a single HAL transfer.  They return false if the bus failed or
+ * stayed busy, or if this module's DMA transfer is still in flight.
+*/
+bool dra818_write_burst(Dra818* dra, uint8_t reg, const uint8_t* values, size_t count);
+bool dra818_write_list(Dra818* dra, const Dra818RegValue* list, size_t count);
+bool dra818_read_burst(Dra818* dra, uint8_t reg, uint8_t* values, size_t count);
+
+/**
+ * DMA-backed variants.  They return as soon as the transfer is started; the
+ * callback runs from interrupt context when it completes.  For reads, `values`
+ * must stay valid until then.  The bus stays taken until completion.
+*/
+bool dra818_write_burst_dma(
+    Dra818* dra,
+    uint8_t reg,
+    const uint8_t* values,
+    size_t count,
+    Dra818TransferCallback callback,
+    void* context);
+bool dra818_read_burst_dma(
+    Dra818* dra,
+    uint8_t reg,
+    uint8_t* values,
+    size_t count,
+    Dra818TransferCallback callback,
+    void* context);
+bool dra818_dma_busy(Dra818* dra);
+
+/**
+ * Shadow register cache.  dra818_read() is served from the cache once a register
+ * is known, and dra818_write() skips the bus when the value is unchanged.
+ * dra818_set() only stages a value; dra818_commit() then sends every staged
+ * change in one transfer.  A reset invalidates the cache; dra818_resync() reloads
+ * it from the module.
+*/
+void dra818_set(Dra818* dra, uint8_t reg, uint8_t value);
+bool dra818_commit(Dra818* dra);
+bool dra818_is_dirty(Dra818* dra);
+void dra818_invalidate(Dra818* dra);
+bool dra818_resync(Dra818* dra);
+
+/**
+ * Interrupt-driven receive.  While enabled, a falling edge on the module's INT
+ * line starts DMA reads of its receive register; their completion interrupt
+ * pushes each byte into a lock-free ring and, once INT goes high, calls
+ * `callback` (e.g. to set a worker thread flag).  No interrupt handler waits
+ * for the SPI.  One consumer thread collects the bytes in batches with
+ * dra818_rx_read(); bytes arriving while the ring is full are dropped and counted.
+*/
+void dra818_rx_start(Dra818* dra, Dra818RxCallback callback, void* context);
+void dra818_rx_stop(Dra818* dra);
+size_t dra818_rx_read(Dra818* dra, uint8_t* data, size_t size);
+size_t dra818_rx_available(Dra818* dra);
+uint32_t dra818_rx_overflows(Dra818* dra);
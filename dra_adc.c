@@ -0,0 +1,147 @@
+/*
+ -- dra_adc.c
+ -- Timer-paced ADC sampling of the DRA818V/U audio output
+*/
+
+#include <furi.h>
+#include <furi_hal_adc.h>
+#include <furi_hal_bus.h>
+#include <furi_hal_gpio.h>
+#include <furi_hal_interrupt.h>
+#include <furi_hal_resources.h>
+#include <stm32wbxx_ll_tim.h>
+#include "dra_adc.h"
+
+#define TAG "Dra818Adc"
+
+#define DRA818_ADC_CHANNEL FuriHalAdcChannel4 // PC3, GPIO header pin 7 (PA4 carries the tone)
+#define DRA818_ADC_TIMER_HZ 64000000
+
+typedef enum {
+    Dra818AdcEvtStop = (1 << 0),
+    Dra818AdcEvtBlock = (1 << 1),
+} Dra818AdcEvtFlags;
+
+static FuriHalAdcHandle* dra818_adc_handle = NULL;
+static FuriThread* dra818_adc_thread = NULL;
+static Dra818AdcCallback dra818_adc_callback;
+static void* dra818_adc_context;
+
+// Ping-pong blocks.  The interrupt owns blocks[fill]; blocks[ready] belongs to the
+// worker while ready_pending is set.
+static int16_t dra818_adc_blocks[2][DRA818_ADC_BLOCK];
+static size_t dra818_adc_fill;
+static size_t dra818_adc_count;
+static volatile size_t dra818_adc_ready;
+static volatile bool dra818_adc_ready_pending;
+static volatile uint32_t dra818_adc_overrun_count;
+
+static void dra818_adc_isr(void* context) {
+    UNUSED(context);
+    if(!LL_TIM_IsActiveFlag_UPDATE(TIM2)) {
+        return;
+    }
+    LL_TIM_ClearFlag_UPDATE(TIM2);
+
+    uint16_t raw = furi_hal_adc_read(dra818_adc_handle, DRA818_ADC_CHANNEL);
+    dra818_adc_blocks[dra818_adc_fill][dra818_adc_count++] = (int16_t)raw - 2048;
+    if(dra818_adc_count < DRA818_ADC_BLOCK) {
+        return;
+    }
+    dra818_adc_count = 0;
+    if(dra818_adc_ready_pending) {
+        // The worker still has the other block: drop this one and refill it.
+        dra818_adc_overrun_count++;
+        return;
+    }
+    dra818_adc_ready = dra818_adc_fill;
+    dra818_adc_ready_pending = true;
+    dra818_adc_fill ^= 1;
+    furi_thread_flags_set(furi_thread_get_id(dra818_adc_thread), Dra818AdcEvtBlock);
+}
+
+static int32_t dra818_adc_worker(void* context) {
+    UNUSED(context);
+    while(true) {
+        uint32_t events = furi_thread_flags_wait(
+            Dra818AdcEvtStop | Dra818AdcEvtBlock, FuriFlagWaitAny, FuriWaitForever);
+        if(events & FuriFlagError) {
+            continue;
+        }
+        if(events & Dra818AdcEvtStop) {
+            break;
+        }
+        if(dra818_adc_ready_pending) {
+            dra818_adc_callback(
+                dra818_adc_blocks[dra818_adc_ready], DRA818_ADC_BLOCK, dra818_adc_context);
+            dra818_adc_ready_pending = false;
+        }
+    }
+    return 0;
+}
+
+bool dra818_adc_start(uint32_t sample_rate, Dra818AdcCallback callback, void* context) {
+    if(dra818_adc_thread || sample_rate == 0 || sample_rate > DRA818_ADC_RATE_MAX ||
+       furi_hal_bus_is_enabled(FuriHalBusTIM2)) {
+        return false;
+    }
+    dra818_adc_callback = callback;
+    dra818_adc_context = context;
+    dra818_adc_fill = 0;
+    dra818_adc_count = 0;
+    dra818_adc_ready_pending = false;
+    dra818_adc_overrun_count = 0;
+
+    dra818_adc_thread = furi_thread_alloc_ex(TAG, DRA818_ADC_STACK_SIZE, dra818_adc_worker, NULL);
+    furi_thread_set_priority(dra818_adc_thread, FuriThreadPriorityHighest);
+    furi_thread_start(dra818_adc_thread);
+
+    // Short sampling time and no oversampling keep each conversion to a few us.
+    furi_hal_gpio_init(&gpio_ext_pc3, GpioModeAnalog, GpioPullNo, GpioSpeedVeryHigh);
+    dra818_adc_handle = furi_hal_adc_acquire();
+    furi_hal_adc_configure_ex(
+        dra818_adc_handle,
+        FuriHalAdcScale2048,
+        FuriHalAdcClockSync64,
+        FuriHalAdcOversampleNone,
+        FuriHalAdcSamplingtime12_5);
+
+    furi_hal_bus_enable(FuriHalBusTIM2);
+    LL_TIM_SetPrescaler(TIM2, 0);
+    LL_TIM_SetAutoReload(TIM2, DRA818_ADC_TIMER_HZ / sample_rate - 1);
+    LL_TIM_SetCounter(TIM2, 0);
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTIM2, dra818_adc_isr, NULL);
+    LL_TIM_EnableIT_UPDATE(TIM2);
+    LL_TIM_EnableCounter(TIM2);
+    return true;
+}
+
+void dra818_adc_stop() {
+    if(!dra818_adc_thread) {
+        return;
+    }
+    LL_TIM_DisableCounter(TIM2);
+    LL_TIM_DisableIT_UPDATE(TIM2);
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTIM2, NULL, NULL);
+    furi_hal_bus_disable(FuriHalBusTIM2);
+
+    furi_hal_adc_release(dra818_adc_handle);
+    dra818_adc_handle = NULL;
+    furi_hal_gpio_init(&gpio_ext_pc3, GpioModeAnalog, GpioPullNo, GpioSpeedLow);
+
+    furi_thread_flags_set(furi_thread_get_id(dra818_adc_thread), Dra818AdcEvtStop);
+    furi_thread_join(dra818_adc_thread);
+    furi_thread_free(dra818_adc_thread);
+    dra818_adc_thread = NULL;
+    if(dra818_adc_overrun_count) {
+        FURI_LOG_W(TAG, "%lu blocks dropped", dra818_adc_overrun_count);
+    }
+}
+
+bool dra818_adc_running() {
+    return dra818_adc_thread != NULL;
+}
+
+uint32_t dra818_adc_overruns() {
+    return dra818_adc_overrun_count;
+}
@@ -0,0 +1,27 @@
+/*
+ -- dra_adc.h
+ -- Timer-paced ADC sampling of the DRA818V/U audio output
+ --
+ -- TIM2 triggers one conversion of PC3 per sample.  Samples are collected into
+ -- two blocks in turn (ping-pong); a full block is handed to a worker thread
+ -- while the interrupt fills the other one.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DRA818_ADC_BLOCK      256 // Samples per block
+#define DRA818_ADC_RATE_MAX   48000
+#define DRA818_ADC_STACK_SIZE 2048 // Worker stack; the block callback runs on it
+
+// Called on the worker thread with one block of samples, centred on 0 (12-bit range).
+typedef void (*Dra818AdcCallback)(const int16_t* samples, size_t count, void* context);
+
+bool dra818_adc_start(uint32_t sample_rate, Dra818AdcCallback callback, void* context);
+void dra818_adc_stop();
+bool dra818_adc_running();
+// Blocks dropped because the worker had not finished the previous one.
+uint32_t dra818_adc_overruns();
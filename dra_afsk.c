@@ -0,0 +1,302 @@
+/*
+ -- dra_afsk.c
+ -- AFSK1200 (Bell 202) modem for AX.25/APRS over the DRA818V/U
+*/
+
+#include <furi.h>
+#include <string.h>
+#include "dra_adc.h"
+#include "dra_afsk.h"
+#include "dra_crc.h"
+#include "dra_stats.h"
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+#define DRA818_AFSK_FLAG 0x7E
+
+static Dra818AfskMod dra818_afsk_tx;
+static Dra818AfskDemod dra818_afsk_rx;
+
+static bool dra818_afsk_put_bit(Dra818AfskMod* mod, bool bit) {
+    if(mod->bit_count >= DRA818_AFSK_TX_BITS_MAX) {
+        return false;
+    }
+    uint8_t mask = 1 << (mod->bit_count & 7);
+    if(bit) {
+        mod->bits[mod->bit_count >> 3] |= mask;
+    } else {
+        mod->bits[mod->bit_count >> 3] &= ~mask;
+    }
+    mod->bit_count++;
+    return true;
+}
+
+// Bytes go out LSB first.  With stuffing, a 0 is inserted after every five ones in a row.
+static void dra818_afsk_put_byte(Dra818AfskMod* mod, uint8_t byte, uint8_t* ones) {
+    for(size_t i = 0; i < 8; i++) {
+        bool bit = (byte >> i) & 1;
+        dra818_afsk_put_bit(mod, bit);
+        if(!ones) {
+            continue;
+        }
+        *ones = bit ? *ones + 1 : 0;
+        if(*ones == 5) {
+            dra818_afsk_put_bit(mod, false);
+            *ones = 0;
+        }
+    }
+}
+
+// Loads the tone for the bit at bit_pos: a 0 toggles the tone, a 1 keeps it (NRZI).
+static void dra818_afsk_mod_bit(Dra818AfskMod* mod) {
+    bool bit = (mod->bits[mod->bit_pos >> 3] >> (mod->bit_pos & 7)) & 1;
+    if(!bit) {
+        mod->mark = !mod->mark;
+    }
+    mod->osc.step[0] = mod->mark ? mod->step_mark : mod->step_space;
+}
+
+bool dra818_afsk_mod_init(
+    Dra818AfskMod* mod,
+    const uint8_t* frame,
+    size_t size,
+    uint32_t sample_rate) {
+    if(size < DRA818_AFSK_FRAME_MIN || size > DRA818_AFSK_FRAME_MAX) {
+        return false;
+    }
+    mod->bit_count = 0;
+    for(size_t i = 0; i < DRA818_AFSK_TXDELAY_FLAGS; i++) {
+        dra818_afsk_put_byte(mod, DRA818_AFSK_FLAG, NULL);
+    }
+    uint8_t ones = 0;
+    for(size_t i = 0; i < size; i++) {
+        dra818_afsk_put_byte(mod, frame[i], &ones);
+    }
+    uint16_t fcs = dra818_crc16_x25(frame, size);
+    dra818_afsk_put_byte(mod, fcs & 0xFF, &ones);
+    dra818_afsk_put_byte(mod, fcs >> 8, &ones);
+    for(size_t i = 0; i < DRA818_AFSK_TXTAIL_FLAGS; i++) {
+        dra818_afsk_put_byte(mod, DRA818_AFSK_FLAG, NULL);
+    }
+
+    // Both tones come from one oscillator so the phase stays continuous across bits.
+    Dra818ToneStep step = {.f1 = DRA818_AFSK_SPACE_HZ * 10, .level = DRA818_TONE_LEVEL_AUDIO};
+    dra818_tone_osc_set(&mod->osc, &step, sample_rate);
+    mod->step_space = mod->osc.step[0];
+    step.f1 = DRA818_AFSK_MARK_HZ * 10;
+    dra818_tone_osc_set(&mod->osc, &step, sample_rate);
+    mod->step_mark = mod->osc.step[0];
+
+    mod->sample_rate = sample_rate;
+    mod->baud_acc = 0;
+    mod->bit_pos = 0;
+    mod->mark = true;
+    dra818_afsk_mod_bit(mod);
+    return true;
+}
+
+bool dra818_afsk_mod_next(Dra818AfskMod* mod, int16_t* sample) {
+    if(mod->bit_pos >= mod->bit_count) {
+        return false;
+    }
+    *sample = dra818_tone_osc_next(&mod->osc);
+    mod->baud_acc += DRA818_AFSK_BAUD;
+    if(mod->baud_acc >= mod->sample_rate) {
+        mod->baud_acc -= mod->sample_rate;
+        if(++mod->bit_pos < mod->bit_count) {
+            dra818_afsk_mod_bit(mod);
+        }
+    }
+    return true;
+}
+
+void dra818_afsk_demod_init(
+    Dra818AfskDemod* demod,
+    uint32_t sample_rate,
+    Dra818AfskFrameCallback callback,
+    void* context) {
+    memset(demod, 0, sizeof(Dra818AfskDemod));
+    demod->taps = (sample_rate / DRA818_AFSK_BAUD) & ~1U; // Even, for the paired MACs
+    if(demod->taps > DRA818_AFSK_TAPS_MAX) {
+        demod->taps = DRA818_AFSK_TAPS_MAX;
+    }
+    demod->pll_step = (int32_t)(((uint64_t)DRA818_AFSK_BAUD << 32) / sample_rate);
+    demod->callback = callback;
+    demod->context = context;
+
+    // Reference I/Q pairs from the tone generator's sine table; cos is sin a quarter turn on.
+    static const uint32_t freqs[2] = {DRA818_AFSK_MARK_HZ, DRA818_AFSK_SPACE_HZ};
+    for(size_t tone = 0; tone < 2; tone++) {
+        Dra818ToneStep step = {.f1 = freqs[tone] * 10, .level = 255};
+        Dra818ToneOsc osc_i, osc_q;
+        dra818_tone_osc_set(&osc_i, &step, sample_rate);
+        dra818_tone_osc_set(&osc_q, &step, sample_rate);
+        osc_i.phase[0] = 1UL << 30;
+        for(size_t i = 0; i < demod->taps; i++) {
+            demod->ref[tone * 2][i] = dra818_tone_osc_next(&osc_i) >> 3;
+            demod->ref[tone * 2 + 1][i] = dra818_tone_osc_next(&osc_q) >> 3;
+        }
+    }
+}
+
+// Correlates one bit-long window with the four references.
+static inline void dra818_afsk_correlate(
+    const Dra818AfskDemod* demod,
+    const int16_t* window,
+    int32_t* out) {
+#if defined(__ARM_FEATURE_SIMD32)
+    // Two 16x16 multiply-accumulates per SMLAD.
+    int32_t acc[4] = {0, 0, 0, 0};
+    for(size_t i = 0; i < demod->taps; i += 2) {
+        int16x2_t x;
+        memcpy(&x, &window[i], sizeof(x));
+        for(size_t r = 0; r < 4; r++) {
+            int16x2_t ref;
+            memcpy(&ref, &demod->ref[r][i], sizeof(ref));
+            acc[r] = __smlad(x, ref, acc[r]);
+        }
+    }
+    memcpy(out, acc, sizeof(acc));
+#else
+    for(size_t r = 0; r < 4; r++) {
+        int32_t acc = 0;
+        for(size_t i = 0; i < demod->taps; i++) {
+            acc += (int32_t)window[i] * demod->ref[r][i];
+        }
+        out[r] = acc;
+    }
+#endif
+}
+
+static void dra818_afsk_frame_end(Dra818AfskDemod* demod) {
+    if(!demod->in_frame || demod->bit_count != 7 ||
+       demod->frame_size < DRA818_AFSK_FRAME_MIN + 2) {
+        return; // Back-to-back flags, or noise between them
+    }
+    size_t size = demod->frame_size - 2;
+    uint16_t fcs = demod->frame[size] | (demod->frame[size + 1] << 8);
+    if(fcs != dra818_crc16_x25(demod->frame, size)) {
+        demod->stats.fcs_errors++;
+        return;
+    }
+    demod->stats.frames++;
+    if(demod->callback) {
+        demod->callback(demod->frame, size, demod->context);
+    }
+}
+
+static void dra818_afsk_hdlc_bit(Dra818AfskDemod* demod, bool bit) {
+    demod->shift = (demod->shift >> 1) | (bit ? 0x80 : 0);
+    if(demod->shift == DRA818_AFSK_FLAG) {
+        dra818_afsk_frame_end(demod);
+        demod->in_frame = true;
+        demod->frame_size = 0;
+        demod->bit_count = 0;
+        demod->ones = 0;
+        return;
+    }
+    if(bit) {
+        if(++demod->ones >= 7) {
+            if(demod->in_frame && demod->frame_size) {
+                demod->stats.aborts++;
+            }
+            demod->in_frame = false;
+            return;
+        }
+    } else {
+        bool stuffed = demod->ones == 5;
+        demod->ones = 0;
+        if(stuffed) {
+            return;
+        }
+    }
+    if(!demod->in_frame) {
+        return;
+    }
+    demod->byte = (demod->byte >> 1) | (bit ? 0x80 : 0);
+    if(++demod->bit_count == 8) {
+        demod->bit_count = 0;
+        if(demod->frame_size >= sizeof(demod->frame)) {
+            demod->stats.aborts++;
+            demod->in_frame = false;
+            return;
+        }
+        demod->frame[demod->frame_size++] = demod->byte;
+    }
+}
+
+void dra818_afsk_demod_process(Dra818AfskDemod* demod, const int16_t* samples, size_t count) {
+    size_t taps = demod->taps;
+    for(size_t n = 0; n < count; n++) {
+        // DC blocker, then the sample goes in twice so the window never wraps.
+        int32_t x = samples[n];
+        demod->dc += ((x << 8) - demod->dc) >> 6;
+        int16_t v = x - (demod->dc >> 8);
+        demod->history[demod->pos] = v;
+        demod->history[demod->pos + taps] = v;
+        demod->pos = demod->pos + 1 == taps ? 0 : demod->pos + 1;
+
+        int32_t corr[4];
+        dra818_afsk_correlate(demod, &demod->history[demod->pos], corr);
+        for(size_t r = 0; r < 4; r++) {
+            corr[r] >>= 12;
+        }
+        int32_t mark = corr[0] * corr[0] + corr[1] * corr[1];
+        int32_t space = corr[2] * corr[2] + corr[3] * corr[3];
+
+        // Tone changes pull the bit clock towards them (bit edges sit at phase 0).
+        bool level = mark > space;
+        if(level != demod->level) {
+            demod->level = level;
+            demod->pll = (demod->pll >> 2) * 3;
+        }
+        int32_t previous = demod->pll;
+        demod->pll = (int32_t)((uint32_t)demod->pll + (uint32_t)demod->pll_step);
+        if(previous > 0 && demod->pll < 0) {
+            // Mid-bit: same tone as last bit is a 1 (NRZI).
+            dra818_afsk_hdlc_bit(demod, level == demod->last_bit_level);
+            demod->last_bit_level = level;
+        }
+    }
+    demod->stats.samples += count;
+}
+
+static bool dra818_afsk_tx_source(int16_t* sample, void* context) {
+    return dra818_afsk_mod_next(context, sample);
+}
+
+bool dra818_afsk_transmit(
+    const uint8_t* frame,
+    size_t size,
+    Dra818ToneDoneCallback callback,
+    void* context) {
+    if(dra818_tone_busy() ||
+       !dra818_afsk_mod_init(&dra818_afsk_tx, frame, size, DRA818_TONE_SAMPLE_RATE)) {
+        return false;
+    }
+    return dra818_tone_play_source(dra818_afsk_tx_source, &dra818_afsk_tx, callback, context);
+}
+
+static void dra818_afsk_rx_block(const int16_t* samples, size_t count, void* context) {
+    DRA818_STATS_BEGIN(start);
+    dra818_afsk_demod_process(context, samples, count);
+    DRA818_STATS_END(start, Dra818StatAfsk, true);
+}
+
+bool dra818_afsk_rx_start(Dra818AfskFrameCallback callback, void* context) {
+    if(dra818_adc_running()) {
+        return false;
+    }
+    dra818_afsk_demod_init(&dra818_afsk_rx, DRA818_AFSK_RX_RATE, callback, context);
+    return dra818_adc_start(DRA818_AFSK_RX_RATE, dra818_afsk_rx_block, &dra818_afsk_rx);
+}
+
+void dra818_afsk_rx_stop() {
+    dra818_adc_stop();
+}
+
+void dra818_afsk_rx_get_stats(Dra818AfskStats* stats) {
+    *stats = dra818_afsk_rx.stats;
+}
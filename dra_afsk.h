@@ -0,0 +1,110 @@
+/*
+ -- dra_afsk.h
+ -- AFSK1200 (Bell 202) modem for AX.25/APRS over the DRA818V/U
+ --
+ -- TX turns a frame into an HDLC bit stream (flags, bit stuffing, FCS) and
+ -- plays it NRZI-coded as a phase-continuous 1200/2200 Hz tone through
+ -- dra_tone.  RX runs a fixed-point correlator on ADC samples from dra_adc,
+ -- recovers the bit clock with a DPLL and deframes HDLC.
+ --
+ -- The modulator, demodulator and FCS do not touch hardware and can be fed
+ -- samples directly, e.g. from a WAV file on a host.  Keying the transmitter
+ -- around dra818_afsk_transmit() is up to the caller.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_tone.h"
+
+#define DRA818_AFSK_BAUD     1200
+#define DRA818_AFSK_MARK_HZ  1200
+#define DRA818_AFSK_SPACE_HZ 2200
+
+#define DRA818_AFSK_FRAME_MIN     15 // Shortest AX.25 frame (two addresses + control), no FCS
+#define DRA818_AFSK_FRAME_MAX     330 // Longest AX.25 frame we handle, no FCS
+#define DRA818_AFSK_TXDELAY_FLAGS 40 // Preamble, about 270 ms
+#define DRA818_AFSK_TXTAIL_FLAGS  4
+// Worst case: every 5th data bit stuffed.
+#define DRA818_AFSK_TX_BITS_MAX                                         \
+    ((DRA818_AFSK_TXDELAY_FLAGS + DRA818_AFSK_TXTAIL_FLAGS + 1) * 8 + \
+     (DRA818_AFSK_FRAME_MAX + 2) * 8 * 6 / 5)
+
+#define DRA818_AFSK_RX_RATE    13200 // ADC rate for RX; 9600..19200 are supported
+#define DRA818_AFSK_TAPS_MAX   16 // Correlator length (one bit at the highest rate)
+
+typedef struct {
+    uint8_t bits[(DRA818_AFSK_TX_BITS_MAX + 7) / 8]; // HDLC bits, before NRZI
+    size_t bit_count;
+    size_t bit_pos;
+    uint32_t baud_acc; // Bit clock: += baud per sample, next bit at sample_rate
+    uint32_t sample_rate;
+    uint32_t step_mark;
+    uint32_t step_space;
+    bool mark; // Current tone (NRZI state)
+    Dra818ToneOsc osc;
+} Dra818AfskMod;
+
+// Frames one AX.25 frame (without FCS) for transmission at sample_rate.
+bool dra818_afsk_mod_init(
+    Dra818AfskMod* mod,
+    const uint8_t* frame,
+    size_t size,
+    uint32_t sample_rate);
+// Next audio sample; false once the frame has been sent.
+bool dra818_afsk_mod_next(Dra818AfskMod* mod, int16_t* sample);
+
+// Called with a frame that passed its FCS check (FCS removed).
+typedef void (*Dra818AfskFrameCallback)(const uint8_t* frame, size_t size, void* context);
+
+typedef struct {
+    uint32_t samples;
+    uint32_t frames; // Frames with a good FCS
+    uint32_t fcs_errors; // Complete frames with a bad FCS
+    uint32_t aborts; // Frames ended by seven ones, or too long
+} Dra818AfskStats;
+
+typedef struct {
+    size_t taps; // Correlator length, even
+    int16_t ref[4][DRA818_AFSK_TAPS_MAX]; // Mark I/Q, space I/Q, Q12
+    int16_t history[2 * DRA818_AFSK_TAPS_MAX]; // Samples, stored twice for a flat window
+    size_t pos;
+    int32_t dc; // DC estimate, Q8
+    int32_t pll; // Bit clock phase; a bit is sampled when it wraps
+    int32_t pll_step;
+    bool level; // Demodulated tone (mark = true)
+    bool last_bit_level; // Tone at the previous bit sample, for NRZI
+
+    uint8_t shift; // Last 8 received bits, newest in bit 7
+    uint8_t ones; // Consecutive ones
+    bool in_frame;
+    uint8_t byte;
+    uint8_t bit_count;
+    uint8_t frame[DRA818_AFSK_FRAME_MAX + 2];
+    size_t frame_size;
+
+    Dra818AfskFrameCallback callback;
+    void* context;
+    Dra818AfskStats stats;
+} Dra818AfskDemod;
+
+void dra818_afsk_demod_init(
+    Dra818AfskDemod* demod,
+    uint32_t sample_rate,
+    Dra818AfskFrameCallback callback,
+    void* context);
+// samples: audio centred on 0, at most 12 bits.
+void dra818_afsk_demod_process(Dra818AfskDemod* demod, const int16_t* samples, size_t count);
+
+// Sends one frame through dra_tone; callback as for dra818_tone_play().
+bool dra818_afsk_transmit(
+    const uint8_t* frame,
+    size_t size,
+    Dra818ToneDoneCallback callback,
+    void* context);
+// Starts receiving from dra_adc at DRA818_AFSK_RX_RATE; callback runs on the ADC worker.
+bool dra818_afsk_rx_start(Dra818AfskFrameCallback callback, void* context);
+void dra818_afsk_rx_stop();
+void dra818_afsk_rx_get_stats(Dra818AfskStats* stats);
@@ -0,0 +1,669 @@
+/*
+ -- dra_at.c
+ -- Asynchronous UART AT-command engine for DRA818V/U and SA818 modules
+*/
+
+#include <furi.h>
+#include <furi_hal_serial.h>
+#include <furi_hal_serial_control.h>
+#include <string.h>
+#include "dra_at.h"
+#include "dra_stats.h"
+
+#define TAG "Dra818At"
+
+#define DRA818_AT_RX_BUFFER 256 // Bytes buffered between the UART ISR and the worker
+
+typedef enum {
+    Dra818AtEvtStop = (1 << 0),
+    Dra818AtEvtRxData = (1 << 1),
+    Dra818AtEvtSubmit = (1 << 2),
+    Dra818AtEvtRelease = (1 << 3),
+} Dra818AtEvtFlags;
+
+#define DRA818_AT_ALL_EVENTS \
+    (Dra818AtEvtStop | Dra818AtEvtRxData | Dra818AtEvtSubmit | Dra818AtEvtRelease)
+
+// Configuration fields tracked by the shadow, each sent by its own command.
+typedef enum {
+    Dra818AtFieldGroup = (1 << 0),
+    Dra818AtFieldVolume = (1 << 1),
+} Dra818AtField;
+
+typedef enum {
+    Dra818AtParseIdle, // Between lines, skipping CR/LF
+    Dra818AtParseLine, // Collecting a response line
+    Dra818AtParseDiscard, // Line too long, dropping bytes until LF
+} Dra818AtParseState;
+
+typedef struct {
+    char command[DRA818_AT_CMD_MAX];
+    size_t length;
+    const char* expect;
+    uint32_t timeout; // ticks
+    bool held; // CR/LF waits for dra818_at_release(); guarded by mutex once queued
+    Dra818AtCallback callback;
+    void* context;
+} Dra818AtCommand;
+
+struct Dra818At {
+    FuriHalSerialHandle* serial;
+    FuriStreamBuffer* rx_stream;
+    FuriThread* thread;
+    FuriMutex* mutex;
+
+    // Commands waiting to be sent, guarded by mutex.
+    Dra818AtCommand queue[DRA818_AT_QUEUE_SIZE];
+    size_t queue_head;
+    size_t queue_count;
+    bool busy;
+
+    // Configuration shadow, guarded by mutex.  "staged" is what the caller
+    // wants, "sent" what the commit in flight carries and "applied" what the
+    // module has acknowledged.
+    Dra818AtGroup group_staged;
+    Dra818AtGroup group_sent;
+    Dra818AtGroup group_applied;
+    uint8_t volume_staged;
+    uint8_t volume_sent;
+    uint8_t volume_applied;
+    uint8_t fields_staged; // Dra818AtField bits staged at least once
+    uint8_t fields_applied; // Dra818AtField bits known to match the module
+    size_t commit_pending;
+    Dra818AtResult commit_result;
+    Dra818AtCallback commit_callback;
+    void* commit_context;
+
+    void* calling; // Context whose callback the worker is running, guarded by mutex
+
+    // Worker-owned state; current.callback and current.held are guarded by mutex.
+    Dra818AtCommand current;
+    bool holding; // current went out without its CR/LF
+    uint32_t deadline;
+#ifdef DRA_STATS
+    uint32_t sent_at; // dra818_stats_now() when the current command went out
+#endif
+    Dra818AtParseState parse_state;
+    char line[DRA818_AT_LINE_MAX];
+    size_t line_length;
+};
+
+static void dra818_at_on_rx(FuriHalSerialHandle* handle, FuriHalSerialRxEvent event, void* context) {
+    Dra818At* at = context;
+    if(event & FuriHalSerialRxEventData) {
+        uint8_t data = furi_hal_serial_async_rx(handle);
+        furi_stream_buffer_send(at->rx_stream, &data, 1, 0);
+        furi_thread_flags_set(furi_thread_get_id(at->thread), Dra818AtEvtRxData);
+    }
+}
+
+// Run a command's callback, with dra818_at_cancel() holding off until it returns.
+static void dra818_at_call(
+    Dra818At* at,
+    Dra818AtCallback callback,
+    Dra818AtResult result,
+    const char* response,
+    void* context) {
+    if(callback) {
+        callback(result, response, context);
+    }
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    at->calling = NULL;
+    furi_mutex_release(at->mutex);
+}
+
+static void dra818_at_complete(Dra818At* at, Dra818AtResult result, const char* response) {
+    at->holding = false;
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    at->busy = false;
+    Dra818AtCallback callback = at->current.callback;
+    at->calling = callback ? at->current.context : NULL;
+    furi_mutex_release(at->mutex);
+
+#ifdef DRA_STATS
+    if(result != Dra818AtResultCancelled) {
+        dra818_stats_record(
+            Dra818StatAt,
+            at->sent_at,
+            result == Dra818AtResultOk,
+            result == Dra818AtResultTimeout);
+    }
+#endif
+    dra818_at_call(at, callback, result, response, at->current.context);
+}
+
+static void dra818_at_start_next(Dra818At* at) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    bool ready = !at->busy && at->queue_count > 0;
+    if(ready) {
+        at->current = at->queue[at->queue_head];
+        at->queue_head = (at->queue_head + 1) % DRA818_AT_QUEUE_SIZE;
+        at->queue_count--;
+        at->busy = true;
+    }
+    bool held = ready && at->current.held;
+    furi_mutex_release(at->mutex);
+
+    if(ready) {
+        at->parse_state = Dra818AtParseIdle;
+        at->deadline = furi_get_tick() + at->current.timeout;
+#ifdef DRA_STATS
+        at->sent_at = dra818_stats_now();
+#endif
+        // A held command goes out without its CR/LF; the module only acts on a whole line.
+        at->holding = held;
+        size_t length = at->current.length - (held ? 2 : 0);
+        furi_hal_serial_tx(at->serial, (uint8_t*)at->current.command, length);
+    }
+}
+
+// Finish a held command once it was released: the line ending makes the module act.
+static void dra818_at_finish_held(Dra818At* at) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    bool release = at->holding && !at->current.held;
+    furi_mutex_release(at->mutex);
+
+    if(release) {
+        at->holding = false;
+        at->deadline = furi_get_tick() + at->current.timeout;
+#ifdef DRA_STATS
+        at->sent_at = dra818_stats_now();
+#endif
+        furi_hal_serial_tx(
+            at->serial, (uint8_t*)&at->current.command[at->current.length - 2], 2);
+    }
+}
+
+static void dra818_at_handle_line(Dra818At* at) {
+    if(!at->busy || !at->current.expect) {
+        FURI_LOG_D(TAG, "Unsolicited: %s", at->line);
+        return;
+    }
+
+    size_t expect_length = strlen(at->current.expect);
+    if(strncmp(at->line, at->current.expect, expect_length) != 0) {
+        FURI_LOG_D(TAG, "Ignored: %s", at->line);
+        return;
+    }
+
+    // "+DMOxxx:0" means success, any other code is a failure.  Value answers
+    // such as "RSSI=123" or "S=1" always complete successfully.
+    const char* code = &at->line[expect_length];
+    Dra818AtResult result = Dra818AtResultOk;
+    if(code[0] == ':' && code[1] != '0') {
+        result = Dra818AtResultError;
+    }
+    dra818_at_complete(at, result, at->line);
+}
+
+static void dra818_at_parse_byte(Dra818At* at, uint8_t byte) {
+    switch(at->parse_state) {
+    case Dra818AtParseIdle:
+        if(byte == '\r' || byte == '\n') {
+            break;
+        }
+        at->line_length = 0;
+        at->parse_state = Dra818AtParseLine;
+        /* fall through */
+    case Dra818AtParseLine:
+        if(byte == '\r' || byte == '\n') {
+            at->line[at->line_length] = '\0';
+            at->parse_state = Dra818AtParseIdle;
+            dra818_at_handle_line(at);
+        } else if(at->line_length < DRA818_AT_LINE_MAX - 1) {
+            at->line[at->line_length++] = byte;
+        } else {
+            at->parse_state = Dra818AtParseDiscard;
+        }
+        break;
+    case Dra818AtParseDiscard:
+        if(byte == '\n') {
+            at->parse_state = Dra818AtParseIdle;
+        }
+        break;
+    }
+}
+
+static int32_t dra818_at_worker(void* context) {
+    Dra818At* at = context;
+    uint8_t data[32];
+
+    while(true) {
+        uint32_t wait = FuriWaitForever;
+        if(at->busy && !at->holding) {
+            int32_t remaining = (int32_t)(at->deadline - furi_get_tick());
+            wait = remaining > 0 ? (uint32_t)remaining : 0;
+        }
+
+        uint32_t events = furi_thread_flags_wait(DRA818_AT_ALL_EVENTS, FuriFlagWaitAny, wait);
+        if(events & FuriFlagError) {
+            events = 0; // Timed out waiting for the module
+        }
+        if(events & Dra818AtEvtStop) {
+            break;
+        }
+
+        if(events & Dra818AtEvtRxData) {
+            size_t length;
+            while((length = furi_stream_buffer_receive(at->rx_stream, data, sizeof(data), 0)) >
+                  0) {
+                for(size_t i = 0; i < length; i++) {
+                    dra818_at_parse_byte(at, data[i]);
+                }
+            }
+        }
+
+        dra818_at_finish_held(at);
+        if(at->busy && !at->holding && (int32_t)(furi_get_tick() - at->deadline) >= 0) {
+            FURI_LOG_W(TAG, "Timeout: %.*s", (int)at->current.length - 2, at->current.command);
+            dra818_at_complete(at, Dra818AtResultTimeout, "");
+        }
+
+        dra818_at_start_next(at);
+        dra818_at_finish_held(at); // Released while its text was on the wire
+    }
+
+    // Cancel whatever is still in flight or queued.
+    if(at->busy) {
+        dra818_at_complete(at, Dra818AtResultCancelled, "");
+    }
+    while(true) {
+        furi_mutex_acquire(at->mutex, FuriWaitForever);
+        bool queued = at->queue_count > 0;
+        if(queued) {
+            at->current = at->queue[at->queue_head];
+            at->queue_head = (at->queue_head + 1) % DRA818_AT_QUEUE_SIZE;
+            at->queue_count--;
+            at->calling = at->current.callback ? at->current.context : NULL;
+        }
+        furi_mutex_release(at->mutex);
+        if(!queued) {
+            break;
+        }
+        dra818_at_call(
+            at, at->current.callback, Dra818AtResultCancelled, "", at->current.context);
+    }
+
+    return 0;
+}
+
+Dra818At* dra818_at_alloc(FuriHalSerialId serial_id, uint32_t baud) {
+    FuriHalSerialHandle* serial = furi_hal_serial_control_acquire(serial_id);
+    if(!serial) {
+        FURI_LOG_E(TAG, "UART is in use");
+        return NULL;
+    }
+
+    Dra818At* at = malloc(sizeof(Dra818At));
+    at->serial = serial;
+    at->rx_stream = furi_stream_buffer_alloc(DRA818_AT_RX_BUFFER, 1);
+    at->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    at->queue_head = 0;
+    at->queue_count = 0;
+    at->busy = false;
+    at->holding = false;
+    at->parse_state = Dra818AtParseIdle;
+    at->line_length = 0;
+    at->fields_staged = 0;
+    at->fields_applied = 0;
+    at->commit_pending = 0;
+
+    at->thread = furi_thread_alloc_ex("Dra818AtWorker", 1024, dra818_at_worker, at);
+    furi_thread_start(at->thread);
+
+    furi_hal_serial_init(at->serial, baud);
+    furi_hal_serial_async_rx_start(at->serial, dra818_at_on_rx, at, false);
+
+    return at;
+}
+
+void dra818_at_free(Dra818At* at) {
+    furi_hal_serial_async_rx_stop(at->serial);
+
+    furi_thread_flags_set(furi_thread_get_id(at->thread), Dra818AtEvtStop);
+    furi_thread_join(at->thread);
+    furi_thread_free(at->thread);
+
+    furi_hal_serial_deinit(at->serial);
+    furi_hal_serial_control_release(at->serial);
+
+    furi_mutex_free(at->mutex);
+    furi_stream_buffer_free(at->rx_stream);
+    free(at);
+}
+
+static bool dra818_at_queue(
+    Dra818At* at,
+    const char* command,
+    const char* expect,
+    uint32_t timeout_ms,
+    bool held,
+    Dra818AtCallback callback,
+    void* context) {
+    size_t length = strlen(command);
+    if(length + 2 > DRA818_AT_CMD_MAX) {
+        return false;
+    }
+
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    bool queued = at->queue_count < DRA818_AT_QUEUE_SIZE;
+    if(queued) {
+        Dra818AtCommand* slot =
+            &at->queue[(at->queue_head + at->queue_count) % DRA818_AT_QUEUE_SIZE];
+        memcpy(slot->command, command, length);
+        slot->command[length] = '\r';
+        slot->command[length + 1] = '\n';
+        slot->length = length + 2;
+        slot->expect = expect;
+        slot->timeout = furi_ms_to_ticks(timeout_ms);
+        slot->held = held;
+        slot->callback = callback;
+        slot->context = context;
+        at->queue_count++;
+    }
+    furi_mutex_release(at->mutex);
+
+    if(queued) {
+        furi_thread_flags_set(furi_thread_get_id(at->thread), Dra818AtEvtSubmit);
+    }
+    return queued;
+}
+
+bool dra818_at_submit(
+    Dra818At* at,
+    const char* command,
+    const char* expect,
+    uint32_t timeout_ms,
+    Dra818AtCallback callback,
+    void* context) {
+    return dra818_at_queue(at, command, expect, timeout_ms, false, callback, context);
+}
+
+static void dra818_at_commit_group_done(Dra818AtResult result, const char* response, void* context);
+static void
+    dra818_at_commit_volume_done(Dra818AtResult result, const char* response, void* context);
+
+static bool dra818_at_is_commit(const Dra818AtCommand* command) {
+    return command->callback == dra818_at_commit_group_done ||
+           command->callback == dra818_at_commit_volume_done;
+}
+
+// Let the held command submitted with `context` finish, with the mutex held.
+static bool dra818_at_unhold(Dra818At* at, void* context) {
+    for(size_t i = 0; i < at->queue_count; i++) {
+        Dra818AtCommand* command = &at->queue[(at->queue_head + i) % DRA818_AT_QUEUE_SIZE];
+        if(command->context == context) {
+            command->held = false;
+        }
+    }
+    bool wake = at->busy && at->current.held && at->current.context == context;
+    if(wake) {
+        at->current.held = false;
+    }
+    return wake;
+}
+
+void dra818_at_release(Dra818At* at, void* context) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    bool wake = dra818_at_unhold(at, context);
+    furi_mutex_release(at->mutex);
+    if(wake) {
+        furi_thread_flags_set(furi_thread_get_id(at->thread), Dra818AtEvtRelease);
+    }
+}
+
+size_t dra818_at_pending(Dra818At* at) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    size_t pending = at->queue_count + (at->busy ? 1 : 0);
+    furi_mutex_release(at->mutex);
+    return pending;
+}
+
+void dra818_at_cancel(Dra818At* at, void* context) {
+    bool worker = furi_thread_get_current_id() == furi_thread_get_id(at->thread);
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    // A commit's commands carry the engine as context; they belong to the commit's owner.
+    // The one in flight still updates the shadow, but the owner is not called back.
+    bool commit = at->commit_pending > 0 && at->commit_context == context;
+    if(commit) {
+        at->commit_callback = NULL;
+    }
+    // Keep the other commands in order while squeezing the cancelled ones out.
+    size_t kept = 0;
+    for(size_t i = 0; i < at->queue_count; i++) {
+        Dra818AtCommand* command = &at->queue[(at->queue_head + i) % DRA818_AT_QUEUE_SIZE];
+        if(command->context == context) {
+            continue;
+        }
+        if(commit && dra818_at_is_commit(command)) {
+            at->commit_pending--; // Never sent, so the module keeps what it had
+            continue;
+        }
+        at->queue[(at->queue_head + kept++) % DRA818_AT_QUEUE_SIZE] = *command;
+    }
+    at->queue_count = kept;
+    // A held command in flight still gets its line ending, or the next command
+    // would be appended to its text.
+    bool wake = dra818_at_unhold(at, context);
+    if(at->busy && at->current.context == context) {
+        at->current.callback = NULL;
+    }
+    while(!worker && at->calling == context) {
+        furi_mutex_release(at->mutex);
+        furi_delay_tick(1);
+        furi_mutex_acquire(at->mutex, FuriWaitForever);
+    }
+    furi_mutex_release(at->mutex);
+    if(wake) {
+        furi_thread_flags_set(furi_thread_get_id(at->thread), Dra818AtEvtRelease);
+    }
+}
+
+bool dra818_at_connect(Dra818At* at, Dra818AtCallback callback, void* context) {
+    return dra818_at_submit(
+        at, "AT+DMOCONNECT", "+DMOCONNECT", DRA818_AT_TIMEOUT_DEFAULT, callback, context);
+}
+
+size_t dra818_at_format_group(char* out, size_t size, const Dra818AtGroup* group) {
+    static const char prefix[] = "AT+DMOSETGROUP=";
+    // prefix + "1," + 2 x ("MMMM.FFFF,") + "TTTT,S," + "TTTT" + terminator
+    if(size < sizeof(prefix) - 1 + 2 + 2 * 10 + 7 + 4 + 1) {
+        return 0;
+    }
+
+    char* p = out;
+    memcpy(p, prefix, sizeof(prefix) - 1);
+    p += sizeof(prefix) - 1;
+    *p++ = group->wide ? '1' : '0';
+    *p++ = ',';
+    p += dra818_plan_format_freq(p, group->tx_freq);
+    *p++ = ',';
+    p += dra818_plan_format_freq(p, group->rx_freq);
+    *p++ = ',';
+    dra818_plan_format_tone(p, group->tx_tone);
+    p += 4;
+    *p++ = ',';
+    *p++ = '0' + (group->squelch > 8 ? 8 : group->squelch);
+    *p++ = ',';
+    dra818_plan_format_tone(p, group->rx_tone);
+    p += 4;
+    *p = '\0';
+    return p - out;
+}
+
+static bool dra818_at_queue_group(
+    Dra818At* at,
+    const Dra818AtGroup* group,
+    bool held,
+    Dra818AtCallback callback,
+    void* context) {
+    char command[DRA818_AT_CMD_MAX];
+    if(!dra818_at_format_group(command, sizeof(command), group)) {
+        return false;
+    }
+    return dra818_at_queue(
+        at, command, "+DMOSETGROUP", DRA818_AT_TIMEOUT_DEFAULT, held, callback, context);
+}
+
+bool dra818_at_set_group(
+    Dra818At* at,
+    const Dra818AtGroup* group,
+    Dra818AtCallback callback,
+    void* context) {
+    return dra818_at_queue_group(at, group, false, callback, context);
+}
+
+bool dra818_at_set_group_held(
+    Dra818At* at,
+    const Dra818AtGroup* group,
+    Dra818AtCallback callback,
+    void* context) {
+    return dra818_at_queue_group(at, group, true, callback, context);
+}
+
+bool dra818_at_set_volume(Dra818At* at, uint8_t volume, Dra818AtCallback callback, void* context) {
+    char command[] = "AT+DMOSETVOLUME=0";
+    command[sizeof(command) - 2] = '0' + (volume > 8 ? 8 : volume);
+    return dra818_at_submit(
+        at, command, "+DMOSETVOLUME", DRA818_AT_TIMEOUT_DEFAULT, callback, context);
+}
+
+bool dra818_at_read_rssi(Dra818At* at, Dra818AtCallback callback, void* context) {
+    return dra818_at_submit(at, "RSSI?", "RSSI", DRA818_AT_TIMEOUT_DEFAULT, callback, context);
+}
+
+bool dra818_at_parse_rssi(const char* response, uint8_t* rssi) {
+    if(strncmp(response, "RSSI=", 5) != 0) {
+        return false;
+    }
+    uint32_t value = 0;
+    const char* p = &response[5];
+    if(*p < '0' || *p > '9') {
+        return false;
+    }
+    for(; *p >= '0' && *p <= '9'; p++) {
+        value = value * 10 + (*p - '0');
+    }
+    *rssi = value > 255 ? 255 : value;
+    return true;
+}
+
+static bool dra818_at_group_equal(const Dra818AtGroup* a, const Dra818AtGroup* b) {
+    return a->wide == b->wide && a->tx_freq == b->tx_freq && a->rx_freq == b->rx_freq &&
+           a->tx_tone == b->tx_tone && a->squelch == b->squelch && a->rx_tone == b->rx_tone;
+}
+
+// Fields that differ from the module, with the mutex held.
+static uint8_t dra818_at_dirty_fields(Dra818At* at) {
+    uint8_t dirty = at->fields_staged & ~at->fields_applied;
+    if((at->fields_staged & at->fields_applied & Dra818AtFieldGroup) &&
+       !dra818_at_group_equal(&at->group_staged, &at->group_applied)) {
+        dirty |= Dra818AtFieldGroup;
+    }
+    if((at->fields_staged & at->fields_applied & Dra818AtFieldVolume) &&
+       at->volume_staged != at->volume_applied) {
+        dirty |= Dra818AtFieldVolume;
+    }
+    return dirty;
+}
+
+void dra818_at_stage_group(Dra818At* at, const Dra818AtGroup* group) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    at->group_staged = *group;
+    at->fields_staged |= Dra818AtFieldGroup;
+    furi_mutex_release(at->mutex);
+}
+
+void dra818_at_stage_volume(Dra818At* at, uint8_t volume) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    at->volume_staged = volume;
+    at->fields_staged |= Dra818AtFieldVolume;
+    furi_mutex_release(at->mutex);
+}
+
+bool dra818_at_is_dirty(Dra818At* at) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    bool dirty = dra818_at_dirty_fields(at) != 0;
+    furi_mutex_release(at->mutex);
+    return dirty;
+}
+
+void dra818_at_invalidate(Dra818At* at) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    at->fields_applied = 0;
+    furi_mutex_release(at->mutex);
+}
+
+// One command of a commit finished; report the commit once all of them have.
+static void dra818_at_commit_step(Dra818At* at, Dra818AtField field, Dra818AtResult result) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    if(result == Dra818AtResultOk) {
+        if(field == Dra818AtFieldGroup) {
+            at->group_applied = at->group_sent;
+        } else {
+            at->volume_applied = at->volume_sent;
+        }
+        at->fields_applied |= field;
+    } else {
+        at->fields_applied &= ~field;
+        at->commit_result = result;
+    }
+    bool done = --at->commit_pending == 0;
+    Dra818AtResult commit_result = at->commit_result;
+    Dra818AtCallback callback = at->commit_callback;
+    void* context = at->commit_context;
+    if(done && callback && furi_thread_get_current_id() == furi_thread_get_id(at->thread)) {
+        at->calling = context; // dra818_at_cancel(at, context) waits for the callback
+    }
+    furi_mutex_release(at->mutex);
+
+    if(done && callback) {
+        callback(commit_result, "", context);
+    }
+}
+
+static void dra818_at_commit_group_done(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(response);
+    dra818_at_commit_step(context, Dra818AtFieldGroup, result);
+}
+
+static void
+    dra818_at_commit_volume_done(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(response);
+    dra818_at_commit_step(context, Dra818AtFieldVolume, result);
+}
+
+bool dra818_at_commit(Dra818At* at, Dra818AtCallback callback, void* context) {
+    furi_mutex_acquire(at->mutex, FuriWaitForever);
+    if(at->commit_pending > 0) {
+        furi_mutex_release(at->mutex);
+        return false; // Stage more and commit again once this one reports
+    }
+    uint8_t dirty = dra818_at_dirty_fields(at);
+    at->group_sent = at->group_staged;
+    at->volume_sent = at->volume_staged;
+    at->commit_pending = __builtin_popcount(dirty);
+    at->commit_result = Dra818AtResultOk;
+    at->commit_callback = callback;
+    at->commit_context = context;
+    furi_mutex_release(at->mutex);
+
+    if(!dirty) {
+        if(callback) {
+            callback(Dra818AtResultOk, "", context);
+        }
+        return true;
+    }
+
+    if(dirty & Dra818AtFieldGroup) {
+        if(!dra818_at_set_group(at, &at->group_sent, dra818_at_commit_group_done, at)) {
+            dra818_at_commit_step(at, Dra818AtFieldGroup, Dra818AtResultError);
+        }
+    }
+    if(dirty & Dra818AtFieldVolume) {
+        if(!dra818_at_set_volume(at, at->volume_sent, dra818_at_commit_volume_done, at)) {
+            dra818_at_commit_step(at, Dra818AtFieldVolume, Dra818AtResultError);
+        }
+    }
+    return true;
+}
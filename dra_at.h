@@ -0,0 +1,131 @@
+/*
+ -- dra_at.h
+ -- Asynchronous UART AT-command engine for DRA818V/U and SA818 modules
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <furi_hal_serial.h>
+#include "dra_plan.h"
+
+#define DRA818_AT_BAUD            9600 // Fixed UART rate of the DRA818/SA818
+#define DRA818_AT_QUEUE_SIZE      8 // Commands that may wait behind the one in flight
+#define DRA818_AT_CMD_MAX         64 // Longest command line including CR/LF
+#define DRA818_AT_LINE_MAX        64 // Longest response line kept by the parser
+#define DRA818_AT_TIMEOUT_DEFAULT 1000 // Per-command answer timeout (ms)
+
+typedef enum {
+    Dra818AtResultOk, // The module answered with a success code
+    Dra818AtResultError, // The module answered with a failure code
+    Dra818AtResultTimeout, // No answer before the command timed out
+    Dra818AtResultCancelled, // The engine was stopped before the command completed
+} Dra818AtResult;
+
+/**
+ * Called from the engine worker thread when a command completes.  `response` is
+ * the matching response line without CR/LF (empty on timeout) and is only valid
+ * for the duration of the call.
+*/
+typedef void (*Dra818AtCallback)(Dra818AtResult result, const char* response, void* context);
+
+// Channel parameters sent with AT+DMOSETGROUP.
+typedef struct {
+    bool wide; // 25 kHz (true) or 12.5 kHz (false) channel spacing
+    Dra818Freq tx_freq; // Transmit frequency
+    Dra818Freq rx_freq; // Receive frequency
+    Dra818Tone tx_tone; // Transmit CTCSS/DCS tone
+    uint8_t squelch; // Squelch level 0..8
+    Dra818Tone rx_tone; // Receive CTCSS/DCS tone
+} Dra818AtGroup;
+
+typedef struct Dra818At Dra818At;
+
+/**
+ * @brief      Allocate the engine and start its worker thread.
+ * @param      serial_id  The Flipper UART the module is wired to.
+ * @param      baud       The UART baud rate (DRA818_AT_BAUD for stock modules).
+ * @return     Dra818At object, or NULL if the UART is in use.
+*/
+Dra818At* dra818_at_alloc(FuriHalSerialId serial_id, uint32_t baud);
+
+/**
+ * @brief      Stop the worker, cancel pending commands and release the UART.
+*/
+void dra818_at_free(Dra818At* at);
+
+/**
+ * @brief      Queue a raw command.  Never blocks on the module.
+ * @param      command     Command text without CR/LF, e.g. "AT+DMOCONNECT".
+ * @param      expect      Prefix of the response line that completes it, e.g. "+DMOCONNECT".
+ * @param      timeout_ms  Time allowed for the answer once the command is sent.
+ * @return     false if the queue is full or the command is too long.
+*/
+bool dra818_at_submit(
+    Dra818At* at,
+    const char* command,
+    const char* expect,
+    uint32_t timeout_ms,
+    Dra818AtCallback callback,
+    void* context);
+
+// Number of commands queued or in flight.
+size_t dra818_at_pending(Dra818At* at);
+
+/**
+ * @brief      Drop every command submitted with `context`.  Queued ones are removed
+ *           and one in flight completes without calling back.  If its callback is
+ *           running on the worker right now, this waits for it to return, so once
+ *           it returns `context` may be freed.  Safe to call from such a callback.
+*/
+void dra818_at_cancel(Dra818At* at, void* context);
+
+bool dra818_at_connect(Dra818At* at, Dra818AtCallback callback, void* context);
+/**
+ * @brief      Write the AT+DMOSETGROUP command line for `group` (without CR/LF)
+ *           into `out`.  No allocation and no floating point.
+ * @return     Length written, or 0 if `size` is too small.
+*/
+size_t dra818_at_format_group(char* out, size_t size, const Dra818AtGroup* group);
+
+bool dra818_at_set_group(
+    Dra818At* at,
+    const Dra818AtGroup* group,
+    Dra818AtCallback callback,
+    void* context);
+/**
+ * @brief      Queue an AT+DMOSETGROUP whose text goes out as soon as the UART is
+ *           free but whose CR/LF waits for dra818_at_release(), so the module
+ *           keeps its channel until then.  Commands queued behind it wait too,
+ *           and its timeout only starts once it is released.
+ *           dra818_at_cancel() releases it as well.
+*/
+bool dra818_at_set_group_held(
+    Dra818At* at,
+    const Dra818AtGroup* group,
+    Dra818AtCallback callback,
+    void* context);
+// Send the line ending of the held command submitted with `context`.
+void dra818_at_release(Dra818At* at, void* context);
+bool dra818_at_set_volume(Dra818At* at, uint8_t volume, Dra818AtCallback callback, void* context);
+bool dra818_at_read_rssi(Dra818At* at, Dra818AtCallback callback, void* context);
+
+/**
+ * Configuration shadow.  Staging a field only records it; dra818_at_commit()
+ * then sends just the fields that differ from what the module last
+ * acknowledged.  The callback runs once, after every command of the commit has
+ * completed (immediately, on the caller's thread, if nothing changed).
+ * dra818_at_cancel() with the commit's `context` drops its commands that have
+ * not gone out yet and its callback.
+ * Call dra818_at_invalidate() after a module reset so everything is resent.
+*/
+void dra818_at_stage_group(Dra818At* at, const Dra818AtGroup* group);
+void dra818_at_stage_volume(Dra818At* at, uint8_t volume);
+bool dra818_at_commit(Dra818At* at, Dra818AtCallback callback, void* context);
+bool dra818_at_is_dirty(Dra818At* at);
+void dra818_at_invalidate(Dra818At* at);
+
+// Parse the value of an "RSSI=nnn" response; returns false if it is not one.
+bool dra818_at_parse_rssi(const char* response, uint8_t* rssi);
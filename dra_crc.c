@@ -0,0 +1,63 @@
+/*
+ -- dra_crc.c
+ -- CRC-16 helpers shared by the settings record, the host link and AX.25
+*/
+
+#include "dra_crc.h"
+
+// 0x1021 applied to each nibble value, MSB first.
+static const uint16_t dra818_crc16_ccitt_table[16] = {
+    0x0000,
+    0x1021,
+    0x2042,
+    0x3063,
+    0x4084,
+    0x50A5,
+    0x60C6,
+    0x70E7,
+    0x8108,
+    0x9129,
+    0xA14A,
+    0xB16B,
+    0xC18C,
+    0xD1AD,
+    0xE1CE,
+    0xF1EF,
+};
+
+// The same polynomial reflected (0x8408), LSB first.
+static const uint16_t dra818_crc16_x25_table[16] = {
+    0x0000,
+    0x1081,
+    0x2102,
+    0x3183,
+    0x4204,
+    0x5285,
+    0x6306,
+    0x7387,
+    0x8408,
+    0x9489,
+    0xA50A,
+    0xB58B,
+    0xC60C,
+    0xD68D,
+    0xE70E,
+    0xF78F,
+};
+
+uint16_t dra818_crc16_ccitt(uint16_t crc, const uint8_t* data, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        crc = (crc << 4) ^ dra818_crc16_ccitt_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ dra818_crc16_ccitt_table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+uint16_t dra818_crc16_x25(const uint8_t* data, size_t size) {
+    uint16_t crc = DRA818_CRC16_INIT;
+    for(size_t i = 0; i < size; i++) {
+        crc = (crc >> 4) ^ dra818_crc16_x25_table[(crc ^ data[i]) & 0x0F];
+        crc = (crc >> 4) ^ dra818_crc16_x25_table[(crc ^ (data[i] >> 4)) & 0x0F];
+    }
+    return crc ^ 0xFFFF;
+}
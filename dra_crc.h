@@ -0,0 +1,20 @@
+/*
+ -- dra_crc.h
+ -- CRC-16 helpers shared by the settings record, the host link and AX.25
+ --
+ -- Both variants use the 0x1021 polynomial and a 16-entry table, so each byte
+ -- costs two lookups instead of eight shifts.
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DRA818_CRC16_INIT 0xFFFF // Starting value of both variants
+
+// CRC-16/CCITT-FALSE (MSB first, no final XOR).  Pass the previous result to continue.
+uint16_t dra818_crc16_ccitt(uint16_t crc, const uint8_t* data, size_t size);
+
+// CRC-16/X.25 (LSB first, final XOR), the AX.25 frame check sequence.
+uint16_t dra818_crc16_x25(const uint8_t* data, size_t size);
@@ -0,0 +1,741 @@
+/*
+ -- dra_host.c
+ -- Host control service for DRA818V/U modules over USB serial
+*/
+
+#include <furi.h>
+#include <storage/storage.h>
+#include <stdio.h>
+#include <string.h>
+#include "dra_crc.h"
+#include "dra_host.h"
+#include "dra_port.h"
+#include "dra_stats.h"
+
+#define TAG "Dra818Host"
+
+#define DRA818_HOST_RX_BATCH     16 // Packets read before the worker looks at anything else
+#define DRA818_HOST_PASS_RESULTS (DRA818_RADIO_PASS_QUEUE * 2) // Waiting plus in flight
+#define DRA818_HOST_CSV_ROW_MAX  96 // Longest CSV row written for an uploaded memory
+
+// Columns the memory importer reads (RepeaterBook names, where they differ from CHIRP's).
+#define DRA818_HOST_CSV_HEADER \
+    "Name,Frequency,Input Frequency,Uplink Tone,Downlink Tone,Mode,Bank\n"
+
+typedef enum {
+    Dra818HostEvtStop = (1 << 0),
+    Dra818HostEvtRx = (1 << 1), // A packet arrived (from the USB interrupt)
+    Dra818HostEvtTxDone = (1 << 2), // The last packet went out (from the USB interrupt)
+    Dra818HostEvtPass = (1 << 3), // Passthrough results queued
+    Dra818HostEvtSquelch = (1 << 4), // The squelch changed
+} Dra818HostEvtFlags;
+
+// TxDone is only waited for while sending.
+#define DRA818_HOST_ALL_EVENTS \
+    (Dra818HostEvtStop | Dra818HostEvtRx | Dra818HostEvtPass | Dra818HostEvtSquelch)
+
+typedef struct {
+    bool ok;
+    Dra818RadioPassResult result;
+} Dra818HostPassDone;
+
+struct Dra818Host {
+    Dra818HostConfig config;
+    FuriThread* thread;
+    FuriMutex* mutex; // Guards status, stats and the bank flags; never held for SD access
+    FuriMessageQueue* pass_results; // Dra818HostPassDone, from the radio thread
+    volatile bool stopping; // Late callbacks must no longer signal the worker
+
+    Dra818HostStatus status;
+    Dra818HostStats stats; // Copy of counters for other threads
+    bool bank_busy;
+    bool bank_open; // The worker has the bank open for this batch of requests
+    bool bank_waiting; // dra818_host_set_bank_busy() waits for bank_closed
+    FuriSemaphore* bank_closed;
+
+    // Worker-owned state.
+    Dra818HostParser parser;
+    Dra818HostStats counters;
+    Dra818Mem* mem; // Opened by the first bank request of a batch, closed after it
+    uint8_t tx[DRA818_HOST_TX_BUFFER];
+    size_t tx_fill;
+    uint32_t tx_frames; // Frames in tx
+    bool stalled; // The host stopped taking packets; output is dropped until it sends again
+    uint32_t status_period_ms; // 0: not subscribed
+    uint32_t status_due; // Tick of the next status event
+    uint8_t event_seq;
+    Storage* storage;
+    File* upload; // Staging CSV while an upload is open
+    uint32_t upload_rows;
+    uint8_t payload[DRA818_HOST_PAYLOAD_MAX]; // Response being built
+    Dra818Memory memories[DRA818_HOST_MEM_PER_FRAME];
+    char csv[DRA818_HOST_MEM_PER_FRAME * DRA818_HOST_CSV_ROW_MAX];
+};
+
+static uint8_t* dra818_host_put(uint8_t* p, uint32_t value, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        *p++ = value >> (8 * i);
+    }
+    return p;
+}
+
+static uint32_t dra818_host_take(const uint8_t** p, size_t size) {
+    uint32_t value = 0;
+    for(size_t i = 0; i < size; i++) {
+        value |= (uint32_t)(*p)[i] << (8 * i);
+    }
+    *p += size;
+    return value;
+}
+
+size_t dra818_host_frame(
+    uint8_t* out,
+    uint8_t seq,
+    uint8_t cmd,
+    const uint8_t* payload,
+    size_t size) {
+    uint8_t* p = out;
+    *p++ = DRA818_HOST_SYNC;
+    p = dra818_host_put(p, size, 2);
+    *p++ = seq;
+    *p++ = cmd;
+    if(size) {
+        memmove(p, payload, size);
+        p += size;
+    }
+    p = dra818_host_put(p, dra818_crc16_ccitt(DRA818_CRC16_INIT, out + 1, size + 4), 2);
+    return p - out;
+}
+
+void dra818_host_parser_reset(Dra818HostParser* parser) {
+    memset(parser, 0, sizeof(Dra818HostParser));
+}
+
+static void dra818_host_parser_drop(Dra818HostParser* parser, size_t count) {
+    memmove(parser->buffer, parser->buffer + count, parser->fill - count);
+    parser->fill -= count;
+}
+
+// Deliver every complete frame in the buffer.  A bad frame only costs its sync byte, so a
+// frame that starts inside it is still found.
+static void dra818_host_parser_scan(
+    Dra818HostParser* parser,
+    Dra818HostFrameCallback callback,
+    void* context) {
+    while(true) {
+        size_t skip = 0;
+        while(skip < parser->fill && parser->buffer[skip] != DRA818_HOST_SYNC) {
+            skip++;
+        }
+        if(skip) {
+            parser->stats.skipped += skip;
+            dra818_host_parser_drop(parser, skip);
+        }
+        if(parser->fill < 3) {
+            return;
+        }
+        size_t length = parser->buffer[1] | parser->buffer[2] << 8;
+        if(length > DRA818_HOST_PAYLOAD_MAX) {
+            parser->stats.crc_errors++;
+            dra818_host_parser_drop(parser, 1);
+            continue;
+        }
+        size_t total = length + DRA818_HOST_OVERHEAD;
+        if(parser->fill < total) {
+            return;
+        }
+        uint16_t crc = parser->buffer[total - 2] | parser->buffer[total - 1] << 8;
+        if(dra818_crc16_ccitt(DRA818_CRC16_INIT, parser->buffer + 1, length + 4) != crc) {
+            parser->stats.crc_errors++;
+            dra818_host_parser_drop(parser, 1);
+            continue;
+        }
+        parser->stats.frames++;
+        callback(parser->buffer[3], parser->buffer[4], parser->buffer + 5, length, context);
+        dra818_host_parser_drop(parser, total);
+    }
+}
+
+void dra818_host_parse(
+    Dra818HostParser* parser,
+    const uint8_t* data,
+    size_t size,
+    Dra818HostFrameCallback callback,
+    void* context) {
+    // A full buffer always holds a whole frame or a bad one, so each scan makes room.
+    while(size > 0) {
+        size_t take = MIN(size, sizeof(parser->buffer) - parser->fill);
+        memcpy(parser->buffer + parser->fill, data, take);
+        parser->fill += take;
+        data += take;
+        size -= take;
+        dra818_host_parser_scan(parser, callback, context);
+    }
+}
+
+void dra818_host_put_memory(uint8_t* out, const Dra818Memory* memory) {
+    uint8_t* p = out;
+    p = dra818_host_put(p, memory->number, 4);
+    p = dra818_host_put(p, memory->rx_freq, 4);
+    p = dra818_host_put(p, memory->tx_freq, 4);
+    p = dra818_host_put(p, memory->rx_tone, 2);
+    p = dra818_host_put(p, memory->tx_tone, 2);
+    *p++ = memory->bank;
+    *p++ = memory->wide ? 1 : 0;
+    memset(p, 0, DRA818_MEM_NAME_MAX);
+    memcpy(p, memory->name, strnlen(memory->name, DRA818_MEM_NAME_MAX - 1));
+}
+
+void dra818_host_take_memory(const uint8_t* in, Dra818Memory* memory) {
+    const uint8_t* p = in;
+    memory->number = dra818_host_take(&p, 4);
+    memory->rx_freq = dra818_host_take(&p, 4);
+    memory->tx_freq = dra818_host_take(&p, 4);
+    memory->rx_tone = dra818_host_take(&p, 2);
+    memory->tx_tone = dra818_host_take(&p, 2);
+    memory->bank = *p++;
+    memory->wide = (*p++ & 1) != 0;
+    memcpy(memory->name, p, DRA818_MEM_NAME_MAX);
+    memory->name[DRA818_MEM_NAME_MAX - 1] = '\0';
+}
+
+static void dra818_host_signal(Dra818Host* host, uint32_t flags) {
+    if(!host->stopping) {
+        furi_thread_flags_set(furi_thread_get_id(host->thread), flags);
+    }
+}
+
+static void dra818_host_rx_ready(void* context) {
+    dra818_host_signal(context, Dra818HostEvtRx);
+}
+
+static void dra818_host_tx_done(void* context) {
+    dra818_host_signal(context, Dra818HostEvtTxDone);
+}
+
+// Send what is collected, a packet at a time.  A transfer that ends on a full packet needs an
+// empty one to end it.
+static void dra818_host_flush(Dra818Host* host) {
+    if(host->tx_fill == 0) {
+        return;
+    }
+    size_t sent = 0;
+    size_t chunk = 0;
+    while(!host->stalled && (sent < host->tx_fill || chunk == DRA818_PORT_LINK_PACKET)) {
+        chunk = MIN(host->tx_fill - sent, (size_t)DRA818_PORT_LINK_PACKET);
+        furi_thread_flags_clear(Dra818HostEvtTxDone);
+        dra818_port_link_send(host->tx + sent, chunk);
+        uint32_t flags = furi_thread_flags_wait(
+            Dra818HostEvtTxDone, FuriFlagWaitAny, furi_ms_to_ticks(DRA818_HOST_TX_TIMEOUT_MS));
+        if(flags & FuriFlagError) {
+            host->counters.tx_timeouts++;
+            host->stalled = true;
+        }
+        sent += chunk;
+    }
+    if(host->stalled) {
+        host->counters.dropped += host->tx_frames;
+    } else {
+        host->counters.bytes_tx += host->tx_fill;
+        host->counters.transfers++;
+        host->counters.batch_max = MAX(host->counters.batch_max, host->tx_frames);
+    }
+    host->tx_fill = 0;
+    host->tx_frames = 0;
+}
+
+static void dra818_host_send(
+    Dra818Host* host,
+    uint8_t seq,
+    uint8_t cmd,
+    const uint8_t* payload,
+    size_t size) {
+    if(host->tx_fill + size + DRA818_HOST_OVERHEAD > sizeof(host->tx)) {
+        dra818_host_flush(host);
+    }
+    host->tx_fill += dra818_host_frame(host->tx + host->tx_fill, seq, cmd, payload, size);
+    host->tx_frames++;
+    host->counters.responses++;
+}
+
+// Answer with the `size` bytes built after the result byte in host->payload.
+static void
+    dra818_host_reply(Dra818Host* host, uint8_t seq, uint8_t cmd, uint8_t result, size_t size) {
+    if(result != Dra818HostResultOk) {
+        host->counters.errors++;
+    }
+    host->payload[0] = result;
+    dra818_host_send(host, seq, cmd | DRA818_HOST_RESPONSE, host->payload, size + 1);
+}
+
+static size_t dra818_host_format_status(Dra818Host* host, uint8_t* out) {
+    furi_mutex_acquire(host->mutex, FuriWaitForever);
+    Dra818HostStatus status = host->status;
+    furi_mutex_release(host->mutex);
+    uint8_t* p = out;
+    p = dra818_host_put(p, furi_get_tick(), 4);
+    *p++ = status.init;
+    uint8_t flags = status.squelch_open ? DRA818_HOST_STATUS_SQUELCH : 0;
+    if(status.rssi >= 0) {
+        flags |= DRA818_HOST_STATUS_RSSI;
+    }
+    *p++ = flags;
+    *p++ = status.rssi >= 0 ? status.rssi : 0;
+    p = dra818_host_put(p, status.rx_freq, 4);
+    p = dra818_host_put(p, status.tx_freq, 4);
+    p = dra818_host_put(p, status.power_duty, 2);
+    return p - out;
+}
+
+// Opens the bank for this batch of requests into host->mem (NULL if there is none).
+// False if an import has it.  The mutex only covers the flags; the SD access runs
+// without it, so the radio thread's status updates never wait for the card.
+static bool dra818_host_bank_open(Dra818Host* host) {
+    furi_mutex_acquire(host->mutex, FuriWaitForever);
+    bool busy = host->bank_busy;
+    host->bank_open = host->bank_open || !busy;
+    furi_mutex_release(host->mutex);
+    if(busy) {
+        return false;
+    }
+    if(!host->mem) {
+        host->mem = dra818_mem_alloc(host->config.memories_dir);
+    }
+    return true;
+}
+
+// Closes the bank after a batch and lets a waiting dra818_host_set_bank_busy() go on.
+static void dra818_host_bank_close(Dra818Host* host) {
+    if(host->mem) {
+        dra818_mem_free(host->mem);
+        host->mem = NULL;
+    }
+    furi_mutex_acquire(host->mutex, FuriWaitForever);
+    bool waiting = host->bank_waiting;
+    host->bank_open = false;
+    host->bank_waiting = false;
+    furi_mutex_release(host->mutex);
+    if(waiting) {
+        furi_semaphore_release(host->bank_closed);
+    }
+}
+
+static Dra818HostResult dra818_host_mem_read(
+    Dra818Host* host,
+    const uint8_t* payload,
+    size_t size,
+    uint8_t* out,
+    size_t* length) {
+    if(size != 5) {
+        return Dra818HostResultBadRequest;
+    }
+    uint32_t first = dra818_host_take(&payload, 4);
+    size_t count = MIN(*payload, (uint8_t)DRA818_HOST_MEM_PER_FRAME);
+
+    if(!dra818_host_bank_open(host)) {
+        return Dra818HostResultBusy;
+    }
+    count = host->mem ? dra818_mem_read_run(host->mem, first, host->memories, count) : 0;
+
+    out[0] = count;
+    for(size_t i = 0; i < count; i++) {
+        dra818_host_put_memory(out + 1 + i * DRA818_HOST_MEM_RECORD, &host->memories[i]);
+    }
+    *length = 1 + count * DRA818_HOST_MEM_RECORD;
+    return Dra818HostResultOk;
+}
+
+// Tone as the importer's RepeaterBook columns take it: "", "88.5" or "D023N".
+static size_t dra818_host_format_tone(char* out, Dra818Tone tone) {
+    if(tone == DRA818_TONE_NONE) {
+        return 0;
+    }
+    if(DRA818_TONE_IS_DCS(tone)) {
+        out[0] = 'D';
+        dra818_plan_format_tone(out + 1, tone);
+        return 5;
+    }
+    uint16_t tenths = dra818_ctcss_tones[tone - 1];
+    return snprintf(out, 8, "%u.%u", tenths / 10, tenths % 10);
+}
+
+// One CSV row under DRA818_HOST_CSV_HEADER.
+static size_t dra818_host_format_row(char* out, const Dra818Memory* memory) {
+    char* p = out;
+    *p++ = '"';
+    for(size_t i = 0; i < DRA818_MEM_NAME_MAX - 1 && memory->name[i]; i++) {
+        char c = memory->name[i];
+        if(c == '"') {
+            *p++ = '"';
+        }
+        *p++ = (uint8_t)c < ' ' ? ' ' : c;
+    }
+    *p++ = '"';
+    *p++ = ',';
+    p += dra818_plan_format_freq(p, memory->rx_freq);
+    *p++ = ',';
+    p += dra818_plan_format_freq(p, memory->tx_freq);
+    *p++ = ',';
+    p += dra818_host_format_tone(p, memory->tx_tone);
+    *p++ = ',';
+    p += dra818_host_format_tone(p, memory->rx_tone);
+    p += snprintf(p, 12, ",%s,%u\n", memory->wide ? "FM" : "NFM", memory->bank);
+    return p - out;
+}
+
+static void dra818_host_upload_close(Dra818Host* host) {
+    if(host->upload) {
+        storage_file_close(host->upload);
+        storage_file_free(host->upload);
+        host->upload = NULL;
+    }
+}
+
+static Dra818HostResult dra818_host_upload_begin(Dra818Host* host) {
+    dra818_host_upload_close(host);
+    host->upload_rows = 0;
+    host->upload = storage_file_alloc(host->storage);
+    const char* header = DRA818_HOST_CSV_HEADER;
+    const char* path = host->config.upload_path;
+    if(!storage_file_open(host->upload, path, FSAM_WRITE, FSOM_CREATE_ALWAYS) ||
+       storage_file_write(host->upload, header, strlen(header)) != strlen(header)) {
+        dra818_host_upload_close(host);
+        return Dra818HostResultFailed;
+    }
+    return Dra818HostResultOk;
+}
+
+// The whole frame is checked before any of it is written, so a rejected frame can be resent.
+static Dra818HostResult dra818_host_upload_data(
+    Dra818Host* host,
+    const uint8_t* payload,
+    size_t size,
+    uint8_t* out,
+    size_t* length) {
+    if(!host->upload || size == 0 || size % DRA818_HOST_MEM_RECORD != 0) {
+        return Dra818HostResultBadRequest;
+    }
+    size_t count = size / DRA818_HOST_MEM_RECORD;
+    size_t bytes = 0;
+    for(size_t i = 0; i < count; i++) {
+        Dra818Memory* memory = &host->memories[0];
+        dra818_host_take_memory(payload + i * DRA818_HOST_MEM_RECORD, memory);
+        if(!dra818_plan_tone_valid(memory->rx_tone) || !dra818_plan_tone_valid(memory->tx_tone)) {
+            return Dra818HostResultBadRequest;
+        }
+        bytes += dra818_host_format_row(host->csv + bytes, memory);
+    }
+    if(storage_file_write(host->upload, host->csv, bytes) != bytes) {
+        dra818_host_upload_close(host);
+        return Dra818HostResultFailed;
+    }
+    host->upload_rows += count;
+    dra818_host_put(out, host->upload_rows, 4);
+    *length = 4;
+    return Dra818HostResultOk;
+}
+
+static Dra818HostResult dra818_host_upload_commit(Dra818Host* host) {
+    if(!host->upload) {
+        return Dra818HostResultBadRequest;
+    }
+    dra818_host_upload_close(host);
+    FURI_LOG_I(TAG, "Upload of %lu memories committed", host->upload_rows);
+    bool started =
+        host->config.import && host->config.import(host->config.upload_path, host->config.context);
+    return started ? Dra818HostResultOk : Dra818HostResultBusy;
+}
+
+// Hand a passthrough request to the radio; its response is sent when the result comes back.
+static Dra818HostResult dra818_host_pass(
+    Dra818Host* host,
+    uint8_t seq,
+    uint8_t cmd,
+    const uint8_t* payload,
+    size_t size) {
+    Dra818RadioPass pass;
+    memset(&pass, 0, sizeof(pass));
+    pass.tag = seq | (uint32_t)cmd << 8;
+    switch(cmd) {
+    case Dra818HostCmdAt: {
+        if(size < 3) {
+            return Dra818HostResultBadRequest;
+        }
+        pass.type = Dra818RadioPassAt;
+        pass.timeout_ms = dra818_host_take(&payload, 2);
+        size_t expect = *payload++;
+        size_t command = size - 3 - MIN(expect, size - 3);
+        if(expect >= sizeof(pass.expect) || command == 0 || command >= sizeof(pass.command)) {
+            return Dra818HostResultBadRequest;
+        }
+        memcpy(pass.expect, payload, expect);
+        memcpy(pass.command, payload + expect, command);
+        if(pass.timeout_ms == 0) {
+            pass.timeout_ms = DRA818_AT_TIMEOUT_DEFAULT;
+        }
+        break;
+    }
+    case Dra818HostCmdRegRead:
+        if(size != 2 || payload[1] == 0 || payload[1] > DRA818_BURST_MAX) {
+            return Dra818HostResultBadRequest;
+        }
+        pass.type = Dra818RadioPassRead;
+        pass.reg = payload[0];
+        pass.count = payload[1];
+        break;
+    case Dra818HostCmdRegWrite:
+        if(size < 2 || size - 1 > DRA818_BURST_MAX) {
+            return Dra818HostResultBadRequest;
+        }
+        pass.type = Dra818RadioPassWrite;
+        pass.reg = payload[0];
+        pass.count = size - 1;
+        memcpy(pass.values, payload + 1, pass.count);
+        break;
+    }
+    return dra818_radio_passthrough(host->config.radio, &pass) ? Dra818HostResultOk :
+                                                                 Dra818HostResultBusy;
+}
+
+static void dra818_host_pass_reply(Dra818Host* host) {
+    Dra818HostPassDone done;
+    while(furi_message_queue_get(host->pass_results, &done, 0) == FuriStatusOk) {
+        uint8_t seq = done.result.tag & 0xFF;
+        uint8_t cmd = (done.result.tag >> 8) & 0xFF;
+        uint8_t* out = host->payload + 1;
+        size_t length = 0;
+        if(cmd == Dra818HostCmdAt) {
+            out[0] = done.result.at_result;
+            length = strnlen(done.result.response, sizeof(done.result.response));
+            memcpy(out + 1, done.result.response, length);
+            length++;
+        } else if(cmd == Dra818HostCmdRegRead) {
+            length = done.result.count;
+            memcpy(out, done.result.values, length);
+        }
+        dra818_host_reply(
+            host, seq, cmd, done.ok ? Dra818HostResultOk : Dra818HostResultFailed, length);
+    }
+}
+
+static void dra818_host_request(
+    uint8_t seq,
+    uint8_t cmd,
+    const uint8_t* payload,
+    size_t size,
+    void* context) {
+    Dra818Host* host = context;
+    uint8_t* out = host->payload + 1;
+    size_t length = 0;
+    Dra818HostResult result = Dra818HostResultOk;
+    DRA818_STATS_BEGIN(start);
+    switch(cmd) {
+    case Dra818HostCmdPing:
+        if(size >= DRA818_HOST_PAYLOAD_MAX) {
+            result = Dra818HostResultBadRequest;
+            break;
+        }
+        memcpy(out, payload, size);
+        length = size;
+        break;
+    case Dra818HostCmdInfo: {
+        uint32_t count =
+            dra818_host_bank_open(host) && host->mem ? dra818_mem_count(host->mem) : 0;
+        uint8_t* p = out;
+        *p++ = DRA818_HOST_VERSION;
+        p = dra818_host_put(p, DRA818_HOST_PAYLOAD_MAX, 2);
+        p = dra818_host_put(p, count, 4);
+        length = p - out;
+        break;
+    }
+    case Dra818HostCmdStatus:
+        length = dra818_host_format_status(host, out);
+        break;
+    case Dra818HostCmdSubscribe:
+        if(size != 2) {
+            result = Dra818HostResultBadRequest;
+            break;
+        }
+        host->status_period_ms = dra818_host_take(&payload, 2);
+        if(host->status_period_ms) {
+            host->status_period_ms =
+                MAX(host->status_period_ms, (uint32_t)DRA818_HOST_STATUS_MIN_MS);
+            host->status_due = furi_get_tick() + host->status_period_ms;
+        }
+        break;
+    case Dra818HostCmdMemRead:
+        result = dra818_host_mem_read(host, payload, size, out, &length);
+        break;
+    case Dra818HostCmdUploadBegin:
+        result = dra818_host_upload_begin(host);
+        break;
+    case Dra818HostCmdUploadData:
+        result = dra818_host_upload_data(host, payload, size, out, &length);
+        break;
+    case Dra818HostCmdUploadCommit:
+        result = dra818_host_upload_commit(host);
+        break;
+    case Dra818HostCmdAt:
+    case Dra818HostCmdRegRead:
+    case Dra818HostCmdRegWrite:
+        result = dra818_host_pass(host, seq, cmd, payload, size);
+        if(result == Dra818HostResultOk) {
+            DRA818_STATS_END(start, Dra818StatHost, true);
+            return; // Answered once the module is done
+        }
+        break;
+    default:
+        result = Dra818HostResultUnknown;
+        break;
+    }
+    dra818_host_reply(host, seq, cmd, result, result == Dra818HostResultOk ? length : 0);
+    DRA818_STATS_END(start, Dra818StatHost, result == Dra818HostResultOk);
+}
+
+static void dra818_host_status_event(Dra818Host* host) {
+    uint8_t* out = host->payload + 1;
+    host->payload[0] = Dra818HostResultOk;
+    size_t length = dra818_host_format_status(host, out);
+    dra818_host_send(
+        host,
+        host->event_seq++,
+        Dra818HostCmdStatus | DRA818_HOST_RESPONSE | DRA818_HOST_EVENT,
+        host->payload,
+        length + 1);
+}
+
+static int32_t dra818_host_worker(void* context) {
+    Dra818Host* host = context;
+    uint8_t packet[DRA818_PORT_LINK_PACKET];
+    while(true) {
+        uint32_t timeout = FuriWaitForever;
+        if(host->status_period_ms) {
+            int32_t wait_ms = host->status_due - furi_get_tick();
+            timeout = furi_ms_to_ticks(MAX(wait_ms, 1L));
+        }
+        uint32_t events = furi_thread_flags_wait(DRA818_HOST_ALL_EVENTS, FuriFlagWaitAny, timeout);
+        if(events & FuriFlagError) {
+            events = 0; // Timeout: only the status stream is due
+        }
+        if(events & Dra818HostEvtStop) {
+            break;
+        }
+        if(events & Dra818HostEvtRx) {
+            size_t size = 0;
+            size_t packets = 0;
+            while(packets < DRA818_HOST_RX_BATCH &&
+                  (size = dra818_port_link_receive(packet, sizeof(packet))) > 0) {
+                packets++;
+                host->counters.bytes_rx += size;
+                host->stalled = false;
+                dra818_host_parse(&host->parser, packet, size, dra818_host_request, host);
+            }
+            if(packets == DRA818_HOST_RX_BATCH) {
+                dra818_host_signal(host, Dra818HostEvtRx); // More may be waiting
+            }
+            dra818_host_bank_close(host);
+        }
+        if(events & Dra818HostEvtPass) {
+            dra818_host_pass_reply(host);
+        }
+        if(host->status_period_ms) {
+            uint32_t now = furi_get_tick();
+            bool due = (int32_t)(now - host->status_due) >= 0;
+            if(due || (events & Dra818HostEvtSquelch)) {
+                dra818_host_status_event(host);
+            }
+            if(due) {
+                host->status_due = now + host->status_period_ms;
+            }
+        }
+        dra818_host_flush(host);
+
+        furi_mutex_acquire(host->mutex, FuriWaitForever);
+        host->stats = host->counters;
+        host->stats.parser = host->parser.stats;
+        furi_mutex_release(host->mutex);
+    }
+    return 0;
+}
+
+Dra818Host* dra818_host_alloc(const Dra818HostConfig* config) {
+    Dra818Host* host = malloc(sizeof(Dra818Host));
+    memset(host, 0, sizeof(Dra818Host));
+    host->config = *config;
+    host->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    host->bank_closed = furi_semaphore_alloc(1, 0);
+    host->pass_results =
+        furi_message_queue_alloc(DRA818_HOST_PASS_RESULTS, sizeof(Dra818HostPassDone));
+    host->status.rssi = -1;
+    host->status.power_duty = 1000;
+    host->storage = furi_record_open(RECORD_STORAGE);
+
+    // The worker runs first, so the link callbacks always have a thread to signal.
+    host->thread = furi_thread_alloc_ex(TAG, DRA818_HOST_STACK_SIZE, dra818_host_worker, host);
+    furi_thread_start(host->thread);
+    if(!dra818_port_link_open(dra818_host_rx_ready, dra818_host_tx_done, host)) {
+        FURI_LOG_E(TAG, "USB serial port unavailable");
+        dra818_host_free(host);
+        return NULL;
+    }
+    return host;
+}
+
+void dra818_host_free(Dra818Host* host) {
+    host->stopping = true;
+    furi_thread_flags_set(furi_thread_get_id(host->thread), Dra818HostEvtStop);
+    furi_thread_join(host->thread);
+    furi_thread_free(host->thread);
+    dra818_port_link_close();
+
+    FURI_LOG_I(
+        TAG,
+        "%lu frames, %lu CRC errors, %lu responses in %lu transfers, %lu tx timeouts",
+        host->parser.stats.frames,
+        host->parser.stats.crc_errors,
+        host->counters.responses,
+        host->counters.transfers,
+        host->counters.tx_timeouts);
+    dra818_host_upload_close(host);
+    dra818_host_bank_close(host);
+    furi_record_close(RECORD_STORAGE);
+    furi_message_queue_free(host->pass_results);
+    furi_semaphore_free(host->bank_closed);
+    furi_mutex_free(host->mutex);
+    free(host);
+}
+
+void dra818_host_set_status(Dra818Host* host, const Dra818HostStatus* status) {
+    furi_mutex_acquire(host->mutex, FuriWaitForever);
+    bool squelch = status->squelch_open != host->status.squelch_open;
+    host->status = *status;
+    furi_mutex_release(host->mutex);
+    if(squelch) {
+        dra818_host_signal(host, Dra818HostEvtSquelch);
+    }
+}
+
+void dra818_host_pass_done(Dra818Host* host, bool ok, const Dra818RadioPassResult* result) {
+    Dra818HostPassDone done = {.ok = ok, .result = *result};
+    if(furi_message_queue_put(host->pass_results, &done, 0) == FuriStatusOk) {
+        dra818_host_signal(host, Dra818HostEvtPass);
+    }
+}
+
+void dra818_host_set_bank_busy(Dra818Host* host, bool busy) {
+    furi_mutex_acquire(host->mutex, FuriWaitForever);
+    host->bank_busy = busy;
+    bool wait = busy && host->bank_open;
+    host->bank_waiting = wait;
+    furi_mutex_release(host->mutex);
+    if(wait) {
+        // The worker closes the bank at the end of its batch; no new request opens it.
+        furi_semaphore_acquire(host->bank_closed, FuriWaitForever);
+    }
+}
+
+void dra818_host_get_stats(Dra818Host* host, Dra818HostStats* stats) {
+    furi_mutex_acquire(host->mutex, FuriWaitForever);
+    *stats = host->stats;
+    furi_mutex_release(host->mutex);
+}
@@ -0,0 +1,183 @@
+/*
+ -- dra_host.h
+ -- Host control service for DRA818V/U modules over USB serial
+ --
+ -- A computer drives the app through a small binary protocol on the second USB
+ -- serial port (see dra818_port_link_*).  Every frame is
+ --
+ --   A5 | length (2) | seq | cmd | payload[length] | crc (2)
+ --
+ -- with little-endian fields and a CRC-16/CCITT-FALSE over length..payload.
+ -- The receiver hunts for the next A5 after a bad length or CRC, so a lost or
+ -- garbled byte costs one frame.  Each request gets one response: cmd with
+ -- DRA818_HOST_RESPONSE set, the request's seq, and a payload that starts with
+ -- a Dra818HostResult byte.  Requests are pipelined: the host may send many
+ -- without waiting, they are handled in order, and the responses are batched
+ -- into as few USB transfers as possible.  Passthrough responses come when the
+ -- module answers, so they can overtake later requests; seq tells them apart.
+ -- Unsolicited frames (the status stream) are shaped like a response, with
+ -- DRA818_HOST_EVENT set as well and a running count in seq.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_mem.h"
+#include "dra_plan.h"
+#include "dra_radio.h"
+
+#define DRA818_HOST_VERSION     2
+#define DRA818_HOST_SYNC        0xA5
+#define DRA818_HOST_PAYLOAD_MAX 256
+#define DRA818_HOST_OVERHEAD    7 // Sync, length, seq, cmd and CRC
+#define DRA818_HOST_FRAME_MAX   (DRA818_HOST_PAYLOAD_MAX + DRA818_HOST_OVERHEAD)
+#define DRA818_HOST_RESPONSE    0x80 // Set in cmd of frames from the device
+#define DRA818_HOST_EVENT       0x40 // Set as well in frames nobody asked for
+
+#define DRA818_HOST_MEM_RECORD    36 // Wire size of one memory
+#define DRA818_HOST_MEM_PER_FRAME 7 // Memories in one MemRead response or UploadData request
+#define DRA818_HOST_STATUS_MIN_MS 20 // Fastest status stream
+#define DRA818_HOST_TX_BUFFER     1024 // Responses collected before they go out
+#define DRA818_HOST_TX_TIMEOUT_MS 100 // A packet the host does not take in this time is dropped
+#define DRA818_HOST_STACK_SIZE    2048
+
+#define DRA818_HOST_STATUS_SQUELCH 0x01 // Status flag: the squelch is open
+#define DRA818_HOST_STATUS_RSSI    0x02 // Status flag: rssi holds a reading (any of 0..255)
+
+/**
+ * Requests.  Payload layouts, request -> response (after the result byte):
+ *   Ping         anything -> the same bytes
+ *   Info         - -> version, payload max (2), memories (4)
+ *   Status       - -> tick (4), init state, flags (DRA818_HOST_STATUS_*), rssi (0 unless
+ *                flagged valid), rx freq (4), tx freq (4), power duty permille (2)
+ *   Subscribe    period ms (2; 0 stops) -> -; then a Status event every period
+ *                and whenever the squelch changes
+ *   MemRead      first (4), count -> up to DRA818_HOST_MEM_PER_FRAME memories
+ *   UploadBegin  - -> -; starts a new upload, dropping one not committed
+ *   UploadData   memories -> memories received so far (4)
+ *   UploadCommit - -> -; the uploaded memories replace the bank (asynchronously)
+ *   At           timeout ms (2), expect length, expect, command -> AT result, response
+ *   RegRead      reg, count -> values
+ *   RegWrite     reg, values -> -
+ * A memory is number (4, ignored on upload), rx freq (4), tx freq (4), rx tone (2),
+ * tx tone (2), bank, flags (bit 0: wide) and a zero-padded name of DRA818_MEM_NAME_MAX.
+*/
+typedef enum {
+    Dra818HostCmdPing = 0x01,
+    Dra818HostCmdInfo = 0x02,
+    Dra818HostCmdMemRead = 0x10,
+    Dra818HostCmdUploadBegin = 0x11,
+    Dra818HostCmdUploadData = 0x12,
+    Dra818HostCmdUploadCommit = 0x13,
+    Dra818HostCmdSubscribe = 0x20,
+    Dra818HostCmdStatus = 0x21,
+    Dra818HostCmdAt = 0x30,
+    Dra818HostCmdRegRead = 0x31,
+    Dra818HostCmdRegWrite = 0x32,
+} Dra818HostCmd;
+
+typedef enum {
+    Dra818HostResultOk,
+    Dra818HostResultBadRequest, // Payload too short, too long or out of range
+    Dra818HostResultBusy, // Try again later (queue full, import running)
+    Dra818HostResultFailed, // Carried out, but it did not work
+    Dra818HostResultUnknown, // No such command
+} Dra818HostResult;
+
+typedef struct {
+    uint32_t frames; // Good frames
+    uint32_t crc_errors; // Frames dropped for a bad CRC or length
+    uint32_t skipped; // Bytes dropped while hunting for a sync byte
+} Dra818HostParserStats;
+
+// Frame reassembly.  Zero it (or call dra818_host_parser_reset) before use.
+typedef struct {
+    uint8_t buffer[DRA818_HOST_FRAME_MAX];
+    size_t fill;
+    Dra818HostParserStats stats;
+} Dra818HostParser;
+
+// Called for every good frame; payload is only valid during the call.
+typedef void (*Dra818HostFrameCallback)(
+    uint8_t seq,
+    uint8_t cmd,
+    const uint8_t* payload,
+    size_t size,
+    void* context);
+
+// Write a frame to `out` (DRA818_HOST_OVERHEAD + size bytes); returns its length.
+size_t dra818_host_frame(
+    uint8_t* out,
+    uint8_t seq,
+    uint8_t cmd,
+    const uint8_t* payload,
+    size_t size);
+void dra818_host_parser_reset(Dra818HostParser* parser);
+void dra818_host_parse(
+    Dra818HostParser* parser,
+    const uint8_t* data,
+    size_t size,
+    Dra818HostFrameCallback callback,
+    void* context);
+
+// Wire form of a memory, DRA818_HOST_MEM_RECORD bytes.
+void dra818_host_put_memory(uint8_t* out, const Dra818Memory* memory);
+void dra818_host_take_memory(const uint8_t* in, Dra818Memory* memory);
+
+/**
+ * Called on the service thread when an upload is committed.  The bank must be
+ * imported from `csv_path` elsewhere (it takes a while), with the bank marked
+ * busy meanwhile.  Returns false if that cannot start now.
+*/
+typedef bool (*Dra818HostImportCallback)(const char* csv_path, void* context);
+
+typedef struct {
+    Dra818Radio* radio; // Passthrough requests go here
+    const char* memories_dir; // Bank served to MemRead
+    const char* upload_path; // Uploads are staged here as a CSV the importer reads
+    Dra818HostImportCallback import;
+    void* context;
+} Dra818HostConfig;
+
+// What the Status request and stream report; kept up to date by the app.
+typedef struct {
+    Dra818InitState init;
+    bool squelch_open;
+    int16_t rssi; // -1 if none
+    Dra818Freq rx_freq;
+    Dra818Freq tx_freq;
+    uint16_t power_duty; // Permille; 1000 without power save
+} Dra818HostStatus;
+
+typedef struct {
+    Dra818HostParserStats parser;
+    uint32_t bytes_rx;
+    uint32_t bytes_tx;
+    uint32_t responses; // Frames sent, events included
+    uint32_t errors; // Requests answered with anything but Ok
+    uint32_t transfers; // USB transfers carrying them
+    uint32_t batch_max; // Most frames in one transfer
+    uint32_t tx_timeouts; // Packets the host did not take
+    uint32_t dropped; // Frames thrown away because the host stopped reading
+} Dra818HostStats;
+
+typedef struct Dra818Host Dra818Host;
+
+// Open the link and start the service thread; NULL if the USB port cannot be switched over.
+Dra818Host* dra818_host_alloc(const Dra818HostConfig* config);
+// Stops the service and gives the USB port back.  Passthrough answers still due are dropped.
+void dra818_host_free(Dra818Host* host);
+
+// Safe from any thread.  A squelch change is streamed at once.
+void dra818_host_set_status(Dra818Host* host, const Dra818HostStatus* status);
+// Hand over a Dra818RadioEventPass; safe from any thread.
+void dra818_host_pass_done(Dra818Host* host, bool ok, const Dra818RadioPassResult* result);
+/**
+ * Mark the bank on SD busy (an import is running) or free.  Marking it busy waits
+ * until the service closes its handle on the bank, at most one batch of requests.
+*/
+void dra818_host_set_bank_busy(Dra818Host* host, bool busy);
+
+void dra818_host_get_stats(Dra818Host* host, Dra818HostStats* stats);
@@ -0,0 +1,1001 @@
+/*
+ -- dra_mem.c
+ -- Channel memory bank on SD card for DRA818V/U
+*/
+
+#include <furi.h>
+#include <storage/storage.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dra_mem.h"
+#include "dra_stats.h"
+
+#define TAG "Dra818Mem"
+
+#define DRA818_MEM_MAGIC   0x4D415244 // "DRAM" little-endian
+#define DRA818_MEM_VERSION 1
+
+#define DRA818_MEM_HEADER_SIZE 12 // magic, version, kind, entry size, count
+#define DRA818_MEM_RECORD_SIZE 32
+#define DRA818_MEM_FIDX_SIZE   8 // rx_freq, record (24 bits), bank
+#define DRA818_MEM_NIDX_SIZE   (DRA818_MEM_KEY_SIZE + 4) // name key, record
+
+#define DRA818_MEM_CHUNK         512 // CSV bytes read at a time
+#define DRA818_MEM_LINE_MAX      256 // Longer CSV lines are skipped
+#define DRA818_MEM_COLUMNS_MAX   32 // Columns after this are ignored
+#define DRA818_MEM_WRITE_RECORDS 16 // Records buffered per write
+#define DRA818_MEM_RUN_ENTRIES   1024 // Index entries sorted in RAM per run
+#define DRA818_MEM_FAN_IN        64 // Runs merged in one pass
+#define DRA818_MEM_MERGE_ENTRIES 8 // Entries buffered per run while merging
+#define DRA818_MEM_CACHE_ENTRIES 32 // Index entries read at a time when looking up
+#define DRA818_MEM_RUN_RECORDS   8 // Records read at a time by dra818_mem_read_run
+
+typedef enum {
+    Dra818MemKindRecords,
+    Dra818MemKindFreqIndex,
+    Dra818MemKindNameIndex,
+} Dra818MemKind;
+
+static const char* const dra818_mem_files[] = {
+    [Dra818MemKindRecords] = "memories.bin",
+    [Dra818MemKindFreqIndex] = "memories.fidx",
+    [Dra818MemKindNameIndex] = "memories.nidx",
+};
+
+static const uint16_t dra818_mem_entry_sizes[] = {
+    [Dra818MemKindRecords] = DRA818_MEM_RECORD_SIZE,
+    [Dra818MemKindFreqIndex] = DRA818_MEM_FIDX_SIZE,
+    [Dra818MemKindNameIndex] = DRA818_MEM_NIDX_SIZE,
+};
+
+#define DRA818_MEM_KINDS COUNT_OF(dra818_mem_files)
+
+static uint8_t* dra818_mem_put(uint8_t* out, uint32_t value, size_t bytes) {
+    for(size_t i = 0; i < bytes; i++) {
+        *out++ = value >> (i * 8);
+    }
+    return out;
+}
+
+static uint32_t dra818_mem_take(const uint8_t** in, size_t bytes) {
+    uint32_t value = 0;
+    for(size_t i = 0; i < bytes; i++) {
+        value |= (uint32_t)(*in)[i] << (i * 8);
+    }
+    *in += bytes;
+    return value;
+}
+
+static char dra818_mem_upper(char c) {
+    return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+static bool dra818_mem_same(const char* a, const char* b) {
+    while(*a && dra818_mem_upper(*a) == dra818_mem_upper(*b)) {
+        a++;
+        b++;
+    }
+    return *a == '\0' && *b == '\0';
+}
+
+static void dra818_mem_path(char* out, const char* dir, Dra818MemKind kind, const char* suffix) {
+    snprintf(out, DRA818_MEM_PATH_MAX, "%s/%s%s", dir, dra818_mem_files[kind], suffix);
+}
+
+static bool dra818_mem_write_header(File* file, Dra818MemKind kind, uint32_t count) {
+    uint8_t header[DRA818_MEM_HEADER_SIZE];
+    uint8_t* p = header;
+    p = dra818_mem_put(p, DRA818_MEM_MAGIC, 4);
+    p = dra818_mem_put(p, DRA818_MEM_VERSION, 1);
+    p = dra818_mem_put(p, kind, 1);
+    p = dra818_mem_put(p, dra818_mem_entry_sizes[kind], 2);
+    p = dra818_mem_put(p, count, 4);
+    return storage_file_seek(file, 0, true) &&
+           storage_file_write(file, header, sizeof(header)) == sizeof(header);
+}
+
+// Entry count, or -1 if the file is not a bank file of this kind.
+static int32_t dra818_mem_read_header(File* file, Dra818MemKind kind) {
+    uint8_t header[DRA818_MEM_HEADER_SIZE];
+    if(storage_file_read(file, header, sizeof(header)) != sizeof(header)) {
+        return -1;
+    }
+    const uint8_t* p = header;
+    if(dra818_mem_take(&p, 4) != DRA818_MEM_MAGIC ||
+       dra818_mem_take(&p, 1) != DRA818_MEM_VERSION || dra818_mem_take(&p, 1) != kind ||
+       dra818_mem_take(&p, 2) != dra818_mem_entry_sizes[kind]) {
+        return -1;
+    }
+    uint32_t count = dra818_mem_take(&p, 4);
+    return count <= DRA818_MEM_MAX_RECORDS ? (int32_t)count : -1;
+}
+
+static void dra818_mem_encode(const Dra818Memory* memory, uint8_t* out) {
+    uint8_t* p = out;
+    p = dra818_mem_put(p, memory->rx_freq, 4);
+    p = dra818_mem_put(p, memory->tx_freq, 4);
+    p = dra818_mem_put(p, memory->rx_tone, 2);
+    p = dra818_mem_put(p, memory->tx_tone, 2);
+    p = dra818_mem_put(p, memory->bank, 1);
+    p = dra818_mem_put(p, memory->wide ? 1 : 0, 1);
+    memcpy(p, memory->name, DRA818_MEM_NAME_MAX);
+}
+
+static void dra818_mem_decode(const uint8_t* in, uint32_t number, Dra818Memory* memory) {
+    const uint8_t* p = in;
+    memory->number = number;
+    memory->rx_freq = dra818_mem_take(&p, 4);
+    memory->tx_freq = dra818_mem_take(&p, 4);
+    memory->rx_tone = dra818_mem_take(&p, 2);
+    memory->tx_tone = dra818_mem_take(&p, 2);
+    memory->bank = dra818_mem_take(&p, 1);
+    memory->wide = (dra818_mem_take(&p, 1) & 1) != 0;
+    memcpy(memory->name, p, DRA818_MEM_NAME_MAX);
+    memory->name[DRA818_MEM_NAME_MAX - 1] = '\0';
+}
+
+// Upper-cased leading characters of `name`, zero padded.
+static void dra818_mem_key(const char* name, uint8_t* key) {
+    memset(key, 0, DRA818_MEM_KEY_SIZE);
+    for(size_t i = 0; i < DRA818_MEM_KEY_SIZE && name[i]; i++) {
+        key[i] = dra818_mem_upper(name[i]);
+    }
+}
+
+// Index orders.  Ties are broken on the record number, so every key is unique.
+static int dra818_mem_fidx_compare(const void* a, const void* b) {
+    const uint8_t* pa = a;
+    const uint8_t* pb = b;
+    uint32_t fa = dra818_mem_take(&pa, 4);
+    uint32_t fb = dra818_mem_take(&pb, 4);
+    if(fa != fb) {
+        return fa < fb ? -1 : 1;
+    }
+    uint32_t ra = dra818_mem_take(&pa, 3);
+    uint32_t rb = dra818_mem_take(&pb, 3);
+    return ra < rb ? -1 : ra > rb;
+}
+
+static int dra818_mem_nidx_compare(const void* a, const void* b) {
+    int c = memcmp(a, b, DRA818_MEM_KEY_SIZE);
+    if(c != 0) {
+        return c;
+    }
+    const uint8_t* pa = (const uint8_t*)a + DRA818_MEM_KEY_SIZE;
+    const uint8_t* pb = (const uint8_t*)b + DRA818_MEM_KEY_SIZE;
+    uint32_t ra = dra818_mem_take(&pa, 4);
+    uint32_t rb = dra818_mem_take(&pb, 4);
+    return ra < rb ? -1 : ra > rb;
+}
+
+/**
+ * External sort for one index.  Entries collect in RAM and each full buffer is
+ * sorted and written out as a run; finishing merges the runs into the index.
+*/
+typedef struct {
+    File* file; // Runs, one after another
+    int (*compare)(const void*, const void*);
+    size_t size; // Entry size
+    uint8_t* buffer; // DRA818_MEM_RUN_ENTRIES entries
+    size_t fill;
+    uint32_t runs;
+    uint32_t total;
+    bool ok;
+} Dra818MemSorter;
+
+typedef struct {
+    uint32_t next; // Next entry of the run still on SD
+    uint32_t end;
+    uint8_t pos; // Current entry in data
+    uint8_t fill;
+    uint8_t data[DRA818_MEM_MERGE_ENTRIES * DRA818_MEM_NIDX_SIZE];
+} Dra818MemRun;
+
+static void dra818_mem_sorter_init(
+    Dra818MemSorter* sorter,
+    Storage* storage,
+    const char* path,
+    size_t size,
+    int (*compare)(const void*, const void*)) {
+    sorter->file = storage_file_alloc(storage);
+    sorter->compare = compare;
+    sorter->size = size;
+    sorter->buffer = malloc(DRA818_MEM_RUN_ENTRIES * size);
+    sorter->fill = 0;
+    sorter->runs = 0;
+    sorter->total = 0;
+    sorter->ok = storage_file_open(sorter->file, path, FSAM_READ_WRITE, FSOM_CREATE_ALWAYS);
+}
+
+static void dra818_mem_sorter_free(Dra818MemSorter* sorter) {
+    storage_file_close(sorter->file);
+    storage_file_free(sorter->file);
+    free(sorter->buffer);
+}
+
+static void dra818_mem_sorter_spill(Dra818MemSorter* sorter) {
+    size_t bytes = sorter->fill * sorter->size;
+    qsort(sorter->buffer, sorter->fill, sorter->size, sorter->compare);
+    sorter->ok = sorter->ok && storage_file_write(sorter->file, sorter->buffer, bytes) == bytes;
+    sorter->runs++;
+    sorter->fill = 0;
+}
+
+static void dra818_mem_sorter_add(Dra818MemSorter* sorter, const uint8_t* entry) {
+    memcpy(sorter->buffer + sorter->fill * sorter->size, entry, sorter->size);
+    sorter->total++;
+    if(++sorter->fill == DRA818_MEM_RUN_ENTRIES) {
+        dra818_mem_sorter_spill(sorter);
+    }
+}
+
+static bool dra818_mem_run_refill(Dra818MemSorter* sorter, Dra818MemRun* run) {
+    uint32_t count = MIN(run->end - run->next, (uint32_t)DRA818_MEM_MERGE_ENTRIES);
+    size_t bytes = count * sorter->size;
+    run->pos = 0;
+    run->fill = count;
+    if(!storage_file_seek(sorter->file, run->next * sorter->size, true) ||
+       storage_file_read(sorter->file, run->data, bytes) != bytes) {
+        sorter->ok = false;
+        run->fill = 0;
+    }
+    run->next += count;
+    return run->fill > 0;
+}
+
+static void dra818_mem_heap_down(
+    Dra818MemSorter* sorter,
+    Dra818MemRun* runs,
+    uint8_t* heap,
+    size_t count,
+    size_t i) {
+    while(true) {
+        size_t smallest = i;
+        for(size_t child = 2 * i + 1; child <= 2 * i + 2 && child < count; child++) {
+            Dra818MemRun* a = &runs[heap[child]];
+            Dra818MemRun* b = &runs[heap[smallest]];
+            if(sorter->compare(a->data + a->pos * sorter->size, b->data + b->pos * sorter->size) <
+               0) {
+                smallest = child;
+            }
+        }
+        if(smallest == i) {
+            return;
+        }
+        uint8_t swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+// Write all entries, sorted, to `out` after its header.
+static bool dra818_mem_sorter_finish(Dra818MemSorter* sorter, File* out) {
+    if(sorter->runs == 0) {
+        // Everything fit in RAM: no runs, no merge.
+        size_t bytes = sorter->fill * sorter->size;
+        qsort(sorter->buffer, sorter->fill, sorter->size, sorter->compare);
+        return sorter->ok && storage_file_write(out, sorter->buffer, bytes) == bytes;
+    }
+    if(sorter->fill > 0) {
+        dra818_mem_sorter_spill(sorter);
+    }
+    furi_check(sorter->runs <= DRA818_MEM_FAN_IN);
+
+    Dra818MemRun* runs = malloc(sorter->runs * sizeof(Dra818MemRun));
+    uint8_t heap[DRA818_MEM_FAN_IN];
+    size_t heap_count = 0;
+    for(uint32_t i = 0; i < sorter->runs; i++) {
+        runs[i].next = i * DRA818_MEM_RUN_ENTRIES;
+        runs[i].end = MIN(runs[i].next + DRA818_MEM_RUN_ENTRIES, sorter->total);
+        if(dra818_mem_run_refill(sorter, &runs[i])) {
+            heap[heap_count++] = i;
+        }
+    }
+    for(size_t i = heap_count; i-- > 0;) {
+        dra818_mem_heap_down(sorter, runs, heap, heap_count, i);
+    }
+
+    // The run buffer is free now; it collects the merged output.
+    size_t written = 0;
+    while(heap_count > 0 && sorter->ok) {
+        Dra818MemRun* run = &runs[heap[0]];
+        memcpy(
+            sorter->buffer + written * sorter->size,
+            run->data + run->pos * sorter->size,
+            sorter->size);
+        if(++written == DRA818_MEM_RUN_ENTRIES) {
+            size_t bytes = written * sorter->size;
+            sorter->ok = storage_file_write(out, sorter->buffer, bytes) == bytes;
+            written = 0;
+        }
+        if(++run->pos == run->fill && !dra818_mem_run_refill(sorter, run)) {
+            heap[0] = heap[--heap_count];
+        }
+        dra818_mem_heap_down(sorter, runs, heap, heap_count, 0);
+    }
+    size_t bytes = written * sorter->size;
+    sorter->ok = sorter->ok && storage_file_write(out, sorter->buffer, bytes) == bytes;
+    free(runs);
+    return sorter->ok;
+}
+
+/**
+ * CSV import.  CHIRP exports and RepeaterBook's own CSV name their columns
+ * differently; the header row maps each column to what it holds.
+*/
+typedef enum {
+    Dra818MemColumnNone,
+    Dra818MemColumnFreq,
+    Dra818MemColumnInput, // Transmit frequency (RepeaterBook)
+    Dra818MemColumnName,
+    Dra818MemColumnDuplex, // "+", "-", "split" or "off" (CHIRP)
+    Dra818MemColumnOffset, // MHz, or the transmit frequency for "split"
+    Dra818MemColumnToneMode, // "", "Tone", "TSQL", "DTCS" or "Cross" (CHIRP)
+    Dra818MemColumnRTone,
+    Dra818MemColumnCTone,
+    Dra818MemColumnDcs,
+    Dra818MemColumnDcsPolarity, // "NN", "NR", "RN" or "RR": transmit, then receive
+    Dra818MemColumnUplinkTone, // "100.0" or "D023N" (RepeaterBook)
+    Dra818MemColumnDownlinkTone,
+    Dra818MemColumnMode, // "FM" or "NFM"; other modes are skipped
+    Dra818MemColumnBank,
+    Dra818MemColumnCount,
+} Dra818MemColumn;
+
+static const struct {
+    const char* name;
+    Dra818MemColumn column;
+} dra818_mem_headers[] = {
+    {"Frequency", Dra818MemColumnFreq},
+    {"Output Freq", Dra818MemColumnFreq},
+    {"Output Frequency", Dra818MemColumnFreq},
+    {"Input Freq", Dra818MemColumnInput},
+    {"Input Frequency", Dra818MemColumnInput},
+    {"Name", Dra818MemColumnName},
+    {"Call", Dra818MemColumnName},
+    {"Callsign", Dra818MemColumnName},
+    {"Duplex", Dra818MemColumnDuplex},
+    {"Offset", Dra818MemColumnOffset},
+    {"Tone", Dra818MemColumnToneMode},
+    {"rToneFreq", Dra818MemColumnRTone},
+    {"cToneFreq", Dra818MemColumnCTone},
+    {"DtcsCode", Dra818MemColumnDcs},
+    {"DtcsPolarity", Dra818MemColumnDcsPolarity},
+    {"Uplink Tone", Dra818MemColumnUplinkTone},
+    {"Downlink Tone", Dra818MemColumnDownlinkTone},
+    {"Mode", Dra818MemColumnMode},
+    {"Bank", Dra818MemColumnBank},
+};
+
+typedef struct {
+    uint8_t columns[DRA818_MEM_COLUMNS_MAX]; // Dra818MemColumn of each CSV column
+    bool header_seen;
+    char line[DRA818_MEM_LINE_MAX];
+    size_t length;
+    bool overflow; // Current line is too long and is being skipped
+    uint8_t records[DRA818_MEM_WRITE_RECORDS * DRA818_MEM_RECORD_SIZE];
+    size_t records_fill;
+} Dra818MemImport;
+
+// Split `line` in place; quoted fields may hold commas and "" for a quote.
+static size_t dra818_mem_split(char* line, char** fields, size_t max) {
+    size_t count = 0;
+    char* in = line;
+    while(count < max) {
+        while(*in == ' ') {
+            in++;
+        }
+        char* out = in;
+        fields[count++] = out;
+        bool quoted = *in == '"';
+        if(quoted) {
+            in++;
+        }
+        while(*in) {
+            if(quoted && *in == '"') {
+                if(in[1] != '"') {
+                    quoted = false;
+                    in++;
+                    continue;
+                }
+                in++;
+            } else if(!quoted && *in == ',') {
+                break;
+            }
+            *out++ = *in++;
+        }
+        bool more = *in == ',';
+        while(out > fields[count - 1] && out[-1] == ' ') {
+            out--;
+        }
+        *out = '\0';
+        if(!more) {
+            break;
+        }
+        in++;
+    }
+    return count;
+}
+
+// "146.520000" -> 1465200.  Digits past the 100 Hz resolution are dropped.
+static Dra818Freq dra818_mem_parse_freq(const char* text) {
+    uint32_t mhz = 0;
+    uint32_t frac = 0;
+    size_t digits = 0;
+    if(*text < '0' || *text > '9') {
+        return 0;
+    }
+    while(*text >= '0' && *text <= '9' && mhz < 10000) {
+        mhz = mhz * 10 + (*text++ - '0');
+    }
+    if(*text == '.') {
+        text++;
+        while(*text >= '0' && *text <= '9' && digits < 4) {
+            frac = frac * 10 + (*text++ - '0');
+            digits++;
+        }
+    }
+    for(; digits < 4; digits++) {
+        frac *= 10;
+    }
+    return DRA818_FREQ_MHZ(mhz, frac);
+}
+
+static bool dra818_mem_parse_ctcss(const char* text, Dra818Tone* tone) {
+    Dra818Freq tenths = dra818_mem_parse_freq(text) / 1000; // 0.1 Hz
+    for(size_t i = 0; i < DRA818_CTCSS_COUNT; i++) {
+        if(dra818_ctcss_tones[i] == tenths) {
+            *tone = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool dra818_mem_parse_dcs(const char* text, bool inverted, Dra818Tone* tone) {
+    uint16_t code = 0;
+    if(*text < '0' || *text > '7') {
+        return false;
+    }
+    while(*text >= '0' && *text <= '7' && code < 0x200) {
+        code = code * 8 + (*text++ - '0');
+    }
+    *tone = DRA818_TONE_DCS(code) | (inverted ? DRA818_TONE_DCS_INVERTED : 0);
+    return dra818_plan_tone_valid(*tone);
+}
+
+// RepeaterBook tone column: "", "CSQ", "88.5", "D023N" or "D023I".
+static bool dra818_mem_parse_tone(const char* text, Dra818Tone* tone) {
+    *tone = DRA818_TONE_NONE;
+    if(*text == '\0' || dra818_mem_same(text, "CSQ")) {
+        return true;
+    }
+    if(*text == 'D' || *text == 'd') {
+        size_t length = strlen(text);
+        char polarity = dra818_mem_upper(text[length - 1]);
+        return dra818_mem_parse_dcs(text + 1, polarity == 'I' || polarity == 'R', tone);
+    }
+    return dra818_mem_parse_ctcss(text, tone);
+}
+
+static bool dra818_mem_in_band(Dra818Freq freq) {
+    for(size_t i = 0; i < DRA818_BAND_COUNT; i++) {
+        if(freq >= dra818_bands[i].min && freq <= dra818_bands[i].max) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool dra818_mem_parse_row(
+    Dra818MemImport* import,
+    char** fields,
+    size_t count,
+    Dra818Memory* memory) {
+    const char* value[Dra818MemColumnCount];
+    for(size_t i = 0; i < Dra818MemColumnCount; i++) {
+        value[i] = "";
+    }
+    for(size_t i = 0; i < count; i++) {
+        value[import->columns[i]] = fields[i];
+    }
+
+    memset(memory, 0, sizeof(Dra818Memory));
+    memory->rx_freq = dra818_mem_parse_freq(value[Dra818MemColumnFreq]);
+    memory->tx_freq = memory->rx_freq;
+    Dra818Freq offset = dra818_mem_parse_freq(value[Dra818MemColumnOffset]);
+    const char* duplex = value[Dra818MemColumnDuplex];
+    if(*value[Dra818MemColumnInput]) {
+        memory->tx_freq = dra818_mem_parse_freq(value[Dra818MemColumnInput]);
+    } else if(dra818_mem_same(duplex, "+")) {
+        memory->tx_freq += offset;
+    } else if(dra818_mem_same(duplex, "-")) {
+        memory->tx_freq -= offset;
+    } else if(dra818_mem_same(duplex, "split")) {
+        memory->tx_freq = offset;
+    }
+    if(!dra818_mem_in_band(memory->rx_freq) || !dra818_mem_in_band(memory->tx_freq)) {
+        return false;
+    }
+
+    const char* mode = value[Dra818MemColumnMode];
+    bool narrow = dra818_mem_same(mode, "NFM");
+    if(*mode && !narrow && !dra818_mem_same(mode, "FM")) {
+        return false; // AM, DV, DMR...
+    }
+    memory->wide = !narrow;
+
+    bool ok = true;
+    const char* tone_mode = value[Dra818MemColumnToneMode];
+    const char* polarity = value[Dra818MemColumnDcsPolarity];
+    if(dra818_mem_same(tone_mode, "Tone")) {
+        ok = dra818_mem_parse_ctcss(value[Dra818MemColumnRTone], &memory->tx_tone);
+    } else if(dra818_mem_same(tone_mode, "TSQL")) {
+        ok = dra818_mem_parse_ctcss(value[Dra818MemColumnCTone], &memory->tx_tone);
+        memory->rx_tone = memory->tx_tone;
+    } else if(dra818_mem_same(tone_mode, "DTCS")) {
+        const char* code = value[Dra818MemColumnDcs];
+        ok = dra818_mem_parse_dcs(code, polarity[0] == 'R', &memory->tx_tone) &&
+             dra818_mem_parse_dcs(code, polarity[0] && polarity[1] == 'R', &memory->rx_tone);
+    } else if(dra818_mem_same(tone_mode, "Cross")) {
+        // Only the common Tone->Tone form maps onto the module.
+        ok = dra818_mem_parse_ctcss(value[Dra818MemColumnRTone], &memory->tx_tone) &&
+             dra818_mem_parse_ctcss(value[Dra818MemColumnCTone], &memory->rx_tone);
+    } else {
+        ok = dra818_mem_parse_tone(value[Dra818MemColumnUplinkTone], &memory->tx_tone) &&
+             dra818_mem_parse_tone(value[Dra818MemColumnDownlinkTone], &memory->rx_tone);
+    }
+    if(!ok) {
+        return false;
+    }
+
+    uint32_t bank = atoi(value[Dra818MemColumnBank]);
+    memory->bank = bank < DRA818_MEM_BANK_ANY ? bank : 0;
+    strlcpy(memory->name, value[Dra818MemColumnName], sizeof(memory->name));
+    return true;
+}
+
+typedef struct {
+    Dra818MemImport* import;
+    File* records;
+    Dra818MemSorter* sorters; // By frequency, by name
+    Dra818MemImportStats* stats;
+    bool ok;
+} Dra818MemImportJob;
+
+static void dra818_mem_flush_records(Dra818MemImportJob* job) {
+    Dra818MemImport* import = job->import;
+    size_t bytes = import->records_fill * DRA818_MEM_RECORD_SIZE;
+    job->ok = job->ok && storage_file_write(job->records, import->records, bytes) == bytes;
+    import->records_fill = 0;
+}
+
+static void dra818_mem_import_line(Dra818MemImportJob* job) {
+    Dra818MemImport* import = job->import;
+    char* fields[DRA818_MEM_COLUMNS_MAX];
+    if(import->length == 0) {
+        return;
+    }
+    import->line[import->length] = '\0';
+    size_t count = dra818_mem_split(import->line, fields, DRA818_MEM_COLUMNS_MAX);
+
+    if(!import->header_seen) {
+        import->header_seen = true;
+        bool freq = false;
+        for(size_t i = 0; i < count; i++) {
+            import->columns[i] = Dra818MemColumnNone;
+            for(size_t h = 0; h < COUNT_OF(dra818_mem_headers); h++) {
+                if(dra818_mem_same(fields[i], dra818_mem_headers[h].name)) {
+                    import->columns[i] = dra818_mem_headers[h].column;
+                    freq |= dra818_mem_headers[h].column == Dra818MemColumnFreq;
+                    break;
+                }
+            }
+        }
+        if(!freq) {
+            FURI_LOG_E(TAG, "No frequency column in CSV header");
+            job->ok = false;
+        }
+        return;
+    }
+
+    Dra818MemImportStats* stats = job->stats;
+    stats->rows++;
+    Dra818Memory memory;
+    if(stats->imported == DRA818_MEM_MAX_RECORDS) {
+        stats->truncated = true;
+        return;
+    }
+    if(!dra818_mem_parse_row(import, fields, count, &memory)) {
+        stats->skipped++;
+        return;
+    }
+
+    uint32_t number = stats->imported++;
+    dra818_mem_encode(&memory, import->records + import->records_fill * DRA818_MEM_RECORD_SIZE);
+    if(++import->records_fill == DRA818_MEM_WRITE_RECORDS) {
+        dra818_mem_flush_records(job);
+    }
+
+    uint8_t entry[DRA818_MEM_NIDX_SIZE];
+    uint8_t* p = entry;
+    p = dra818_mem_put(p, memory.rx_freq, 4);
+    p = dra818_mem_put(p, number, 3);
+    p = dra818_mem_put(p, memory.bank, 1);
+    dra818_mem_sorter_add(&job->sorters[0], entry);
+    dra818_mem_key(memory.name, entry);
+    dra818_mem_put(entry + DRA818_MEM_KEY_SIZE, number, 4);
+    dra818_mem_sorter_add(&job->sorters[1], entry);
+}
+
+static void dra818_mem_import_chunk(Dra818MemImportJob* job, const char* data, size_t size) {
+    Dra818MemImport* import = job->import;
+    for(size_t i = 0; i < size && job->ok; i++) {
+        char c = data[i];
+        if(c == '\n') {
+            if(!import->overflow) {
+                dra818_mem_import_line(job);
+            } else if(import->header_seen) {
+                job->stats->rows++;
+                job->stats->skipped++;
+            }
+            import->length = 0;
+            import->overflow = false;
+        } else if(c != '\r' && !import->overflow) {
+            if(import->length == DRA818_MEM_LINE_MAX - 1) {
+                import->overflow = true;
+            } else {
+                import->line[import->length++] = c;
+            }
+        }
+    }
+}
+
+bool dra818_mem_import(const char* csv_path, const char* dir, Dra818MemImportStats* stats) {
+    char path[DRA818_MEM_PATH_MAX];
+    char final_path[DRA818_MEM_PATH_MAX];
+    uint32_t start = furi_get_tick();
+    memset(stats, 0, sizeof(Dra818MemImportStats));
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, dir);
+    File* csv = storage_file_alloc(storage);
+    File* files[DRA818_MEM_KINDS];
+    for(size_t kind = 0; kind < DRA818_MEM_KINDS; kind++) {
+        files[kind] = storage_file_alloc(storage);
+    }
+    Dra818MemSorter sorters[2];
+    dra818_mem_path(path, dir, Dra818MemKindFreqIndex, ".run");
+    dra818_mem_sorter_init(
+        &sorters[0], storage, path, DRA818_MEM_FIDX_SIZE, dra818_mem_fidx_compare);
+    dra818_mem_path(path, dir, Dra818MemKindNameIndex, ".run");
+    dra818_mem_sorter_init(
+        &sorters[1], storage, path, DRA818_MEM_NIDX_SIZE, dra818_mem_nidx_compare);
+
+    Dra818MemImportJob job = {
+        .import = malloc(sizeof(Dra818MemImport)),
+        .records = files[Dra818MemKindRecords],
+        .sorters = sorters,
+        .stats = stats,
+        .ok = sorters[0].ok && sorters[1].ok,
+    };
+    memset(job.import, 0, sizeof(Dra818MemImport));
+    for(size_t kind = 0; kind < DRA818_MEM_KINDS && job.ok; kind++) {
+        dra818_mem_path(path, dir, kind, ".tmp");
+        job.ok = storage_file_open(files[kind], path, FSAM_READ_WRITE, FSOM_CREATE_ALWAYS) &&
+                 dra818_mem_write_header(files[kind], kind, 0);
+    }
+    if(job.ok && !storage_file_open(csv, csv_path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        FURI_LOG_E(TAG, "Cannot open %s", csv_path);
+        job.ok = false;
+    }
+
+    // Records are written as rows come in; the index entries go to the sorters.
+    char chunk[DRA818_MEM_CHUNK];
+    size_t read;
+    while(job.ok && (read = storage_file_read(csv, chunk, sizeof(chunk))) > 0) {
+        stats->bytes += read;
+        dra818_mem_import_chunk(&job, chunk, read);
+    }
+    dra818_mem_import_chunk(&job, "\n", 1); // Last line without a newline
+    dra818_mem_flush_records(&job);
+    free(job.import);
+    storage_file_close(csv);
+    storage_file_free(csv);
+
+    job.ok = job.ok && dra818_mem_write_header(
+                           files[Dra818MemKindRecords], Dra818MemKindRecords, stats->imported);
+    for(size_t i = 0; i < 2; i++) {
+        Dra818MemKind kind = i == 0 ? Dra818MemKindFreqIndex : Dra818MemKindNameIndex;
+        job.ok = job.ok && dra818_mem_write_header(files[kind], kind, stats->imported) &&
+                 dra818_mem_sorter_finish(&sorters[i], files[kind]);
+        stats->runs = sorters[i].runs;
+        dra818_mem_sorter_free(&sorters[i]);
+        dra818_mem_path(path, dir, kind, ".run");
+        storage_common_remove(storage, path);
+    }
+
+    // Replace the old bank only once every new file is complete.
+    for(size_t kind = 0; kind < DRA818_MEM_KINDS; kind++) {
+        job.ok = storage_file_close(files[kind]) && job.ok;
+        storage_file_free(files[kind]);
+    }
+    for(size_t kind = 0; kind < DRA818_MEM_KINDS; kind++) {
+        dra818_mem_path(path, dir, kind, ".tmp");
+        dra818_mem_path(final_path, dir, kind, "");
+        if(job.ok) {
+            storage_common_remove(storage, final_path);
+            job.ok = storage_common_rename(storage, path, final_path) == FSE_OK;
+        }
+        storage_common_remove(storage, path);
+    }
+    furi_record_close(RECORD_STORAGE);
+
+    stats->duration_ms = furi_get_tick() - start;
+    FURI_LOG_I(
+        TAG,
+        "Import %s: %lu of %lu rows in %lu ms, %lu runs",
+        job.ok ? "done" : "failed",
+        stats->imported,
+        stats->rows,
+        stats->duration_ms,
+        stats->runs);
+    return job.ok;
+}
+
+struct Dra818Mem {
+    Storage* storage;
+    File* files[DRA818_MEM_KINDS];
+    uint32_t count;
+    // Block of index entries last read; lookups walk the indexes in order.
+    File* cache_file;
+    uint32_t cache_first;
+    uint32_t cache_fill;
+    uint8_t cache[DRA818_MEM_CACHE_ENTRIES * DRA818_MEM_NIDX_SIZE];
+};
+
+Dra818Mem* dra818_mem_alloc(const char* dir) {
+    char path[DRA818_MEM_PATH_MAX];
+    Dra818Mem* mem = malloc(sizeof(Dra818Mem));
+    mem->storage = furi_record_open(RECORD_STORAGE);
+    mem->cache_file = NULL;
+    mem->cache_fill = 0;
+
+    bool ok = true;
+    for(size_t kind = 0; kind < DRA818_MEM_KINDS; kind++) {
+        mem->files[kind] = storage_file_alloc(mem->storage);
+        dra818_mem_path(path, dir, kind, "");
+        int32_t count = -1;
+        if(ok && storage_file_open(mem->files[kind], path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+            count = dra818_mem_read_header(mem->files[kind], kind);
+        }
+        // All three files must agree, or an interrupted replace mixed two banks.
+        ok = ok && count >= 0 && (kind == 0 || (uint32_t)count == mem->count);
+        mem->count = count;
+    }
+    if(!ok) {
+        dra818_mem_free(mem);
+        return NULL;
+    }
+    FURI_LOG_I(TAG, "%lu memories", mem->count);
+    return mem;
+}
+
+void dra818_mem_free(Dra818Mem* mem) {
+    for(size_t kind = 0; kind < DRA818_MEM_KINDS; kind++) {
+        storage_file_close(mem->files[kind]);
+        storage_file_free(mem->files[kind]);
+    }
+    furi_record_close(RECORD_STORAGE);
+    free(mem);
+}
+
+uint32_t dra818_mem_count(Dra818Mem* mem) {
+    return mem->count;
+}
+
+bool dra818_mem_read(Dra818Mem* mem, uint32_t number, Dra818Memory* memory) {
+    uint8_t record[DRA818_MEM_RECORD_SIZE];
+    File* file = mem->files[Dra818MemKindRecords];
+    if(number >= mem->count ||
+       !storage_file_seek(file, DRA818_MEM_HEADER_SIZE + number * DRA818_MEM_RECORD_SIZE, true) ||
+       storage_file_read(file, record, sizeof(record)) != sizeof(record)) {
+        return false;
+    }
+    dra818_mem_decode(record, number, memory);
+    return true;
+}
+
+size_t dra818_mem_read_run(Dra818Mem* mem, uint32_t first, Dra818Memory* out, size_t count) {
+    uint8_t records[DRA818_MEM_RUN_RECORDS * DRA818_MEM_RECORD_SIZE];
+    File* file = mem->files[Dra818MemKindRecords];
+    if(first >= mem->count ||
+       !storage_file_seek(file, DRA818_MEM_HEADER_SIZE + first * DRA818_MEM_RECORD_SIZE, true)) {
+        return 0;
+    }
+    count = MIN(count, (size_t)(mem->count - first));
+    size_t done = 0;
+    while(done < count) {
+        size_t chunk = MIN(count - done, (size_t)DRA818_MEM_RUN_RECORDS);
+        size_t bytes = chunk * DRA818_MEM_RECORD_SIZE;
+        if(storage_file_read(file, records, bytes) != bytes) {
+            break;
+        }
+        for(size_t i = 0; i < chunk; i++) {
+            dra818_mem_decode(
+                records + i * DRA818_MEM_RECORD_SIZE, first + done + i, &out[done + i]);
+        }
+        done += chunk;
+    }
+    return done;
+}
+
+// Index entry at `slot`.  A miss reads a block ahead of the slot, or behind it when walking
+// backwards.
+static const uint8_t*
+    dra818_mem_entry(Dra818Mem* mem, bool by_name, uint32_t slot, bool forward) {
+    Dra818MemKind kind = by_name ? Dra818MemKindNameIndex : Dra818MemKindFreqIndex;
+    File* file = mem->files[kind];
+    size_t size = dra818_mem_entry_sizes[kind];
+    if(mem->cache_file != file || slot < mem->cache_first ||
+       slot >= mem->cache_first + mem->cache_fill) {
+        uint32_t first = slot;
+        if(!forward) {
+            first = slot + 1 >= DRA818_MEM_CACHE_ENTRIES ? slot + 1 - DRA818_MEM_CACHE_ENTRIES : 0;
+        }
+        uint32_t count = MIN(mem->count - first, (uint32_t)DRA818_MEM_CACHE_ENTRIES);
+        mem->cache_file = NULL;
+        if(!storage_file_seek(file, DRA818_MEM_HEADER_SIZE + first * size, true) ||
+           storage_file_read(file, mem->cache, count * size) != count * size) {
+            return NULL;
+        }
+        mem->cache_file = file;
+        mem->cache_first = first;
+        mem->cache_fill = count;
+    }
+    return mem->cache + (slot - mem->cache_first) * size;
+}
+
+// Order of an index entry against a search key: a frequency, or a name key prefix.
+static int dra818_mem_entry_compare(
+    const uint8_t* entry,
+    bool by_name,
+    uint32_t freq,
+    const uint8_t* key,
+    size_t key_size) {
+    if(by_name) {
+        return memcmp(entry, key, key_size);
+    }
+    uint32_t entry_freq = dra818_mem_take(&entry, 4);
+    return entry_freq < freq ? -1 : entry_freq > freq;
+}
+
+// First slot whose entry is not below the key (upper: not at or below it).
+static uint32_t dra818_mem_bound(
+    Dra818Mem* mem,
+    bool by_name,
+    uint32_t freq,
+    const uint8_t* key,
+    size_t key_size,
+    bool upper) {
+    uint32_t low = 0;
+    uint32_t high = mem->count;
+    while(low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        const uint8_t* entry = dra818_mem_entry(mem, by_name, mid, true);
+        if(!entry) {
+            return high;
+        }
+        int c = dra818_mem_entry_compare(entry, by_name, freq, key, key_size);
+        if(upper ? c <= 0 : c < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+void dra818_mem_query_all(Dra818MemQuery* query) {
+    memset(query, 0, sizeof(Dra818MemQuery));
+    query->max = UINT32_MAX;
+    query->bank = DRA818_MEM_BANK_ANY;
+}
+
+void dra818_mem_find(Dra818Mem* mem, const Dra818MemQuery* query, Dra818MemCursor* cursor) {
+    cursor->query = *query;
+    cursor->by_name = query->name[0] != '\0';
+    if(cursor->by_name) {
+        uint8_t key[DRA818_MEM_KEY_SIZE];
+        dra818_mem_key(query->name, key);
+        size_t key_size = MIN(strlen(query->name), (size_t)DRA818_MEM_KEY_SIZE);
+        cursor->start = dra818_mem_bound(mem, true, 0, key, key_size, false);
+        cursor->end = dra818_mem_bound(mem, true, 0, key, key_size, true);
+    } else {
+        cursor->start = dra818_mem_bound(mem, false, query->min, NULL, 0, false);
+        cursor->end = dra818_mem_bound(mem, false, query->max, NULL, 0, true);
+    }
+    cursor->first = cursor->start;
+    cursor->last = cursor->start;
+}
+
+static bool dra818_mem_match(const Dra818MemQuery* query, const Dra818Memory* memory) {
+    if(memory->rx_freq < query->min || memory->rx_freq > query->max ||
+       (query->bank != DRA818_MEM_BANK_ANY && memory->bank != query->bank)) {
+        return false;
+    }
+    for(size_t i = 0; query->name[i]; i++) {
+        if(dra818_mem_upper(query->name[i]) != dra818_mem_upper(memory->name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check the entry at `slot` and read its memory into `memory` if it matches.
+static bool dra818_mem_visit(
+    Dra818Mem* mem,
+    const Dra818MemCursor* cursor,
+    uint32_t slot,
+    bool forward,
+    Dra818Memory* memory) {
+    const uint8_t* entry = dra818_mem_entry(mem, cursor->by_name, slot, forward);
+    if(!entry) {
+        return false;
+    }
+    uint32_t number;
+    if(cursor->by_name) {
+        entry += DRA818_MEM_KEY_SIZE;
+        number = dra818_mem_take(&entry, 4);
+    } else {
+        entry += 4;
+        number = dra818_mem_take(&entry, 3);
+        uint8_t bank = dra818_mem_take(&entry, 1);
+        if(cursor->query.bank != DRA818_MEM_BANK_ANY && bank != cursor->query.bank) {
+            return false; // Skipped without touching the record
+        }
+    }
+    return dra818_mem_read(mem, number, memory) && dra818_mem_match(&cursor->query, memory);
+}
+
+size_t dra818_mem_page(
+    Dra818Mem* mem,
+    Dra818MemCursor* cursor,
+    bool forward,
+    Dra818Memory* out,
+    size_t count) {
+    DRA818_STATS_BEGIN(stamp);
+    size_t found = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    if(forward) {
+        for(uint32_t slot = cursor->last; slot < cursor->end && found < count; slot++) {
+            if(dra818_mem_visit(mem, cursor, slot, true, &out[found])) {
+                first = found++ == 0 ? slot : first;
+                last = slot + 1;
+            }
+        }
+    } else {
+        for(uint32_t slot = cursor->first; slot > cursor->start && found < count;) {
+            slot--;
+            if(dra818_mem_visit(mem, cursor, slot, false, &out[found])) {
+                last = found++ == 0 ? slot + 1 : last;
+                first = slot;
+            }
+        }
+        // Collected walking backwards; hand them out in index order.
+        for(size_t i = 0; i < found / 2; i++) {
+            Dra818Memory swap = out[i];
+            out[i] = out[found - 1 - i];
+            out[found - 1 - i] = swap;
+        }
+    }
+    if(found > 0) {
+        cursor->first = first;
+        cursor->last = last;
+    }
+    DRA818_STATS_END(stamp, Dra818StatMem, true);
+    return found;
+}
@@ -0,0 +1,110 @@
+/*
+ -- dra_mem.h
+ -- Channel memory bank on SD card for DRA818V/U
+ --
+ -- Memories are imported from a CHIRP or RepeaterBook CSV export.  The file is
+ -- streamed in small chunks and every row becomes a fixed-size binary record,
+ -- so lists far larger than RAM can be imported.  Two sorted indexes are built
+ -- alongside the records (by frequency and by name), using sorted runs on SD
+ -- and a single merge pass.  Lookups binary-search an index on SD and read
+ -- records one page at a time, so RAM use does not depend on the bank size.
+ --
+ -- Files (in the directory given to dra818_mem_alloc/import):
+ --   memories.bin   header + records in import order
+ --   memories.fidx  header + {rx_freq, record, bank} sorted by frequency
+ --   memories.nidx  header + {name key, record} sorted by name
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_plan.h"
+
+#define DRA818_MEM_NAME_MAX    18 // Including the terminator
+#define DRA818_MEM_KEY_SIZE    8 // Leading name characters held in the name index
+#define DRA818_MEM_MAX_RECORDS 65536 // Sorted runs x merge fan-in; later rows are not imported
+#define DRA818_MEM_BANK_ANY    0xFF
+#define DRA818_MEM_PATH_MAX    96
+
+typedef struct {
+    uint32_t number; // Record number (import order)
+    Dra818Freq rx_freq;
+    Dra818Freq tx_freq;
+    Dra818Tone rx_tone;
+    Dra818Tone tx_tone;
+    uint8_t bank;
+    bool wide;
+    char name[DRA818_MEM_NAME_MAX];
+} Dra818Memory;
+
+typedef struct {
+    Dra818Freq min; // Receive frequency range, inclusive
+    Dra818Freq max;
+    uint8_t bank; // DRA818_MEM_BANK_ANY for all banks
+    char name[DRA818_MEM_NAME_MAX]; // Name prefix, case-insensitive; "" for any name
+} Dra818MemQuery;
+
+/**
+ * Position of a paged lookup.  Results come in index order: by frequency, or by
+ * name when the query has a name prefix.  The cursor only holds index positions,
+ * so a page can be dropped and fetched again at any time.
+*/
+typedef struct {
+    Dra818MemQuery query;
+    bool by_name; // Walking the name index
+    uint32_t start; // Index slots that can match: [start, end)
+    uint32_t end;
+    uint32_t first; // Slots of the current page: [first, last)
+    uint32_t last;
+} Dra818MemCursor;
+
+typedef struct {
+    uint32_t rows; // Data rows read
+    uint32_t imported;
+    uint32_t skipped; // Rows with an unusable frequency, tone or mode
+    uint32_t bytes; // CSV bytes read
+    uint32_t runs; // Sorted runs written per index
+    uint32_t duration_ms;
+    bool truncated; // DRA818_MEM_MAX_RECORDS reached
+} Dra818MemImportStats;
+
+typedef struct Dra818Mem Dra818Mem;
+
+/**
+ * @brief      Import `csv_path` into `dir`, replacing the bank there.  The new files are
+ *           written under temporary names and only replace the old bank once complete, so a
+ *           failed import leaves it untouched.  Blocks for as long as the import takes; run it
+ *           on a worker thread.  No Dra818Mem may be open on `dir` meanwhile.
+ * @return     true if a bank was written (it may hold no memories).
+*/
+bool dra818_mem_import(const char* csv_path, const char* dir, Dra818MemImportStats* stats);
+
+// NULL if `dir` holds no bank.  Not thread-safe; use a handle from one thread.
+Dra818Mem* dra818_mem_alloc(const char* dir);
+void dra818_mem_free(Dra818Mem* mem);
+
+uint32_t dra818_mem_count(Dra818Mem* mem);
+bool dra818_mem_read(Dra818Mem* mem, uint32_t number, Dra818Memory* memory);
+// Up to `count` memories in record order from `first` on, read in large chunks; returns how many.
+size_t dra818_mem_read_run(Dra818Mem* mem, uint32_t first, Dra818Memory* out, size_t count);
+
+// Matches every memory.
+void dra818_mem_query_all(Dra818MemQuery* query);
+
+// Position `cursor` before the first match of `query`.
+void dra818_mem_find(Dra818Mem* mem, const Dra818MemQuery* query, Dra818MemCursor* cursor);
+
+/**
+ * @brief      Fetch the page after (forward) or before the current one.  Memories come back
+ *           in index order either way.  When there is nothing further the cursor is left on
+ *           the current page.
+ * @return     Memories written to `out`, up to `count`.
+*/
+size_t dra818_mem_page(
+    Dra818Mem* mem,
+    Dra818MemCursor* cursor,
+    bool forward,
+    Dra818Memory* out,
+    size_t count);
@@ -0,0 +1,94 @@
+/*
+ -- dra_plan.c
+ -- Channel plan tables and allocation-free command formatting for DRA818V/U
+*/
+
+#include "dra_plan.h"
+
+const uint16_t dra818_ctcss_tones[DRA818_CTCSS_COUNT] = {
+    670,  719,  744,  770,  797,  825,  854,  885,  915,  948,  974,  1000, 1035,
+    1072, 1109, 1148, 1188, 1230, 1273, 1318, 1365, 1413, 1462, 1514, 1567, 1622,
+    1679, 1738, 1799, 1862, 1928, 2035, 2107, 2181, 2257, 2336, 2418, 2503,
+};
+
+const uint16_t dra818_dcs_codes[DRA818_DCS_COUNT] = {
+    0023, 0025, 0026, 0031, 0032, 0036, 0043, 0047, 0051, 0053, 0054, 0065, 0071,
+    0072, 0073, 0074, 0114, 0115, 0116, 0122, 0125, 0131, 0132, 0134, 0143, 0145,
+    0152, 0155, 0156, 0162, 0165, 0172, 0174, 0205, 0212, 0223, 0225, 0226, 0243,
+    0244, 0245, 0246, 0251, 0252, 0255, 0261, 0263, 0265, 0266, 0271, 0274, 0306,
+    0311, 0315, 0325, 0331, 0332, 0343, 0346, 0351, 0356, 0364, 0365, 0371, 0411,
+    0412, 0413, 0423, 0431, 0432, 0445, 0446, 0452, 0454, 0455, 0462, 0464, 0465,
+    0466, 0503, 0506, 0516, 0523, 0526, 0532, 0546, 0565, 0606, 0612, 0624, 0627,
+    0631, 0632, 0654, 0662, 0664, 0703, 0712, 0723, 0731, 0732, 0734, 0743, 0754,
+};
+
+const Dra818Band dra818_bands[DRA818_BAND_COUNT] = {
+    {"VHF", DRA818_FREQ_MHZ(134, 0), DRA818_FREQ_MHZ(174, 0)},
+    {"UHF", DRA818_FREQ_MHZ(400, 0), DRA818_FREQ_MHZ(480, 0)},
+};
+
+bool dra818_plan_freq_valid(Dra818Freq freq, bool wide) {
+    Dra818Freq step = wide ? DRA818_STEP_WIDE : DRA818_STEP_NARROW;
+    if(freq % step != 0) {
+        return false;
+    }
+    for(size_t i = 0; i < DRA818_BAND_COUNT; i++) {
+        if(freq >= dra818_bands[i].min && freq <= dra818_bands[i].max) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool dra818_plan_tone_valid(Dra818Tone tone) {
+    if(!DRA818_TONE_IS_DCS(tone)) {
+        return tone <= DRA818_CTCSS_COUNT;
+    }
+    uint16_t code = DRA818_TONE_DCS_CODE(tone);
+    for(size_t i = 0; i < DRA818_DCS_COUNT; i++) {
+        if(dra818_dcs_codes[i] == code) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void dra818_plan_format_tone(char* out, Dra818Tone tone) {
+    if(DRA818_TONE_IS_DCS(tone)) {
+        uint16_t code = DRA818_TONE_DCS_CODE(tone);
+        out[0] = '0' + ((code >> 6) & 7);
+        out[1] = '0' + ((code >> 3) & 7);
+        out[2] = '0' + (code & 7);
+        out[3] = (tone & DRA818_TONE_DCS_INVERTED) ? 'I' : 'N';
+    } else {
+        out[0] = '0';
+        out[1] = '0';
+        out[2] = '0' + tone / 10;
+        out[3] = '0' + tone % 10;
+    }
+}
+
+size_t dra818_plan_format_freq(char* out, Dra818Freq freq) {
+    uint32_t mhz = freq / 10000;
+    uint32_t frac = freq % 10000;
+    char digits[4];
+    size_t length = 0;
+
+    // Whole MHz without leading zeros, then exactly four decimals.
+    size_t count = 0;
+    do {
+        digits[count++] = '0' + mhz % 10;
+        mhz /= 10;
+    } while(mhz && count < sizeof(digits));
+    while(count) {
+        out[length++] = digits[--count];
+    }
+    out[length++] = '.';
+    out[length + 3] = '0' + frac % 10;
+    frac /= 10;
+    out[length + 2] = '0' + frac % 10;
+    frac /= 10;
+    out[length + 1] = '0' + frac % 10;
+    out[length] = '0' + frac / 10;
+    return length + 4;
+}
@@ -0,0 +1,72 @@
+/*
+ -- dra_plan.h
+ -- Channel plan tables and allocation-free command formatting for DRA818V/U
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Fixed-point frequency: MHz with four decimals, i.e. units of 100 Hz.  This is
+ * exactly the resolution of the module's "145.5000" command format, so no
+ * rounding or floating point is ever needed.
+*/
+typedef uint32_t Dra818Freq;
+
+#define DRA818_FREQ_UNIT_HZ        100
+#define DRA818_FREQ_HZ(hz)         ((Dra818Freq)((hz) / DRA818_FREQ_UNIT_HZ))
+#define DRA818_FREQ_KHZ(khz)       ((Dra818Freq)((khz) * 10))
+#define DRA818_FREQ_MHZ(mhz, frac) ((Dra818Freq)((mhz) * 10000 + (frac))) // frac: 4 decimals
+#define DRA818_FREQ_TO_HZ(freq)    ((uint32_t)(freq) * DRA818_FREQ_UNIT_HZ)
+
+#define DRA818_STEP_NARROW DRA818_FREQ_MHZ(0, 125) // 12.5 kHz channel grid
+#define DRA818_STEP_WIDE   DRA818_FREQ_MHZ(0, 250) // 25 kHz channel grid
+
+/**
+ * Sub-audio tone selection.  0 is no tone, 1..DRA818_CTCSS_COUNT is a CTCSS
+ * tone number as used by the module, and DRA818_TONE_DCS() selects a DCS code
+ * given as its octal value (e.g. 023).
+*/
+typedef uint16_t Dra818Tone;
+
+#define DRA818_TONE_NONE         0
+#define DRA818_TONE_DCS_FLAG     0x8000
+#define DRA818_TONE_DCS_INVERTED 0x4000
+#define DRA818_TONE_DCS(code)    ((Dra818Tone)(DRA818_TONE_DCS_FLAG | (code)))
+#define DRA818_TONE_DCS_I(code)  ((Dra818Tone)(DRA818_TONE_DCS_FLAG | DRA818_TONE_DCS_INVERTED | (code)))
+#define DRA818_TONE_IS_DCS(tone) (((tone) & DRA818_TONE_DCS_FLAG) != 0)
+#define DRA818_TONE_DCS_CODE(tone) ((tone) & 0x01FF)
+
+#define DRA818_CTCSS_COUNT 38
+#define DRA818_DCS_COUNT   104
+
+typedef struct {
+    const char* name;
+    Dra818Freq min;
+    Dra818Freq max;
+} Dra818Band;
+
+#define DRA818_BAND_COUNT 2
+
+// CTCSS tone frequencies in 0.1 Hz, index 0 is tone number 1.
+extern const uint16_t dra818_ctcss_tones[DRA818_CTCSS_COUNT];
+// Standard DCS codes as octal values.
+extern const uint16_t dra818_dcs_codes[DRA818_DCS_COUNT];
+// Receive/transmit ranges of the DRA818V and DRA818U.
+extern const Dra818Band dra818_bands[DRA818_BAND_COUNT];
+
+// True if `freq` lies in a supported band and on the 12.5 or 25 kHz grid.
+bool dra818_plan_freq_valid(Dra818Freq freq, bool wide);
+bool dra818_plan_tone_valid(Dra818Tone tone);
+
+// Write the four characters the module expects for `tone` ("0000", "0012", "023N", "023I").
+void dra818_plan_format_tone(char* out, Dra818Tone tone);
+
+/**
+ * Write "MMM.FFFF" for `freq` into `out` and return the number of characters
+ * written (no terminator).  `out` needs room for 9 characters.
+*/
+size_t dra818_plan_format_freq(char* out, Dra818Freq freq);
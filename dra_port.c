@@ -0,0 +1,221 @@
+/*
+ -- dra_port.c
+ -- Flipper HAL implementation of the DRA818V/U driver seam
+*/
+
+#include <flipper.h>
+#include <furi.h>
+#include <furi_hal_usb.h>
+#include <furi_hal_usb_cdc.h>
+#include <gpio.h>
+#include <spi.h>
+#include "dra_port.h"
+#include "dra_stats.h"
+
+// Slot 0: first module (e.g. DRA818V)
+#define DRA818_CS_PIN  GPIO_PIN_0 // Chip Select pin for DRA818
+#define DRA818_RST_PIN GPIO_PIN_1 // Reset pin for DRA818
+#define DRA818_INT_PIN GPIO_PIN_2 // Interrupt pin for DRA818 (if applicable)
+#define DRA818_SQ_PIN  GPIO_PIN_3 // Squelch output of DRA818 (low = carrier present)
+#define DRA818_PD_PIN  GPIO_PIN_8 // Power down input of DRA818 (low = sleep)
+
+// Slot 1: second module (e.g. DRA818U) on the same SPI bus
+#define DRA818_B_CS_PIN  GPIO_PIN_4
+#define DRA818_B_RST_PIN GPIO_PIN_5
+#define DRA818_B_INT_PIN GPIO_PIN_6
+#define DRA818_B_SQ_PIN  GPIO_PIN_7
+#define DRA818_B_PD_PIN  GPIO_PIN_9
+
+#define DRA818_SPI_CLOCK_HZ 64000000 // SPI1 kernel clock (APB2)
+
+#define DRA818_LINK_CDC 1 // CDC interface of the host link in the dual-port configuration
+
+SPI_HandleTypeDef hspi1; // SPI handler
+
+static const uint16_t dra818_port_pins[DRA818_PORT_SLOTS][Dra818PinCount] = {
+    {
+        [Dra818PinCs] = DRA818_CS_PIN,
+        [Dra818PinRst] = DRA818_RST_PIN,
+        [Dra818PinInt] = DRA818_INT_PIN,
+        [Dra818PinSq] = DRA818_SQ_PIN,
+        [Dra818PinPd] = DRA818_PD_PIN,
+    },
+    {
+        [Dra818PinCs] = DRA818_B_CS_PIN,
+        [Dra818PinRst] = DRA818_B_RST_PIN,
+        [Dra818PinInt] = DRA818_B_INT_PIN,
+        [Dra818PinSq] = DRA818_B_SQ_PIN,
+        [Dra818PinPd] = DRA818_B_PD_PIN,
+    },
+};
+
+static const uint32_t dra818_port_prescalers[DRA818_PORT_SPEEDS] = {
+    SPI_BAUDRATEPRESCALER_256,
+    SPI_BAUDRATEPRESCALER_128,
+    SPI_BAUDRATEPRESCALER_64,
+    SPI_BAUDRATEPRESCALER_32,
+    SPI_BAUDRATEPRESCALER_16,
+    SPI_BAUDRATEPRESCALER_8,
+    SPI_BAUDRATEPRESCALER_4,
+    SPI_BAUDRATEPRESCALER_2,
+};
+
+static const uint32_t dra818_port_modes[] = {
+    [Dra818PinModeInput] = GPIO_MODE_INPUT,
+    [Dra818PinModeOutput] = GPIO_MODE_OUTPUT,
+    [Dra818PinModeIrqFalling] = GPIO_MODE_IT_FALLING,
+    [Dra818PinModeIrqBoth] = GPIO_MODE_IT_RISING_FALLING,
+};
+
+bool dra818_port_bus_init() {
+    // SPI configuration structure
+    hspi1.Instance = SPI1;
+    hspi1.Init.Mode = SPI_MODE_MASTER;
+    hspi1.Init.Direction = SPI_DIRECTION_2LINES;
+    hspi1.Init.DataSize = SPI_DATASIZE_8BIT;
+    hspi1.Init.CLKPolarity = SPI_POLARITY_LOW;
+    hspi1.Init.CLKPhase = SPI_PHASE_1EDGE;
+    hspi1.Init.NSS = SPI_NSS_SOFT;
+    hspi1.Init.BaudRatePrescaler = dra818_port_prescalers[DRA818_PORT_SPEED_DEFAULT];
+    hspi1.Init.FirstBit = SPI_FIRSTBIT_MSB;
+    hspi1.Init.TIMode = SPI_TIMODE_DISABLE;
+    hspi1.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
+    hspi1.Init.CRCPolynomial = 10;
+
+    if(HAL_SPI_Init(&hspi1) != HAL_OK) {
+        FURI_LOG(FURI_LOG_ERROR, "SPI Init failed!");
+        return false;
+    }
+    return true;
+}
+
+bool dra818_port_bus_set_speed(uint8_t speed) {
+    if(speed >= DRA818_PORT_SPEEDS) {
+        return false;
+    }
+    hspi1.Init.BaudRatePrescaler = dra818_port_prescalers[speed];
+    return HAL_SPI_Init(&hspi1) == HAL_OK;
+}
+
+uint32_t dra818_port_bus_hz(uint8_t speed) {
+    return DRA818_SPI_CLOCK_HZ >> (DRA818_PORT_SPEEDS - speed);
+}
+
+bool dra818_port_spi_transfer(const uint8_t* tx, uint8_t* rx, size_t size, uint32_t timeout_ms) {
+    DRA818_STATS_BEGIN(start);
+    HAL_StatusTypeDef status = HAL_SPI_TransmitReceive(&hspi1, (uint8_t*)tx, rx, size, timeout_ms);
+    DRA818_STATS_END_EX(start, Dra818StatSpi, status == HAL_OK, status == HAL_TIMEOUT);
+    return status == HAL_OK;
+}
+
+bool dra818_port_spi_transfer_dma(const uint8_t* tx, uint8_t* rx, size_t size) {
+    return HAL_SPI_TransmitReceive_DMA(&hspi1, (uint8_t*)tx, rx, size) == HAL_OK;
+}
+
+void dra818_port_pin_mode(uint8_t slot, Dra818Pin pin, Dra818PinMode mode) {
+    gpio_init(dra818_port_pins[slot][pin], dra818_port_modes[mode]);
+}
+
+void dra818_port_pin_write(uint8_t slot, Dra818Pin pin, bool level) {
+    gpio_set(dra818_port_pins[slot][pin], level ? 1 : 0);
+}
+
+bool dra818_port_pin_read(uint8_t slot, Dra818Pin pin) {
+    return gpio_read(dra818_port_pins[slot][pin]) != 0;
+}
+
+// HAL weak overrides, called from the SPI DMA interrupt.
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi) {
+    if(hspi == &hspi1) {
+        dra818_port_dma_done(true);
+    }
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi) {
+    if(hspi == &hspi1) {
+        dra818_port_dma_done(false);
+    }
+}
+
+// HAL weak override, called from the EXTI interrupt.
+void HAL_GPIO_EXTI_Callback(uint16_t pin) {
+    for(uint8_t slot = 0; slot < DRA818_PORT_SLOTS; slot++) {
+        for(size_t i = 0; i < COUNT_OF(dra818_port_pins[slot]); i++) {
+            if(dra818_port_pins[slot][i] == pin) {
+                dra818_port_pin_irq(slot, (Dra818Pin)i);
+                return;
+            }
+        }
+    }
+}
+
+static struct {
+    FuriHalUsbInterface* usb_prev; // Configuration to restore on close (NULL: link closed)
+    bool usb_locked; // The USB configuration was locked before we opened
+    Dra818PortLinkCallback rx_ready;
+    Dra818PortLinkCallback tx_done;
+    void* context;
+} dra818_port_link;
+
+static void dra818_port_link_rx(void* context) {
+    UNUSED(context);
+    dra818_port_link.rx_ready(dra818_port_link.context);
+}
+
+static void dra818_port_link_tx(void* context) {
+    UNUSED(context);
+    dra818_port_link.tx_done(dra818_port_link.context);
+}
+
+static CdcCallbacks dra818_port_link_callbacks = {
+    .tx_ep_callback = dra818_port_link_tx,
+    .rx_ep_callback = dra818_port_link_rx,
+};
+
+bool dra818_port_link_open(
+    Dra818PortLinkCallback rx_ready,
+    Dra818PortLinkCallback tx_done,
+    void* context) {
+    if(dra818_port_link.usb_prev) {
+        return false;
+    }
+    FuriHalUsbInterface* usb_prev = furi_hal_usb_get_config();
+    bool usb_locked = furi_hal_usb_is_locked();
+    furi_hal_usb_unlock();
+    if(usb_prev != &usb_cdc_dual && !furi_hal_usb_set_config(&usb_cdc_dual, NULL)) {
+        if(usb_locked) {
+            furi_hal_usb_lock(); // Leave USB as we found it
+        }
+        return false;
+    }
+    dra818_port_link.usb_prev = usb_prev;
+    dra818_port_link.usb_locked = usb_locked;
+    dra818_port_link.rx_ready = rx_ready;
+    dra818_port_link.tx_done = tx_done;
+    dra818_port_link.context = context;
+    furi_hal_cdc_set_callbacks(DRA818_LINK_CDC, &dra818_port_link_callbacks, NULL);
+    return true;
+}
+
+void dra818_port_link_close() {
+    if(!dra818_port_link.usb_prev) {
+        return;
+    }
+    furi_hal_cdc_set_callbacks(DRA818_LINK_CDC, NULL, NULL);
+    if(dra818_port_link.usb_prev != &usb_cdc_dual) {
+        furi_hal_usb_set_config(dra818_port_link.usb_prev, NULL);
+    }
+    if(dra818_port_link.usb_locked) {
+        furi_hal_usb_lock();
+    }
+    dra818_port_link.usb_prev = NULL;
+}
+
+size_t dra818_port_link_receive(uint8_t* data, size_t size) {
+    int32_t length = furi_hal_cdc_receive(DRA818_LINK_CDC, data, size);
+    return length > 0 ? (size_t)length : 0;
+}
+
+void dra818_port_link_send(const uint8_t* data, size_t size) {
+    furi_hal_cdc_send(DRA818_LINK_CDC, (uint8_t*)data, size);
+}
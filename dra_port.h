@@ -0,0 +1,78 @@
+/*
+ -- dra_port.h
+ -- Board/HAL seam of the DRA818V/U driver
+ --
+ -- dra.c reaches the SPI bus and the modules' GPIO lines only through these
+ -- functions.  All modules share one SPI bus; each is wired to its own set of
+ -- CS/RST/INT/SQ/PD lines, identified by a slot number.  dra_port.c
+ -- implements them on the Flipper HAL; another build (e.g. a host simulation
+ -- with a behavioural module model) can link its own implementation instead
+ -- without touching the driver.
+ --
+ -- The host link (the USB serial port dra_host talks over) goes through the
+ -- same seam.  The simulator in host/ keeps dra_port.c and runs it over a
+ -- simulated CDC link; another build could put a pty behind these functions.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DRA818_PORT_SLOTS 2 // Modules that can be wired up at once
+
+#define DRA818_PORT_LINK_PACKET 64 // Largest chunk the host link moves at once
+
+// SPI clock steps: 0 is the slowest (prescaler 256), each step doubles the clock.
+#define DRA818_PORT_SPEEDS        8
+#define DRA818_PORT_SPEED_DEFAULT 4 // Prescaler 16, conservative for long wiring
+
+typedef enum {
+    Dra818PinCs, // Chip select (active low)
+    Dra818PinRst, // Reset (active low)
+    Dra818PinInt, // Receive data ready (active low)
+    Dra818PinSq, // Squelch output (low = carrier present)
+    Dra818PinPd, // Power down (low = module sleeps, keeping its configuration)
+    Dra818PinCount,
+} Dra818Pin;
+
+typedef enum {
+    Dra818PinModeInput,
+    Dra818PinModeOutput,
+    Dra818PinModeIrqFalling,
+    Dra818PinModeIrqBoth,
+} Dra818PinMode;
+
+bool dra818_port_bus_init();
+// Re-initialises the bus at another clock step.  Call with no transfer in flight.
+bool dra818_port_bus_set_speed(uint8_t speed);
+uint32_t dra818_port_bus_hz(uint8_t speed);
+bool dra818_port_spi_transfer(const uint8_t* tx, uint8_t* rx, size_t size, uint32_t timeout_ms);
+// Starts a DMA transfer; completion is reported through dra818_port_dma_done().
+bool dra818_port_spi_transfer_dma(const uint8_t* tx, uint8_t* rx, size_t size);
+
+void dra818_port_pin_mode(uint8_t slot, Dra818Pin pin, Dra818PinMode mode);
+void dra818_port_pin_write(uint8_t slot, Dra818Pin pin, bool level);
+bool dra818_port_pin_read(uint8_t slot, Dra818Pin pin);
+
+// Implemented by the driver; the port calls them from interrupt context.
+void dra818_port_dma_done(bool success);
+void dra818_port_pin_irq(uint8_t slot, Dra818Pin pin);
+
+// Called from the USB interrupt: a packet arrived, or the last one sent has gone out.
+typedef void (*Dra818PortLinkCallback)(void* context);
+
+// Host link on the second USB serial port; the first stays with the CLI.
+bool dra818_port_link_open(
+    Dra818PortLinkCallback rx_ready,
+    Dra818PortLinkCallback tx_done,
+    void* context);
+void dra818_port_link_close();
+/**
+ * Take the waiting packet, up to `size` bytes; 0 if none.  A packet left unread
+ * holds the next one back, so a busy reader throttles the host.
+*/
+size_t dra818_port_link_receive(uint8_t* data, size_t size);
+// Send up to DRA818_PORT_LINK_PACKET bytes; tx_done follows.  Size 0 ends a transfer.
+void dra818_port_link_send(const uint8_t* data, size_t size);
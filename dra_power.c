@@ -0,0 +1,150 @@
+/*
+ -- dra_power.c
+ -- Duty-cycled power-save receive for DRA818V/U modules
+*/
+
+#include <string.h>
+#include "dra_power.h"
+
+// Settling is cut short by a window shorter than the settle time.
+static uint32_t dra818_power_settle(const Dra818PowerConfig* config) {
+    return config->settle_ms < config->on_ms ? config->settle_ms : config->on_ms;
+}
+
+// Wrap-safe "a is at or after b" for millisecond times.
+static bool dra818_power_reached(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) >= 0;
+}
+
+static void dra818_power_account(Dra818PowerSchedule* schedule, uint32_t now) {
+    uint32_t elapsed = now - schedule->since;
+    schedule->since = now;
+    switch(schedule->state) {
+    case Dra818PowerStateAwake:
+        schedule->stats.awake_ms += elapsed;
+        break;
+    case Dra818PowerStateListen:
+        schedule->stats.listen_ms += elapsed;
+        break;
+    case Dra818PowerStateSleep:
+        schedule->stats.sleep_ms += elapsed;
+        break;
+    }
+}
+
+static void
+    dra818_power_enter(Dra818PowerSchedule* schedule, Dra818PowerState state, uint32_t now) {
+    schedule->state = state;
+    switch(state) {
+    case Dra818PowerStateAwake:
+        schedule->deadline = now + schedule->config.hang_ms;
+        break;
+    case Dra818PowerStateListen:
+        schedule->stats.windows++;
+        schedule->valid_at = now + dra818_power_settle(&schedule->config);
+        schedule->deadline = now + schedule->config.on_ms;
+        schedule->checked = false;
+        break;
+    case Dra818PowerStateSleep:
+        schedule->deadline = now + schedule->config.off_ms;
+        break;
+    }
+}
+
+void dra818_power_init(
+    Dra818PowerSchedule* schedule,
+    const Dra818PowerConfig* config,
+    uint32_t now) {
+    memset(schedule, 0, sizeof(Dra818PowerSchedule));
+    schedule->config = *config;
+    schedule->since = now;
+    dra818_power_enter(schedule, Dra818PowerStateAwake, now);
+}
+
+uint32_t dra818_power_update(Dra818PowerSchedule* schedule, uint32_t now, bool active) {
+    dra818_power_account(schedule, now);
+    while(true) {
+        switch(schedule->state) {
+        case Dra818PowerStateAwake:
+            if(active) {
+                dra818_power_enter(schedule, Dra818PowerStateAwake, now);
+            } else if(schedule->config.off_ms && dra818_power_reached(now, schedule->deadline)) {
+                dra818_power_enter(schedule, Dra818PowerStateSleep, now);
+                continue;
+            }
+            return schedule->config.off_ms ? schedule->deadline - now : UINT32_MAX;
+        case Dra818PowerStateSleep:
+            if(dra818_power_reached(now, schedule->deadline)) {
+                dra818_power_enter(schedule, Dra818PowerStateListen, now);
+                continue;
+            }
+            return schedule->deadline - now;
+        case Dra818PowerStateListen:
+            if(!dra818_power_reached(now, schedule->valid_at)) {
+                return schedule->valid_at - now; // The squelch output is still settling
+            }
+            if(active) {
+                // Open at the first look: it started while the module was off.
+                schedule->stats.wakes++;
+                schedule->stats.late += schedule->checked ? 0 : 1;
+                dra818_power_enter(schedule, Dra818PowerStateAwake, now);
+                continue;
+            }
+            schedule->checked = true;
+            if(dra818_power_reached(now, schedule->deadline)) {
+                dra818_power_enter(schedule, Dra818PowerStateSleep, now);
+                continue;
+            }
+            return schedule->deadline - now;
+        }
+    }
+}
+
+bool dra818_power_wake(Dra818PowerSchedule* schedule, uint32_t now) {
+    dra818_power_account(schedule, now);
+    bool was_off = schedule->state == Dra818PowerStateSleep;
+    dra818_power_enter(schedule, Dra818PowerStateAwake, now);
+    return was_off;
+}
+
+bool dra818_power_on(const Dra818PowerSchedule* schedule) {
+    return schedule->state != Dra818PowerStateSleep;
+}
+
+bool dra818_power_listening(const Dra818PowerSchedule* schedule, uint32_t now) {
+    return schedule->state == Dra818PowerStateAwake ||
+           (schedule->state == Dra818PowerStateListen &&
+            dra818_power_reached(now, schedule->valid_at));
+}
+
+uint16_t dra818_power_duty(const Dra818PowerStats* stats) {
+    uint64_t on = (uint64_t)stats->awake_ms + stats->listen_ms;
+    uint64_t total = on + stats->sleep_ms;
+    return total ? on * 1000 / total : 1000;
+}
+
+void dra818_power_estimate(
+    const Dra818PowerConfig* config,
+    const Dra818PowerModel* model,
+    Dra818PowerEstimate* estimate) {
+    memset(estimate, 0, sizeof(Dra818PowerEstimate));
+    uint64_t period = (uint64_t)config->on_ms + config->off_ms;
+    if(config->off_ms == 0 || period == 0) {
+        estimate->duty_permille = 1000;
+        estimate->current_ua = model->rx_ua;
+        return;
+    }
+    // A transmission that starts while the squelch is valid is seen at once.  One that starts
+    // in the dead time (off, then settling) is seen when the next window settles, so the
+    // delay falls evenly between 0 and the dead time, and a burst shorter than that delay is
+    // over before anyone looks.
+    uint64_t dead = config->off_ms + dra818_power_settle(config);
+    estimate->duty_permille = config->on_ms * 1000 / period;
+    estimate->current_ua =
+        ((uint64_t)model->rx_ua * config->on_ms + (uint64_t)model->sleep_ua * config->off_ms) /
+        period;
+    estimate->latency_mean_ms = dead * dead / (2 * period);
+    estimate->latency_max_ms = dead;
+    estimate->miss_permille =
+        dead > model->burst_ms ? (dead - model->burst_ms) * 1000 / period : 0;
+}
@@ -0,0 +1,99 @@
+/*
+ -- dra_power.h
+ -- Duty-cycled power-save receive for DRA818V/U modules
+ --
+ -- The module is powered down (PD low) for off_ms, then listens for on_ms.  Its
+ -- squelch output is only trusted settle_ms after power-up.  Activity during a
+ -- window (or work for the module) wakes it fully; it goes back to cycling
+ -- hang_ms after the squelch closes.  The schedule is plain arithmetic on the
+ -- millisecond times it is given, with no threads or HAL, so a host simulation can
+ -- drive it with synthetic traffic exactly as the radio thread does.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DRA818_POWER_SETTLE_MS 60 // Power-up to a valid squelch output
+#define DRA818_POWER_HANG_MS   3000 // Stay awake this long after activity ends
+
+// Typical module current when receiving and in power-down, for the estimate.
+#define DRA818_POWER_RX_UA    60000
+#define DRA818_POWER_SLEEP_UA 100
+
+typedef struct {
+    uint32_t on_ms; // Listening window, including the settle time
+    uint32_t off_ms; // Powered down between windows; 0 disables power save
+    uint32_t settle_ms;
+    uint32_t hang_ms;
+} Dra818PowerConfig;
+
+typedef enum {
+    Dra818PowerStateAwake, // Fully on: activity, work, or the hang time after it
+    Dra818PowerStateListen, // Powered for a window, waiting for the squelch
+    Dra818PowerStateSleep, // Powered down
+} Dra818PowerState;
+
+typedef struct {
+    uint32_t windows; // Listening windows opened
+    uint32_t wakes; // Windows that found activity
+    uint32_t late; // Wakes where the activity was already there when the window opened
+    uint32_t awake_ms;
+    uint32_t listen_ms;
+    uint32_t sleep_ms;
+} Dra818PowerStats;
+
+typedef struct {
+    Dra818PowerConfig config;
+    Dra818PowerState state;
+    uint32_t since; // Last update
+    uint32_t deadline; // End of the hang time, window or sleep
+    uint32_t valid_at; // Squelch trusted from here in the current window
+    bool checked; // The squelch has been looked at in this window
+    Dra818PowerStats stats;
+} Dra818PowerSchedule;
+
+typedef struct {
+    uint32_t rx_ua; // Module current when receiving
+    uint32_t sleep_ua; // Module current when powered down
+    uint32_t burst_ms; // Shortest transmission that should be caught
+} Dra818PowerModel;
+
+typedef struct {
+    uint16_t duty_permille; // Share of idle time the module is powered
+    uint32_t current_ua; // Average module current while idle (no activity)
+    uint32_t latency_mean_ms; // Transmission start to detection
+    uint32_t latency_max_ms;
+    uint16_t miss_permille; // Transmissions exactly burst_ms long that end before they are seen
+} Dra818PowerEstimate;
+
+// Start awake (for its hang time) at `now`.
+void dra818_power_init(
+    Dra818PowerSchedule* schedule,
+    const Dra818PowerConfig* config,
+    uint32_t now);
+
+/**
+ * @brief      Advance the schedule to `now`.  `active` is the squelch (or pending work); it is
+ *           only looked at while the squelch output is valid.
+ * @return     ms until the schedule next needs an update, unless activity comes first.
+*/
+uint32_t dra818_power_update(Dra818PowerSchedule* schedule, uint32_t now, bool active);
+
+// Go fully awake at once, e.g. to send the module a command.  Returns true if it was off.
+bool dra818_power_wake(Dra818PowerSchedule* schedule, uint32_t now);
+
+// The module should be powered.
+bool dra818_power_on(const Dra818PowerSchedule* schedule);
+// The squelch output can be trusted at `now`.
+bool dra818_power_listening(const Dra818PowerSchedule* schedule, uint32_t now);
+
+// Share of the time so far the module was powered, in permille.
+uint16_t dra818_power_duty(const Dra818PowerStats* stats);
+
+// Idle current and detection latency a schedule should give, for random transmission starts.
+void dra818_power_estimate(
+    const Dra818PowerConfig* config,
+    const Dra818PowerModel* model,
+    Dra818PowerEstimate* estimate);
@@ -0,0 +1,620 @@
+/*
+ -- dra_radio.c
+ -- Radio service thread for DRA818V/U modules
+*/
+
+#include <furi.h>
+#include <string.h>
+#include "dra_radio.h"
+#include "dra_stats.h"
+
+#define TAG "Dra818Radio"
+
+typedef enum {
+    Dra818RadioEvtStop = (1 << 0),
+    Dra818RadioEvtCommand = (1 << 1), // Commands were posted
+    Dra818RadioEvtReady = (1 << 2), // Init sequence finished
+    Dra818RadioEvtSquelch = (1 << 3), // Squelch edge (from the EXTI interrupt)
+    Dra818RadioEvtRssi = (1 << 4), // RSSI read completed
+    Dra818RadioEvtCommit = (1 << 5), // AT commit completed
+    Dra818RadioEvtScan = (1 << 6), // Scan samples queued
+    Dra818RadioEvtPass = (1 << 7), // AT passthrough completed
+} Dra818RadioEvtFlags;
+
+#define DRA818_RADIO_ALL_EVENTS                                                   \
+    (Dra818RadioEvtStop | Dra818RadioEvtCommand | Dra818RadioEvtReady |           \
+     Dra818RadioEvtSquelch | Dra818RadioEvtRssi | Dra818RadioEvtCommit |          \
+     Dra818RadioEvtScan | Dra818RadioEvtPass)
+
+typedef struct {
+    Dra818RadioCommandType type;
+    uint32_t seq; // Post order, so the newest command of a type wins
+    uint32_t posted_at; // Tick
+#ifdef DRA_STATS
+    uint32_t stamp; // dra818_stats_now() at post
+#endif
+    Dra818AtGroup group;
+    uint8_t volume;
+    bool scan_on;
+    Dra818ScanConfig scan;
+    Dra818PowerConfig power;
+} Dra818RadioCommand;
+
+// An AT passthrough request out with the engine.
+typedef struct {
+    Dra818Radio* radio;
+    bool used;
+    volatile bool done; // result is filled in
+    char expect[DRA818_RADIO_PASS_EXPECT_MAX]; // The engine keeps a pointer to it
+    Dra818RadioPassResult result;
+} Dra818RadioPassSlot;
+
+struct Dra818Radio {
+    Dra818* dra;
+    Dra818At* at;
+    Dra818RadioEventCallback callback;
+    void* context;
+    FuriThread* thread;
+    FuriMessageQueue* queue;
+    FuriMutex* mutex;
+    Dra818Scan* scan; // Allocated on the first scan
+    FuriMessageQueue* scan_samples; // Dra818ScanSample, from the scanner's threads
+    FuriMessageQueue* passes; // Dra818RadioPass, waiting for a slot
+    Dra818RadioPassSlot pass_slots[DRA818_RADIO_PASS_QUEUE]; // Worker-owned
+
+    // Newest waiting command of each type, guarded by mutex.  Commands normally pass
+    // through the queue; one that finds it full goes straight in here.
+    Dra818RadioCommand pending[Dra818RadioCommandCount];
+    uint32_t pending_mask;
+    uint32_t seq;
+    Dra818RadioMetrics metrics;
+
+    // Results handed to the worker by driver and AT callbacks.
+    volatile bool ready_result;
+    volatile bool rssi_ok;
+    volatile uint8_t rssi_value;
+    volatile bool commit_ok;
+
+    // Worker-owned state.
+    volatile bool stopping; // Late callbacks must no longer signal the worker
+    volatile bool squelch_open;
+    bool commit_wanted; // Something was staged that the module has not been sent
+    bool commit_in_flight;
+    bool rssi_in_flight;
+    bool scanning;
+    bool power_save; // The power schedule below is running
+    bool module_asleep; // PD is low
+    Dra818PowerSchedule power;
+    Dra818PowerStats power_stats; // Copy of power.stats for other threads, guarded by mutex
+};
+
+static void dra818_radio_signal(Dra818Radio* radio, uint32_t flags) {
+    if(!radio->stopping) {
+        furi_thread_flags_set(furi_thread_get_id(radio->thread), flags);
+    }
+}
+
+static void dra818_radio_ready_callback(bool ready, void* context) {
+    Dra818Radio* radio = context;
+    radio->ready_result = ready;
+    dra818_radio_signal(radio, Dra818RadioEvtReady);
+}
+
+static void dra818_radio_squelch_callback(bool open, void* context) {
+    UNUSED(open);
+    dra818_radio_signal(context, Dra818RadioEvtSquelch);
+}
+
+static void
+    dra818_radio_rssi_callback(Dra818AtResult result, const char* response, void* context) {
+    Dra818Radio* radio = context;
+    uint8_t rssi = 0;
+    radio->rssi_ok = result == Dra818AtResultOk && dra818_at_parse_rssi(response, &rssi);
+    radio->rssi_value = rssi;
+    dra818_radio_signal(radio, Dra818RadioEvtRssi);
+}
+
+static void
+    dra818_radio_commit_callback(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(response);
+    Dra818Radio* radio = context;
+    radio->commit_ok = result == Dra818AtResultOk;
+    dra818_radio_signal(radio, Dra818RadioEvtCommit);
+}
+
+static void dra818_radio_scan_callback(const Dra818ScanSample* sample, void* context) {
+    Dra818Radio* radio = context;
+    if(furi_message_queue_put(radio->scan_samples, sample, 0) == FuriStatusOk) {
+        dra818_radio_signal(radio, Dra818RadioEvtScan);
+    }
+}
+
+static void
+    dra818_radio_pass_callback(Dra818AtResult result, const char* response, void* context) {
+    Dra818RadioPassSlot* slot = context;
+    slot->result.at_result = result;
+    strlcpy(slot->result.response, response, sizeof(slot->result.response));
+    slot->done = true;
+    dra818_radio_signal(slot->radio, Dra818RadioEvtPass);
+}
+
+static void dra818_radio_publish(Dra818Radio* radio, Dra818RadioEventType type, bool value) {
+    Dra818RadioEvent event = {.type = type, .value = value, .rssi = radio->rssi_value};
+    if(radio->callback) {
+        radio->callback(&event, radio->context);
+    }
+}
+
+// Keep cmd unless a newer command of its type is already waiting.  Call with mutex held.
+static void dra818_radio_merge(Dra818Radio* radio, const Dra818RadioCommand* cmd) {
+    uint32_t bit = 1UL << cmd->type;
+    if(radio->pending_mask & bit) {
+        radio->metrics.coalesced++;
+        if(radio->pending[cmd->type].seq > cmd->seq) {
+            return;
+        }
+    }
+    radio->pending[cmd->type] = *cmd;
+    radio->pending_mask |= bit;
+}
+
+static void dra818_radio_post(Dra818Radio* radio, Dra818RadioCommand* cmd) {
+    cmd->posted_at = furi_get_tick();
+#ifdef DRA_STATS
+    cmd->stamp = dra818_stats_now();
+#endif
+    furi_mutex_acquire(radio->mutex, FuriWaitForever);
+    cmd->seq = ++radio->seq;
+    radio->metrics.posted++;
+    if(furi_message_queue_put(radio->queue, cmd, 0) != FuriStatusOk) {
+        radio->metrics.overflows++;
+        dra818_radio_merge(radio, cmd);
+    }
+    uint32_t depth = furi_message_queue_get_count(radio->queue);
+    if(depth > radio->metrics.queue_depth_max) {
+        radio->metrics.queue_depth_max = depth;
+    }
+    furi_mutex_release(radio->mutex);
+    dra818_radio_signal(radio, Dra818RadioEvtCommand);
+}
+
+static void dra818_radio_execute(Dra818Radio* radio, const Dra818RadioCommand* cmd) {
+    switch(cmd->type) {
+    case Dra818RadioCommandStart: {
+        Dra818InitConfig config = {
+            .reset_ms = DRA818_RESET_MS,
+            .boot_ms = DRA818_BOOT_MS,
+            .probe = radio->at,
+            .probe_interval_ms = DRA818_PROBE_INTERVAL_MS,
+            .probe_timeout_ms = DRA818_PROBE_TIMEOUT_MS,
+        };
+        // A finished init sends everything staged so far (see the Ready event).
+        radio->commit_wanted = false;
+        dra818_init_async(radio->dra, &config, dra818_radio_ready_callback, radio);
+        break;
+    }
+    case Dra818RadioCommandSetGroup:
+        if(radio->at) {
+            dra818_at_stage_group(radio->at, &cmd->group);
+            radio->commit_wanted = true;
+        }
+        break;
+    case Dra818RadioCommandSetVolume:
+        if(radio->at) {
+            dra818_at_stage_volume(radio->at, cmd->volume);
+            radio->commit_wanted = true;
+        }
+        break;
+    case Dra818RadioCommandReadRssi:
+        if(radio->at && !radio->rssi_in_flight &&
+           dra818_init_state(radio->dra) == Dra818InitStateReady) {
+            radio->rssi_in_flight =
+                dra818_at_read_rssi(radio->at, dra818_radio_rssi_callback, radio);
+        }
+        break;
+    case Dra818RadioCommandCalibrate: {
+        Dra818RadioEvent event = {.type = Dra818RadioEventCalibrated};
+        event.value = dra818_init_state(radio->dra) == Dra818InitStateReady &&
+                      dra818_calibrate(radio->dra, &event.speed);
+        if(radio->callback) {
+            radio->callback(&event, radio->context);
+        }
+        break;
+    }
+    case Dra818RadioCommandScan:
+        if(radio->scanning) {
+            // Back to the configured channel: send everything again.
+            dra818_scan_stop(radio->scan);
+            radio->scanning = false;
+            dra818_at_invalidate(radio->at);
+            radio->commit_wanted = true;
+        }
+        if(cmd->scan_on && radio->at && dra818_init_state(radio->dra) == Dra818InitStateReady) {
+            if(!radio->scan) {
+                radio->scan = dra818_scan_alloc(radio->dra, radio->at);
+            }
+            radio->scanning =
+                dra818_scan_start(radio->scan, &cmd->scan, dra818_radio_scan_callback, radio);
+        }
+        break;
+    case Dra818RadioCommandPowerSave:
+        radio->power_save = cmd->power.off_ms > 0;
+        if(radio->power_save) {
+            dra818_power_init(&radio->power, &cmd->power, furi_get_tick());
+        }
+        break;
+    default:
+        break;
+    }
+
+    uint32_t latency = furi_get_tick() - cmd->posted_at;
+    furi_mutex_acquire(radio->mutex, FuriWaitForever);
+    radio->metrics.executed++;
+    radio->metrics.latency_total_ms += latency;
+    if(latency > radio->metrics.latency_max_ms) {
+        radio->metrics.latency_max_ms = latency;
+    }
+    furi_mutex_release(radio->mutex);
+    DRA818_STATS_END(cmd->stamp, Dra818StatRadio, true);
+}
+
+static void dra818_radio_run_commands(Dra818Radio* radio) {
+    Dra818RadioCommand pending[Dra818RadioCommandCount];
+    Dra818RadioCommand cmd;
+
+    furi_mutex_acquire(radio->mutex, FuriWaitForever);
+    while(furi_message_queue_get(radio->queue, &cmd, 0) == FuriStatusOk) {
+        dra818_radio_merge(radio, &cmd);
+    }
+    uint32_t mask = radio->pending_mask;
+    memcpy(pending, radio->pending, sizeof(pending));
+    radio->pending_mask = 0;
+    furi_mutex_release(radio->mutex);
+
+    for(size_t type = 0; type < Dra818RadioCommandCount; type++) {
+        if(mask & (1UL << type)) {
+            dra818_radio_execute(radio, &pending[type]);
+        }
+    }
+}
+
+// Send what was staged once the module is up and no other commit is in flight.
+static void dra818_radio_try_commit(Dra818Radio* radio) {
+    if(!radio->commit_wanted || radio->commit_in_flight || radio->scanning ||
+       dra818_init_state(radio->dra) != Dra818InitStateReady) {
+        return;
+    }
+    radio->commit_in_flight = true;
+    if(dra818_at_commit(radio->at, dra818_radio_commit_callback, radio)) {
+        radio->commit_wanted = false;
+    } else {
+        radio->commit_in_flight = false; // Another commit is still out; retry shortly
+    }
+}
+
+static Dra818RadioPassSlot* dra818_radio_pass_slot(Dra818Radio* radio) {
+    for(size_t i = 0; i < DRA818_RADIO_PASS_QUEUE; i++) {
+        if(!radio->pass_slots[i].used) {
+            return &radio->pass_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static bool dra818_radio_pass_busy(Dra818Radio* radio) {
+    for(size_t i = 0; i < DRA818_RADIO_PASS_QUEUE; i++) {
+        if(radio->pass_slots[i].used) {
+            return true;
+        }
+    }
+    return furi_message_queue_get_count(radio->passes) > 0;
+}
+
+// Carry out waiting passthrough requests in order while there is a slot for an AT answer.
+// Register access is done on the spot.
+static void dra818_radio_run_passes(Dra818Radio* radio) {
+    Dra818RadioPass pass;
+    Dra818RadioPassSlot* slot;
+    while((slot = dra818_radio_pass_slot(radio)) &&
+          furi_message_queue_get(radio->passes, &pass, 0) == FuriStatusOk) {
+        Dra818RadioEvent event = {.type = Dra818RadioEventPass, .pass.tag = pass.tag};
+        size_t count = MIN(pass.count, (uint8_t)DRA818_BURST_MAX);
+        switch(pass.type) {
+        case Dra818RadioPassAt:
+            memset(&slot->result, 0, sizeof(slot->result));
+            slot->result.tag = pass.tag;
+            slot->done = false;
+            strlcpy(slot->expect, pass.expect, sizeof(slot->expect));
+            if(radio->at &&
+               dra818_at_submit(
+                   radio->at,
+                   pass.command,
+                   slot->expect,
+                   pass.timeout_ms,
+                   dra818_radio_pass_callback,
+                   slot)) {
+                slot->used = true;
+                continue;
+            }
+            event.pass.at_result = Dra818AtResultCancelled;
+            break;
+        case Dra818RadioPassRead:
+            event.value = dra818_read_burst(radio->dra, pass.reg, event.pass.values, count);
+            event.pass.count = event.value ? count : 0;
+            break;
+        case Dra818RadioPassWrite:
+            event.value = dra818_write_burst(radio->dra, pass.reg, pass.values, count);
+            break;
+        }
+        if(radio->callback) {
+            radio->callback(&event, radio->context);
+        }
+    }
+}
+
+// Publish AT passthrough answers, freeing their slots.
+static void dra818_radio_finish_passes(Dra818Radio* radio) {
+    for(size_t i = 0; i < DRA818_RADIO_PASS_QUEUE; i++) {
+        Dra818RadioPassSlot* slot = &radio->pass_slots[i];
+        if(slot->used && slot->done) {
+            Dra818RadioEvent event = {
+                .type = Dra818RadioEventPass,
+                .value = slot->result.at_result == Dra818AtResultOk,
+                .pass = slot->result,
+            };
+            slot->used = false;
+            if(radio->callback) {
+                radio->callback(&event, radio->context);
+            }
+        }
+    }
+}
+
+// Power the module up for work; the AT engine cannot reach it while it sleeps.
+static void dra818_radio_power_wake(Dra818Radio* radio) {
+    if(radio->power_save) {
+        dra818_power_wake(&radio->power, furi_get_tick());
+    }
+    if(radio->module_asleep) {
+        dra818_sleep(radio->dra, false);
+        radio->module_asleep = false;
+        furi_delay_ms(DRA818_POWER_SETTLE_MS);
+    }
+}
+
+// Advance the power-save schedule and drive PD to match.  Returns ms until it needs another
+// look (UINT32_MAX: never).
+static uint32_t dra818_radio_power_step(Dra818Radio* radio) {
+    if(!radio->power_save) {
+        if(radio->module_asleep) {
+            dra818_radio_power_wake(radio);
+        }
+        return UINT32_MAX;
+    }
+    uint32_t now = furi_get_tick();
+    bool busy = radio->commit_wanted || radio->commit_in_flight || radio->rssi_in_flight ||
+                radio->scanning || dra818_radio_pass_busy(radio) ||
+                dra818_init_state(radio->dra) != Dra818InitStateReady;
+    bool open = dra818_power_listening(&radio->power, now) && dra818_squelch_open(radio->dra);
+    uint32_t next = dra818_power_update(&radio->power, now, busy || open);
+    bool asleep = !dra818_power_on(&radio->power);
+    if(asleep != radio->module_asleep) {
+        dra818_sleep(radio->dra, asleep);
+        radio->module_asleep = asleep;
+    }
+    furi_mutex_acquire(radio->mutex, FuriWaitForever);
+    radio->power_stats = radio->power.stats;
+    furi_mutex_release(radio->mutex);
+    return next;
+}
+
+static void dra818_radio_squelch_check(Dra818Radio* radio) {
+    // Asleep or settling, the squelch output means nothing.
+    if(radio->power_save && !dra818_power_listening(&radio->power, furi_get_tick())) {
+        return;
+    }
+    bool open = dra818_squelch_open(radio->dra);
+    if(open != radio->squelch_open) {
+        radio->squelch_open = open;
+        dra818_radio_publish(radio, Dra818RadioEventSquelch, open);
+    }
+}
+
+static int32_t dra818_radio_worker(void* context) {
+    Dra818Radio* radio = context;
+    uint32_t power_ms = UINT32_MAX;
+    while(true) {
+        bool retry = radio->commit_wanted && !radio->scanning &&
+                     dra818_init_state(radio->dra) == Dra818InitStateReady;
+        uint32_t timeout_ms = retry ? MIN((uint32_t)DRA818_RADIO_RETRY_MS, power_ms) : power_ms;
+        uint32_t timeout =
+            timeout_ms == UINT32_MAX ? FuriWaitForever : furi_ms_to_ticks(MAX(timeout_ms, 1UL));
+        uint32_t events =
+            furi_thread_flags_wait(DRA818_RADIO_ALL_EVENTS, FuriFlagWaitAny, timeout);
+        if(events & FuriFlagError) {
+            events = 0; // Timeout: only retry the commit
+        }
+        if(events & Dra818RadioEvtStop) {
+            break;
+        }
+        if(events & Dra818RadioEvtCommand) {
+            dra818_radio_power_wake(radio);
+            dra818_radio_run_commands(radio);
+        }
+        if(events & Dra818RadioEvtPass) {
+            dra818_radio_finish_passes(radio);
+        }
+        if(events & (Dra818RadioEvtCommand | Dra818RadioEvtPass)) {
+            dra818_radio_run_passes(radio);
+        }
+        if(events & Dra818RadioEvtReady) {
+            // The driver hands the post-reset configuration to this thread, which
+            // owns every other transfer to the module.
+            bool ready = radio->ready_result && dra818_init_configure(radio->dra);
+            if(ready && radio->at) {
+                radio->commit_wanted = true; // Sent by the worker, reported as Applied
+            }
+            dra818_radio_publish(radio, Dra818RadioEventReady, ready);
+        }
+        if(events & Dra818RadioEvtSquelch) {
+            dra818_radio_squelch_check(radio);
+        }
+        if(events & Dra818RadioEvtRssi) {
+            radio->rssi_in_flight = false;
+            if(radio->rssi_ok) {
+                dra818_radio_publish(radio, Dra818RadioEventRssi, true);
+            }
+        }
+        if(events & Dra818RadioEvtCommit) {
+            radio->commit_in_flight = false;
+            dra818_radio_publish(radio, Dra818RadioEventApplied, radio->commit_ok);
+        }
+        if(events & Dra818RadioEvtScan) {
+            Dra818RadioEvent event = {.type = Dra818RadioEventScan};
+            while(furi_message_queue_get(radio->scan_samples, &event.sample, 0) == FuriStatusOk) {
+                if(radio->callback && radio->scanning) {
+                    radio->callback(&event, radio->context);
+                }
+            }
+        }
+        dra818_radio_try_commit(radio);
+        if(radio->power_save || radio->module_asleep) {
+            power_ms = dra818_radio_power_step(radio);
+            dra818_radio_squelch_check(radio); // A window may just have become valid
+        } else {
+            power_ms = UINT32_MAX;
+        }
+    }
+    dra818_radio_power_wake(radio);
+    return 0;
+}
+
+Dra818Radio* dra818_radio_alloc(
+    Dra818* dra,
+    Dra818At* at,
+    Dra818RadioEventCallback callback,
+    void* context) {
+    Dra818Radio* radio = malloc(sizeof(Dra818Radio));
+    memset(radio, 0, sizeof(Dra818Radio));
+    radio->dra = dra;
+    radio->at = at;
+    radio->callback = callback;
+    radio->context = context;
+    radio->queue = furi_message_queue_alloc(DRA818_RADIO_QUEUE_SIZE, sizeof(Dra818RadioCommand));
+    radio->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    radio->scan_samples =
+        furi_message_queue_alloc(DRA818_RADIO_SCAN_QUEUE, sizeof(Dra818ScanSample));
+    radio->passes = furi_message_queue_alloc(DRA818_RADIO_PASS_QUEUE, sizeof(Dra818RadioPass));
+    for(size_t i = 0; i < DRA818_RADIO_PASS_QUEUE; i++) {
+        radio->pass_slots[i].radio = radio;
+    }
+    radio->squelch_open = dra818_squelch_open(dra);
+
+    radio->thread = furi_thread_alloc_ex(TAG, DRA818_RADIO_STACK_SIZE, dra818_radio_worker, radio);
+    furi_thread_start(radio->thread);
+    dra818_squelch_set_callback(dra, dra818_radio_squelch_callback, radio);
+    return radio;
+}
+
+void dra818_radio_free(Dra818Radio* radio) {
+    dra818_squelch_set_callback(radio->dra, NULL, NULL);
+    dra818_init_cancel(radio->dra);
+    radio->stopping = true;
+    furi_thread_flags_set(furi_thread_get_id(radio->thread), Dra818RadioEvtStop);
+    furi_thread_join(radio->thread);
+    furi_thread_free(radio->thread);
+    // The scanner waits for its last retune, so it goes before the engine.
+    if(radio->scan) {
+        dra818_scan_free(radio->scan);
+    }
+    // Commands still in the engine complete as cancelled; their callbacks only touch radio.
+    if(radio->at) {
+        dra818_at_free(radio->at);
+    }
+
+    FURI_LOG_I(
+        TAG,
+        "%lu commands, %lu coalesced, %lu overflows, queue max %lu, latency max %lu ms",
+        radio->metrics.posted,
+        radio->metrics.coalesced,
+        radio->metrics.overflows,
+        radio->metrics.queue_depth_max,
+        radio->metrics.latency_max_ms);
+    furi_message_queue_free(radio->queue);
+    furi_message_queue_free(radio->scan_samples);
+    furi_message_queue_free(radio->passes);
+    furi_mutex_free(radio->mutex);
+    free(radio);
+}
+
+void dra818_radio_start(Dra818Radio* radio) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandStart};
+    dra818_radio_post(radio, &cmd);
+}
+
+void dra818_radio_set_group(Dra818Radio* radio, const Dra818AtGroup* group) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandSetGroup, .group = *group};
+    dra818_radio_post(radio, &cmd);
+}
+
+void dra818_radio_set_volume(Dra818Radio* radio, uint8_t volume) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandSetVolume, .volume = volume};
+    dra818_radio_post(radio, &cmd);
+}
+
+void dra818_radio_read_rssi(Dra818Radio* radio) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandReadRssi};
+    dra818_radio_post(radio, &cmd);
+}
+
+void dra818_radio_calibrate(Dra818Radio* radio) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandCalibrate};
+    dra818_radio_post(radio, &cmd);
+}
+
+void dra818_radio_scan_start(Dra818Radio* radio, const Dra818ScanConfig* config) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandScan, .scan_on = true, .scan = *config};
+    dra818_radio_post(radio, &cmd);
+}
+
+void dra818_radio_scan_stop(Dra818Radio* radio) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandScan, .scan_on = false};
+    dra818_radio_post(radio, &cmd);
+}
+
+void dra818_radio_set_power_save(Dra818Radio* radio, const Dra818PowerConfig* config) {
+    Dra818RadioCommand cmd = {.type = Dra818RadioCommandPowerSave, .power = *config};
+    dra818_radio_post(radio, &cmd);
+}
+
+bool dra818_radio_passthrough(Dra818Radio* radio, const Dra818RadioPass* pass) {
+    if(furi_message_queue_put(radio->passes, pass, 0) != FuriStatusOk) {
+        return false;
+    }
+    dra818_radio_signal(radio, Dra818RadioEvtCommand);
+    return true;
+}
+
+Dra818InitState dra818_radio_init_state(Dra818Radio* radio) {
+    return dra818_init_state(radio->dra);
+}
+
+bool dra818_radio_squelch_open(Dra818Radio* radio) {
+    return radio->squelch_open;
+}
+
+bool dra818_radio_get_power_stats(Dra818Radio* radio, Dra818PowerStats* stats) {
+    furi_mutex_acquire(radio->mutex, FuriWaitForever);
+    *stats = radio->power_stats;
+    bool on = radio->power_save;
+    furi_mutex_release(radio->mutex);
+    return on;
+}
+
+void dra818_radio_get_metrics(Dra818Radio* radio, Dra818RadioMetrics* metrics) {
+    furi_mutex_acquire(radio->mutex, FuriWaitForever);
+    *metrics = radio->metrics;
+    metrics->queue_depth = furi_message_queue_get_count(radio->queue);
+    furi_mutex_release(radio->mutex);
+}
+
@@ -0,0 +1,156 @@
+/*
+ -- dra_radio.h
+ -- Radio service thread for DRA818V/U modules
+ --
+ -- One worker thread owns a module and its AT engine.  Other threads (the GUI
+ -- in particular) post typed commands through a message queue and never call
+ -- the driver themselves, so a slow or stuck bus cannot stall input handling.
+ -- Commands of the same type collapse: when several are waiting, only the
+ -- newest is carried out (e.g. the last frequency while the user scrolls).
+ -- Status changes come back as events on the worker thread.
+ --
+ -- Passthrough requests (raw AT commands and register access, e.g. from the
+ -- host link) are the exception: each one is carried out and answered on its
+ -- own, in order, through a separate small queue.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra.h"
+#include "dra_at.h"
+#include "dra_power.h"
+#include "dra_scan.h"
+
+#define DRA818_RADIO_QUEUE_SIZE 16 // Commands waiting for the worker
+#define DRA818_RADIO_STACK_SIZE 2560 // Room for a copy of every pending command and an event
+#define DRA818_RADIO_RETRY_MS   50 // Retry interval for a commit the AT engine turned away
+#define DRA818_RADIO_SCAN_QUEUE 8 // Scan samples waiting to be published
+#define DRA818_RADIO_PASS_QUEUE 4 // Passthrough requests waiting, and in flight
+#define DRA818_RADIO_PASS_EXPECT_MAX 16 // Longest expected response prefix, with terminator
+
+typedef enum {
+    Dra818RadioCommandStart, // Reset and init the module, probing over AT if available
+    Dra818RadioCommandSetGroup, // Channel, tones and squelch
+    Dra818RadioCommandSetVolume,
+    Dra818RadioCommandReadRssi,
+    Dra818RadioCommandCalibrate, // Find the fastest reliable bus clock (see dra818_calibrate)
+    Dra818RadioCommandScan, // Start or stop the channel scanner
+    Dra818RadioCommandPowerSave, // Set or clear the power-save schedule
+    Dra818RadioCommandCount,
+} Dra818RadioCommandType;
+
+typedef enum {
+    Dra818RadioEventReady, // Init finished; value: the module answered
+    Dra818RadioEventSquelch, // Squelch output changed; value: open
+    Dra818RadioEventRssi, // RSSI read; rssi holds the reading
+    Dra818RadioEventApplied, // Staged configuration sent; value: acknowledged
+    Dra818RadioEventCalibrated, // Bus calibration done; value: succeeded, speed holds the step
+    Dra818RadioEventScan, // Scanner visited a channel; sample holds the result
+    Dra818RadioEventPass, // Passthrough request done; value: succeeded, pass holds the result
+} Dra818RadioEventType;
+
+typedef enum {
+    Dra818RadioPassAt, // Raw AT command
+    Dra818RadioPassRead, // Register burst read
+    Dra818RadioPassWrite, // Register burst write
+} Dra818RadioPassType;
+
+typedef struct {
+    Dra818RadioPassType type;
+    uint32_t tag; // The caller's, handed back with the result
+    char command[DRA818_AT_CMD_MAX]; // At: command without CR/LF
+    char expect[DRA818_RADIO_PASS_EXPECT_MAX]; // At: response prefix that completes it
+    uint32_t timeout_ms; // At
+    uint8_t reg; // Read, Write: first register
+    uint8_t count; // Read, Write: registers, up to DRA818_BURST_MAX
+    uint8_t values[DRA818_BURST_MAX]; // Write
+} Dra818RadioPass;
+
+typedef struct {
+    uint32_t tag;
+    Dra818AtResult at_result; // At
+    char response[DRA818_AT_LINE_MAX]; // At: the response line
+    uint8_t count; // Read: registers read
+    uint8_t values[DRA818_BURST_MAX]; // Read
+} Dra818RadioPassResult;
+
+typedef struct {
+    Dra818RadioEventType type;
+    bool value;
+    uint8_t rssi;
+    uint8_t speed;
+    Dra818ScanSample sample;
+    Dra818RadioPassResult pass;
+} Dra818RadioEvent;
+
+typedef struct {
+    uint32_t posted; // Commands posted
+    uint32_t coalesced; // Commands dropped because a newer one of the same type followed
+    uint32_t overflows; // Commands that found the queue full (still carried out)
+    uint32_t executed; // Commands carried out
+    uint32_t queue_depth; // Commands waiting now
+    uint32_t queue_depth_max;
+    uint32_t latency_max_ms; // Post to execution
+    uint32_t latency_total_ms; // Sum over executed commands, for the average
+} Dra818RadioMetrics;
+
+// Called on the worker thread.
+typedef void (*Dra818RadioEventCallback)(const Dra818RadioEvent* event, void* context);
+
+typedef struct Dra818Radio Dra818Radio;
+
+/**
+ * @brief      Start the worker for `dra`.  The radio takes over `at` (NULL if the UART was
+ *           not available) and frees it; `dra` stays the caller's, to free afterwards.
+*/
+Dra818Radio* dra818_radio_alloc(
+    Dra818* dra,
+    Dra818At* at,
+    Dra818RadioEventCallback callback,
+    void* context);
+// Stops the worker and frees the AT engine; waiting commands are dropped, init is cancelled.
+void dra818_radio_free(Dra818Radio* radio);
+
+// Posting never blocks.  Safe from any thread, but not from an interrupt.
+void dra818_radio_start(Dra818Radio* radio);
+void dra818_radio_set_group(Dra818Radio* radio, const Dra818AtGroup* group);
+void dra818_radio_set_volume(Dra818Radio* radio, uint8_t volume);
+void dra818_radio_read_rssi(Dra818Radio* radio);
+// Carried out only once init is done; otherwise reported as failed.
+void dra818_radio_calibrate(Dra818Radio* radio);
+/**
+ * Scanning retunes the module behind the staged configuration's back, so staged
+ * changes wait while it runs and the whole configuration is sent again once it
+ * stops.  Start and stop collapse like other commands: the last one posted wins.
+ * Ignored until init is done.
+*/
+void dra818_radio_scan_start(Dra818Radio* radio, const Dra818ScanConfig* config);
+void dra818_radio_scan_stop(Dra818Radio* radio);
+
+/**
+ * Power-save receive (see dra_power.h).  While nothing is going on the worker
+ * powers the module down between listening windows and sleeps itself, so the
+ * Flipper can idle too; the squelch opening in a window, or any command, wakes
+ * the module fully.  Cycling waits while init, a commit, an RSSI read or a scan
+ * is in progress.  off_ms 0 turns it off.
+*/
+void dra818_radio_set_power_save(Dra818Radio* radio, const Dra818PowerConfig* config);
+// False if power save is off.
+bool dra818_radio_get_power_stats(Dra818Radio* radio, Dra818PowerStats* stats);
+
+/**
+ * @brief      Queue a passthrough request.  It is not merged with others; its result comes
+ *           back as a Dra818RadioEventPass carrying the same tag.  AT requests fail at once
+ *           without the UART.  The module is kept awake while any are outstanding.
+ * @return     false if DRA818_RADIO_PASS_QUEUE requests are already waiting.
+*/
+bool dra818_radio_passthrough(Dra818Radio* radio, const Dra818RadioPass* pass);
+
+// Last values seen by the worker.
+Dra818InitState dra818_radio_init_state(Dra818Radio* radio);
+bool dra818_radio_squelch_open(Dra818Radio* radio);
+
+void dra818_radio_get_metrics(Dra818Radio* radio, Dra818RadioMetrics* metrics);
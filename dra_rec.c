@@ -0,0 +1,352 @@
+/*
+ -- dra_rec.c
+ -- Receive audio recorder for DRA818V/U modules
+*/
+
+#include <furi.h>
+#include <storage/storage.h>
+#include <stdatomic.h>
+#include <string.h>
+#include "dra_adc.h"
+#include "dra_rec.h"
+#include "dra_stats.h"
+
+#define TAG "Dra818Rec"
+
+#define DRA818_REC_ADPCM_SAMPLES ((DRA818_REC_ADPCM_BLOCK - 4) * 2 + 1) // Per block
+#define DRA818_REC_ADPCM_INDEX_MAX 88
+
+typedef enum {
+    Dra818RecEvtStop = (1 << 0),
+    Dra818RecEvtBuffer = (1 << 1),
+} Dra818RecEvtFlags;
+
+struct Dra818Rec {
+    Storage* storage;
+    File* file;
+    FuriThread* thread;
+    Dra818RecFormat format;
+    uint32_t sample_rate;
+    uint32_t hang; // Samples kept after the gate closes
+    uint32_t hang_left;
+    atomic_bool gate;
+
+    // Buffer ring.  The encoder (the ADC worker, then the stopping thread) fills buffer
+    // head % DRA818_REC_BUFFERS and queues it by advancing head; the writer owns the
+    // buffers from tail up to head and releases each by advancing tail.
+    uint8_t* buffers; // DRA818_REC_BUFFERS x DRA818_REC_BUFFER_SIZE
+    size_t lengths[DRA818_REC_BUFFERS]; // Bytes in each queued buffer
+    size_t fill; // Bytes in the buffer being filled
+    atomic_uint_least32_t head; // Buffers queued
+    atomic_uint_least32_t tail; // Buffers written
+
+    // IMA-ADPCM encoder
+    int32_t predictor;
+    uint8_t index;
+    size_t block_pos; // Samples in the current block
+    uint8_t nibble; // Low nibble waiting for its partner
+
+    Dra818RecStats stats; // Encoder and writer each update only their own fields
+};
+
+static const int16_t dra818_rec_steps[DRA818_REC_ADPCM_INDEX_MAX + 1] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+    25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+    88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+    307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+    1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+    3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+static const int8_t dra818_rec_index_steps[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+static uint8_t* dra818_rec_put(uint8_t* out, uint32_t value, size_t bytes) {
+    for(size_t i = 0; i < bytes; i++) {
+        *out++ = value >> (i * 8);
+    }
+    return out;
+}
+
+static uint8_t* dra818_rec_put_tag(uint8_t* out, const char* tag, uint32_t size) {
+    memcpy(out, tag, 4);
+    return dra818_rec_put(out + 4, size, 4);
+}
+
+// Build the DRA818_REC_HEADER_SIZE byte WAV header for `bytes` of audio.
+static void dra818_rec_header(Dra818Rec* rec, uint8_t* header, uint32_t bytes) {
+    bool adpcm = rec->format == Dra818RecFormatAdpcm;
+    uint8_t* out = dra818_rec_put_tag(header, "RIFF", DRA818_REC_HEADER_SIZE - 8 + bytes);
+    memcpy(out, "WAVE", 4);
+    out = dra818_rec_put_tag(out + 4, "fmt ", adpcm ? 20 : 16);
+    out = dra818_rec_put(out, adpcm ? 0x0011 : 0x0001, 2);
+    out = dra818_rec_put(out, 1, 2); // Mono
+    out = dra818_rec_put(out, rec->sample_rate, 4);
+    if(adpcm) {
+        uint32_t rate = rec->sample_rate * DRA818_REC_ADPCM_BLOCK / DRA818_REC_ADPCM_SAMPLES;
+        out = dra818_rec_put(out, rate, 4);
+        out = dra818_rec_put(out, DRA818_REC_ADPCM_BLOCK, 2);
+        out = dra818_rec_put(out, 4, 2);
+        out = dra818_rec_put(out, 2, 2); // Extra format bytes
+        out = dra818_rec_put(out, DRA818_REC_ADPCM_SAMPLES, 2);
+        out = dra818_rec_put_tag(out, "fact", 4);
+        out = dra818_rec_put(out, rec->stats.samples, 4);
+    } else {
+        out = dra818_rec_put(out, rec->sample_rate * 2, 4);
+        out = dra818_rec_put(out, 2, 2);
+        out = dra818_rec_put(out, 16, 2);
+    }
+    // Pad so the audio starts on a sector boundary.
+    size_t junk = DRA818_REC_HEADER_SIZE - (out - header) - 16;
+    out = dra818_rec_put_tag(out, "JUNK", junk);
+    memset(out, 0, junk);
+    dra818_rec_put_tag(out + junk, "data", bytes);
+}
+
+static int32_t dra818_rec_writer(void* context) {
+    Dra818Rec* rec = context;
+    bool stop = false;
+    while(!stop) {
+        uint32_t events = furi_thread_flags_wait(
+            Dra818RecEvtStop | Dra818RecEvtBuffer, FuriFlagWaitAny, FuriWaitForever);
+        if(events & FuriFlagError) {
+            continue;
+        }
+        // Drain before honouring a stop, so the last buffers reach the file.
+        stop = events & Dra818RecEvtStop;
+        uint32_t tail = atomic_load_explicit(&rec->tail, memory_order_relaxed);
+        while(tail != atomic_load_explicit(&rec->head, memory_order_acquire)) {
+            size_t slot = tail % DRA818_REC_BUFFERS;
+            size_t length = rec->lengths[slot];
+            uint32_t start = furi_get_tick();
+            DRA818_STATS_BEGIN(write);
+            bool ok = storage_file_write(
+                          rec->file, rec->buffers + slot * DRA818_REC_BUFFER_SIZE, length) ==
+                      length;
+            DRA818_STATS_END(write, Dra818StatRec, ok);
+            rec->stats.write_max_ms = MAX(rec->stats.write_max_ms, furi_get_tick() - start);
+            rec->stats.writes++;
+            if(ok) {
+                rec->stats.bytes += length;
+            } else {
+                rec->stats.write_errors++;
+            }
+            atomic_store_explicit(&rec->tail, ++tail, memory_order_release);
+        }
+    }
+    return 0;
+}
+
+// Room left in the ring without touching a buffer the writer still owns.
+static size_t dra818_rec_room(Dra818Rec* rec) {
+    uint32_t queued = atomic_load_explicit(&rec->head, memory_order_relaxed) -
+                      atomic_load_explicit(&rec->tail, memory_order_acquire);
+    if(queued >= DRA818_REC_BUFFERS) {
+        return 0;
+    }
+    return (DRA818_REC_BUFFERS - 1 - queued) * DRA818_REC_BUFFER_SIZE +
+           (DRA818_REC_BUFFER_SIZE - rec->fill);
+}
+
+static void dra818_rec_queue(Dra818Rec* rec) {
+    uint32_t head = atomic_load_explicit(&rec->head, memory_order_relaxed);
+    rec->lengths[head % DRA818_REC_BUFFERS] = rec->fill;
+    rec->fill = 0;
+    atomic_store_explicit(&rec->head, head + 1, memory_order_release);
+    uint32_t queued = head + 1 - atomic_load_explicit(&rec->tail, memory_order_acquire);
+    rec->stats.buffers_max = MAX(rec->stats.buffers_max, queued);
+    furi_thread_flags_set(furi_thread_get_id(rec->thread), Dra818RecEvtBuffer);
+}
+
+static void dra818_rec_emit(Dra818Rec* rec, uint8_t byte) {
+    uint32_t head = atomic_load_explicit(&rec->head, memory_order_relaxed);
+    rec->buffers[(head % DRA818_REC_BUFFERS) * DRA818_REC_BUFFER_SIZE + rec->fill++] = byte;
+    if(rec->fill == DRA818_REC_BUFFER_SIZE) {
+        dra818_rec_queue(rec);
+    }
+}
+
+// One IMA-ADPCM step: quantise the difference to the prediction in 4 bits and track
+// the decoder's reconstruction, so errors do not accumulate.
+static uint8_t dra818_rec_adpcm_nibble(Dra818Rec* rec, int32_t sample) {
+    int32_t step = dra818_rec_steps[rec->index];
+    int32_t diff = sample - rec->predictor;
+    uint8_t nibble = 0;
+    if(diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    int32_t delta = step >> 3;
+    for(uint8_t bit = 4; bit; bit >>= 1) {
+        if(diff >= step) {
+            nibble |= bit;
+            diff -= step;
+            delta += step;
+        }
+        step >>= 1;
+    }
+    rec->predictor += (nibble & 8) ? -delta : delta;
+    rec->predictor = CLAMP(rec->predictor, INT16_MAX, INT16_MIN);
+    int32_t index = rec->index + dra818_rec_index_steps[nibble & 7];
+    rec->index = CLAMP(index, DRA818_REC_ADPCM_INDEX_MAX, 0);
+    return nibble;
+}
+
+// Each block opens with the first sample verbatim and the step index, so a decoder can
+// start at any block; the rest are packed two per byte, earlier sample in the low nibble.
+static void dra818_rec_adpcm(Dra818Rec* rec, int16_t sample) {
+    if(rec->block_pos == 0) {
+        rec->predictor = sample;
+        dra818_rec_emit(rec, (uint16_t)sample);
+        dra818_rec_emit(rec, (uint16_t)sample >> 8);
+        dra818_rec_emit(rec, rec->index);
+        dra818_rec_emit(rec, 0);
+    } else if(rec->block_pos & 1) {
+        rec->nibble = dra818_rec_adpcm_nibble(rec, sample);
+    } else {
+        dra818_rec_emit(rec, rec->nibble | dra818_rec_adpcm_nibble(rec, sample) << 4);
+    }
+    if(++rec->block_pos == DRA818_REC_ADPCM_SAMPLES) {
+        rec->block_pos = 0;
+    }
+}
+
+// Worst-case encoded size of `count` samples.
+static size_t dra818_rec_bytes(Dra818Rec* rec, size_t count) {
+    if(rec->format == Dra818RecFormatPcm16) {
+        return count * 2;
+    }
+    return (count + 1) / 2 + 4 * (count / DRA818_REC_ADPCM_SAMPLES + 1);
+}
+
+static void dra818_rec_block(const int16_t* samples, size_t count, void* context) {
+    Dra818Rec* rec = context;
+    if(atomic_load_explicit(&rec->gate, memory_order_relaxed)) {
+        rec->hang_left = rec->hang;
+    } else if(rec->hang_left) {
+        rec->hang_left -= MIN(rec->hang_left, count);
+    } else {
+        rec->stats.gated += count;
+        return;
+    }
+    // Take the whole block or none of it, so an overrun leaves a gap, not a broken block.
+    if(dra818_rec_room(rec) < dra818_rec_bytes(rec, count)) {
+        rec->stats.dropped += count;
+        return;
+    }
+    for(size_t i = 0; i < count; i++) {
+        int16_t sample = samples[i] * 16; // 12-bit to 16-bit
+        if(rec->format == Dra818RecFormatAdpcm) {
+            dra818_rec_adpcm(rec, sample);
+        } else {
+            dra818_rec_emit(rec, (uint16_t)sample);
+            dra818_rec_emit(rec, (uint16_t)sample >> 8);
+        }
+    }
+    rec->stats.samples += count;
+}
+
+static void dra818_rec_free(Dra818Rec* rec) {
+    if(rec->thread) {
+        furi_thread_flags_set(furi_thread_get_id(rec->thread), Dra818RecEvtStop);
+        furi_thread_join(rec->thread);
+        furi_thread_free(rec->thread);
+    }
+    storage_file_close(rec->file);
+    storage_file_free(rec->file);
+    furi_record_close(RECORD_STORAGE);
+    free(rec->buffers);
+    free(rec);
+}
+
+Dra818Rec* dra818_rec_start(
+    const char* path,
+    uint32_t sample_rate,
+    Dra818RecFormat format,
+    bool open) {
+    if(dra818_adc_running()) {
+        return NULL;
+    }
+    Dra818Rec* rec = malloc(sizeof(Dra818Rec));
+    rec->format = format;
+    rec->sample_rate = sample_rate;
+    rec->hang = sample_rate * DRA818_REC_HANG_MS / 1000;
+    atomic_init(&rec->gate, open);
+    atomic_init(&rec->head, 0);
+    atomic_init(&rec->tail, 0);
+    rec->buffers = malloc(DRA818_REC_BUFFERS * DRA818_REC_BUFFER_SIZE);
+    rec->storage = furi_record_open(RECORD_STORAGE);
+    rec->file = storage_file_alloc(rec->storage);
+
+    uint8_t header[DRA818_REC_HEADER_SIZE];
+    dra818_rec_header(rec, header, 0);
+    if(!storage_file_open(rec->file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS) ||
+       storage_file_write(rec->file, header, sizeof(header)) != sizeof(header)) {
+        FURI_LOG_E(TAG, "Cannot create %s", path);
+        dra818_rec_free(rec);
+        return NULL;
+    }
+
+    rec->thread = furi_thread_alloc_ex(TAG, DRA818_REC_STACK_SIZE, dra818_rec_writer, rec);
+    furi_thread_set_priority(rec->thread, FuriThreadPriorityLow);
+    furi_thread_start(rec->thread);
+    if(!dra818_adc_start(sample_rate, dra818_rec_block, rec)) {
+        dra818_rec_free(rec);
+        storage_simply_remove(furi_record_open(RECORD_STORAGE), path);
+        furi_record_close(RECORD_STORAGE);
+        return NULL;
+    }
+    return rec;
+}
+
+void dra818_rec_stop(Dra818Rec* rec, Dra818RecStats* stats) {
+    // With the ADC worker gone this thread becomes the encoder: finish the last ADPCM
+    // block (holding the last sample) and queue the partial buffer.
+    dra818_adc_stop();
+    if(rec->format == Dra818RecFormatAdpcm && rec->block_pos) {
+        while(dra818_rec_room(rec) < DRA818_REC_ADPCM_BLOCK) {
+            furi_delay_ms(1);
+        }
+        while(rec->block_pos) {
+            dra818_rec_adpcm(rec, rec->predictor);
+        }
+    }
+    if(rec->fill) {
+        dra818_rec_queue(rec);
+    }
+    furi_thread_flags_set(furi_thread_get_id(rec->thread), Dra818RecEvtStop);
+    furi_thread_join(rec->thread);
+    furi_thread_free(rec->thread);
+    rec->thread = NULL;
+
+    uint8_t header[DRA818_REC_HEADER_SIZE];
+    dra818_rec_header(rec, header, rec->stats.bytes);
+    if(!storage_file_seek(rec->file, 0, true) ||
+       storage_file_write(rec->file, header, sizeof(header)) != sizeof(header)) {
+        rec->stats.write_errors++;
+    }
+    dra818_rec_get_stats(rec, &rec->stats);
+    FURI_LOG_I(
+        TAG,
+        "%lu samples, %lu gated, %lu dropped, %lu ADC overruns, %lu/%d buffers, %lu ms max",
+        rec->stats.samples,
+        rec->stats.gated,
+        rec->stats.dropped,
+        rec->stats.adc_overruns,
+        rec->stats.buffers_max,
+        DRA818_REC_BUFFERS,
+        rec->stats.write_max_ms);
+    if(stats) {
+        *stats = rec->stats;
+    }
+    dra818_rec_free(rec);
+}
+
+void dra818_rec_set_gate(Dra818Rec* rec, bool open) {
+    atomic_store_explicit(&rec->gate, open, memory_order_relaxed);
+}
+
+void dra818_rec_get_stats(Dra818Rec* rec, Dra818RecStats* stats) {
+    *stats = rec->stats;
+    stats->adc_overruns = dra818_adc_overruns();
+}
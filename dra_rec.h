@@ -0,0 +1,61 @@
+/*
+ -- dra_rec.h
+ -- Receive audio recorder for DRA818V/U modules
+ --
+ -- Audio comes from dra_adc.  On the ADC worker each block is encoded, as
+ -- 16-bit PCM or 4-bit IMA-ADPCM, into a ring of large buffers.  A
+ -- low-priority writer thread writes each full buffer to a WAV file on SD in
+ -- one call.  The WAV header is padded to 512 bytes, so every buffer lands on
+ -- a sector boundary.  Blocks are only kept while the gate (the squelch) is
+ -- open, plus a short hang time.  If SD falls so far behind that no buffer is
+ -- free, whole blocks are dropped and counted, so the file stays decodable.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DRA818_REC_BUFFERS       6 // Buffers in the ring
+#define DRA818_REC_BUFFER_SIZE   4096 // Bytes per buffer (a multiple of 512)
+#define DRA818_REC_HEADER_SIZE   512 // WAV header, padded with a JUNK chunk
+#define DRA818_REC_ADPCM_BLOCK   256 // Bytes per IMA-ADPCM block (505 samples)
+#define DRA818_REC_HANG_MS       500 // Audio kept after the gate closes
+#define DRA818_REC_STACK_SIZE    1024
+
+typedef enum {
+    Dra818RecFormatPcm16,
+    Dra818RecFormatAdpcm, // IMA-ADPCM, 4 bits per sample
+} Dra818RecFormat;
+
+typedef struct {
+    uint32_t samples; // Samples recorded
+    uint32_t gated; // Samples skipped while the gate was closed
+    uint32_t dropped; // Samples dropped because no buffer was free
+    uint32_t adc_overruns; // Blocks the ADC dropped before they reached the recorder
+    uint32_t bytes; // Audio bytes written
+    uint32_t writes;
+    uint32_t write_errors;
+    uint32_t write_max_ms; // Slowest buffer write
+    uint32_t buffers_max; // High-water mark of full buffers waiting for SD
+} Dra818RecStats;
+
+typedef struct Dra818Rec Dra818Rec;
+
+/**
+ * @brief      Start recording to a new WAV file at `path`.
+ * @param      open  Initial gate state.
+ * @return     NULL if the file cannot be created or the ADC is busy.
+*/
+Dra818Rec* dra818_rec_start(
+    const char* path,
+    uint32_t sample_rate,
+    Dra818RecFormat format,
+    bool open);
+// Stop, write what is buffered, finish the WAV header and free `rec`.  Fills `stats` if set.
+void dra818_rec_stop(Dra818Rec* rec, Dra818RecStats* stats);
+
+// Open or close the gate; safe from any thread.
+void dra818_rec_set_gate(Dra818Rec* rec, bool open);
+void dra818_rec_get_stats(Dra818Rec* rec, Dra818RecStats* stats);
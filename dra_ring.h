@@ -0,0 +1,68 @@
+/*
+ -- dra_ring.h
+ -- Lock-free single-producer/single-consumer byte ring
+ --
+ -- One context (typically an interrupt handler) pushes, one thread pops.  No
+ -- locks are taken, so the producer never waits on the consumer.  The storage
+ -- size must be a power of two.
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint8_t* buffer;
+    size_t mask; // size - 1
+    atomic_size_t head; // Next slot to write, owned by the producer
+    atomic_size_t tail; // Next slot to read, owned by the consumer
+    atomic_uint_least32_t overflows; // Bytes dropped because the ring was full
+} Dra818Ring;
+
+static inline void dra818_ring_init(Dra818Ring* ring, uint8_t* storage, size_t size) {
+    ring->buffer = storage;
+    ring->mask = size - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->overflows, 0);
+}
+
+// Producer side.  Returns false (and counts an overflow) if the ring is full.
+static inline bool dra818_ring_push(Dra818Ring* ring, uint8_t data) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if(head - tail > ring->mask) {
+        atomic_fetch_add_explicit(&ring->overflows, 1, memory_order_relaxed);
+        return false;
+    }
+    ring->buffer[head & ring->mask] = data;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Consumer side.  Copies up to `size` bytes in one batch and returns how many.
+static inline size_t dra818_ring_pop(Dra818Ring* ring, uint8_t* data, size_t size) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = head - tail;
+    if(count > size) {
+        count = size;
+    }
+    for(size_t i = 0; i < count; i++) {
+        data[i] = ring->buffer[(tail + i) & ring->mask];
+    }
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+static inline size_t dra818_ring_count(Dra818Ring* ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire) -
+           atomic_load_explicit(&ring->tail, memory_order_acquire);
+}
+
+static inline uint32_t dra818_ring_overflows(Dra818Ring* ring) {
+    return atomic_load_explicit(&ring->overflows, memory_order_relaxed);
+}
@@ -0,0 +1,349 @@
+/*
+ -- dra_scan.c
+ -- Channel scanner for DRA818V/U modules
+*/
+
+#include <furi.h>
+#include <string.h>
+#include "dra.h"
+#include "dra_scan.h"
+
+#define TAG "Dra818Scan"
+
+struct Dra818Scan {
+    Dra818* dra;
+    Dra818At* at;
+    FuriTimer* dwell_timer;
+    FuriMutex* mutex;
+    FuriSemaphore* idle; // Released when the last command in flight completes for free()
+
+    Dra818ScanConfig config;
+    Dra818Freq* list; // Own copy of the memory list
+    size_t count;
+    uint32_t* lockouts; // One bit per channel
+    Dra818ScanCallback callback;
+    void* context;
+
+    bool running;
+    bool retune_pending; // A DMOSETGROUP from this scanner is queued or in flight
+    bool retune_held; // That DMOSETGROUP waits for the dwell to end before its CR/LF
+    bool retune_retry; // The last retune could not be queued
+    bool holding; // Parked on an active channel
+    bool free_waiting; // dra818_scan_free() waits on idle
+    size_t current; // Channel the module is tuned to
+    size_t target; // Channel of the retune in flight, or to retry
+    size_t next; // Next channel in the sequential rotation
+    uint32_t since_priority;
+    bool rssi_pending; // An RSSI? from this scanner is in flight
+    size_t rssi_channel; // Channel the RSSI? in flight belongs to
+    bool rssi_active; // Squelch state at the end of that channel's dwell
+
+    Dra818ScanStats stats;
+    uint32_t start_tick;
+};
+
+static bool dra818_scan_locked(Dra818Scan* scan, size_t channel) {
+    return scan->lockouts[channel / 32] & (1UL << (channel % 32));
+}
+
+Dra818Freq dra818_scan_channel_freq(Dra818Scan* scan, size_t channel) {
+    if(scan->list) {
+        return scan->list[channel];
+    }
+    return scan->config.start + channel * scan->config.step;
+}
+
+size_t dra818_scan_channel_count(Dra818Scan* scan) {
+    return scan->count;
+}
+
+// Choose the channel after the current one, with the mutex held.
+static size_t dra818_scan_pick_next(Dra818Scan* scan) {
+    bool use_priority = scan->config.priority < scan->count && scan->config.priority_every > 0;
+
+    if(use_priority && scan->since_priority >= scan->config.priority_every) {
+        scan->since_priority = 0;
+        if(scan->current != scan->config.priority) {
+            return scan->config.priority;
+        }
+    }
+
+    for(size_t tried = 0; tried < scan->count; tried++) {
+        size_t channel = scan->next;
+        scan->next = (scan->next + 1) % scan->count;
+        if(dra818_scan_locked(scan, channel)) {
+            continue;
+        }
+        if(use_priority && channel == scan->config.priority) {
+            continue; // Visited through the priority revisit instead
+        }
+        scan->since_priority++;
+        return channel;
+    }
+
+    // Everything else is locked out; stay on the priority channel if there is one.
+    return use_priority ? scan->config.priority : scan->current;
+}
+
+static void dra818_scan_retune_done(Dra818AtResult result, const char* response, void* context);
+
+// Queue the retune for `channel`, with the mutex held.  A held retune is sent during
+// the current dwell and only takes effect once dra818_at_release() ends its line.
+static void dra818_scan_retune(Dra818Scan* scan, size_t channel, bool held) {
+    Dra818AtGroup group = scan->config.group;
+    group.tx_freq = dra818_scan_channel_freq(scan, channel);
+    group.rx_freq = group.tx_freq;
+    scan->target = channel;
+    scan->retune_pending =
+        held ? dra818_at_set_group_held(scan->at, &group, dra818_scan_retune_done, scan) :
+               dra818_at_set_group(scan->at, &group, dra818_scan_retune_done, scan);
+    scan->retune_held = held && scan->retune_pending;
+    if(held) {
+        return; // If it could not be queued, the dwell's end sends it the plain way
+    }
+    scan->retune_retry = !scan->retune_pending;
+    if(scan->retune_retry) {
+        // AT queue full; try again after one dwell.
+        scan->stats.retries++;
+        furi_timer_start(scan->dwell_timer, furi_ms_to_ticks(scan->config.dwell_ms));
+    }
+}
+
+// A command of ours completed, with the mutex held.  True if free() should go on.
+static bool dra818_scan_idle(Dra818Scan* scan) {
+    bool wake = scan->free_waiting && !scan->retune_pending && !scan->rssi_pending;
+    if(wake) {
+        scan->free_waiting = false;
+    }
+    return wake;
+}
+
+static void dra818_scan_retune_done(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(response);
+    Dra818Scan* scan = context;
+
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    scan->retune_pending = false;
+    scan->retune_held = false;
+    if(scan->running) {
+        if(result == Dra818AtResultOk) {
+            scan->current = scan->target;
+            furi_timer_start(scan->dwell_timer, furi_ms_to_ticks(scan->config.dwell_ms));
+            // The next channel's command text goes over the UART while this one settles.
+            // An RSSI? has to go out between the two, so that mode cannot do this.
+            if(!scan->config.sample_rssi) {
+                dra818_scan_retune(scan, dra818_scan_pick_next(scan), true);
+            }
+        } else {
+            scan->stats.errors++;
+            dra818_scan_retune(scan, dra818_scan_pick_next(scan), false);
+        }
+    }
+    bool wake = dra818_scan_idle(scan);
+    furi_mutex_release(scan->mutex);
+
+    if(wake) {
+        furi_semaphore_release(scan->idle);
+    }
+}
+
+static void dra818_scan_rssi_done(Dra818AtResult result, const char* response, void* context) {
+    Dra818Scan* scan = context;
+    Dra818ScanSample sample;
+
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    bool report = scan->running;
+    scan->rssi_pending = false;
+    sample.channel = scan->rssi_channel;
+    sample.freq = dra818_scan_channel_freq(scan, sample.channel);
+    sample.active = scan->rssi_active;
+    sample.has_rssi = result == Dra818AtResultOk && dra818_at_parse_rssi(response, &sample.rssi);
+    bool wake = dra818_scan_idle(scan);
+    furi_mutex_release(scan->mutex);
+
+    if(report && scan->callback) {
+        scan->callback(&sample, scan->context);
+    }
+    if(wake) {
+        furi_semaphore_release(scan->idle);
+    }
+}
+
+static void dra818_scan_dwell_callback(void* context) {
+    Dra818Scan* scan = context;
+    Dra818ScanSample sample;
+
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    if(!scan->running) {
+        furi_mutex_release(scan->mutex);
+        return;
+    }
+    if(scan->retune_pending && !scan->retune_held) {
+        furi_mutex_release(scan->mutex);
+        return;
+    }
+    if(scan->retune_retry) {
+        dra818_scan_retune(scan, scan->target, false);
+        furi_mutex_release(scan->mutex);
+        return;
+    }
+
+    sample.channel = scan->current;
+    sample.freq = dra818_scan_channel_freq(scan, scan->current);
+    sample.active = dra818_squelch_open(scan->dra);
+    sample.has_rssi = false;
+    sample.rssi = 0;
+
+    if(!scan->holding) {
+        scan->stats.channels++;
+        if(sample.active) {
+            scan->stats.hits++;
+        }
+    }
+
+    bool report = true;
+    if(sample.active && scan->config.hang_ms > 0) {
+        // Park here and check again after the hang time.
+        scan->holding = true;
+        furi_timer_start(scan->dwell_timer, furi_ms_to_ticks(scan->config.hang_ms));
+    } else {
+        scan->holding = false;
+        if(scan->config.sample_rssi) {
+            scan->rssi_channel = scan->current;
+            scan->rssi_active = sample.active;
+            scan->rssi_pending = dra818_at_read_rssi(scan->at, dra818_scan_rssi_done, scan);
+            report = !scan->rssi_pending;
+        }
+        if(scan->retune_held) {
+            // Its text is on the wire already; the line ending retunes the module.
+            dra818_at_release(scan->at, scan);
+            scan->retune_held = false;
+        } else {
+            // Pipelined: the retune goes out right behind RSSI?, without waiting for
+            // this thread to see its answer.
+            dra818_scan_retune(scan, dra818_scan_pick_next(scan), false);
+        }
+    }
+    furi_mutex_release(scan->mutex);
+
+    if(report && scan->callback) {
+        scan->callback(&sample, scan->context);
+    }
+}
+
+Dra818Scan* dra818_scan_alloc(Dra818* dra, Dra818At* at) {
+    Dra818Scan* scan = malloc(sizeof(Dra818Scan));
+    memset(scan, 0, sizeof(Dra818Scan));
+    scan->dra = dra;
+    scan->at = at;
+    scan->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    scan->idle = furi_semaphore_alloc(1, 0);
+    scan->dwell_timer = furi_timer_alloc(dra818_scan_dwell_callback, FuriTimerTypeOnce, scan);
+    return scan;
+}
+
+void dra818_scan_free(Dra818Scan* scan) {
+    dra818_scan_stop(scan);
+    // Let an outstanding retune or RSSI? call back before the memory goes away.
+    // Other clients' commands on the engine are none of our business.
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    bool pending = scan->retune_pending || scan->rssi_pending;
+    scan->free_waiting = pending;
+    furi_mutex_release(scan->mutex);
+    if(pending) {
+        furi_semaphore_acquire(scan->idle, FuriWaitForever);
+    }
+    furi_timer_free(scan->dwell_timer);
+    furi_semaphore_free(scan->idle);
+    furi_mutex_free(scan->mutex);
+    free(scan->list);
+    free(scan->lockouts);
+    free(scan);
+}
+
+bool dra818_scan_start(
+    Dra818Scan* scan,
+    const Dra818ScanConfig* config,
+    Dra818ScanCallback callback,
+    void* context) {
+    size_t count = config->list ? config->list_count :
+                   config->step ? (config->stop - config->start) / config->step + 1 :
+                                  0;
+    if(count == 0 || (!config->list && config->stop < config->start)) {
+        return false;
+    }
+
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    if(scan->running || scan->retune_pending || scan->rssi_pending) {
+        furi_mutex_release(scan->mutex);
+        return false;
+    }
+
+    scan->config = *config;
+    free(scan->list);
+    scan->list = NULL;
+    if(config->list) {
+        scan->list = malloc(count * sizeof(Dra818Freq));
+        memcpy(scan->list, config->list, count * sizeof(Dra818Freq));
+        scan->config.list = scan->list;
+    }
+    if(scan->count != count || !scan->lockouts) {
+        free(scan->lockouts);
+        scan->lockouts = malloc((count + 31) / 32 * sizeof(uint32_t));
+        memset(scan->lockouts, 0, (count + 31) / 32 * sizeof(uint32_t));
+    }
+    scan->count = count;
+    scan->callback = callback;
+    scan->context = context;
+    scan->holding = false;
+    scan->current = 0;
+    scan->next = 0;
+    scan->since_priority = 0;
+    memset(&scan->stats, 0, sizeof(scan->stats));
+    scan->start_tick = furi_get_tick();
+    scan->running = true;
+
+    dra818_scan_retune(scan, dra818_scan_pick_next(scan), false);
+    furi_mutex_release(scan->mutex);
+
+    FURI_LOG_I(TAG, "Scanning %u channels", (unsigned)count);
+    return true;
+}
+
+void dra818_scan_stop(Dra818Scan* scan) {
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    scan->running = false;
+    if(scan->retune_held) {
+        // Would hold up every other client of the engine; let it finish.
+        dra818_at_release(scan->at, scan);
+        scan->retune_held = false;
+    }
+    furi_mutex_release(scan->mutex);
+    furi_timer_stop(scan->dwell_timer);
+}
+
+bool dra818_scan_is_running(Dra818Scan* scan) {
+    return scan->running;
+}
+
+void dra818_scan_set_lockout(Dra818Scan* scan, size_t channel, bool locked) {
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    if(scan->lockouts && channel < scan->count) {
+        if(locked) {
+            scan->lockouts[channel / 32] |= 1UL << (channel % 32);
+        } else {
+            scan->lockouts[channel / 32] &= ~(1UL << (channel % 32));
+        }
+    }
+    furi_mutex_release(scan->mutex);
+}
+
+void dra818_scan_get_stats(Dra818Scan* scan, Dra818ScanStats* stats) {
+    furi_mutex_acquire(scan->mutex, FuriWaitForever);
+    *stats = scan->stats;
+    uint32_t ticks = furi_get_tick() - scan->start_tick;
+    furi_mutex_release(scan->mutex);
+
+    stats->elapsed_ms = (uint64_t)ticks * 1000 / furi_kernel_get_tick_frequency();
+    stats->rate = stats->elapsed_ms ? stats->channels * 1000.0f / stats->elapsed_ms : 0.0f;
+}
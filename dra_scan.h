@@ -0,0 +1,82 @@
+/*
+ -- dra_scan.h
+ -- Channel scanner for DRA818V/U modules
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra.h"
+#include "dra_at.h"
+
+#define DRA818_SCAN_NO_PRIORITY ((size_t)-1)
+
+typedef struct {
+    // Channels are either a range (start/stop/step) or, if list is set, a memory list.
+    Dra818Freq start; // First frequency of the range
+    Dra818Freq stop; // Last frequency of the range (inclusive)
+    Dra818Freq step; // Range step (DRA818_STEP_NARROW or DRA818_STEP_WIDE)
+    const Dra818Freq* list; // Memory list of frequencies; copied by dra818_scan_start()
+    size_t list_count;
+
+    Dra818AtGroup group; // Bandwidth, tones and squelch used on every channel
+    uint32_t dwell_ms; // Time for squelch to settle after a retune
+    uint32_t hang_ms; // Re-check interval while parked on an active channel (0: never park)
+    size_t priority; // Channel revisited periodically (DRA818_SCAN_NO_PRIORITY for none)
+    uint32_t priority_every; // Revisit the priority channel after this many channels
+    bool sample_rssi; // Read RSSI? on every channel (slower; squelch alone decides hits)
+} Dra818ScanConfig;
+
+typedef struct {
+    size_t channel; // Channel index
+    Dra818Freq freq; // Channel frequency
+    bool active; // Squelch was open at the end of the dwell
+    bool has_rssi; // rssi is valid
+    uint8_t rssi; // Module RSSI reading
+} Dra818ScanSample;
+
+typedef struct {
+    uint32_t channels; // Channels visited since start
+    uint32_t hits; // Channels found active
+    uint32_t errors; // Retunes the module did not acknowledge
+    uint32_t retries; // Retunes put off by one dwell because the AT queue was full
+    uint32_t elapsed_ms; // Time since start
+    float rate; // Achieved channels per second
+} Dra818ScanStats;
+
+/**
+ * Called from the timer or AT worker thread for every channel visited, and again
+ * for every hang interval while parked on an active channel.
+*/
+typedef void (*Dra818ScanCallback)(const Dra818ScanSample* sample, void* context);
+
+typedef struct Dra818Scan Dra818Scan;
+
+// Scans with the module `dra`, retuned through `at`.  Scanners on different modules
+// run independently, e.g. one per band.
+Dra818Scan* dra818_scan_alloc(Dra818* dra, Dra818At* at);
+void dra818_scan_free(Dra818Scan* scan);
+
+/**
+ * @brief      Start scanning.  While a channel dwells, the next channel's
+ *           AT+DMOSETGROUP text is already sent, held back only by its CR/LF, which
+ *           goes out once the squelch was sampled; the module cannot change channel
+ *           any earlier without spoiling the sample.  With sample_rssi the RSSI? has
+ *           to go between the two, so the retune is queued right behind it instead.
+ * @return     false if already running, the channel list is empty, or a retune or
+ *           RSSI? from a previous run is still in flight.
+*/
+bool dra818_scan_start(
+    Dra818Scan* scan,
+    const Dra818ScanConfig* config,
+    Dra818ScanCallback callback,
+    void* context);
+void dra818_scan_stop(Dra818Scan* scan);
+bool dra818_scan_is_running(Dra818Scan* scan);
+
+size_t dra818_scan_channel_count(Dra818Scan* scan);
+Dra818Freq dra818_scan_channel_freq(Dra818Scan* scan, size_t channel);
+void dra818_scan_set_lockout(Dra818Scan* scan, size_t channel, bool locked);
+void dra818_scan_get_stats(Dra818Scan* scan, Dra818ScanStats* stats);
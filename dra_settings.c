@@ -0,0 +1,323 @@
+/*
+ -- dra_settings.c
+ -- Persistent app settings for the DRA818V/U app
+*/
+
+#include <furi.h>
+#include <storage/storage.h>
+#include <string.h>
+#include "dra_crc.h"
+#include "dra_settings.h"
+
+#define TAG "Dra818Settings"
+
+#define DRA818_SETTINGS_MAGIC 0x53415244 // "DRAS" little-endian
+
+typedef enum {
+    Dra818SettingsEvtStop = (1 << 0),
+    Dra818SettingsEvtFlush = (1 << 1), // The debounce timer ran out
+} Dra818SettingsEvtFlags;
+
+struct Dra818SettingsStore {
+    FuriMutex* mutex; // Guards everything below against the writer thread
+    FuriMutex* write_mutex; // One record write at a time; never held with `mutex`
+    FuriTimer* timer; // One-shot; fires once the user stops editing
+    FuriThread* thread; // Writes the record when the timer asks
+    char* path;
+    Dra818Settings settings;
+    uint32_t generation; // Bumped by every change
+    uint32_t saved; // Generation on storage; differs from `generation` while dirty
+    Dra818SettingsStats stats;
+};
+
+static uint8_t* dra818_settings_put(uint8_t* out, uint32_t value, size_t bytes) {
+    for(size_t i = 0; i < bytes; i++) {
+        *out++ = value >> (i * 8);
+    }
+    return out;
+}
+
+static uint32_t dra818_settings_take(const uint8_t** in, size_t bytes) {
+    uint32_t value = 0;
+    for(size_t i = 0; i < bytes; i++) {
+        value |= (uint32_t)(*in)[i] << (i * 8);
+    }
+    *in += bytes;
+    return value;
+}
+
+void dra818_settings_defaults(Dra818Settings* settings) {
+    memset(settings, 0, sizeof(Dra818Settings));
+    settings->pl_mode = 0; // None
+    settings->wide = true;
+    settings->squelch = 1;
+    settings->volume = 6;
+    settings->tx_freq = DRA818_FREQ_MHZ(146, 5200); // 2 m national simplex
+    settings->rx_freq = DRA818_FREQ_MHZ(146, 5200);
+    settings->tx_tone = DRA818_TONE_NONE;
+    settings->rx_tone = DRA818_TONE_NONE;
+    strlcpy(settings->callsign, "W1AW", sizeof(settings->callsign));
+    settings->bus_speed = DRA818_SETTINGS_BUS_SPEED_NONE;
+    settings->power_on_ms = 150;
+    settings->power_off_ms = 0;
+}
+
+// Field by field: the struct has padding, so memcmp could see a change that is not one.
+static bool dra818_settings_equal(const Dra818Settings* a, const Dra818Settings* b) {
+    return a->pl_mode == b->pl_mode && a->wide == b->wide && a->squelch == b->squelch &&
+           a->volume == b->volume && a->tx_freq == b->tx_freq && a->rx_freq == b->rx_freq &&
+           a->tx_tone == b->tx_tone && a->rx_tone == b->rx_tone &&
+           strncmp(a->callsign, b->callsign, sizeof(a->callsign)) == 0 &&
+           a->bus_speed == b->bus_speed && a->power_on_ms == b->power_on_ms &&
+           a->power_off_ms == b->power_off_ms;
+}
+
+size_t dra818_settings_encode(const Dra818Settings* settings, uint8_t* out, size_t size) {
+    if(size < DRA818_SETTINGS_RECORD_SIZE) {
+        return 0;
+    }
+    uint8_t* p = out;
+    p = dra818_settings_put(p, DRA818_SETTINGS_MAGIC, 4);
+    p = dra818_settings_put(p, DRA818_SETTINGS_VERSION, 1);
+    p = dra818_settings_put(p, 0, 1); // Reserved
+    p = dra818_settings_put(p, DRA818_SETTINGS_PAYLOAD_SIZE, 2);
+
+    p = dra818_settings_put(p, settings->pl_mode, 1);
+    p = dra818_settings_put(p, settings->wide ? 1 : 0, 1);
+    p = dra818_settings_put(p, settings->squelch, 1);
+    p = dra818_settings_put(p, settings->volume, 1);
+    p = dra818_settings_put(p, settings->tx_freq, 4);
+    p = dra818_settings_put(p, settings->rx_freq, 4);
+    p = dra818_settings_put(p, settings->tx_tone, 2);
+    p = dra818_settings_put(p, settings->rx_tone, 2);
+    memcpy(p, settings->callsign, DRA818_SETTINGS_CALLSIGN_MAX);
+    p[DRA818_SETTINGS_CALLSIGN_MAX - 1] = '\0';
+    p += DRA818_SETTINGS_CALLSIGN_MAX;
+    p = dra818_settings_put(p, settings->bus_speed, 1);
+    p = dra818_settings_put(p, settings->power_on_ms, 2);
+    p = dra818_settings_put(p, settings->power_off_ms, 2);
+
+    p = dra818_settings_put(p, dra818_crc16_ccitt(DRA818_CRC16_INIT, out, p - out), 2);
+    return p - out;
+}
+
+bool dra818_settings_decode(const uint8_t* data, size_t size, Dra818Settings* settings) {
+    dra818_settings_defaults(settings);
+    if(size < 8) {
+        return false;
+    }
+    const uint8_t* p = data;
+    if(dra818_settings_take(&p, 4) != DRA818_SETTINGS_MAGIC) {
+        return false;
+    }
+    uint32_t version = dra818_settings_take(&p, 1);
+    size_t payload = version == 1 ? DRA818_SETTINGS_PAYLOAD_SIZE_V1 :
+                     version == 2 ? DRA818_SETTINGS_PAYLOAD_SIZE_V2 :
+                     version == 3 ? DRA818_SETTINGS_PAYLOAD_SIZE :
+                                    0;
+    p++; // Reserved
+    if(payload == 0 || dra818_settings_take(&p, 2) != payload || size != 8 + payload + 2) {
+        return false;
+    }
+    const uint8_t* crc = data + size - 2;
+    if(dra818_settings_take(&crc, 2) != dra818_crc16_ccitt(DRA818_CRC16_INIT, data, size - 2)) {
+        return false;
+    }
+
+    // A field that fails its range check keeps its default; the rest still load.
+    Dra818Settings record;
+    record.pl_mode = dra818_settings_take(&p, 1);
+    record.wide = dra818_settings_take(&p, 1) != 0;
+    record.squelch = dra818_settings_take(&p, 1);
+    record.volume = dra818_settings_take(&p, 1);
+    record.tx_freq = dra818_settings_take(&p, 4);
+    record.rx_freq = dra818_settings_take(&p, 4);
+    record.tx_tone = dra818_settings_take(&p, 2);
+    record.rx_tone = dra818_settings_take(&p, 2);
+    memcpy(record.callsign, p, DRA818_SETTINGS_CALLSIGN_MAX);
+    record.callsign[DRA818_SETTINGS_CALLSIGN_MAX - 1] = '\0';
+    p += DRA818_SETTINGS_CALLSIGN_MAX;
+    record.bus_speed = version >= 2 ? dra818_settings_take(&p, 1) : DRA818_SETTINGS_BUS_SPEED_NONE;
+    record.power_on_ms = version >= 3 ? dra818_settings_take(&p, 2) : settings->power_on_ms;
+    record.power_off_ms = version >= 3 ? dra818_settings_take(&p, 2) : settings->power_off_ms;
+
+    if(record.pl_mode < 4) {
+        settings->pl_mode = record.pl_mode;
+    }
+    settings->wide = record.wide;
+    if(record.squelch <= 8) {
+        settings->squelch = record.squelch;
+    }
+    if(record.volume >= 1 && record.volume <= 8) {
+        settings->volume = record.volume;
+    }
+    if(dra818_plan_freq_valid(record.tx_freq, record.wide)) {
+        settings->tx_freq = record.tx_freq;
+    }
+    if(dra818_plan_freq_valid(record.rx_freq, record.wide)) {
+        settings->rx_freq = record.rx_freq;
+    }
+    if(dra818_plan_tone_valid(record.tx_tone)) {
+        settings->tx_tone = record.tx_tone;
+    }
+    if(dra818_plan_tone_valid(record.rx_tone)) {
+        settings->rx_tone = record.rx_tone;
+    }
+    memcpy(settings->callsign, record.callsign, sizeof(settings->callsign));
+    if(record.bus_speed < DRA818_PORT_SPEEDS) {
+        settings->bus_speed = record.bus_speed;
+    }
+    if(record.power_on_ms > 0) {
+        settings->power_on_ms = record.power_on_ms;
+        settings->power_off_ms = record.power_off_ms;
+    }
+    return true;
+}
+
+static bool dra818_settings_load(Dra818SettingsStore* store) {
+    uint8_t record[DRA818_SETTINGS_RECORD_SIZE + 1]; // +1 so an oversized file is caught
+    size_t size = 0;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    if(storage_file_open(file, store->path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        size = storage_file_read(file, record, sizeof(record));
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+
+    return dra818_settings_decode(record, size, &store->settings);
+}
+
+// Called with write_mutex held and `mutex` released.
+static bool dra818_settings_write(Dra818SettingsStore* store, const uint8_t* record, size_t size) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    bool ok = storage_file_open(file, store->path, FSAM_WRITE, FSOM_CREATE_ALWAYS) &&
+              storage_file_write(file, record, size) == size;
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+
+    if(!ok) {
+        FURI_LOG_E(TAG, "Failed to write %s", store->path);
+    }
+    return ok;
+}
+
+static void dra818_settings_timer_callback(void* context) {
+    Dra818SettingsStore* store = context;
+    furi_thread_flags_set(furi_thread_get_id(store->thread), Dra818SettingsEvtFlush);
+}
+
+static int32_t dra818_settings_writer(void* context) {
+    Dra818SettingsStore* store = context;
+    while(true) {
+        uint32_t events = furi_thread_flags_wait(
+            Dra818SettingsEvtStop | Dra818SettingsEvtFlush, FuriFlagWaitAny, FuriWaitForever);
+        if(events & Dra818SettingsEvtStop) {
+            break; // Free writes what is still pending
+        }
+        if(events & Dra818SettingsEvtFlush) {
+            dra818_settings_flush(store);
+        }
+    }
+    return 0;
+}
+
+Dra818SettingsStore* dra818_settings_alloc(const char* path) {
+    Dra818SettingsStore* store = malloc(sizeof(Dra818SettingsStore));
+    store->mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    store->write_mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    store->timer = furi_timer_alloc(dra818_settings_timer_callback, FuriTimerTypeOnce, store);
+    store->path = strdup(path);
+    store->thread =
+        furi_thread_alloc_ex(TAG, DRA818_SETTINGS_STACK_SIZE, dra818_settings_writer, store);
+    furi_thread_set_priority(store->thread, FuriThreadPriorityLow);
+    furi_thread_start(store->thread);
+
+    uint32_t start = furi_get_tick();
+    store->stats.loaded = dra818_settings_load(store);
+    store->stats.load_ms = furi_get_tick() - start;
+    FURI_LOG_I(
+        TAG, "%s in %lu ms", store->stats.loaded ? "Loaded" : "Defaults", store->stats.load_ms);
+    return store;
+}
+
+void dra818_settings_free(Dra818SettingsStore* store) {
+    furi_timer_stop(store->timer);
+    furi_timer_free(store->timer);
+    furi_thread_flags_set(furi_thread_get_id(store->thread), Dra818SettingsEvtStop);
+    furi_thread_join(store->thread);
+    furi_thread_free(store->thread);
+    dra818_settings_flush(store);
+    FURI_LOG_I(
+        TAG,
+        "%lu changes, %lu writes, %lu errors",
+        store->stats.changes,
+        store->stats.writes,
+        store->stats.write_errors);
+    furi_mutex_free(store->write_mutex);
+    furi_mutex_free(store->mutex);
+    free(store->path);
+    free(store);
+}
+
+void dra818_settings_get(Dra818SettingsStore* store, Dra818Settings* settings) {
+    furi_mutex_acquire(store->mutex, FuriWaitForever);
+    *settings = store->settings;
+    furi_mutex_release(store->mutex);
+}
+
+void dra818_settings_set(Dra818SettingsStore* store, const Dra818Settings* settings) {
+    furi_mutex_acquire(store->mutex, FuriWaitForever);
+    bool changed = !dra818_settings_equal(&store->settings, settings);
+    if(changed) {
+        store->settings = *settings;
+        store->generation++;
+        store->stats.changes++;
+    }
+    furi_mutex_release(store->mutex);
+
+    if(changed) {
+        // Restarting the timer pushes the write back until editing pauses.
+        furi_timer_start(store->timer, furi_ms_to_ticks(DRA818_SETTINGS_DEBOUNCE_MS));
+    }
+}
+
+bool dra818_settings_flush(Dra818SettingsStore* store) {
+    furi_mutex_acquire(store->write_mutex, FuriWaitForever);
+
+    // Encode a snapshot under the mutex; the SD write runs without it, so get and set
+    // never wait for storage.
+    uint8_t record[DRA818_SETTINGS_RECORD_SIZE];
+    size_t size = 0;
+    furi_mutex_acquire(store->mutex, FuriWaitForever);
+    uint32_t generation = store->generation;
+    if(generation != store->saved) {
+        size = dra818_settings_encode(&store->settings, record, sizeof(record));
+    }
+    furi_mutex_release(store->mutex);
+
+    bool ok = size == 0 || dra818_settings_write(store, record, size);
+
+    if(size > 0) {
+        furi_mutex_acquire(store->mutex, FuriWaitForever);
+        if(ok) {
+            store->saved = generation; // Still dirty if a set came in during the write
+            store->stats.writes++;
+        } else {
+            store->stats.write_errors++;
+        }
+        furi_mutex_release(store->mutex);
+    }
+    furi_mutex_release(store->write_mutex);
+    return ok;
+}
+
+void dra818_settings_get_stats(Dra818SettingsStore* store, Dra818SettingsStats* stats) {
+    furi_mutex_acquire(store->mutex, FuriWaitForever);
+    *stats = store->stats;
+    furi_mutex_release(store->mutex);
+}
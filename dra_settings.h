@@ -0,0 +1,73 @@
+/*
+ -- dra_settings.h
+ -- Persistent app settings for the DRA818V/U app
+ --
+ -- The settings live in one small binary record (header, payload, CRC) that is
+ -- read once at startup.  Edits are coalesced: each change restarts a debounce
+ -- timer and the record is written only once the user stops editing, or on free.
+ -- The timer only wakes a low-priority writer thread, so SD access never holds up
+ -- the timer service thread.  The record is encoded under the store's lock and
+ -- written outside it, so get and set never wait for the card either.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_plan.h"
+#include "dra_port.h"
+
+#define DRA818_SETTINGS_VERSION        3 // Version 1 and 2 records still load
+#define DRA818_SETTINGS_CALLSIGN_MAX   12 // Including the terminator
+#define DRA818_SETTINGS_DEBOUNCE_MS    2000 // Quiet time before an edit is written
+#define DRA818_SETTINGS_BUS_SPEED_NONE 0xFF // The bus has not been calibrated
+#define DRA818_SETTINGS_STACK_SIZE     1024 // Writer thread
+
+typedef struct {
+    uint8_t pl_mode; // PL Mode setting index
+    bool wide; // 25 kHz channel spacing
+    uint8_t squelch; // 0..8
+    uint8_t volume; // 1..8
+    Dra818Freq tx_freq;
+    Dra818Freq rx_freq;
+    Dra818Tone tx_tone;
+    Dra818Tone rx_tone;
+    char callsign[DRA818_SETTINGS_CALLSIGN_MAX];
+    uint8_t bus_speed; // Calibrated SPI speed step (see dra_port.h)
+    uint16_t power_on_ms; // Power-save listening window
+    uint16_t power_off_ms; // Power-save sleep between windows; 0 keeps the module on
+} Dra818Settings;
+
+#define DRA818_SETTINGS_PAYLOAD_SIZE_V1 (16 + DRA818_SETTINGS_CALLSIGN_MAX)
+#define DRA818_SETTINGS_PAYLOAD_SIZE_V2 (DRA818_SETTINGS_PAYLOAD_SIZE_V1 + 1)
+#define DRA818_SETTINGS_PAYLOAD_SIZE    (DRA818_SETTINGS_PAYLOAD_SIZE_V2 + 4)
+// Header + payload + CRC16.
+#define DRA818_SETTINGS_RECORD_SIZE (8 + DRA818_SETTINGS_PAYLOAD_SIZE + 2)
+
+typedef struct {
+    bool loaded; // The record was read from storage (false = defaults)
+    uint32_t load_ms; // Time spent opening and reading the record
+    uint32_t changes; // Calls to dra818_settings_set() that changed something
+    uint32_t writes; // Records actually written to storage
+    uint32_t write_errors;
+} Dra818SettingsStats;
+
+typedef struct Dra818SettingsStore Dra818SettingsStore;
+
+void dra818_settings_defaults(Dra818Settings* settings);
+// Serialise into a record of DRA818_SETTINGS_RECORD_SIZE bytes; returns its size.
+size_t dra818_settings_encode(const Dra818Settings* settings, uint8_t* out, size_t size);
+// Parse a version 1, 2 or 3 record; false (and defaults) on a bad magic, version or CRC.
+bool dra818_settings_decode(const uint8_t* data, size_t size, Dra818Settings* settings);
+
+// Loads the record from path, falling back to defaults.
+Dra818SettingsStore* dra818_settings_alloc(const char* path);
+// Writes any pending change before freeing.
+void dra818_settings_free(Dra818SettingsStore* store);
+void dra818_settings_get(Dra818SettingsStore* store, Dra818Settings* settings);
+// Replaces the settings and schedules a coalesced write if anything changed.
+void dra818_settings_set(Dra818SettingsStore* store, const Dra818Settings* settings);
+// Writes a pending change now.  Returns false if the write failed.
+bool dra818_settings_flush(Dra818SettingsStore* store);
+void dra818_settings_get_stats(Dra818SettingsStore* store, Dra818SettingsStats* stats);
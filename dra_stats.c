@@ -0,0 +1,148 @@
+/*
+ -- dra_stats.c
+ -- Latency and error instrumentation for the DRA818V/U driver
+*/
+
+#include "dra_stats.h"
+
+#ifdef DRA_STATS
+
+#include <furi.h>
+#include <string.h>
+
+#if defined(__arm__)
+#include <furi_hal_cortex.h>
+#else
+#include <time.h>
+#endif
+
+#define TAG "Dra818Stats"
+
+static Dra818StatEntry dra818_stats[Dra818StatCount];
+
+static const char* const dra818_stats_names[Dra818StatCount] = {
+    [Dra818StatSpi] = "spi",
+    [Dra818StatWrite] = "write",
+    [Dra818StatRead] = "read",
+    [Dra818StatBurst] = "burst",
+    [Dra818StatInit] = "init",
+    [Dra818StatAt] = "at",
+    [Dra818StatAfsk] = "afsk",
+    [Dra818StatTsq] = "tsq",
+    [Dra818StatRadio] = "radio",
+    [Dra818StatMem] = "mem",
+    [Dra818StatRec] = "rec",
+    [Dra818StatHost] = "host",
+};
+
+uint32_t dra818_stats_now() {
+#if defined(__arm__)
+    return DWT->CYCCNT;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+#endif
+}
+
+static uint32_t dra818_stats_to_us(uint32_t elapsed) {
+#if defined(__arm__)
+    return elapsed / furi_hal_cortex_instructions_per_microsecond();
+#else
+    return elapsed / 1000;
+#endif
+}
+
+void dra818_stats_record(Dra818StatOp op, uint32_t start, bool ok, bool timeout) {
+    uint32_t us = dra818_stats_to_us(dra818_stats_now() - start);
+    uint32_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    if(bucket >= DRA818_STATS_BUCKETS) {
+        bucket = DRA818_STATS_BUCKETS - 1;
+    }
+
+    FURI_CRITICAL_ENTER();
+    Dra818StatEntry* entry = &dra818_stats[op];
+    if(entry->count == 0 || us < entry->min_us) {
+        entry->min_us = us;
+    }
+    if(us > entry->max_us) {
+        entry->max_us = us;
+    }
+    entry->count++;
+    entry->total_us += us;
+    entry->histogram[bucket]++;
+    if(!ok) {
+        entry->errors++;
+        if(timeout) {
+            entry->timeouts++;
+        }
+    }
+    FURI_CRITICAL_EXIT();
+}
+
+void dra818_stats_get(Dra818StatOp op, Dra818StatEntry* entry) {
+    FURI_CRITICAL_ENTER();
+    *entry = dra818_stats[op];
+    FURI_CRITICAL_EXIT();
+}
+
+void dra818_stats_reset() {
+    FURI_CRITICAL_ENTER();
+    memset(dra818_stats, 0, sizeof(dra818_stats));
+    FURI_CRITICAL_EXIT();
+}
+
+void dra818_stats_format(FuriString* out) {
+    furi_string_reset(out);
+    for(size_t op = 0; op < Dra818StatCount; op++) {
+        Dra818StatEntry entry;
+        dra818_stats_get(op, &entry);
+        if(entry.count == 0) {
+            continue;
+        }
+        furi_string_cat_printf(
+            out,
+            "%s n=%lu err=%lu to=%lu\n us min/avg/max %lu/%lu/%lu\n",
+            dra818_stats_names[op],
+            entry.count,
+            entry.errors,
+            entry.timeouts,
+            entry.min_us,
+            (uint32_t)(entry.total_us / entry.count),
+            entry.max_us);
+        // Histogram: "<N:count" for each non-empty log2 bucket.
+        furi_string_cat_printf(out, " ");
+        for(size_t bucket = 0; bucket < DRA818_STATS_BUCKETS; bucket++) {
+            if(entry.histogram[bucket]) {
+                furi_string_cat_printf(
+                    out, "<%lu:%lu ", (uint32_t)1 << bucket, entry.histogram[bucket]);
+            }
+        }
+        furi_string_cat_printf(out, "\n");
+    }
+    if(furi_string_size(out) == 0) {
+        furi_string_set_str(out, "No driver activity yet.");
+    }
+}
+
+void dra818_stats_log() {
+    for(size_t op = 0; op < Dra818StatCount; op++) {
+        Dra818StatEntry entry;
+        dra818_stats_get(op, &entry);
+        if(entry.count == 0) {
+            continue;
+        }
+        FURI_LOG_I(
+            TAG,
+            "%s n=%lu err=%lu to=%lu min/avg/max=%lu/%lu/%lu us",
+            dra818_stats_names[op],
+            entry.count,
+            entry.errors,
+            entry.timeouts,
+            entry.min_us,
+            (uint32_t)(entry.total_us / entry.count),
+            entry.max_us);
+    }
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ -- dra_stats.h
+ -- Latency and error instrumentation for the DRA818V/U driver
+ --
+ -- Everything here compiles to nothing unless DRA_STATS is defined, so release
+ -- builds pay no cost for it.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Uncomment to enable driver latency instrumentation and the Diagnostics screen.
+//#define DRA_STATS 1
+
+typedef enum {
+    Dra818StatSpi, // One SPI frame at the port (HAL call)
+    Dra818StatWrite, // dra818_write() that reached the bus
+    Dra818StatRead, // dra818_read() that reached the bus
+    Dra818StatBurst, // Burst and list transfers
+    Dra818StatInit, // dra818_init_async() start to ready
+    Dra818StatAt, // AT command submit to completion
+    Dra818StatAfsk, // AFSK demodulation of one ADC block
+    Dra818StatTsq, // Tone squelch detection of one ADC block
+    Dra818StatRadio, // Radio command post to execution
+    Dra818StatMem, // One page of a memory bank lookup
+    Dra818StatRec, // One recorder buffer written to SD
+    Dra818StatHost, // One host link request handled
+    Dra818StatCount,
+} Dra818StatOp;
+
+#define DRA818_STATS_BUCKETS 16 // log2 microsecond buckets: <1, <2, <4 ... >=16384 us
+
+typedef struct {
+    uint32_t count;
+    uint32_t errors; // Operations that failed
+    uint32_t timeouts; // Operations that failed by running into their timeout
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t histogram[DRA818_STATS_BUCKETS];
+} Dra818StatEntry;
+
+#ifdef DRA_STATS
+
+#include <furi.h>
+
+// Timestamp in cycles (DWT on Cortex-M) or nanoseconds (host fallback).
+uint32_t dra818_stats_now();
+void dra818_stats_record(Dra818StatOp op, uint32_t start, bool ok, bool timeout);
+void dra818_stats_get(Dra818StatOp op, Dra818StatEntry* entry);
+void dra818_stats_reset();
+void dra818_stats_format(FuriString* out);
+void dra818_stats_log();
+
+#define DRA818_STATS_BEGIN(name)                 uint32_t name = dra818_stats_now()
+#define DRA818_STATS_END(name, op, ok)           dra818_stats_record(op, name, ok, false)
+#define DRA818_STATS_END_EX(name, op, ok, tmout) dra818_stats_record(op, name, ok, tmout)
+
+#else
+
+#define DRA818_STATS_BEGIN(name)
+#define DRA818_STATS_END(name, op, ok)
+#define DRA818_STATS_END_EX(name, op, ok, tmout)
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ -- dra_tone.c
+ -- Non-blocking tone generator for the DRA818V/U audio input
+*/
+
+#include <furi.h>
+#include <furi_hal_bus.h>
+#include <furi_hal_interrupt.h>
+#include <furi_hal_pwm.h>
+#include <stm32wbxx_ll_lptim.h>
+#include <stm32wbxx_ll_tim.h>
+#include <string.h>
+#include "dra_tone.h"
+
+// PA7 (TIM1 CH1) is SPI1 MOSI, so the carrier uses LPTIM2 on PA4; TIM1 paces samples.
+#define DRA818_TONE_OUTPUT   FuriHalPwmOutputIdLptim2PA4
+#define DRA818_TONE_TIMER_HZ 64000000
+
+// One period of sine, Q15.
+static const int16_t dra818_tone_sine[256] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767, 32757, 32728, 32678, 32609, 32521, 32412, 32285,
+    32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571,
+    30273, 29956, 29621, 29268, 28898, 28510, 28105, 27683,
+    27245, 26790, 26319, 25832, 25329, 24811, 24279, 23731,
+    23170, 22594, 22005, 21403, 20787, 20159, 19519, 18868,
+    18204, 17530, 16846, 16151, 15446, 14732, 14010, 13279,
+    12539, 11793, 11039, 10278, 9512, 8739, 7962, 7179,
+    6393, 5602, 4808, 4011, 3212, 2410, 1608, 804,
+    0, -804, -1608, -2410, -3212, -4011, -4808, -5602,
+    -6393, -7179, -7962, -8739, -9512, -10278, -11039, -11793,
+    -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+    -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+    -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+    -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+    -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+    -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+    -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+    -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+    -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+    -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+    -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179,
+    -6393, -5602, -4808, -4011, -3212, -2410, -1608, -804,
+};
+
+// DTMF row and column frequencies in 0.1 Hz, keyed by "123A456B789C*0#D".
+static const char dra818_tone_dtmf_keys[] = "123A456B789C*0#D";
+static const uint16_t dra818_tone_dtmf_rows[] = {6970, 7700, 8520, 9410};
+static const uint16_t dra818_tone_dtmf_cols[] = {12090, 13360, 14770, 16330};
+
+static Dra818ToneStep dra818_tone_steps[DRA818_TONE_STEPS_MAX];
+static size_t dra818_tone_count;
+static size_t dra818_tone_index;
+static uint32_t dra818_tone_remaining; // Samples left in the current step
+static bool dra818_tone_forever; // Current step has no end
+static Dra818ToneOsc dra818_tone_osc;
+static Dra818ToneSource dra818_tone_source; // Replaces the step sequence when set
+static void* dra818_tone_source_context;
+static uint32_t dra818_tone_half; // Compare value for a zero sample
+static volatile bool dra818_tone_playing = false; // The update interrupt is producing samples
+static volatile bool dra818_tone_active = false; // A sequence was started and not yet finished
+static Dra818ToneDoneCallback dra818_tone_callback;
+static void* dra818_tone_context;
+
+void dra818_tone_osc_set(Dra818ToneOsc* osc, const Dra818ToneStep* step, uint32_t sample_rate) {
+    uint32_t f1 = step->f1 ? step->f1 : step->f2;
+    uint32_t f2 = step->f1 ? step->f2 : 0;
+    // step = f / fs * 2^32, with f in 0.1 Hz.
+    osc->step[0] = ((uint64_t)f1 << 32) / ((uint64_t)sample_rate * 10);
+    osc->step[1] = ((uint64_t)f2 << 32) / ((uint64_t)sample_rate * 10);
+    osc->phase[0] = 0;
+    osc->phase[1] = 0;
+    osc->level = step->level;
+    osc->dual = f2 != 0;
+}
+
+int16_t dra818_tone_osc_next(Dra818ToneOsc* osc) {
+    int32_t mix = dra818_tone_sine[osc->phase[0] >> 24];
+    if(osc->dual) {
+        mix += dra818_tone_sine[osc->phase[1] >> 24];
+    } else {
+        mix *= 2;
+    }
+    osc->phase[0] += osc->step[0];
+    osc->phase[1] += osc->step[1];
+    return (mix * osc->level) >> 9;
+}
+
+static void dra818_tone_load(size_t index) {
+    const Dra818ToneStep* step = &dra818_tone_steps[index];
+    dra818_tone_osc_set(&dra818_tone_osc, step, DRA818_TONE_SAMPLE_RATE);
+    dra818_tone_forever = step->duration_ms == DRA818_TONE_FOREVER;
+    dra818_tone_remaining = (uint32_t)step->duration_ms * DRA818_TONE_SAMPLE_RATE / 1000;
+    dra818_tone_index = index;
+}
+
+// Runs on the timer thread (or the caller of dra818_tone_stop) once samples have stopped.
+static void dra818_tone_finish(void* context, uint32_t completed) {
+    UNUSED(context);
+    LL_TIM_DisableCounter(TIM1);
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTim1UpTim16, NULL, NULL);
+    furi_hal_bus_disable(FuriHalBusTIM1);
+    furi_hal_pwm_stop(DRA818_TONE_OUTPUT);
+    dra818_tone_active = false;
+    if(dra818_tone_callback) {
+        dra818_tone_callback(completed != 0, dra818_tone_context);
+    }
+}
+
+// Called with the update interrupt masked or from the interrupt itself.
+static bool dra818_tone_silence() {
+    if(!dra818_tone_playing) {
+        return false;
+    }
+    dra818_tone_playing = false;
+    LL_TIM_DisableIT_UPDATE(TIM1);
+    LL_LPTIM_SetCompare(LPTIM2, dra818_tone_half);
+    return true;
+}
+
+static void dra818_tone_isr(void* context) {
+    UNUSED(context);
+    if(!LL_TIM_IsActiveFlag_UPDATE(TIM1)) {
+        return;
+    }
+    LL_TIM_ClearFlag_UPDATE(TIM1);
+
+    int16_t sample;
+    if(dra818_tone_source) {
+        if(!dra818_tone_source(&sample, dra818_tone_source_context)) {
+            if(dra818_tone_silence()) {
+                furi_timer_pending_callback(dra818_tone_finish, NULL, true);
+            }
+            return;
+        }
+        LL_LPTIM_SetCompare(
+            LPTIM2, dra818_tone_half + ((sample * (int32_t)dra818_tone_half) >> 15));
+        return;
+    }
+
+    // Skip to the next step with samples left, stopping after the last one.
+    while(!dra818_tone_forever && dra818_tone_remaining == 0) {
+        if(dra818_tone_index + 1 >= dra818_tone_count) {
+            if(dra818_tone_silence()) {
+                furi_timer_pending_callback(dra818_tone_finish, NULL, true);
+            }
+            return;
+        }
+        dra818_tone_load(dra818_tone_index + 1);
+    }
+    if(!dra818_tone_forever) {
+        dra818_tone_remaining--;
+    }
+    sample = dra818_tone_osc_next(&dra818_tone_osc);
+    LL_LPTIM_SetCompare(LPTIM2, dra818_tone_half + ((sample * (int32_t)dra818_tone_half) >> 15));
+}
+
+static bool dra818_tone_claim() {
+    if(dra818_tone_active || furi_hal_pwm_is_running(DRA818_TONE_OUTPUT) ||
+       furi_hal_bus_is_enabled(FuriHalBusTIM1)) {
+        return false;
+    }
+    dra818_tone_active = true;
+    return true;
+}
+
+static void dra818_tone_start(Dra818ToneDoneCallback callback, void* context) {
+    dra818_tone_callback = callback;
+    dra818_tone_context = context;
+
+    // The HAL sets up the pin and the carrier; TIM1 runs on its own, without a pin,
+    // and its update interrupt asks for one sample per DRA818_TONE_OVERSAMPLE periods.
+    furi_hal_pwm_start(DRA818_TONE_OUTPUT, DRA818_TONE_PWM_HZ, 50);
+    dra818_tone_half = (LL_LPTIM_GetAutoReload(LPTIM2) + 1) / 2;
+    furi_hal_bus_enable(FuriHalBusTIM1);
+    LL_TIM_SetPrescaler(TIM1, 0);
+    LL_TIM_SetAutoReload(TIM1, DRA818_TONE_TIMER_HZ / DRA818_TONE_SAMPLE_RATE - 1);
+    LL_TIM_SetCounter(TIM1, 0);
+    LL_TIM_ClearFlag_UPDATE(TIM1);
+    dra818_tone_playing = true;
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTim1UpTim16, dra818_tone_isr, NULL);
+    LL_TIM_EnableIT_UPDATE(TIM1);
+    LL_TIM_EnableCounter(TIM1);
+}
+
+bool dra818_tone_play(
+    const Dra818ToneStep* steps,
+    size_t count,
+    Dra818ToneDoneCallback callback,
+    void* context) {
+    if(count == 0 || count > DRA818_TONE_STEPS_MAX || !dra818_tone_claim()) {
+        return false;
+    }
+    memcpy(dra818_tone_steps, steps, count * sizeof(Dra818ToneStep));
+    dra818_tone_count = count;
+    dra818_tone_source = NULL;
+    dra818_tone_load(0);
+    dra818_tone_start(callback, context);
+    return true;
+}
+
+bool dra818_tone_play_source(
+    Dra818ToneSource source,
+    void* source_context,
+    Dra818ToneDoneCallback callback,
+    void* context) {
+    if(!dra818_tone_claim()) {
+        return false;
+    }
+    dra818_tone_source = source;
+    dra818_tone_source_context = source_context;
+    dra818_tone_start(callback, context);
+    return true;
+}
+
+bool dra818_tone_play_tone(
+    uint32_t freq,
+    uint16_t duration_ms,
+    Dra818ToneDoneCallback callback,
+    void* context) {
+    Dra818ToneStep step = {
+        .f1 = freq,
+        .f2 = 0,
+        .duration_ms = duration_ms,
+        .level = DRA818_TONE_LEVEL_AUDIO,
+    };
+    return dra818_tone_play(&step, 1, callback, context);
+}
+
+bool dra818_tone_play_ctcss(
+    Dra818Tone tone,
+    uint16_t duration_ms,
+    Dra818ToneDoneCallback callback,
+    void* context) {
+    if(tone == DRA818_TONE_NONE || DRA818_TONE_IS_DCS(tone) || tone > DRA818_CTCSS_COUNT) {
+        return false; // DCS is a bit stream, not a tone
+    }
+    Dra818ToneStep step = {
+        .f1 = dra818_ctcss_tones[tone - 1],
+        .f2 = 0,
+        .duration_ms = duration_ms,
+        .level = DRA818_TONE_LEVEL_CTCSS,
+    };
+    return dra818_tone_play(&step, 1, callback, context);
+}
+
+bool dra818_tone_play_dtmf(
+    const char* digits,
+    uint16_t tone_ms,
+    uint16_t gap_ms,
+    Dra818ToneDoneCallback callback,
+    void* context) {
+    Dra818ToneStep steps[DRA818_TONE_STEPS_MAX];
+    size_t count = 0;
+    for(; *digits && count + 2 <= DRA818_TONE_STEPS_MAX; digits++) {
+        const char* key = strchr(dra818_tone_dtmf_keys, *digits);
+        if(!key) {
+            continue;
+        }
+        size_t index = key - dra818_tone_dtmf_keys;
+        steps[count++] = (Dra818ToneStep){
+            .f1 = dra818_tone_dtmf_rows[index / 4],
+            .f2 = dra818_tone_dtmf_cols[index % 4],
+            .duration_ms = tone_ms,
+            .level = DRA818_TONE_LEVEL_AUDIO,
+        };
+        if(gap_ms) {
+            steps[count++] = (Dra818ToneStep){.duration_ms = gap_ms};
+        }
+    }
+    return dra818_tone_play(steps, count, callback, context);
+}
+
+bool dra818_tone_play_burst(uint16_t duration_ms, Dra818ToneDoneCallback callback, void* context) {
+    return dra818_tone_play_tone(DRA818_TONE_BURST_HZ10, duration_ms, callback, context);
+}
+
+void dra818_tone_stop() {
+    FURI_CRITICAL_ENTER();
+    bool stopped = dra818_tone_silence();
+    FURI_CRITICAL_EXIT();
+    if(stopped) {
+        dra818_tone_finish(NULL, false);
+    }
+}
+
+bool dra818_tone_busy() {
+    return dra818_tone_active;
+}
@@ -0,0 +1,89 @@
+/*
+ -- dra_tone.h
+ -- Non-blocking tone generator for the DRA818V/U audio input
+ --
+ -- A two-oscillator DDS (32-bit phase accumulators, 256-entry sine table)
+ -- computes one sample per TIM1 update interrupt, so playback never blocks the
+ -- caller.  The PWM carrier comes out of LPTIM2 on PA4 (GPIO header pin 4) and
+ -- needs an RC low-pass before the module's MIC input.  PA7 and PA6 carry the
+ -- SPI bus, so TIM1 only paces samples and drives no pin.  Sequences of steps
+ -- cover CTCSS, DTMF strings and 1750 Hz tone bursts.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_plan.h"
+
+#define DRA818_TONE_PWM_HZ      64000 // PWM carrier
+#define DRA818_TONE_OVERSAMPLE  8 // Carrier periods per sample
+#define DRA818_TONE_SAMPLE_RATE (DRA818_TONE_PWM_HZ / DRA818_TONE_OVERSAMPLE)
+#define DRA818_TONE_STEPS_MAX   64 // Steps in one sequence
+#define DRA818_TONE_FOREVER     0 // Step duration: play until dra818_tone_stop()
+
+#define DRA818_TONE_BURST_HZ10  17500 // Repeater access tone burst, 0.1 Hz
+#define DRA818_TONE_LEVEL_CTCSS 48 // Sub-audio tones go out well below voice level
+#define DRA818_TONE_LEVEL_AUDIO 200
+
+// One step of a sequence.  Frequencies are in 0.1 Hz; 0 leaves that oscillator silent, so
+// f1 = f2 = 0 is a gap.
+typedef struct {
+    uint32_t f1;
+    uint32_t f2;
+    uint16_t duration_ms; // DRA818_TONE_FOREVER for the last step only
+    uint8_t level; // Peak amplitude, 0..255
+} Dra818ToneStep;
+
+// DDS state, usable on its own (e.g. on a host) to produce samples.
+typedef struct {
+    uint32_t phase[2];
+    uint32_t step[2];
+    uint8_t level;
+    bool dual; // Both oscillators in use
+} Dra818ToneOsc;
+
+typedef void (*Dra818ToneDoneCallback)(bool completed, void* context);
+// Produces the next sample at DRA818_TONE_SAMPLE_RATE, or returns false to end playback.
+// Called from the timer interrupt.
+typedef bool (*Dra818ToneSource)(int16_t* sample, void* context);
+
+void dra818_tone_osc_set(Dra818ToneOsc* osc, const Dra818ToneStep* step, uint32_t sample_rate);
+// Next sample, -32767..32767 scaled by the step level.
+int16_t dra818_tone_osc_next(Dra818ToneOsc* osc);
+
+// Starts playing a copy of steps in the background.  Fails if a sequence is already
+// playing or the PWM output is taken.  callback runs on the timer thread when the
+// sequence ends (completed = true) or is stopped (completed = false).
+bool dra818_tone_play(
+    const Dra818ToneStep* steps,
+    size_t count,
+    Dra818ToneDoneCallback callback,
+    void* context);
+// Plays samples pulled from source, e.g. a modem, instead of a step sequence.
+bool dra818_tone_play_source(
+    Dra818ToneSource source,
+    void* source_context,
+    Dra818ToneDoneCallback callback,
+    void* context);
+bool dra818_tone_play_tone(
+    uint32_t freq,
+    uint16_t duration_ms,
+    Dra818ToneDoneCallback callback,
+    void* context);
+bool dra818_tone_play_ctcss(
+    Dra818Tone tone,
+    uint16_t duration_ms,
+    Dra818ToneDoneCallback callback,
+    void* context);
+// digits: 0-9, A-D, * and #; anything else is skipped.
+bool dra818_tone_play_dtmf(
+    const char* digits,
+    uint16_t tone_ms,
+    uint16_t gap_ms,
+    Dra818ToneDoneCallback callback,
+    void* context);
+bool dra818_tone_play_burst(uint16_t duration_ms, Dra818ToneDoneCallback callback, void* context);
+void dra818_tone_stop();
+bool dra818_tone_busy();
@@ -0,0 +1,347 @@
+/*
+ -- dra_tsq.c
+ -- CTCSS/DCS tone squelch detector for DRA818V/U receive audio
+*/
+
+#include <furi.h>
+#include <math.h>
+#include <string.h>
+#include "dra_adc.h"
+#include "dra_stats.h"
+#include "dra_tsq.h"
+
+#define DRA818_TSQ_LOWPASS_HZ  300 // Pre-decimation low-pass corner (two poles)
+#define DRA818_TSQ_DC_SHIFT    (1.0f / 256) // DC tracker, about 0.3 s at 800 Hz
+#define DRA818_TSQ_GOLAY_POLY  0xC75 // Golay (23,12) generator
+#define DRA818_TSQ_DCS_BITS    23
+#define DRA818_TSQ_DCS_REPEATS 2 // Matches of one codeword before it counts
+
+typedef struct {
+    float s1[DRA818_CTCSS_COUNT];
+    float s2[DRA818_CTCSS_COUNT];
+    float energy;
+    uint32_t count;
+    uint32_t length; // Samples in the current window
+} Dra818TsqBank;
+
+struct Dra818Tsq {
+    Dra818TsqConfig config;
+    Dra818TsqCallback callback;
+    void* context;
+    volatile Dra818Tone target;
+
+    uint32_t sample_rate;
+    uint32_t decimation;
+    float rate; // Decimated rate
+    uint32_t window;
+    uint32_t ticks; // Decimated samples since alloc
+
+    float lp_alpha;
+    float lp[2];
+    float acc;
+    uint32_t acc_count;
+    float dc;
+
+    float coeff[DRA818_CTCSS_COUNT];
+    Dra818TsqBank bank[2];
+
+    uint32_t dcs_words[DRA818_DCS_COUNT];
+    uint32_t dcs_shift; // Last 23 bits, newest in bit 22
+    uint32_t dcs_bits; // Bits sliced since alloc
+    int32_t dcs_pll;
+    int32_t dcs_pll_step;
+    bool dcs_level;
+    Dra818Tone dcs_hit;
+    uint32_t dcs_hit_at;
+    uint32_t dcs_hit_bit;
+    uint8_t dcs_hit_count;
+
+    Dra818Tone current;
+    Dra818Tone candidate;
+    uint32_t candidate_at;
+    uint8_t hits;
+    uint8_t misses;
+    Dra818TsqStats stats;
+};
+
+static bool dra818_tsq_rx_running = false;
+
+// Codewords go out LSB first: the 9 code bits, 100, then 11 Golay parity bits.
+static uint32_t dra818_tsq_dcs_word(uint16_t code) {
+    uint32_t data = (code & 0x1FF) | 0x800;
+    uint32_t rem = data << 11;
+    for(int bit = 22; bit >= 11; bit--) {
+        if(rem & (1UL << bit)) {
+            rem ^= (uint32_t)DRA818_TSQ_GOLAY_POLY << (bit - 11);
+        }
+    }
+    return data | (rem << 12);
+}
+
+static bool dra818_tsq_same(Dra818Tone a, Dra818Tone b) {
+    return (a & ~DRA818_TONE_DCS_INVERTED) == (b & ~DRA818_TONE_DCS_INVERTED);
+}
+
+void dra818_tsq_config_defaults(Dra818TsqConfig* config) {
+    config->threshold = 0.2f;
+    config->dcs_errors = 1;
+    config->detect_count = 2;
+    config->lose_count = 3;
+}
+
+static void dra818_tsq_bank_reset(Dra818TsqBank* bank, uint32_t length) {
+    memset(bank->s1, 0, sizeof(bank->s1));
+    memset(bank->s2, 0, sizeof(bank->s2));
+    bank->energy = 0;
+    bank->count = 0;
+    bank->length = length;
+}
+
+Dra818Tsq* dra818_tsq_alloc(
+    uint32_t sample_rate,
+    const Dra818TsqConfig* config,
+    Dra818TsqCallback callback,
+    void* context) {
+    if(sample_rate < 2 * DRA818_TSQ_DECIMATED_HZ || sample_rate > DRA818_ADC_RATE_MAX) {
+        return NULL;
+    }
+    Dra818Tsq* tsq = malloc(sizeof(Dra818Tsq));
+    memset(tsq, 0, sizeof(Dra818Tsq));
+    if(config) {
+        tsq->config = *config;
+    } else {
+        dra818_tsq_config_defaults(&tsq->config);
+    }
+    if(tsq->config.detect_count == 0) {
+        tsq->config.detect_count = 1;
+    }
+    if(tsq->config.lose_count == 0) {
+        tsq->config.lose_count = 1;
+    }
+    tsq->callback = callback;
+    tsq->context = context;
+
+    tsq->sample_rate = sample_rate;
+    tsq->decimation = (sample_rate + DRA818_TSQ_DECIMATED_HZ / 2) / DRA818_TSQ_DECIMATED_HZ;
+    tsq->rate = (float)sample_rate / tsq->decimation;
+    tsq->window = (uint32_t)(tsq->rate * DRA818_TSQ_WINDOW_MS / 1000);
+    tsq->lp_alpha = 1.0f - expf(-2.0f * (float)M_PI * DRA818_TSQ_LOWPASS_HZ / sample_rate);
+
+    for(size_t i = 0; i < DRA818_CTCSS_COUNT; i++) {
+        float f = dra818_ctcss_tones[i] / 10.0f;
+        tsq->coeff[i] = 2.0f * cosf(2.0f * (float)M_PI * f / tsq->rate);
+    }
+    // The second bank starts with a half window so the two stay half a window apart.
+    dra818_tsq_bank_reset(&tsq->bank[0], tsq->window);
+    dra818_tsq_bank_reset(&tsq->bank[1], tsq->window / 2);
+
+    for(size_t i = 0; i < DRA818_DCS_COUNT; i++) {
+        tsq->dcs_words[i] = dra818_tsq_dcs_word(dra818_dcs_codes[i]);
+    }
+    tsq->dcs_pll_step = (int32_t)(((uint64_t)DRA818_TSQ_DCS_BAUD10 << 32) * tsq->decimation /
+                                  (10ULL * sample_rate));
+    return tsq;
+}
+
+void dra818_tsq_free(Dra818Tsq* tsq) {
+    free(tsq);
+}
+
+void dra818_tsq_set_target(Dra818Tsq* tsq, Dra818Tone target) {
+    tsq->target = target;
+}
+
+static void dra818_tsq_dcs_bit(Dra818Tsq* tsq, bool bit) {
+    tsq->dcs_shift = (tsq->dcs_shift >> 1) | ((uint32_t)bit << (DRA818_TSQ_DCS_BITS - 1));
+    if(tsq->dcs_bits++ < DRA818_TSQ_DCS_BITS) {
+        return;
+    }
+    Dra818Tone target = tsq->target;
+    int errors = tsq->config.dcs_errors;
+    for(size_t i = 0; i < DRA818_DCS_COUNT; i++) {
+        int distance = __builtin_popcount(tsq->dcs_shift ^ tsq->dcs_words[i]);
+        Dra818Tone tone;
+        if(distance <= errors) {
+            tone = DRA818_TONE_DCS(dra818_dcs_codes[i]);
+        } else if(distance >= DRA818_TSQ_DCS_BITS - errors) {
+            tone = DRA818_TONE_DCS_I(dra818_dcs_codes[i]);
+        } else {
+            continue;
+        }
+        if(target != DRA818_TONE_NONE && !dra818_tsq_same(tone, target)) {
+            continue;
+        }
+        // Some codewords are rotations of others (023N is 047I).  Stay with the code
+        // already being received unless this one comes through the right way up, or
+        // that one was seen only once and may have been chance.
+        bool fresh = tsq->dcs_hit != DRA818_TONE_NONE &&
+                     tsq->ticks - tsq->dcs_hit_at <= tsq->window;
+        bool hit_inverted = tsq->dcs_hit & DRA818_TONE_DCS_INVERTED;
+        bool inverted = tone & DRA818_TONE_DCS_INVERTED;
+        // A repeat comes a whole number of codewords later, give or take a slipped bit.
+        uint32_t phase = (tsq->dcs_bits - tsq->dcs_hit_bit + 1) % DRA818_TSQ_DCS_BITS;
+        if(fresh && tone == tsq->dcs_hit) {
+            if(phase <= 2 && tsq->dcs_hit_count < DRA818_TSQ_DCS_REPEATS) {
+                tsq->dcs_hit_count++;
+            }
+        } else if(
+            !fresh || (hit_inverted && !inverted) ||
+            (tsq->dcs_hit_count < DRA818_TSQ_DCS_REPEATS && (hit_inverted || !inverted))) {
+            tsq->dcs_hit = tone;
+            tsq->dcs_hit_count = 1;
+        }
+        if(tone == tsq->dcs_hit) {
+            tsq->dcs_hit_at = tsq->ticks;
+            tsq->dcs_hit_bit = tsq->dcs_bits;
+        }
+        tsq->stats.dcs_words++;
+        break;
+    }
+}
+
+// Slices the sub-audio signal and samples a bit mid-way between transitions.
+static void dra818_tsq_dcs_sample(Dra818Tsq* tsq, float value) {
+    bool level = value > 0;
+    if(level != tsq->dcs_level) {
+        tsq->dcs_level = level;
+        tsq->dcs_pll = (tsq->dcs_pll >> 2) * 3;
+    }
+    int32_t last = tsq->dcs_pll;
+    tsq->dcs_pll = (int32_t)((uint32_t)tsq->dcs_pll + (uint32_t)tsq->dcs_pll_step);
+    if(last > 0 && tsq->dcs_pll <= 0) {
+        dra818_tsq_dcs_bit(tsq, level);
+    }
+}
+
+static Dra818Tone dra818_tsq_ctcss(Dra818Tsq* tsq, Dra818TsqBank* bank) {
+    size_t best = 0;
+    float best_power = -1;
+    for(size_t i = 0; i < DRA818_CTCSS_COUNT; i++) {
+        float s1 = bank->s1[i];
+        float s2 = bank->s2[i];
+        float power = s1 * s1 + s2 * s2 - tsq->coeff[i] * s1 * s2;
+        if(power > best_power) {
+            best_power = power;
+            best = i;
+        }
+    }
+    // A pure tone gives power = (A * n / 2)^2 against energy = n * A^2 / 2, so this is 1.
+    float share = bank->energy > 0 ? 2 * best_power / (bank->energy * bank->count) : 0;
+    return share >= tsq->config.threshold ? (Dra818Tone)(best + 1) : DRA818_TONE_NONE;
+}
+
+static void dra818_tsq_decide(Dra818Tsq* tsq, Dra818Tone tone) {
+    tsq->stats.decisions++;
+    Dra818Tone target = tsq->target;
+    // One match can be chance on noise (about 1 in 1700 bits); a transmitter repeats
+    // its codeword every 23 bits.
+    if(tone == DRA818_TONE_NONE && tsq->dcs_hit_count >= DRA818_TSQ_DCS_REPEATS &&
+       tsq->ticks - tsq->dcs_hit_at <= tsq->window) {
+        tone = tsq->dcs_hit;
+    }
+    if(target != DRA818_TONE_NONE && !dra818_tsq_same(tone, target)) {
+        tone = DRA818_TONE_NONE;
+    }
+
+    if(tsq->current != DRA818_TONE_NONE) {
+        if(tone == tsq->current) {
+            tsq->misses = 0;
+        } else if(++tsq->misses >= tsq->config.lose_count) {
+            Dra818Tone lost = tsq->current;
+            tsq->current = DRA818_TONE_NONE;
+            tsq->candidate = DRA818_TONE_NONE;
+            tsq->hits = 0;
+            tsq->stats.losses++;
+            if(tsq->callback) {
+                tsq->callback(lost, false, tsq->context);
+            }
+        }
+        return;
+    }
+
+    if(tone == DRA818_TONE_NONE) {
+        tsq->candidate = DRA818_TONE_NONE;
+        tsq->hits = 0;
+        return;
+    }
+    if(tone != tsq->candidate) {
+        tsq->candidate = tone;
+        tsq->candidate_at = tsq->ticks - tsq->window;
+        tsq->hits = 0;
+    }
+    if(++tsq->hits >= tsq->config.detect_count) {
+        tsq->current = tone;
+        tsq->misses = 0;
+        tsq->stats.detects++;
+        tsq->stats.detect_ms = (uint32_t)((tsq->ticks - tsq->candidate_at) * 1000 / tsq->rate);
+        if(tsq->callback) {
+            tsq->callback(tone, true, tsq->context);
+        }
+    }
+}
+
+static void dra818_tsq_step(Dra818Tsq* tsq, float value) {
+    tsq->ticks++;
+    tsq->dc += (value - tsq->dc) * DRA818_TSQ_DC_SHIFT;
+    value -= tsq->dc;
+    dra818_tsq_dcs_sample(tsq, value);
+
+    for(size_t b = 0; b < 2; b++) {
+        Dra818TsqBank* bank = &tsq->bank[b];
+        bank->energy += value * value;
+        for(size_t i = 0; i < DRA818_CTCSS_COUNT; i++) {
+            float s0 = value + tsq->coeff[i] * bank->s1[i] - bank->s2[i];
+            bank->s2[i] = bank->s1[i];
+            bank->s1[i] = s0;
+        }
+        if(++bank->count >= bank->length) {
+            dra818_tsq_decide(tsq, dra818_tsq_ctcss(tsq, bank));
+            dra818_tsq_bank_reset(bank, tsq->window);
+        }
+    }
+}
+
+void dra818_tsq_process(Dra818Tsq* tsq, const int16_t* samples, size_t count) {
+    float alpha = tsq->lp_alpha;
+    tsq->stats.samples += count;
+    for(size_t i = 0; i < count; i++) {
+        tsq->lp[0] += alpha * (samples[i] - tsq->lp[0]);
+        tsq->lp[1] += alpha * (tsq->lp[0] - tsq->lp[1]);
+        tsq->acc += tsq->lp[1];
+        if(++tsq->acc_count < tsq->decimation) {
+            continue;
+        }
+        dra818_tsq_step(tsq, tsq->acc / tsq->decimation);
+        tsq->acc = 0;
+        tsq->acc_count = 0;
+    }
+}
+
+Dra818Tone dra818_tsq_current(Dra818Tsq* tsq) {
+    return tsq->current;
+}
+
+void dra818_tsq_get_stats(Dra818Tsq* tsq, Dra818TsqStats* stats) {
+    *stats = tsq->stats;
+}
+
+static void dra818_tsq_rx_block(const int16_t* samples, size_t count, void* context) {
+    DRA818_STATS_BEGIN(start);
+    dra818_tsq_process(context, samples, count);
+    DRA818_STATS_END(start, Dra818StatTsq, true);
+}
+
+bool dra818_tsq_rx_start(Dra818Tsq* tsq) {
+    if(dra818_adc_running()) {
+        return false;
+    }
+    dra818_tsq_rx_running = dra818_adc_start(tsq->sample_rate, dra818_tsq_rx_block, tsq);
+    return dra818_tsq_rx_running;
+}
+
+void dra818_tsq_rx_stop() {
+    if(dra818_tsq_rx_running) {
+        dra818_adc_stop();
+        dra818_tsq_rx_running = false;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ -- dra_tsq.h
+ -- CTCSS/DCS tone squelch detector for DRA818V/U receive audio
+ --
+ -- Received audio is low-passed and decimated to about 800 Hz, where a bank of
+ -- Goertzel filters tracks all 38 CTCSS tones and a bit slicer with a DPLL
+ -- feeds a 23-bit window that is compared against every DCS codeword.  Two
+ -- Goertzel banks run half a window apart, so a decision is made every quarter
+ -- second on the last half second of audio.  Detect and lose events need a
+ -- configurable number of agreeing decisions in a row.
+ --
+ -- Samples can come from dra_adc or be fed directly, e.g. on a host.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_plan.h"
+
+#define DRA818_TSQ_DECIMATED_HZ 800 // Rate the detectors run at
+#define DRA818_TSQ_WINDOW_MS    500 // Goertzel window; gives 2 Hz bins for 2.5 Hz tone spacing
+#define DRA818_TSQ_DCS_BAUD10   1344 // DCS bit rate, 0.1 bit/s
+
+typedef struct {
+    float threshold; // Share of sub-audio energy a CTCSS tone needs, 0..1
+    uint8_t dcs_errors; // Bit errors accepted in a DCS codeword
+    uint8_t detect_count; // Agreeing decisions before a tone is reported
+    uint8_t lose_count; // Missing decisions before it is reported lost
+} Dra818TsqConfig;
+
+typedef struct {
+    uint32_t samples; // Input samples
+    uint32_t decisions; // Window evaluations
+    uint32_t dcs_words; // DCS codeword matches
+    uint32_t detects;
+    uint32_t losses;
+    uint32_t detect_ms; // Last detect: start of the first agreeing window to the event
+} Dra818TsqStats;
+
+// Called on the thread feeding samples when a tone is detected (present = true) or
+// lost.  DCS tones are reported with DRA818_TONE_DCS_INVERTED if the bits came
+// through inverted.
+typedef void (*Dra818TsqCallback)(Dra818Tone tone, bool present, void* context);
+
+typedef struct Dra818Tsq Dra818Tsq;
+
+void dra818_tsq_config_defaults(Dra818TsqConfig* config);
+
+// sample_rate: rate of the audio passed to dra818_tsq_process(), 1600..48000 Hz.
+Dra818Tsq* dra818_tsq_alloc(
+    uint32_t sample_rate,
+    const Dra818TsqConfig* config,
+    Dra818TsqCallback callback,
+    void* context);
+void dra818_tsq_free(Dra818Tsq* tsq);
+
+// Only report this tone (DRA818_TONE_NONE reports any).  DCS inversion is ignored
+// when matching.  Takes effect at the next decision.
+void dra818_tsq_set_target(Dra818Tsq* tsq, Dra818Tone target);
+// samples: audio centred on 0, at most 12 bits.
+void dra818_tsq_process(Dra818Tsq* tsq, const int16_t* samples, size_t count);
+// Tone currently reported present, or DRA818_TONE_NONE.
+Dra818Tone dra818_tsq_current(Dra818Tsq* tsq);
+void dra818_tsq_get_stats(Dra818Tsq* tsq, Dra818TsqStats* stats);
+
+// Feeds tsq from dra_adc at its sample rate; the callback runs on the ADC worker.
+bool dra818_tsq_rx_start(Dra818Tsq* tsq);
+void dra818_tsq_rx_stop();
@@ -0,0 +1,137 @@
+/*
+ -- dra_waterfall.c
+ -- Band activity history for DRA818V/U scans
+*/
+
+#include <furi.h>
+#include <string.h>
+#include "dra_waterfall.h"
+
+#define DRA818_WATERFALL_STRIDE (DRA818_WATERFALL_WIDTH / 8) // Bitmap bytes per row
+
+struct Dra818Waterfall {
+    size_t channels;
+    size_t rows;
+    size_t stride; // Level bytes per row
+    size_t head; // Newest committed row
+    uint32_t committed; // Rows committed since clear
+    size_t last_channel; // Last channel put into pending
+    bool collecting; // pending holds at least one level
+    uint8_t* levels; // rows x stride, two channels per byte (even channel in the low nibble)
+    uint8_t* pending; // Row being collected
+    uint8_t* bitmap; // rows x DRA818_WATERFALL_STRIDE, XBM bit order
+};
+
+// 4x4 ordered dither: a level lights the pixels whose threshold is below it.
+static const uint8_t dra818_waterfall_bayer[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+Dra818Waterfall* dra818_waterfall_alloc(size_t channels, size_t rows) {
+    furi_check(channels > 0 && channels <= DRA818_WATERFALL_WIDTH);
+    furi_check(DRA818_WATERFALL_WIDTH % channels == 0 && rows > 0);
+    Dra818Waterfall* waterfall = malloc(sizeof(Dra818Waterfall));
+    waterfall->channels = channels;
+    waterfall->rows = rows;
+    waterfall->stride = (channels + 1) / 2;
+    waterfall->levels = malloc(rows * waterfall->stride);
+    waterfall->pending = malloc(waterfall->stride);
+    waterfall->bitmap = malloc(rows * DRA818_WATERFALL_STRIDE);
+    dra818_waterfall_clear(waterfall);
+    return waterfall;
+}
+
+void dra818_waterfall_free(Dra818Waterfall* waterfall) {
+    free(waterfall->levels);
+    free(waterfall->pending);
+    free(waterfall->bitmap);
+    free(waterfall);
+}
+
+void dra818_waterfall_clear(Dra818Waterfall* waterfall) {
+    memset(waterfall->levels, 0, waterfall->rows * waterfall->stride);
+    memset(waterfall->pending, 0, waterfall->stride);
+    memset(waterfall->bitmap, 0, waterfall->rows * DRA818_WATERFALL_STRIDE);
+    waterfall->head = 0;
+    waterfall->committed = 0;
+    waterfall->collecting = false;
+}
+
+static uint8_t dra818_waterfall_nibble(const uint8_t* row, size_t channel) {
+    return (channel & 1) ? row[channel / 2] >> 4 : row[channel / 2] & 0x0F;
+}
+
+// Render the head row into the bitmap.  The dither phase follows the row count, so the
+// pattern scrolls along with the image.
+static void dra818_waterfall_render(Dra818Waterfall* waterfall) {
+    const uint8_t* row = waterfall->levels + waterfall->head * waterfall->stride;
+    uint8_t* out = waterfall->bitmap + waterfall->head * DRA818_WATERFALL_STRIDE;
+    const uint8_t* bayer = dra818_waterfall_bayer[waterfall->committed & 3];
+    size_t width = DRA818_WATERFALL_WIDTH / waterfall->channels;
+    memset(out, 0, DRA818_WATERFALL_STRIDE);
+    for(size_t x = 0; x < DRA818_WATERFALL_WIDTH; x++) {
+        if(dra818_waterfall_nibble(row, x / width) > bayer[x & 3]) {
+            out[x / 8] |= 1 << (x & 7);
+        }
+    }
+}
+
+static void dra818_waterfall_commit(Dra818Waterfall* waterfall) {
+    waterfall->head = (waterfall->head + waterfall->rows - 1) % waterfall->rows;
+    memcpy(
+        waterfall->levels + waterfall->head * waterfall->stride,
+        waterfall->pending,
+        waterfall->stride);
+    memset(waterfall->pending, 0, waterfall->stride);
+    waterfall->committed++;
+    waterfall->collecting = false;
+    dra818_waterfall_render(waterfall);
+}
+
+bool dra818_waterfall_put(Dra818Waterfall* waterfall, size_t channel, uint8_t level) {
+    if(channel >= waterfall->channels) {
+        return false;
+    }
+    bool committed = false;
+    if(waterfall->collecting && channel <= waterfall->last_channel) {
+        dra818_waterfall_commit(waterfall);
+        committed = true;
+    }
+    uint8_t* byte = &waterfall->pending[channel / 2];
+    level = MIN(level, (uint8_t)(DRA818_WATERFALL_LEVELS - 1));
+    *byte = (channel & 1) ? (*byte & 0x0F) | (level << 4) : (*byte & 0xF0) | level;
+    waterfall->last_channel = channel;
+    waterfall->collecting = true;
+    return committed;
+}
+
+uint8_t dra818_waterfall_level(uint8_t rssi, uint8_t floor, uint8_t ceiling) {
+    if(rssi <= floor) {
+        return 0;
+    }
+    if(rssi >= ceiling) {
+        return DRA818_WATERFALL_LEVELS - 1;
+    }
+    uint32_t span = ceiling - floor;
+    return ((rssi - floor) * (DRA818_WATERFALL_LEVELS - 1) + span / 2) / span;
+}
+
+size_t dra818_waterfall_rows(Dra818Waterfall* waterfall) {
+    return waterfall->rows;
+}
+
+uint8_t dra818_waterfall_get(Dra818Waterfall* waterfall, size_t age, size_t channel) {
+    if(age >= waterfall->rows || age >= waterfall->committed || channel >= waterfall->channels) {
+        return 0;
+    }
+    size_t row = (waterfall->head + age) % waterfall->rows;
+    return dra818_waterfall_nibble(waterfall->levels + row * waterfall->stride, channel);
+}
+
+const uint8_t* dra818_waterfall_bitmap(Dra818Waterfall* waterfall, size_t* head) {
+    *head = waterfall->head;
+    return waterfall->bitmap;
+}
@@ -0,0 +1,50 @@
+/*
+ -- dra_waterfall.h
+ -- Band activity history for DRA818V/U scans
+ --
+ -- Each sweep of the scanner becomes one row of 4-bit levels, one per channel,
+ -- kept in a fixed ring of rows (two channels per byte, rows contiguous).  The
+ -- same ring is kept pre-rendered as a 1-bit XBM image, dithered to show the 16
+ -- levels.  A new row is dithered once, when it is committed; older rows keep
+ -- their pixels.  The Flipper canvas is cleared before every frame, so each draw
+ -- still blits the whole ring, 16 bytes a row, in two pieces: the newest row sits
+ -- at the ring head, so the image scrolls without moving any memory.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DRA818_WATERFALL_WIDTH  128 // Pixels across; channels share it equally
+#define DRA818_WATERFALL_LEVELS 16
+
+typedef struct Dra818Waterfall Dra818Waterfall;
+
+// channels: 1..DRA818_WATERFALL_WIDTH and a divisor of it.
+Dra818Waterfall* dra818_waterfall_alloc(size_t channels, size_t rows);
+void dra818_waterfall_free(Dra818Waterfall* waterfall);
+void dra818_waterfall_clear(Dra818Waterfall* waterfall);
+
+/**
+ * @brief      Record a channel's level (0..DRA818_WATERFALL_LEVELS - 1) in the row being
+ *           collected.  A channel at or below the last one recorded starts a new sweep, so
+ *           the collected row is committed first; channels a sweep skipped read as 0.
+ * @return     true if a row was committed.
+*/
+bool dra818_waterfall_put(Dra818Waterfall* waterfall, size_t channel, uint8_t level);
+
+// Map a module RSSI reading onto the 16 levels between `floor` and `ceiling`.
+uint8_t dra818_waterfall_level(uint8_t rssi, uint8_t floor, uint8_t ceiling);
+
+size_t dra818_waterfall_rows(Dra818Waterfall* waterfall);
+// Level of `channel` in the row `age` sweeps back (0 is the newest committed row).
+uint8_t dra818_waterfall_get(Dra818Waterfall* waterfall, size_t age, size_t channel);
+
+/**
+ * @brief      The rendered history: an XBM image DRA818_WATERFALL_WIDTH wide and `rows`
+ *           high, stored as a ring.  Row `head` is the newest; draw rows head..rows-1 first,
+ *           then 0..head-1 below them.
+*/
+const uint8_t* dra818_waterfall_bitmap(Dra818Waterfall* waterfall, size_t* head);
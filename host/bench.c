@@ -0,0 +1,462 @@
+/*
+ -- bench.c
+ -- Cost of the driver's operations on the simulated bus and module
+ --
+ -- Every row is per operation: SPI frames and bytes, time on the SPI wire,
+ -- bytes on the UART, simulated elapsed time, and host CPU time spent by all
+ -- simulated threads (driver, simulator and model together, so compare rows
+ -- rather than reading CPU time as Flipper cycles).  --quick runs fewer
+ -- repetitions, for ctest.  A check that fails is printed and makes the exit
+ -- code nonzero.
+*/
+
+#include <stdio.h>
+#include <furi.h>
+#include <furi_hal_serial.h>
+#include "dra.h"
+#include "dra_at.h"
+#include "dra_scan.h"
+#include "sim.h"
+#include "sim_dra818.h"
+
+#define BENCH_SLOT      0
+#define BENCH_SLOT_B    1 // Second module, on the Lpuart, for the dual-band scan
+#define BENCH_REGS      5 // The registers dra818_init_configure() writes
+#define BENCH_READ_REGS DRA818_REG_COUNT
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t start_cpu_ns;
+    SimSerialStats serial[2]; // Usart and Lpuart
+} BenchMark;
+
+typedef struct {
+    double frames;
+    double bytes;
+    double bus_us;
+    double uart_bytes;
+    double elapsed_us;
+    double cpu_us;
+} BenchResult;
+
+static int failures;
+
+static void bench_check(bool ok, const char* what) {
+    if(!ok) {
+        printf("FAIL %s\n", what);
+        failures++;
+    }
+}
+
+static void bench_start(BenchMark* mark) {
+    sim_spi_reset_stats();
+    sim_serial_get_stats(FuriHalSerialIdUsart, &mark->serial[0]);
+    sim_serial_get_stats(FuriHalSerialIdLpuart, &mark->serial[1]);
+    mark->start_ns = sim_now_ns();
+    mark->start_cpu_ns = sim_cpu_ns();
+}
+
+static BenchResult bench_report(const BenchMark* mark, const char* name, uint32_t count) {
+    SimSpiStats spi;
+    SimSerialStats usart;
+    SimSerialStats lpuart;
+    sim_spi_get_stats(&spi);
+    sim_serial_get_stats(FuriHalSerialIdUsart, &usart);
+    sim_serial_get_stats(FuriHalSerialIdLpuart, &lpuart);
+    double n = count;
+    BenchResult result = {
+        .frames = spi.transactions / n,
+        .bytes = spi.bytes / n,
+        .bus_us = spi.bus_ns / 1e3 / n,
+        .uart_bytes = (usart.tx_bytes - mark->serial[0].tx_bytes + lpuart.tx_bytes -
+                       mark->serial[1].tx_bytes) /
+                      n,
+        .elapsed_us = (sim_now_ns() - mark->start_ns) / 1e3 / n,
+        .cpu_us = (sim_cpu_ns() - mark->start_cpu_ns) / 1e3 / n,
+    };
+    printf(
+        "%-34s %7.1f %7.1f %9.2f %7.1f %11.1f %8.2f\n",
+        name,
+        result.frames,
+        result.bytes,
+        result.bus_us,
+        result.uart_bytes,
+        result.elapsed_us,
+        result.cpu_us);
+    return result;
+}
+
+static void bench_header(const char* section) {
+    printf(
+        "\n%-34s %7s %7s %9s %7s %11s %8s\n",
+        section,
+        "frames",
+        "bytes",
+        "bus us",
+        "uart B",
+        "elapsed us",
+        "cpu us");
+}
+
+// Init
+
+typedef struct {
+    FuriSemaphore* done;
+    bool ready;
+} BenchWait;
+
+static void bench_ready_callback(bool ready, void* context) {
+    BenchWait* wait = context;
+    wait->ready = ready;
+    furi_semaphore_release(wait->done);
+}
+
+static void bench_init(Dra818* dra, Dra818At* at, uint32_t reps) {
+    bench_header("init");
+    BenchMark mark;
+    BenchWait wait = {.done = furi_semaphore_alloc(1, 0)};
+    Dra818InitConfig config = {
+        .reset_ms = DRA818_RESET_MS,
+        .boot_ms = DRA818_BOOT_MS,
+        .probe = NULL,
+        .probe_interval_ms = DRA818_PROBE_INTERVAL_MS,
+        .probe_timeout_ms = DRA818_PROBE_TIMEOUT_MS,
+    };
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        bench_check(dra818_init_async(dra, &config, bench_ready_callback, &wait), "async start");
+        furi_semaphore_acquire(wait.done, FuriWaitForever);
+        bench_check(wait.ready && dra818_init_configure(dra), "async fixed boot ready");
+    }
+    BenchResult fixed = bench_report(&mark, "async, fixed boot delay", reps);
+
+    config.probe = at;
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        bench_check(dra818_init_async(dra, &config, bench_ready_callback, &wait), "probe start");
+        furi_semaphore_acquire(wait.done, FuriWaitForever);
+        bench_check(wait.ready && dra818_init_configure(dra), "async probe ready");
+    }
+    BenchResult probe = bench_report(&mark, "async, DMOCONNECT probe", reps);
+    furi_semaphore_free(wait.done);
+
+    bench_check(fixed.frames == 1, "init configures in one burst");
+    bench_check(probe.elapsed_us < fixed.elapsed_us, "probe beats the fixed boot delay");
+    for(uint8_t reg = 0; reg < BENCH_REGS; reg++) {
+        bench_check(sim_dra818_reg(BENCH_SLOT, reg) == dra818_read(dra, reg), "module defaults");
+    }
+}
+
+// Retune: the five configuration registers change together.
+
+static void bench_at_callback(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(response);
+    bench_check(result == Dra818AtResultOk, "AT command");
+    furi_semaphore_release(context);
+}
+
+static void bench_values(uint8_t* values, uint32_t i) {
+    for(uint8_t reg = 0; reg < BENCH_REGS; reg++) {
+        values[reg] = (uint8_t)(0x10 * reg + (i & 0x0F));
+    }
+}
+
+static void bench_retune(Dra818* dra, Dra818At* at, uint32_t reps) {
+    bench_header("retune");
+    uint8_t values[BENCH_REGS];
+    BenchMark mark;
+
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        bench_values(values, i);
+        for(uint8_t reg = 0; reg < BENCH_REGS; reg++) {
+            dra818_write(dra, reg, values[reg]);
+        }
+    }
+    BenchResult singles = bench_report(&mark, "5 single writes", reps);
+
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        bench_values(values, i + 1);
+        for(uint8_t reg = 0; reg < BENCH_REGS; reg++) {
+            dra818_set(dra, reg, values[reg]);
+        }
+        dra818_commit(dra);
+    }
+    BenchResult burst = bench_report(&mark, "5 x set + commit (one burst)", reps);
+    bench_values(values, reps);
+    for(uint8_t reg = 0; reg < BENCH_REGS; reg++) {
+        bench_check(sim_dra818_reg(BENCH_SLOT, reg) == values[reg], "burst reached the module");
+    }
+
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        dra818_set(dra, 2, 0x5A ^ (i & 1));
+        dra818_commit(dra);
+    }
+    bench_report(&mark, "1 x set + commit", reps);
+
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        for(uint8_t reg = 0; reg < BENCH_REGS; reg++) {
+            dra818_set(dra, reg, dra818_read(dra, reg));
+        }
+        dra818_commit(dra);
+    }
+    BenchResult unchanged = bench_report(&mark, "set + commit, nothing changed", reps);
+
+    bench_check(singles.frames == BENCH_REGS, "single writes take a frame each");
+    bench_check(burst.frames == 1, "commit sends one frame");
+    bench_check(unchanged.frames == 0, "unchanged commit stays off the bus");
+
+    // The channel itself is set over the UART.
+    FuriSemaphore* done = furi_semaphore_alloc(1, 0);
+    Dra818AtGroup group = {
+        .tx_freq = DRA818_FREQ_MHZ(146, 5200),
+        .rx_freq = DRA818_FREQ_MHZ(146, 5200),
+        .squelch = 1,
+    };
+    uint32_t at_reps = MAX(reps / 100, 2U);
+    bench_start(&mark);
+    for(uint32_t i = 0; i < at_reps; i++) {
+        group.rx_freq = DRA818_FREQ_MHZ(146, 5200) + (i & 1) * DRA818_STEP_NARROW;
+        dra818_at_stage_group(at, &group);
+        dra818_at_commit(at, bench_at_callback, done);
+        furi_semaphore_acquire(done, FuriWaitForever);
+    }
+    bench_report(&mark, "AT+DMOSETGROUP", at_reps);
+    bench_start(&mark);
+    for(uint32_t i = 0; i < at_reps; i++) {
+        dra818_at_stage_group(at, &group);
+        dra818_at_commit(at, bench_at_callback, done);
+        furi_semaphore_acquire(done, FuriWaitForever);
+    }
+    BenchResult at_unchanged = bench_report(&mark, "AT commit, nothing changed", at_reps);
+    furi_semaphore_free(done);
+    bench_check(sim_dra818_rx_freq(BENCH_SLOT) == group.rx_freq, "channel reached the module");
+    bench_check(at_unchanged.uart_bytes == 0, "unchanged AT commit stays off the UART");
+}
+
+// Read
+
+static void bench_dma_callback(bool success, void* context) {
+    BenchWait* wait = context;
+    wait->ready = success;
+    furi_semaphore_release(wait->done);
+}
+
+static void bench_read(Dra818* dra, Dra818Bus* bus, uint32_t reps) {
+    bench_header("read 16 registers");
+    uint8_t values[BENCH_READ_REGS];
+    uint8_t sum = 0;
+    BenchMark mark;
+
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        dra818_invalidate(dra);
+        for(uint8_t reg = 0; reg < BENCH_READ_REGS; reg++) {
+            sum += dra818_read(dra, reg);
+        }
+    }
+    BenchResult singles = bench_report(&mark, "16 single reads, cache cold", reps);
+
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        dra818_read_burst(dra, 0x00, values, BENCH_READ_REGS);
+    }
+    BenchResult burst = bench_report(&mark, "one burst read", reps);
+
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        for(uint8_t reg = 0; reg < BENCH_READ_REGS; reg++) {
+            sum += dra818_read(dra, reg);
+        }
+    }
+    BenchResult cached = bench_report(&mark, "16 single reads, cache warm", reps);
+
+    BenchWait wait = {.done = furi_semaphore_alloc(1, 0)};
+    bench_start(&mark);
+    for(uint32_t i = 0; i < reps; i++) {
+        bench_check(
+            dra818_read_burst_dma(
+                dra, 0x00, values, BENCH_READ_REGS, bench_dma_callback, &wait),
+            "DMA start");
+        furi_semaphore_acquire(wait.done, FuriWaitForever);
+        bench_check(wait.ready, "DMA read");
+    }
+    bench_report(&mark, "one burst read, DMA", reps);
+    furi_semaphore_free(wait.done);
+
+    bench_check(singles.frames == BENCH_READ_REGS, "cold reads take a frame each");
+    bench_check(burst.frames == 1, "burst read is one frame");
+    bench_check(cached.frames == 0, "warm reads stay off the bus");
+    for(uint8_t reg = 0; reg < BENCH_READ_REGS; reg++) {
+        bench_check(values[reg] == sim_dra818_reg(BENCH_SLOT, reg), "burst read values");
+    }
+    UNUSED(sum);
+
+    bench_header("burst read by bus speed");
+    uint8_t speed = dra818_bus_get_speed(bus);
+    for(uint8_t step = 0; step < DRA818_PORT_SPEEDS; step++) {
+        char name[40];
+        snprintf(name, sizeof(name), "speed %u (%lu kHz)", step, dra818_port_bus_hz(step) / 1000);
+        bench_check(dra818_bus_set_speed(bus, step), "set speed");
+        bench_start(&mark);
+        for(uint32_t i = 0; i < reps; i++) {
+            dra818_read_burst(dra, 0x00, values, BENCH_READ_REGS);
+        }
+        bench_report(&mark, name, reps);
+    }
+    dra818_bus_set_speed(bus, speed);
+}
+
+// Scan
+
+typedef struct {
+    uint32_t samples;
+    uint32_t active;
+} BenchScan;
+
+static void bench_scan_callback(const Dra818ScanSample* sample, void* context) {
+    BenchScan* scan = context;
+    scan->samples++;
+    scan->active += sample->active;
+}
+
+static double bench_scan(Dra818* dra, Dra818At* at, uint32_t channels) {
+    bench_header("scan, 20 ms dwell, per channel");
+    Dra818ScanConfig config = {
+        .start = DRA818_FREQ_MHZ(146, 0),
+        .stop = DRA818_FREQ_MHZ(146, 2375),
+        .step = DRA818_STEP_NARROW,
+        .group = {.squelch = 1},
+        .dwell_ms = 20,
+        .priority = DRA818_SCAN_NO_PRIORITY,
+    };
+    sim_dra818_set_signal(BENCH_SLOT, DRA818_FREQ_MHZ(146, 1000), 90, DRA818_TONE_NONE);
+
+    // The module's DMOSETGROUP time decides the rate once the dwell is hidden.
+    static const struct {
+        bool rssi;
+        uint32_t group_ms;
+    } cases[] = {{false, 5}, {false, 25}, {false, 50}, {true, 25}};
+    SimDra818Config sim;
+    sim_dra818_get_config(BENCH_SLOT, &sim);
+    uint32_t group_ms = sim.group_ms;
+    double squelch_rate = 0;
+    for(size_t i = 0; i < COUNT_OF(cases); i++) {
+        config.sample_rssi = cases[i].rssi;
+        sim.group_ms = cases[i].group_ms;
+        sim_dra818_set_config(BENCH_SLOT, &sim);
+        Dra818Scan* scan = dra818_scan_alloc(dra, at);
+        BenchScan counts = {0};
+        BenchMark mark;
+        bench_start(&mark);
+        bench_check(dra818_scan_start(scan, &config, bench_scan_callback, &counts), "scan start");
+        while(counts.samples < channels) {
+            furi_delay_ms(10);
+        }
+        dra818_scan_stop(scan);
+        Dra818ScanStats stats;
+        dra818_scan_get_stats(scan, &stats);
+        dra818_scan_free(scan);
+
+        char name[40];
+        snprintf(
+            name,
+            sizeof(name),
+            "%s, group %lu ms",
+            cases[i].rssi ? "with RSSI?" : "squelch only",
+            cases[i].group_ms);
+        BenchResult result = bench_report(&mark, name, counts.samples);
+        printf("%-34s %.1f channels/s, %lu hits\n", "", 1e6 / result.elapsed_us, stats.hits);
+        bench_check(counts.active > 0, "active channel found");
+        bench_check(stats.errors == 0 && stats.retries == 0, "every retune went through");
+        if(!cases[i].rssi && cases[i].group_ms == group_ms) {
+            squelch_rate = 1e6 / result.elapsed_us;
+        }
+    }
+    sim.group_ms = group_ms;
+    sim_dra818_set_config(BENCH_SLOT, &sim);
+    sim_dra818_clear_signals(BENCH_SLOT);
+    return squelch_rate;
+}
+
+// Two modules on one bus, each scanning half the range on its own UART.  The retunes
+// overlap; only the squelch and register traffic share the bus.
+static void bench_scan_dual(
+    Dra818Bus* bus,
+    Dra818* dra,
+    Dra818At* at,
+    uint32_t channels,
+    double single) {
+    Dra818* dra_b = dra818_alloc(bus, BENCH_SLOT_B);
+    Dra818At* at_b = dra818_at_alloc(FuriHalSerialIdLpuart, DRA818_AT_BAUD);
+    Dra818ScanConfig config = {
+        .start = DRA818_FREQ_MHZ(146, 0),
+        .stop = DRA818_FREQ_MHZ(146, 1125),
+        .step = DRA818_STEP_NARROW,
+        .group = {.squelch = 1},
+        .dwell_ms = 20,
+        .priority = DRA818_SCAN_NO_PRIORITY,
+    };
+    Dra818ScanConfig config_b = config;
+    config_b.start = DRA818_FREQ_MHZ(146, 1250);
+    config_b.stop = DRA818_FREQ_MHZ(146, 2375);
+    sim_dra818_set_signal(BENCH_SLOT, DRA818_FREQ_MHZ(146, 1000), 90, DRA818_TONE_NONE);
+    sim_dra818_set_signal(BENCH_SLOT_B, DRA818_FREQ_MHZ(146, 2000), 90, DRA818_TONE_NONE);
+
+    Dra818Scan* scan = dra818_scan_alloc(dra, at);
+    Dra818Scan* scan_b = dra818_scan_alloc(dra_b, at_b);
+    BenchScan counts = {0};
+    BenchScan counts_b = {0};
+    BenchMark mark;
+    bench_start(&mark);
+    bench_check(dra818_scan_start(scan, &config, bench_scan_callback, &counts), "scan start");
+    bench_check(
+        dra818_scan_start(scan_b, &config_b, bench_scan_callback, &counts_b), "scan start");
+    while(counts.samples + counts_b.samples < channels) {
+        furi_delay_ms(10);
+    }
+    dra818_scan_stop(scan);
+    dra818_scan_stop(scan_b);
+    dra818_scan_free(scan);
+    dra818_scan_free(scan_b);
+
+    BenchResult result = bench_report(
+        &mark, "dual slot, squelch, group 25 ms", counts.samples + counts_b.samples);
+    double rate = 1e6 / result.elapsed_us;
+    printf("%-34s %.1f channels/s, %.2fx one slot\n", "", rate, rate / single);
+    bench_check(counts.active > 0 && counts_b.active > 0, "active channel found on each slot");
+    bench_check(rate > 1.8 * single, "dual slot scan overlaps");
+
+    sim_dra818_clear_signals(BENCH_SLOT);
+    sim_dra818_clear_signals(BENCH_SLOT_B);
+    dra818_at_free(at_b);
+    dra818_free(dra_b);
+}
+
+int main(int argc, char** argv) {
+    bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+    uint32_t reps = quick ? 20 : 1000;
+
+    Dra818Bus* bus = dra818_bus_alloc();
+    Dra818* dra = dra818_alloc(bus, BENCH_SLOT);
+    Dra818At* at = dra818_at_alloc(FuriHalSerialIdUsart, DRA818_AT_BAUD);
+    printf(
+        "SPI bus %lu kHz, module answers up to %lu kHz\n",
+        dra818_port_bus_hz(dra818_bus_get_speed(bus)) / 1000,
+        (unsigned long)16000);
+
+    bench_init(dra, at, quick ? 2 : 10);
+    bench_retune(dra, at, reps);
+    bench_read(dra, bus, reps);
+    double single = bench_scan(dra, at, quick ? 40 : 400);
+    bench_scan_dual(bus, dra, at, quick ? 80 : 800, single);
+
+    dra818_at_free(at);
+    dra818_free(dra);
+    dra818_bus_free(bus);
+    printf("\n%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
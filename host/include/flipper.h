@@ -0,0 +1,9 @@
+/*
+ -- flipper.h
+ -- Host stand-in for the firmware's umbrella header
+*/
+
+#pragma once
+
+#include <furi.h>
+#include <furi_hal.h>
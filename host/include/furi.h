@@ -0,0 +1,241 @@
+/*
+ -- furi.h
+ -- Host stand-in for the Furi core API, backed by the simulator in sim_furi.c
+ --
+ -- Only what the app and driver use is declared.  Values and semantics follow
+ -- the firmware; time is simulated (see sim.h), so nothing here really sleeps.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT_OF(x) (sizeof(x) / sizeof(x[0]))
+#define UNUSED(x)   (void)(x)
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+#define CLAMP(x, upper, lower) (MIN(upper, MAX(x, lower)))
+
+// Heap: the firmware's malloc zeroes memory and the code relies on it.  Routing the app's
+// allocations through the simulator also backs memmgr_get_free_heap().
+void* sim_malloc(size_t size);
+void sim_free(void* ptr);
+char* sim_strdup(const char* str);
+#define malloc(size) sim_malloc(size)
+#define free(ptr)    sim_free(ptr)
+#define strdup(str)  sim_strdup(str)
+
+size_t memmgr_get_free_heap(void);
+size_t memmgr_get_minimum_free_heap(void);
+size_t strlcpy(char* dst, const char* src, size_t size);
+
+// Checks
+__attribute__((noreturn)) void furi_crash_at(const char* file, int line, const char* message);
+#define furi_crash(message) furi_crash_at(__FILE__, __LINE__, message)
+#define furi_check(x)                              \
+    do {                                           \
+        if(!(x)) {                                 \
+            furi_crash_at(__FILE__, __LINE__, #x); \
+        }                                          \
+    } while(0)
+#define furi_assert(x) furi_check(x)
+
+// Log
+typedef enum {
+    FuriLogLevelDefault = 0,
+    FuriLogLevelNone = 1,
+    FuriLogLevelError = 2,
+    FuriLogLevelWarn = 3,
+    FuriLogLevelInfo = 4,
+    FuriLogLevelDebug = 5,
+    FuriLogLevelTrace = 6,
+} FuriLogLevel;
+
+void furi_log_print_format(FuriLogLevel level, const char* tag, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#define FURI_LOG_ERROR       FuriLogLevelError
+#define FURI_LOG(level, ...) furi_log_print_format(level, "", __VA_ARGS__)
+#define FURI_LOG_E(tag, ...) furi_log_print_format(FuriLogLevelError, tag, __VA_ARGS__)
+#define FURI_LOG_W(tag, ...) furi_log_print_format(FuriLogLevelWarn, tag, __VA_ARGS__)
+#define FURI_LOG_I(tag, ...) furi_log_print_format(FuriLogLevelInfo, tag, __VA_ARGS__)
+#define FURI_LOG_D(tag, ...) furi_log_print_format(FuriLogLevelDebug, tag, __VA_ARGS__)
+#define FURI_LOG_T(tag, ...) furi_log_print_format(FuriLogLevelTrace, tag, __VA_ARGS__)
+
+// Kernel
+#define FuriWaitForever 0xFFFFFFFFU
+
+typedef enum {
+    FuriStatusOk = 0,
+    FuriStatusError = -1,
+    FuriStatusErrorTimeout = -2,
+    FuriStatusErrorResource = -3,
+    FuriStatusErrorParameter = -4,
+    FuriStatusErrorNoMemory = -5,
+    FuriStatusErrorISR = -6,
+} FuriStatus;
+
+typedef enum {
+    FuriFlagWaitAny = 0x00000000U,
+    FuriFlagWaitAll = 0x00000001U,
+    FuriFlagNoClear = 0x00000002U,
+    FuriFlagError = 0x80000000U,
+    FuriFlagErrorUnknown = 0xFFFFFFFFU,
+    FuriFlagErrorTimeout = 0xFFFFFFFEU,
+    FuriFlagErrorResource = 0xFFFFFFFDU,
+    FuriFlagErrorParameter = 0xFFFFFFFCU,
+    FuriFlagErrorISR = 0xFFFFFFFAU,
+} FuriFlag;
+
+// True in an interrupt handler and with interrupts masked (FURI_CRITICAL_ENTER).
+bool furi_kernel_is_irq_or_masked(void);
+#define FURI_IS_IRQ_MODE() furi_kernel_is_irq_or_masked()
+
+typedef struct {
+    uint32_t depth;
+} __FuriCriticalInfo;
+
+__FuriCriticalInfo __furi_critical_enter(void);
+void __furi_critical_exit(__FuriCriticalInfo info);
+
+#define FURI_CRITICAL_ENTER() __FuriCriticalInfo __furi_critical_info = __furi_critical_enter()
+#define FURI_CRITICAL_EXIT()  __furi_critical_exit(__furi_critical_info)
+
+uint32_t furi_get_tick(void);
+uint32_t furi_ms_to_ticks(uint32_t milliseconds);
+uint32_t furi_kernel_get_tick_frequency(void);
+void furi_delay_tick(uint32_t ticks);
+void furi_delay_ms(uint32_t milliseconds);
+void furi_delay_us(uint32_t microseconds);
+
+// Threads
+typedef struct FuriThread FuriThread;
+typedef void* FuriThreadId;
+typedef int32_t (*FuriThreadCallback)(void* context);
+
+typedef enum {
+    FuriThreadPriorityNone = 0,
+    FuriThreadPriorityIdle = 1,
+    FuriThreadPriorityLowest = 14,
+    FuriThreadPriorityLow = 15,
+    FuriThreadPriorityNormal = 16,
+    FuriThreadPriorityHigh = 17,
+    FuriThreadPriorityHighest = 18,
+    FuriThreadPriorityIsr = 32,
+} FuriThreadPriority;
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context);
+void furi_thread_free(FuriThread* thread);
+void furi_thread_set_priority(FuriThread* thread, FuriThreadPriority priority);
+void furi_thread_start(FuriThread* thread);
+bool furi_thread_join(FuriThread* thread);
+int32_t furi_thread_get_return_code(FuriThread* thread);
+FuriThreadId furi_thread_get_id(FuriThread* thread);
+FuriThreadId furi_thread_get_current_id(void);
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags);
+uint32_t furi_thread_flags_clear(uint32_t flags);
+uint32_t furi_thread_flags_get(void);
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+// Mutex
+typedef enum {
+    FuriMutexTypeNormal,
+    FuriMutexTypeRecursive,
+} FuriMutexType;
+
+typedef struct FuriMutex FuriMutex;
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type);
+void furi_mutex_free(FuriMutex* mutex);
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout);
+FuriStatus furi_mutex_release(FuriMutex* mutex);
+
+// Semaphore
+typedef struct FuriSemaphore FuriSemaphore;
+
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count);
+void furi_semaphore_free(FuriSemaphore* semaphore);
+FuriStatus furi_semaphore_acquire(FuriSemaphore* semaphore, uint32_t timeout);
+FuriStatus furi_semaphore_release(FuriSemaphore* semaphore);
+uint32_t furi_semaphore_get_count(FuriSemaphore* semaphore);
+
+// Message queue
+typedef struct FuriMessageQueue FuriMessageQueue;
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size);
+void furi_message_queue_free(FuriMessageQueue* queue);
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* msg, uint32_t timeout);
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* msg, uint32_t timeout);
+uint32_t furi_message_queue_get_count(FuriMessageQueue* queue);
+
+// Stream buffer
+typedef struct FuriStreamBuffer FuriStreamBuffer;
+
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level);
+void furi_stream_buffer_free(FuriStreamBuffer* stream_buffer);
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* stream_buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* stream_buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout);
+size_t furi_stream_buffer_bytes_available(FuriStreamBuffer* stream_buffer);
+FuriStatus furi_stream_buffer_reset(FuriStreamBuffer* stream_buffer);
+
+// Timer
+typedef void (*FuriTimerCallback)(void* context);
+typedef void (*FuriTimerPendigCallback)(void* context, uint32_t arg);
+
+typedef enum {
+    FuriTimerTypeOnce = 0,
+    FuriTimerTypePeriodic = 1,
+} FuriTimerType;
+
+typedef struct FuriTimer FuriTimer;
+
+FuriTimer* furi_timer_alloc(FuriTimerCallback callback, FuriTimerType type, void* context);
+void furi_timer_free(FuriTimer* timer);
+FuriStatus furi_timer_start(FuriTimer* timer, uint32_t ticks);
+FuriStatus furi_timer_restart(FuriTimer* timer, uint32_t ticks);
+FuriStatus furi_timer_stop(FuriTimer* timer);
+uint32_t furi_timer_is_running(FuriTimer* timer);
+// Runs `callback` on the timer service thread; safe from an interrupt.
+void furi_timer_pending_callback(FuriTimerPendigCallback callback, void* context, uint32_t arg);
+
+// String
+typedef struct FuriString FuriString;
+
+FuriString* furi_string_alloc(void);
+FuriString* furi_string_alloc_set_str(const char* str);
+void furi_string_free(FuriString* string);
+void furi_string_reset(FuriString* string);
+void furi_string_set(FuriString* string, const char* str);
+void furi_string_set_str(FuriString* string, const char* str);
+int furi_string_printf(FuriString* string, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+int furi_string_cat_printf(FuriString* string, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+void furi_string_cat_str(FuriString* string, const char* str);
+const char* furi_string_get_cstr(const FuriString* string);
+size_t furi_string_size(const FuriString* string);
+
+// Records
+void* furi_record_open(const char* name);
+void furi_record_close(const char* name);
@@ -0,0 +1,33 @@
+/*
+ -- furi_hal.h
+ -- Host stand-in for the Furi HAL umbrella header, backed by sim_hal.c
+*/
+
+#pragma once
+
+#include <furi.h>
+#include <furi_hal_adc.h>
+#include <furi_hal_bus.h>
+#include <furi_hal_gpio.h>
+#include <furi_hal_interrupt.h>
+#include <furi_hal_pwm.h>
+#include <furi_hal_resources.h>
+#include <furi_hal_serial.h>
+#include <furi_hal_serial_control.h>
+#include <furi_hal_usb.h>
+#include <furi_hal_usb_cdc.h>
+
+typedef struct {
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+    uint8_t weekday; // 1 = Monday
+} DateTime;
+
+// Derived from the simulated clock, which starts at 2026-01-01 00:00:00.
+void furi_hal_rtc_get_datetime(DateTime* datetime);
+
+uint32_t furi_hal_random_get(void);
@@ -0,0 +1,48 @@
+/*
+ -- furi_hal_adc.h
+ -- Host stand-in for the Furi ADC HAL; samples come from sim_adc_set_source()
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct FuriHalAdcHandle FuriHalAdcHandle;
+
+typedef enum {
+    FuriHalAdcScale2048,
+    FuriHalAdcScale2500,
+} FuriHalAdcScale;
+
+typedef enum {
+    FuriHalAdcClockSync16,
+    FuriHalAdcClockSync32,
+    FuriHalAdcClockSync64,
+} FuriHalAdcClock;
+
+typedef enum {
+    FuriHalAdcOversampleNone,
+    FuriHalAdcOversample2,
+} FuriHalAdcOversample;
+
+typedef enum {
+    FuriHalAdcSamplingtime2_5,
+    FuriHalAdcSamplingtime6_5,
+    FuriHalAdcSamplingtime12_5,
+} FuriHalAdcSamplingTime;
+
+typedef enum {
+    FuriHalAdcChannel1 = 1,
+    FuriHalAdcChannel4 = 4,
+    FuriHalAdcChannel9 = 9,
+} FuriHalAdcChannel;
+
+FuriHalAdcHandle* furi_hal_adc_acquire(void);
+void furi_hal_adc_release(FuriHalAdcHandle* handle);
+void furi_hal_adc_configure_ex(
+    FuriHalAdcHandle* handle,
+    FuriHalAdcScale scale,
+    FuriHalAdcClock clock,
+    FuriHalAdcOversample oversample,
+    FuriHalAdcSamplingTime sampling_time);
+uint16_t furi_hal_adc_read(FuriHalAdcHandle* handle, FuriHalAdcChannel channel);
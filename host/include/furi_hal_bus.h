@@ -0,0 +1,18 @@
+/*
+ -- furi_hal_bus.h
+ -- Host stand-in for the Furi peripheral bus HAL
+*/
+
+#pragma once
+
+#include <stdbool.h>
+
+typedef enum {
+    FuriHalBusTIM1,
+    FuriHalBusTIM2,
+    FuriHalBusCount,
+} FuriHalBus;
+
+void furi_hal_bus_enable(FuriHalBus bus);
+void furi_hal_bus_disable(FuriHalBus bus);
+bool furi_hal_bus_is_enabled(FuriHalBus bus);
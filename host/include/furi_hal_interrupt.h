@@ -0,0 +1,16 @@
+/*
+ -- furi_hal_interrupt.h
+ -- Host stand-in for the Furi interrupt HAL; handlers run on the simulator's ISR thread
+*/
+
+#pragma once
+
+typedef void (*FuriHalInterruptISR)(void* context);
+
+typedef enum {
+    FuriHalInterruptIdTim1UpTim16,
+    FuriHalInterruptIdTIM2,
+    FuriHalInterruptIdMax,
+} FuriHalInterruptId;
+
+void furi_hal_interrupt_set_isr(FuriHalInterruptId index, FuriHalInterruptISR isr, void* context);
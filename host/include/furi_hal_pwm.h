@@ -0,0 +1,18 @@
+/*
+ -- furi_hal_pwm.h
+ -- Host stand-in for the Furi PWM HAL
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum {
+    FuriHalPwmOutputIdTim1PA7,
+    FuriHalPwmOutputIdLptim2PA4,
+} FuriHalPwmOutputId;
+
+void furi_hal_pwm_start(FuriHalPwmOutputId channel, uint32_t freq, uint8_t duty);
+void furi_hal_pwm_stop(FuriHalPwmOutputId channel);
+bool furi_hal_pwm_is_running(FuriHalPwmOutputId channel);
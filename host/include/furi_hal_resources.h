@@ -0,0 +1,10 @@
+/*
+ -- furi_hal_resources.h
+ -- Host stand-in for the Flipper pin definitions
+*/
+
+#pragma once
+
+#include <furi_hal_gpio.h>
+
+extern const GpioPin gpio_ext_pc3;
@@ -0,0 +1,12 @@
+/*
+ -- furi_hal_serial_control.h
+ -- Host stand-in for the Furi UART ownership API
+*/
+
+#pragma once
+
+#include <furi_hal_serial.h>
+
+// NULL if the UART is already taken.
+FuriHalSerialHandle* furi_hal_serial_control_acquire(FuriHalSerialId serial_id);
+void furi_hal_serial_control_release(FuriHalSerialHandle* handle);
@@ -0,0 +1,20 @@
+/*
+ -- furi_hal_usb.h
+ -- Host stand-in for the Furi USB device configuration API
+*/
+
+#pragma once
+
+#include <stdbool.h>
+
+typedef struct FuriHalUsbInterface FuriHalUsbInterface;
+
+extern FuriHalUsbInterface usb_cdc_single;
+extern FuriHalUsbInterface usb_cdc_dual;
+
+FuriHalUsbInterface* furi_hal_usb_get_config(void);
+// Fails while the configuration is locked.
+bool furi_hal_usb_set_config(FuriHalUsbInterface* new_if, void* ctx);
+void furi_hal_usb_lock(void);
+void furi_hal_usb_unlock(void);
+bool furi_hal_usb_is_locked(void);
@@ -0,0 +1,22 @@
+/*
+ -- furi_hal_usb_cdc.h
+ -- Host stand-in for the Furi USB CDC API; the host side is sim_usb_host_send/receive()
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define CDC_DATA_SZ 64
+
+typedef struct {
+    void (*tx_ep_callback)(void* context);
+    void (*rx_ep_callback)(void* context);
+    void (*state_callback)(void* context, uint8_t state);
+    void (*ctrl_line_callback)(void* context, uint8_t state);
+    void (*config_callback)(void* context, void* config);
+} CdcCallbacks;
+
+void furi_hal_cdc_set_callbacks(uint8_t if_num, CdcCallbacks* cb, void* context);
+void furi_hal_cdc_send(uint8_t if_num, uint8_t* buf, uint16_t len);
+int32_t furi_hal_cdc_receive(uint8_t if_num, uint8_t* buf, uint16_t max_len);
@@ -0,0 +1,35 @@
+/*
+ -- gpio.h
+ -- Host stand-in for the board GPIO helpers used by dra_port.c
+ --
+ -- The DRA818 lines of both slots are wired as in dra_port.c; the simulator
+ -- connects them to the module model.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#define GPIO_PIN_0 0
+#define GPIO_PIN_1 1
+#define GPIO_PIN_2 2
+#define GPIO_PIN_3 3
+#define GPIO_PIN_4 4
+#define GPIO_PIN_5 5
+#define GPIO_PIN_6 6
+#define GPIO_PIN_7 7
+#define GPIO_PIN_8 8
+#define GPIO_PIN_9 9
+
+#define GPIO_MODE_INPUT             0
+#define GPIO_MODE_OUTPUT            1
+#define GPIO_MODE_IT_FALLING        2
+#define GPIO_MODE_IT_RISING         3
+#define GPIO_MODE_IT_RISING_FALLING 4
+
+void gpio_init(uint16_t pin, uint32_t mode);
+void gpio_set(uint16_t pin, uint8_t level);
+uint8_t gpio_read(uint16_t pin);
+
+// Defined by the board code; called from the EXTI interrupt.
+void HAL_GPIO_EXTI_Callback(uint16_t pin);
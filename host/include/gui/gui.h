@@ -0,0 +1,57 @@
+/*
+ -- gui/gui.h
+ -- Host stand-in for the Flipper GUI record and canvas
+ --
+ -- Drawing is recorded as text (see sim_gui_screen_text()), not pixels.
+*/
+
+#pragma once
+
+#include <furi.h>
+
+#define RECORD_GUI "gui"
+
+typedef struct Gui Gui;
+typedef struct Canvas Canvas;
+
+typedef enum {
+    FontPrimary,
+    FontSecondary,
+    FontKeyboard,
+    FontBigNumbers,
+} Font;
+
+typedef enum {
+    ColorWhite,
+    ColorBlack,
+    ColorXOR,
+} Color;
+
+typedef enum {
+    AlignLeft,
+    AlignRight,
+    AlignTop,
+    AlignBottom,
+    AlignCenter,
+} Align;
+
+void canvas_set_font(Canvas* canvas, Font font);
+void canvas_set_color(Canvas* canvas, Color color);
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str);
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str);
+void canvas_draw_xbm(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height,
+    const uint8_t* bitmap);
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height);
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y);
@@ -0,0 +1,23 @@
+/*
+ -- gui/modules/text_box.h
+ -- Host stand-in for the Flipper TextBox module
+*/
+
+#pragma once
+
+#include <gui/view.h>
+
+typedef struct TextBox TextBox;
+
+typedef enum {
+    TextBoxFontText,
+    TextBoxFontHex,
+} TextBoxFont;
+
+TextBox* text_box_alloc(void);
+void text_box_free(TextBox* text_box);
+View* text_box_get_view(TextBox* text_box);
+void text_box_reset(TextBox* text_box);
+// The text is not copied; it must outlive the text box or the next call.
+void text_box_set_text(TextBox* text_box, const char* text);
+void text_box_set_font(TextBox* text_box, TextBoxFont font);
@@ -0,0 +1,71 @@
+/*
+ -- gui/view.h
+ -- Host stand-in for the Flipper View API
+*/
+
+#pragma once
+
+#include <gui/gui.h>
+
+#define VIEW_NONE 0xFFFFFFFF
+
+typedef enum {
+    InputKeyUp,
+    InputKeyDown,
+    InputKeyRight,
+    InputKeyLeft,
+    InputKeyOk,
+    InputKeyBack,
+    InputKeyMAX,
+} InputKey;
+
+typedef enum {
+    InputTypePress,
+    InputTypeRelease,
+    InputTypeShort,
+    InputTypeLong,
+    InputTypeRepeat,
+    InputTypeMAX,
+} InputType;
+
+typedef struct {
+    uint32_t sequence;
+    InputKey key;
+    InputType type;
+} InputEvent;
+
+typedef enum {
+    ViewModelTypeNone,
+    ViewModelTypeLockFree,
+    ViewModelTypeLocking,
+} ViewModelType;
+
+typedef struct View View;
+
+typedef void (*ViewDrawCallback)(Canvas* canvas, void* model);
+typedef bool (*ViewInputCallback)(InputEvent* event, void* context);
+typedef bool (*ViewCustomCallback)(uint32_t event, void* context);
+typedef uint32_t (*ViewNavigationCallback)(void* context);
+typedef void (*ViewCallback)(void* context);
+
+View* view_alloc(void);
+void view_free(View* view);
+void view_set_context(View* view, void* context);
+void view_set_draw_callback(View* view, ViewDrawCallback callback);
+void view_set_input_callback(View* view, ViewInputCallback callback);
+void view_set_custom_callback(View* view, ViewCustomCallback callback);
+void view_set_previous_callback(View* view, ViewNavigationCallback callback);
+void view_set_enter_callback(View* view, ViewCallback callback);
+void view_set_exit_callback(View* view, ViewCallback callback);
+void view_allocate_model(View* view, ViewModelType type, size_t size);
+void view_free_model(View* view);
+void* view_get_model(View* view);
+// Releases the model; with update set, the view is redrawn if it is showing.
+void view_commit_model(View* view, bool update);
+
+#define with_view_model(view, type, code, update) \
+    {                                              \
+        type = view_get_model(view);               \
+        {code};                                    \
+        view_commit_model(view, update);           \
+    }
@@ -0,0 +1,13 @@
+/*
+ -- notification/notification.h
+ -- Host stand-in for the Flipper notification service (messages are ignored)
+*/
+
+#pragma once
+
+#define RECORD_NOTIFICATION "notification"
+
+typedef struct NotificationApp NotificationApp;
+typedef struct NotificationSequence NotificationSequence;
+
+void notification_message(NotificationApp* app, const NotificationSequence* sequence);
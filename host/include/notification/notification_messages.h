@@ -0,0 +1,12 @@
+/*
+ -- notification/notification_messages.h
+ -- Host stand-in for the Flipper notification sequences
+*/
+
+#pragma once
+
+#include <notification/notification.h>
+
+extern const NotificationSequence sequence_display_backlight_on;
+extern const NotificationSequence sequence_display_backlight_enforce_on;
+extern const NotificationSequence sequence_display_backlight_enforce_auto;
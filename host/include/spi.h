@@ -0,0 +1,76 @@
+/*
+ -- spi.h
+ -- Host stand-in for the STM32 HAL SPI driver used by dra_port.c
+ --
+ -- Transfers are exchanged with the module model of every slot whose chip
+ -- select is low, and take their time on the wire in simulated time.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    HAL_OK = 0x00,
+    HAL_ERROR = 0x01,
+    HAL_BUSY = 0x02,
+    HAL_TIMEOUT = 0x03,
+} HAL_StatusTypeDef;
+
+typedef struct {
+    uint32_t Mode;
+    uint32_t Direction;
+    uint32_t DataSize;
+    uint32_t CLKPolarity;
+    uint32_t CLKPhase;
+    uint32_t NSS;
+    uint32_t BaudRatePrescaler;
+    uint32_t FirstBit;
+    uint32_t TIMode;
+    uint32_t CRCCalculation;
+    uint32_t CRCPolynomial;
+} SPI_InitTypeDef;
+
+typedef struct {
+    void* Instance;
+    SPI_InitTypeDef Init;
+} SPI_HandleTypeDef;
+
+#define SPI1 ((void*)0x40013000)
+
+#define SPI_MODE_MASTER            0x00000104U
+#define SPI_DIRECTION_2LINES       0x00000000U
+#define SPI_DATASIZE_8BIT          0x00000700U
+#define SPI_POLARITY_LOW           0x00000000U
+#define SPI_PHASE_1EDGE            0x00000000U
+#define SPI_NSS_SOFT               0x00000200U
+#define SPI_FIRSTBIT_MSB           0x00000000U
+#define SPI_TIMODE_DISABLE         0x00000000U
+#define SPI_CRCCALCULATION_DISABLE 0x00000000U
+
+// BR[2:0] in CR1 bits 5:3; the clock is the kernel clock divided by 2 << BR.
+#define SPI_BAUDRATEPRESCALER_2   0x00000000U
+#define SPI_BAUDRATEPRESCALER_4   0x00000008U
+#define SPI_BAUDRATEPRESCALER_8   0x00000010U
+#define SPI_BAUDRATEPRESCALER_16  0x00000018U
+#define SPI_BAUDRATEPRESCALER_32  0x00000020U
+#define SPI_BAUDRATEPRESCALER_64  0x00000028U
+#define SPI_BAUDRATEPRESCALER_128 0x00000030U
+#define SPI_BAUDRATEPRESCALER_256 0x00000038U
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef* hspi);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(
+    SPI_HandleTypeDef* hspi,
+    uint8_t* pTxData,
+    uint8_t* pRxData,
+    uint16_t Size,
+    uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(
+    SPI_HandleTypeDef* hspi,
+    uint8_t* pTxData,
+    uint8_t* pRxData,
+    uint16_t Size);
+
+// Defined by the board code; called from the DMA completion interrupt.
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi);
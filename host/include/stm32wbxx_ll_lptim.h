@@ -0,0 +1,15 @@
+/*
+ -- stm32wbxx_ll_lptim.h
+ -- Host stand-in for the LPTIM low-level driver; compare writes can be captured
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct LPTIM_TypeDef LPTIM_TypeDef;
+
+extern LPTIM_TypeDef* const LPTIM2;
+
+void LL_LPTIM_SetCompare(LPTIM_TypeDef* lptim, uint32_t value);
+uint32_t LL_LPTIM_GetAutoReload(LPTIM_TypeDef* lptim);
@@ -0,0 +1,27 @@
+/*
+ -- stm32wbxx_ll_tim.h
+ -- Host stand-in for the TIM low-level driver
+ --
+ -- A timer with its counter and update interrupt enabled raises the update
+ -- interrupt every (PSC + 1) * (ARR + 1) cycles of a 64 MHz clock, in
+ -- simulated time.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct TIM_TypeDef TIM_TypeDef;
+
+extern TIM_TypeDef* const TIM1;
+extern TIM_TypeDef* const TIM2;
+
+void LL_TIM_SetPrescaler(TIM_TypeDef* tim, uint32_t prescaler);
+void LL_TIM_SetAutoReload(TIM_TypeDef* tim, uint32_t auto_reload);
+void LL_TIM_SetCounter(TIM_TypeDef* tim, uint32_t counter);
+void LL_TIM_EnableCounter(TIM_TypeDef* tim);
+void LL_TIM_DisableCounter(TIM_TypeDef* tim);
+void LL_TIM_EnableIT_UPDATE(TIM_TypeDef* tim);
+void LL_TIM_DisableIT_UPDATE(TIM_TypeDef* tim);
+uint32_t LL_TIM_IsActiveFlag_UPDATE(TIM_TypeDef* tim);
+void LL_TIM_ClearFlag_UPDATE(TIM_TypeDef* tim);
@@ -0,0 +1,70 @@
+/*
+ -- storage/storage.h
+ -- Host stand-in for the Flipper storage API
+ --
+ -- "/ext" and "/int" paths map to a directory on the host (see
+ -- sim_storage_root()); files are plain stdio files.
+*/
+
+#pragma once
+
+#include <furi.h>
+
+#define RECORD_STORAGE "storage"
+
+#define APP_DATA_PATH(path) "/ext/apps_data/dra_flipper/" path
+
+typedef struct Storage Storage;
+typedef struct File File;
+
+typedef enum {
+    FSAM_READ = (1 << 0),
+    FSAM_WRITE = (1 << 1),
+    FSAM_READ_WRITE = FSAM_READ | FSAM_WRITE,
+} FS_AccessMode;
+
+typedef enum {
+    FSOM_OPEN_EXISTING = 1, // Open, fail if the file does not exist
+    FSOM_OPEN_ALWAYS = 2, // Open, create if it does not exist
+    FSOM_OPEN_APPEND = 4, // Open for appending, create if it does not exist
+    FSOM_CREATE_NEW = 8, // Create, fail if the file exists
+    FSOM_CREATE_ALWAYS = 16, // Create, truncating an existing file
+} FS_OpenMode;
+
+typedef enum {
+    FSE_OK,
+    FSE_NOT_READY,
+    FSE_EXIST,
+    FSE_NOT_EXIST,
+    FSE_INVALID_PARAMETER,
+    FSE_DENIED,
+    FSE_INVALID_NAME,
+    FSE_INTERNAL,
+    FSE_NOT_IMPLEMENTED,
+    FSE_ALREADY_OPEN,
+} FS_Error;
+
+File* storage_file_alloc(Storage* storage);
+// Closes the file if it is still open.
+void storage_file_free(File* file);
+bool storage_file_open(
+    File* file,
+    const char* path,
+    FS_AccessMode access_mode,
+    FS_OpenMode open_mode);
+bool storage_file_close(File* file);
+bool storage_file_is_open(File* file);
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read);
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write);
+bool storage_file_seek(File* file, uint32_t offset, bool from_start);
+uint64_t storage_file_tell(File* file);
+uint64_t storage_file_size(File* file);
+bool storage_file_sync(File* file);
+bool storage_file_eof(File* file);
+
+FS_Error storage_common_remove(Storage* storage, const char* path);
+FS_Error storage_common_rename(Storage* storage, const char* old_path, const char* new_path);
+bool storage_file_exists(Storage* storage, const char* path);
+// Creates the directory (and its parents); true if it exists afterwards.
+bool storage_simply_mkdir(Storage* storage, const char* path);
+bool storage_simply_remove(Storage* storage, const char* path);
@@ -0,0 +1,125 @@
+/*
+ -- sim.h
+ -- Control side of the host simulator: clock, bus accounting, fault injection,
+ -- the far ends of the UART, USB, ADC, GUI and storage seams, and WAV input
+ --
+ -- Time is simulated.  It stands still while any simulated thread can run and
+ -- jumps to the next deadline (a delay, a timeout, a timer or an interrupt)
+ -- once every thread is blocked, so a 2 s probe timeout costs no wall time.
+ -- There is one CPU: threads run one at a time and only give it up when they
+ -- block, so every run of a test sees the same interleaving.  Interrupt
+ -- handlers run ahead of any thread, one at a time, and never while a thread
+ -- is in FURI_CRITICAL_ENTER.  Work done on the CPU takes no simulated time;
+ -- blocking SPI and UART transfers take their time on the wire.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SIM_NS_PER_MS 1000000ULL
+
+// Clock
+uint64_t sim_now_ns(void);
+// Block the calling thread for `ns` of simulated time.  With interrupts masked (or in a
+// handler) this is a busy wait: the clock moves on but nothing else runs.
+void sim_sleep_ns(uint64_t ns);
+// Host CPU time spent by the simulated threads, including the simulator's own work.
+uint64_t sim_cpu_ns(void);
+
+// Wait for sim_signal(object) until `deadline_ns` (UINT64_MAX: forever); false on timeout.
+// One CPU means nothing can slip in between checking a condition and waiting for it.
+bool sim_wait(const void* object, uint64_t deadline_ns);
+void sim_signal(const void* object);
+
+// Schedule `handler(context, arg)` on the ISR thread at `at_ns` (not before now).
+typedef void (*SimIrqHandler)(void* context, uint32_t arg);
+void sim_irq_at(uint64_t at_ns, SimIrqHandler handler, void* context, uint32_t arg);
+
+// Heap in use through the firmware malloc, in bytes.
+size_t sim_heap_used(void);
+
+// SPI bus accounting.  bus_ns is time on the wire; transactions count HAL calls.
+typedef struct {
+    uint32_t transactions;
+    uint32_t dma_transactions;
+    uint32_t bytes;
+    uint64_t bus_ns;
+    uint32_t failures; // Injected with sim_spi_fail()
+    uint32_t hz; // Clock of the last transfer
+} SimSpiStats;
+
+void sim_spi_get_stats(SimSpiStats* stats);
+void sim_spi_reset_stats(void);
+// Fail the next `count` SPI transfers with HAL_ERROR.
+void sim_spi_fail(uint32_t count);
+// Fixed cost of one HAL call (chip select, setup), added to every transfer.
+#define SIM_SPI_SETUP_NS 1500
+
+// UART accounting per serial id (bytes each way, on the wire).
+typedef struct {
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint64_t tx_ns;
+} SimSerialStats;
+
+void sim_serial_get_stats(uint8_t serial_id, SimSerialStats* stats);
+// Queue bytes from the module to the Flipper, one receive interrupt per byte.
+void sim_serial_reply(uint8_t serial_id, const char* data, size_t size, uint64_t delay_ns);
+
+// GPIO: the levels the board code sees.  Inputs are driven by the module model.
+void sim_gpio_drive(uint16_t pin, bool level);
+bool sim_gpio_level(uint16_t pin);
+
+// Audio input: returns the 12-bit ADC reading at `now_ns` (default: mid-scale 2048).
+typedef uint16_t (*SimAdcSource)(uint64_t now_ns, void* context);
+void sim_adc_set_source(SimAdcSource source, void* context);
+
+// Tone output: LPTIM2 compare values, captured while `buffer` is set.
+void sim_pwm_capture(uint32_t* buffer, size_t size);
+size_t sim_pwm_captured(void);
+
+// USB: the host end of the CDC link.  Packets are 64 bytes, SIM_USB_PACKET_NS apart.
+#define SIM_USB_PACKET_NS 50000
+
+void sim_usb_host_send(const uint8_t* data, size_t size);
+// Waits up to `timeout_ms` of simulated time for at least one byte.
+size_t sim_usb_host_receive(uint8_t* data, size_t size, uint32_t timeout_ms);
+size_t sim_usb_host_pending(void);
+// Zero-length packets the device sent to end transfers.
+uint32_t sim_usb_zlp_count(void);
+// Make the next furi_hal_usb_set_config() calls fail.
+void sim_usb_fail_set_config(bool fail);
+
+// GUI: keys go to the running view dispatcher; drawn text is kept per frame.
+void sim_gui_press(uint8_t key); // InputKey: Press, Short, Release
+void sim_gui_long_press(uint8_t key); // InputKey: Press, Long, Release
+// Copies the text of the last frame, one canvas_draw_str per line.
+void sim_gui_screen_text(char* out, size_t size);
+uint32_t sim_gui_frames(void);
+// Polls the screen every 10 ms; true once `text` shows up.
+bool sim_gui_wait_text(const char* text, uint32_t timeout_ms);
+// Types `text` into the showing TextInput and presses OK; false if none is showing.
+bool sim_gui_text_input(const char* text);
+
+// Storage: directory that stands in for the SD card.  Its contents are removed.
+void sim_storage_root(const char* path);
+// Host path of a Flipper path such as "/ext/apps_data/dra_flipper/x".
+void sim_storage_path(const char* path, char* out, size_t size);
+// Each storage_file_read() takes `ms` of simulated time (default 0).
+void sim_storage_set_read_ms(uint32_t ms);
+// Each storage_file_write() takes `ms` of simulated time (default 0), like a slow card.
+void sim_storage_set_write_ms(uint32_t ms);
+
+// WAV: mono or first channel of 8/16-bit PCM, as signed 16-bit samples.
+typedef struct {
+    uint32_t sample_rate;
+    size_t count;
+    int16_t* samples;
+} SimWav;
+
+// False if the file is missing or not PCM; `wav` is then empty.
+bool sim_wav_read(const char* path, SimWav* wav);
+void sim_wav_free(SimWav* wav);
@@ -0,0 +1,460 @@
+/*
+ -- sim_dra818.c
+ -- Behavioural model of the DRA818 modules wired to the board's slots
+*/
+
+#include <stdio.h>
+#include <furi.h>
+#include "dra.h"
+#include "sim.h"
+#include "sim_dra818.h"
+
+#define SIM_DRA818_FIFO     256
+#define SIM_DRA818_LINE_MAX 64
+#define SIM_DRA818_SIGNALS  16
+
+typedef enum {
+    SimFrameAddress, // Next byte is an address
+    SimFrameWrite, // Single write: next byte is the value
+    SimFrameRead, // Single read: next byte clocks the value out
+    SimFrameBurstWrite,
+    SimFrameBurstRead,
+} SimFrameState;
+
+typedef struct {
+    Dra818Freq freq;
+    uint8_t rssi;
+    Dra818Tone tone;
+} SimSignal;
+
+typedef struct {
+    SimDra818Config config;
+    SimDra818Stats stats;
+
+    bool in_reset; // RST held low
+    bool asleep; // PD held low
+    bool booted; // Out of reset and done booting
+    uint64_t awake_at; // After PD is released the module answers again from here
+    uint32_t boot_generation; // Stale boot completions are dropped
+
+    uint8_t regs[SIM_DRA818_REGS];
+    SimFrameState frame;
+    uint8_t frame_reg;
+
+    uint8_t fifo[SIM_DRA818_FIFO];
+    size_t fifo_head;
+    size_t fifo_count;
+
+    char line[SIM_DRA818_LINE_MAX];
+    size_t line_length;
+    bool line_overflow;
+
+    bool tuned; // An AT+DMOSETGROUP was accepted since the last reset
+    Dra818Freq rx_freq;
+    uint8_t squelch;
+    Dra818Tone rx_tone;
+    uint8_t volume;
+    uint32_t squelch_generation;
+
+    SimSignal signals[SIM_DRA818_SIGNALS];
+} SimDra818;
+
+static const SimDra818Config sim_dra818_defaults = {
+    .boot_ms = 60,
+    .wake_ms = 5,
+    .group_ms = 25,
+    .command_ms = 5,
+    .spi_max_hz = 16000000,
+    .mute = false,
+};
+
+static SimDra818 sim_dra818[DRA818_PORT_SLOTS];
+static bool sim_dra818_initialised;
+
+// Modules power up booted, awake and configured to the defaults.
+static SimDra818* sim_dra818_get(uint8_t slot) {
+    furi_check(slot < DRA818_PORT_SLOTS);
+    if(!sim_dra818_initialised) {
+        sim_dra818_initialised = true;
+        for(size_t i = 0; i < DRA818_PORT_SLOTS; i++) {
+            sim_dra818[i].config = sim_dra818_defaults;
+            sim_dra818[i].booted = true;
+            sim_dra818[i].volume = 4;
+        }
+    }
+    return &sim_dra818[slot];
+}
+
+static bool sim_dra818_alive(SimDra818* module) {
+    return module->booted && !module->asleep && sim_now_ns() >= module->awake_at;
+}
+
+static const SimSignal* sim_dra818_signal(SimDra818* module, Dra818Freq freq) {
+    for(size_t i = 0; i < SIM_DRA818_SIGNALS; i++) {
+        if(module->signals[i].rssi && module->signals[i].freq == freq) {
+            return &module->signals[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8_t sim_dra818_rssi(SimDra818* module) {
+    const SimSignal* signal = sim_dra818_signal(module, module->rx_freq);
+    return signal ? signal->rssi : SIM_DRA818_NOISE_RSSI;
+}
+
+// Squelch level n opens at an RSSI of 30 + 10n; level 0 is always open.
+static bool sim_dra818_squelch_open(SimDra818* module) {
+    if(!sim_dra818_alive(module) || !module->tuned) {
+        return false;
+    }
+    if(module->squelch == 0) {
+        return true;
+    }
+    const SimSignal* signal = sim_dra818_signal(module, module->rx_freq);
+    if(!signal || signal->rssi < 30 + 10 * module->squelch) {
+        return false;
+    }
+    return module->rx_tone == DRA818_TONE_NONE || module->rx_tone == signal->tone;
+}
+
+static void sim_dra818_squelch_event(void* context, uint32_t generation) {
+    SimDra818* module = context;
+    if(generation == module->squelch_generation) {
+        uint8_t slot = module - sim_dra818;
+        sim_board_drive(slot, Dra818PinSq, !sim_dra818_squelch_open(module)); // Low = open
+    }
+}
+
+// Decide the squelch again after `delay_ms`; a later call supersedes this one.
+static void sim_dra818_squelch_update(SimDra818* module, uint32_t delay_ms) {
+    module->squelch_generation++;
+    sim_irq_at(
+        sim_now_ns() + delay_ms * SIM_NS_PER_MS,
+        sim_dra818_squelch_event,
+        module,
+        module->squelch_generation);
+}
+
+static void sim_dra818_int_update(SimDra818* module) {
+    uint8_t slot = module - sim_dra818;
+    sim_board_drive(slot, Dra818PinInt, module->fifo_count == 0); // Low = data waiting
+}
+
+static void sim_dra818_power_on_reset(SimDra818* module) {
+    memset(module->regs, 0, sizeof(module->regs));
+    module->frame = SimFrameAddress;
+    module->fifo_head = 0;
+    module->fifo_count = 0;
+    module->line_length = 0;
+    module->line_overflow = false;
+    module->tuned = false;
+    module->rx_freq = 0;
+    module->squelch = 0;
+    module->rx_tone = DRA818_TONE_NONE;
+    module->volume = 4;
+    sim_dra818_int_update(module);
+    sim_dra818_squelch_update(module, 0);
+}
+
+static void sim_dra818_boot_done(void* context, uint32_t generation) {
+    SimDra818* module = context;
+    if(generation == module->boot_generation && !module->in_reset) {
+        module->booted = true;
+    }
+}
+
+void sim_dra818_pin_write(uint8_t slot, Dra818Pin pin, bool level) {
+    SimDra818* module = sim_dra818_get(slot);
+    switch(pin) {
+    case Dra818PinCs:
+        if(!level) {
+            module->frame = SimFrameAddress;
+            module->stats.frames++;
+        }
+        break;
+    case Dra818PinRst:
+        module->boot_generation++;
+        module->in_reset = !level;
+        if(!level) {
+            module->stats.resets++;
+            module->booted = false;
+            sim_dra818_power_on_reset(module);
+        } else {
+            sim_irq_at(
+                sim_now_ns() + module->config.boot_ms * SIM_NS_PER_MS,
+                sim_dra818_boot_done,
+                module,
+                module->boot_generation);
+        }
+        break;
+    case Dra818PinPd:
+        module->asleep = !level;
+        if(level) {
+            module->awake_at = sim_now_ns() + module->config.wake_ms * SIM_NS_PER_MS;
+            sim_dra818_squelch_update(module, module->config.wake_ms);
+        } else {
+            module->line_length = 0;
+            sim_dra818_squelch_update(module, 0);
+        }
+        break;
+    default:
+        break; // INT and SQ are the module's outputs
+    }
+}
+
+static uint8_t sim_dra818_fifo_pop(SimDra818* module) {
+    uint8_t byte = module->fifo[module->fifo_head];
+    module->fifo_head = (module->fifo_head + 1) % SIM_DRA818_FIFO;
+    module->fifo_count--;
+    module->stats.fifo_reads++;
+    sim_dra818_int_update(module);
+    return byte;
+}
+
+uint8_t sim_dra818_spi_byte(uint8_t slot, uint8_t mosi, uint32_t hz) {
+    SimDra818* module = sim_dra818_get(slot);
+    if(!sim_dra818_alive(module)) {
+        return 0xFF; // MISO floats
+    }
+
+    uint8_t miso = 0x00;
+    uint8_t reg = module->frame_reg % SIM_DRA818_REGS;
+    switch(module->frame) {
+    case SimFrameAddress:
+        module->frame_reg = mosi & DRA818_REG_MASK;
+        if(mosi & DRA818_REG_BURST) {
+            module->frame = (mosi & DRA818_REG_READ) ? SimFrameBurstRead : SimFrameBurstWrite;
+        } else {
+            module->frame = (mosi & DRA818_REG_READ) ? SimFrameRead : SimFrameWrite;
+        }
+        break;
+    case SimFrameWrite:
+        // Address/value pairs may follow back to back in the same chip-select.
+        module->regs[reg] = mosi;
+        module->stats.reg_writes++;
+        module->frame = SimFrameAddress;
+        break;
+    case SimFrameRead:
+        // Register 0x01 doubles as the receive data register while the FIFO holds bytes.
+        if(reg == 0x01 && module->fifo_count) {
+            miso = sim_dra818_fifo_pop(module);
+        } else {
+            miso = module->regs[reg];
+            module->stats.reg_reads++;
+        }
+        module->frame = SimFrameAddress;
+        break;
+    case SimFrameBurstWrite:
+        module->regs[reg] = mosi;
+        module->stats.reg_writes++;
+        module->frame_reg++;
+        break;
+    case SimFrameBurstRead:
+        miso = module->regs[reg];
+        module->stats.reg_reads++;
+        module->frame_reg++;
+        break;
+    }
+
+    if(hz > module->config.spi_max_hz) {
+        miso ^= 0x01; // Setup time violated: the last bit is sampled wrong
+    }
+    return miso;
+}
+
+// AT command set
+
+static void sim_dra818_reply(SimDra818* module, const char* text, uint32_t delay_ms) {
+    char line[SIM_DRA818_LINE_MAX + 2];
+    int length = snprintf(line, sizeof(line), "%s\r\n", text);
+    sim_serial_reply(module - sim_dra818, line, length, delay_ms * SIM_NS_PER_MS);
+}
+
+static bool sim_dra818_parse_freq(const char* text, Dra818Freq* freq) {
+    unsigned mhz, fraction;
+    char dot;
+    if(sscanf(text, "%3u%c%4u", &mhz, &dot, &fraction) != 3 || dot != '.' ||
+       strlen(text) != 8) {
+        return false;
+    }
+    *freq = DRA818_FREQ_MHZ(mhz, fraction);
+    return (mhz >= 134 && mhz < 174) || (mhz >= 400 && mhz < 480);
+}
+
+// "0000" (none), "0001".."0038" (CTCSS) or "023N"/"023I" (DCS).
+static bool sim_dra818_parse_tone(const char* text, Dra818Tone* tone) {
+    if(strlen(text) != 4) {
+        return false;
+    }
+    if(text[3] == 'N' || text[3] == 'I') {
+        unsigned code;
+        if(sscanf(text, "%3o", &code) != 1) {
+            return false;
+        }
+        *tone = text[3] == 'I' ? DRA818_TONE_DCS_I(code) : DRA818_TONE_DCS(code);
+        return true;
+    }
+    unsigned number;
+    if(sscanf(text, "%4u", &number) != 1 || number > DRA818_CTCSS_COUNT) {
+        return false;
+    }
+    *tone = number;
+    return true;
+}
+
+static void sim_dra818_set_group(SimDra818* module, const char* args) {
+    // W,TTT.TTTT,RRR.RRRR,TTTT,S,RRRR
+    char fields[6][12];
+    size_t count = 0;
+    const char* start = args;
+    while(count < 6) {
+        const char* end = strchr(start, ',');
+        size_t length = end ? (size_t)(end - start) : strlen(start);
+        if(length >= sizeof(fields[0])) {
+            break;
+        }
+        memcpy(fields[count], start, length);
+        fields[count++][length] = '\0';
+        if(!end) {
+            break;
+        }
+        start = end + 1;
+    }
+
+    Dra818Freq tx_freq, rx_freq;
+    Dra818Tone tx_tone, rx_tone;
+    bool ok = count == 6 && (strcmp(fields[0], "0") == 0 || strcmp(fields[0], "1") == 0) &&
+              sim_dra818_parse_freq(fields[1], &tx_freq) &&
+              sim_dra818_parse_freq(fields[2], &rx_freq) &&
+              sim_dra818_parse_tone(fields[3], &tx_tone) && strlen(fields[4]) == 1 &&
+              fields[4][0] >= '0' && fields[4][0] <= '8' &&
+              sim_dra818_parse_tone(fields[5], &rx_tone);
+    if(ok) {
+        module->tuned = true;
+        module->rx_freq = rx_freq;
+        module->squelch = fields[4][0] - '0';
+        module->rx_tone = rx_tone;
+        module->stats.group_sets++;
+        // The squelch output closes while the synthesizer settles.
+        sim_board_drive(module - sim_dra818, Dra818PinSq, true);
+        sim_dra818_squelch_update(module, module->config.group_ms + SIM_DRA818_SETTLE_MS);
+    }
+    sim_dra818_reply(module, ok ? "+DMOSETGROUP:0" : "+DMOSETGROUP:1", module->config.group_ms);
+}
+
+static void sim_dra818_command(SimDra818* module, const char* line) {
+    module->stats.at_commands++;
+    if(strcmp(line, "AT+DMOCONNECT") == 0) {
+        sim_dra818_reply(module, "+DMOCONNECT:0", module->config.command_ms);
+    } else if(strncmp(line, "AT+DMOSETGROUP=", 15) == 0) {
+        sim_dra818_set_group(module, &line[15]);
+    } else if(strncmp(line, "AT+DMOSETVOLUME=", 16) == 0) {
+        bool ok = strlen(line) == 17 && line[16] >= '0' && line[16] <= '8';
+        if(ok) {
+            module->volume = line[16] - '0';
+        }
+        sim_dra818_reply(
+            module, ok ? "+DMOSETVOLUME:0" : "+DMOSETVOLUME:1", module->config.command_ms);
+    } else if(strcmp(line, "RSSI?") == 0) {
+        char answer[16];
+        snprintf(answer, sizeof(answer), "RSSI=%u", sim_dra818_rssi(module));
+        module->stats.rssi_reads++;
+        sim_dra818_reply(module, answer, module->config.command_ms);
+    }
+}
+
+void sim_dra818_uart_receive(uint8_t slot, const uint8_t* data, size_t size) {
+    SimDra818* module = sim_dra818_get(slot);
+    if(!sim_dra818_alive(module) || module->config.mute) {
+        return;
+    }
+    for(size_t i = 0; i < size; i++) {
+        if(data[i] == '\r') {
+            continue;
+        }
+        if(data[i] != '\n') {
+            if(module->line_length < SIM_DRA818_LINE_MAX - 1) {
+                module->line[module->line_length++] = data[i];
+            } else {
+                module->line_overflow = true;
+            }
+            continue;
+        }
+        module->line[module->line_length] = '\0';
+        if(!module->line_overflow && module->line_length) {
+            sim_dra818_command(module, module->line);
+        }
+        module->line_length = 0;
+        module->line_overflow = false;
+    }
+}
+
+// Test side
+
+void sim_dra818_get_config(uint8_t slot, SimDra818Config* config) {
+    *config = sim_dra818_get(slot)->config;
+}
+
+void sim_dra818_set_config(uint8_t slot, const SimDra818Config* config) {
+    sim_dra818_get(slot)->config = *config;
+}
+
+void sim_dra818_get_stats(uint8_t slot, SimDra818Stats* stats) {
+    *stats = sim_dra818_get(slot)->stats;
+}
+
+void sim_dra818_reset_stats(uint8_t slot) {
+    memset(&sim_dra818_get(slot)->stats, 0, sizeof(SimDra818Stats));
+}
+
+uint8_t sim_dra818_reg(uint8_t slot, uint8_t reg) {
+    return sim_dra818_get(slot)->regs[reg % SIM_DRA818_REGS];
+}
+
+bool sim_dra818_ready(uint8_t slot) {
+    return sim_dra818_alive(sim_dra818_get(slot));
+}
+
+Dra818Freq sim_dra818_rx_freq(uint8_t slot) {
+    SimDra818* module = sim_dra818_get(slot);
+    return module->tuned ? module->rx_freq : 0;
+}
+
+uint8_t sim_dra818_volume(uint8_t slot) {
+    return sim_dra818_get(slot)->volume;
+}
+
+void sim_dra818_set_signal(uint8_t slot, Dra818Freq freq, uint8_t rssi, Dra818Tone tone) {
+    SimDra818* module = sim_dra818_get(slot);
+    SimSignal* free_slot = NULL;
+    for(size_t i = 0; i < SIM_DRA818_SIGNALS; i++) {
+        SimSignal* signal = &module->signals[i];
+        if(signal->rssi && signal->freq == freq) {
+            free_slot = signal;
+            break;
+        }
+        if(!signal->rssi && !free_slot) {
+            free_slot = signal;
+        }
+    }
+    furi_check(free_slot);
+    free_slot->freq = freq;
+    free_slot->rssi = rssi;
+    free_slot->tone = tone;
+    sim_dra818_squelch_update(module, 0);
+}
+
+void sim_dra818_clear_signals(uint8_t slot) {
+    SimDra818* module = sim_dra818_get(slot);
+    memset(module->signals, 0, sizeof(module->signals));
+    sim_dra818_squelch_update(module, 0);
+}
+
+void sim_dra818_air_receive(uint8_t slot, const uint8_t* data, size_t size) {
+    SimDra818* module = sim_dra818_get(slot);
+    for(size_t i = 0; i < size && module->fifo_count < SIM_DRA818_FIFO; i++) {
+        module->fifo[(module->fifo_head + module->fifo_count++) % SIM_DRA818_FIFO] = data[i];
+    }
+    sim_dra818_int_update(module);
+}
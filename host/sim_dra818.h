@@ -0,0 +1,65 @@
+/*
+ -- sim_dra818.h
+ -- Behavioural model of the DRA818 modules wired to the board's slots
+ --
+ -- Each slot holds one module: a register file behind SPI with a receive FIFO
+ -- that pulls INT low, the AT command set on its UART, reset and power-down
+ -- lines, and a squelch output that opens for signals configured here.
+ -- Timings are defaults a test can change before bringing the module up.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "dra_plan.h"
+#include "dra_port.h"
+
+#define SIM_DRA818_REGS        64
+#define SIM_DRA818_NOISE_RSSI  15 // RSSI answered with no signal on the channel
+#define SIM_DRA818_SETTLE_MS   15 // Squelch decision after a retune
+
+typedef struct {
+    uint32_t boot_ms; // RST released to SPI and AT answering
+    uint32_t wake_ms; // PD released to answering again
+    uint32_t group_ms; // AT+DMOSETGROUP processing before the answer
+    uint32_t command_ms; // Other commands
+    uint32_t spi_max_hz; // Faster clocks corrupt bit 0 of every byte read
+    bool mute; // Ignore AT commands (a module that never answers)
+} SimDra818Config;
+
+typedef struct {
+    uint32_t frames; // Chip-select cycles
+    uint32_t reg_writes;
+    uint32_t reg_reads;
+    uint32_t fifo_reads; // Bytes taken from the receive FIFO
+    uint32_t resets;
+    uint32_t at_commands;
+    uint32_t group_sets; // Accepted AT+DMOSETGROUP
+    uint32_t rssi_reads;
+} SimDra818Stats;
+
+void sim_dra818_get_config(uint8_t slot, SimDra818Config* config);
+void sim_dra818_set_config(uint8_t slot, const SimDra818Config* config);
+void sim_dra818_get_stats(uint8_t slot, SimDra818Stats* stats);
+void sim_dra818_reset_stats(uint8_t slot);
+
+uint8_t sim_dra818_reg(uint8_t slot, uint8_t reg);
+bool sim_dra818_ready(uint8_t slot); // Out of reset, booted and awake
+// Receive frequency and squelch level of the last accepted AT+DMOSETGROUP (0: none).
+Dra818Freq sim_dra818_rx_freq(uint8_t slot);
+uint8_t sim_dra818_volume(uint8_t slot);
+
+// A carrier on `freq` at `rssi` (0..255) with sub-audio `tone`; rssi 0 removes it.
+void sim_dra818_set_signal(uint8_t slot, Dra818Freq freq, uint8_t rssi, Dra818Tone tone);
+void sim_dra818_clear_signals(uint8_t slot);
+// Bytes received over the air, queued in the receive FIFO (INT goes low).
+void sim_dra818_air_receive(uint8_t slot, const uint8_t* data, size_t size);
+
+// Board side.  sim_hal.c calls the model with what the Flipper drives, and the model
+// drives its outputs (INT, SQ) back through sim_board_drive().
+void sim_board_drive(uint8_t slot, Dra818Pin pin, bool level);
+void sim_dra818_pin_write(uint8_t slot, Dra818Pin pin, bool level);
+uint8_t sim_dra818_spi_byte(uint8_t slot, uint8_t mosi, uint32_t hz);
+void sim_dra818_uart_receive(uint8_t slot, const uint8_t* data, size_t size);
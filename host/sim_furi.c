@@ -0,0 +1,1155 @@
+/*
+ -- sim_furi.c
+ -- Furi kernel on pthreads with a simulated clock
+ --
+ -- Like the Flipper, the simulator has one CPU.  Each simulated thread (app
+ -- threads, the timer service and the ISR thread) is a pthread, but only the
+ -- one holding the CPU runs; it hands the CPU on when it blocks in one of the
+ -- primitives below.  When no thread is ready the clock jumps to the earliest
+ -- deadline.  Runs are therefore deterministic.  All state is guarded by one lock.
+*/
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <furi.h>
+#include "sim.h"
+
+#undef malloc
+#undef free
+#undef strdup
+
+#define SIM_HEAP_SIZE (64 * 1024 * 1024) // Nominal heap behind memmgr_get_free_heap()
+#define SIM_FOREVER   UINT64_MAX
+
+typedef struct SimWaiter {
+    pthread_cond_t cond;
+    const void* object; // Woken by sim_notify(object)
+    uint64_t deadline; // Woken by the clock (SIM_FOREVER: never)
+    bool timed_out;
+    bool in_irq;
+    uint32_t critical; // FURI_CRITICAL_ENTER depth
+    uint64_t cpu_start; // Thread CPU clock when this thread got the CPU
+    struct SimWaiter* next; // In the waiting list or the ready queue
+} SimWaiter;
+
+struct FuriThread {
+    SimWaiter waiter; // First: the scheduler works on waiters
+    char* name;
+    FuriThreadCallback callback;
+    void* context;
+    pthread_t pthread;
+    bool started;
+    bool finished;
+    bool adopted; // The main thread, which did not start through furi_thread_start()
+    int32_t return_code;
+    uint32_t flags;
+};
+
+static pthread_mutex_t sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t sim_now;
+static uint64_t sim_cpu_total;
+static SimWaiter* sim_cpu; // The one thread allowed to run
+static SimWaiter* sim_waiting;
+static SimWaiter* sim_ready_head;
+static SimWaiter** sim_ready_tail = &sim_ready_head;
+static FuriThread* sim_isr_thread;
+static FuriThread sim_main_thread = {.name = "main", .adopted = true};
+static __thread FuriThread* sim_self;
+
+static uint64_t sim_thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+__attribute__((constructor)) static void sim_furi_init(void) {
+    pthread_cond_init(&sim_main_thread.waiter.cond, NULL);
+    sim_main_thread.waiter.cpu_start = sim_thread_cpu_ns();
+    sim_self = &sim_main_thread;
+    sim_cpu = &sim_main_thread.waiter;
+}
+
+static const char* sim_thread_name(void) {
+    return sim_self ? sim_self->name : "?";
+}
+
+// Queue a thread for the CPU; interrupt handlers go first.
+static void sim_ready(SimWaiter* waiter) {
+    if(sim_isr_thread && waiter == &sim_isr_thread->waiter) {
+        waiter->next = sim_ready_head;
+        sim_ready_head = waiter;
+        if(sim_ready_tail == &sim_ready_head) {
+            sim_ready_tail = &waiter->next;
+        }
+    } else {
+        waiter->next = NULL;
+        *sim_ready_tail = waiter;
+        sim_ready_tail = &waiter->next;
+    }
+}
+
+static void sim_wake(SimWaiter** link, bool timed_out) {
+    SimWaiter* waiter = *link;
+    *link = waiter->next;
+    waiter->timed_out = timed_out;
+    sim_ready(waiter);
+}
+
+static void sim_notify(const void* object) {
+    SimWaiter** link = &sim_waiting;
+    while(*link) {
+        if((*link)->object == object) {
+            sim_wake(link, false);
+        } else {
+            link = &(*link)->next;
+        }
+    }
+}
+
+static void sim_wake_due(void) {
+    SimWaiter** link = &sim_waiting;
+    while(*link) {
+        if((*link)->deadline <= sim_now) {
+            sim_wake(link, true);
+        } else {
+            link = &(*link)->next;
+        }
+    }
+}
+
+// The running thread gave up the CPU: hand it to the next ready thread, moving the
+// clock to the next deadline if there is none.
+static void sim_dispatch(void) {
+    SimWaiter* self = &sim_self->waiter;
+    sim_cpu_total += sim_thread_cpu_ns() - self->cpu_start;
+    while(!sim_ready_head) {
+        uint64_t next = SIM_FOREVER;
+        for(SimWaiter* waiter = sim_waiting; waiter; waiter = waiter->next) {
+            next = MIN(next, waiter->deadline);
+        }
+        if(next == SIM_FOREVER) {
+            fprintf(
+                stderr,
+                "sim: deadlock at %llu ns, every thread waits forever\n",
+                (unsigned long long)sim_now);
+            abort();
+        }
+        __atomic_store_n(&sim_now, MAX(next, sim_now), __ATOMIC_RELAXED);
+        sim_wake_due();
+    }
+    sim_cpu = sim_ready_head;
+    sim_ready_head = sim_cpu->next;
+    if(!sim_ready_head) {
+        sim_ready_tail = &sim_ready_head;
+    }
+    pthread_cond_signal(&sim_cpu->cond);
+}
+
+// Wait for the CPU, with sim_lock held.
+static void sim_run(void) {
+    SimWaiter* self = &sim_self->waiter;
+    while(sim_cpu != self) {
+        pthread_cond_wait(&self->cond, &sim_lock);
+    }
+    self->cpu_start = sim_thread_cpu_ns();
+}
+
+// Wait for sim_notify(object) or the deadline, with sim_lock held.  Returns false on timeout.
+static bool sim_block(const void* object, uint64_t deadline) {
+    if(deadline <= sim_now) {
+        return false;
+    }
+    SimWaiter* self = &sim_self->waiter;
+    self->object = object;
+    self->deadline = deadline;
+    self->timed_out = false;
+    self->next = sim_waiting;
+    sim_waiting = self;
+    sim_dispatch();
+    sim_run();
+    return !self->timed_out;
+}
+
+static uint64_t sim_deadline(uint32_t timeout) {
+    return timeout == FuriWaitForever ? SIM_FOREVER : sim_now + timeout * SIM_NS_PER_MS;
+}
+
+static void sim_check_blocking(uint32_t timeout) {
+    if(timeout != 0 && furi_kernel_is_irq_or_masked()) {
+        furi_crash("blocking call from an interrupt or a critical section");
+    }
+}
+
+uint64_t sim_now_ns(void) {
+    return __atomic_load_n(&sim_now, __ATOMIC_RELAXED);
+}
+
+uint64_t sim_cpu_ns(void) {
+    pthread_mutex_lock(&sim_lock);
+    uint64_t total = sim_cpu_total + sim_thread_cpu_ns() - sim_self->waiter.cpu_start;
+    pthread_mutex_unlock(&sim_lock);
+    return total;
+}
+
+void sim_sleep_ns(uint64_t ns) {
+    pthread_mutex_lock(&sim_lock);
+    if(furi_kernel_is_irq_or_masked()) {
+        // Busy wait with interrupts off: nothing else runs meanwhile.
+        __atomic_store_n(&sim_now, sim_now + ns, __ATOMIC_RELAXED);
+        sim_wake_due();
+    } else {
+        sim_block(&sim_self->waiter, sim_now + ns);
+    }
+    pthread_mutex_unlock(&sim_lock);
+}
+
+bool sim_wait(const void* object, uint64_t deadline_ns) {
+    sim_check_blocking(deadline_ns > sim_now_ns());
+    pthread_mutex_lock(&sim_lock);
+    bool signalled = sim_block(object, deadline_ns);
+    pthread_mutex_unlock(&sim_lock);
+    return signalled;
+}
+
+void sim_signal(const void* object) {
+    pthread_mutex_lock(&sim_lock);
+    sim_notify(object);
+    pthread_mutex_unlock(&sim_lock);
+}
+
+// Heap
+
+typedef struct {
+    size_t size;
+    size_t pad;
+} SimHeapHeader;
+
+static size_t sim_heap_in_use;
+static size_t sim_heap_peak;
+
+void* sim_malloc(size_t size) {
+    SimHeapHeader* header = calloc(1, sizeof(SimHeapHeader) + size);
+    if(!header) {
+        furi_crash("out of memory");
+    }
+    header->size = size;
+    __atomic_add_fetch(&sim_heap_in_use, size, __ATOMIC_RELAXED);
+    size_t in_use = __atomic_load_n(&sim_heap_in_use, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&sim_heap_peak, __ATOMIC_RELAXED);
+    while(in_use > peak &&
+          !__atomic_compare_exchange_n(
+              &sim_heap_peak, &peak, in_use, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    return header + 1;
+}
+
+void sim_free(void* ptr) {
+    if(!ptr) {
+        return;
+    }
+    SimHeapHeader* header = (SimHeapHeader*)ptr - 1;
+    __atomic_sub_fetch(&sim_heap_in_use, header->size, __ATOMIC_RELAXED);
+    free(header);
+}
+
+char* sim_strdup(const char* str) {
+    size_t size = strlen(str) + 1;
+    char* copy = sim_malloc(size);
+    memcpy(copy, str, size);
+    return copy;
+}
+
+size_t sim_heap_used(void) {
+    return __atomic_load_n(&sim_heap_in_use, __ATOMIC_RELAXED);
+}
+
+size_t memmgr_get_free_heap(void) {
+    return SIM_HEAP_SIZE - sim_heap_used();
+}
+
+size_t memmgr_get_minimum_free_heap(void) {
+    return SIM_HEAP_SIZE - __atomic_load_n(&sim_heap_peak, __ATOMIC_RELAXED);
+}
+
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if(size) {
+        size_t copy = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copy);
+        dst[copy] = '\0';
+    }
+    return length;
+}
+
+// Checks and log
+
+void furi_crash_at(const char* file, int line, const char* message) {
+    fprintf(stderr, "furi_crash: %s:%d: %s (thread %s)\n", file, line, message, sim_thread_name());
+    abort();
+}
+
+static pthread_mutex_t sim_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static int sim_log_level = -1;
+
+static int sim_log_threshold(void) {
+    if(sim_log_level < 0) {
+        // DRA_SIM_LOG: E, W, I, D or T (default W)
+        const char* env = getenv("DRA_SIM_LOG");
+        const char* levels = "EWIDT";
+        const char* level = env && *env ? strchr(levels, *env) : NULL;
+        sim_log_level = FuriLogLevelError + (level ? level - levels : 1);
+    }
+    return sim_log_level;
+}
+
+void furi_log_print_format(FuriLogLevel level, const char* tag, const char* format, ...) {
+    if(level == FuriLogLevelDefault) {
+        level = FuriLogLevelInfo;
+    }
+    if((int)level > sim_log_threshold()) {
+        return;
+    }
+    static const char letters[] = "??EWIDT";
+    pthread_mutex_lock(&sim_log_lock);
+    fprintf(stderr, "%8lu [%c][%s] ", (unsigned long)furi_get_tick(), letters[level], tag);
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&sim_log_lock);
+}
+
+// Kernel
+
+// One CPU: a thread with interrupts masked never gives it up, so the critical
+// section only has to count.
+bool furi_kernel_is_irq_or_masked(void) {
+    return sim_self->waiter.in_irq || sim_self->waiter.critical > 0;
+}
+
+__FuriCriticalInfo __furi_critical_enter(void) {
+    return (__FuriCriticalInfo){.depth = ++sim_self->waiter.critical};
+}
+
+void __furi_critical_exit(__FuriCriticalInfo info) {
+    furi_check(sim_self->waiter.critical == info.depth);
+    sim_self->waiter.critical--;
+}
+
+uint32_t furi_get_tick(void) {
+    return (uint32_t)(sim_now_ns() / SIM_NS_PER_MS);
+}
+
+uint32_t furi_ms_to_ticks(uint32_t milliseconds) {
+    return milliseconds;
+}
+
+uint32_t furi_kernel_get_tick_frequency(void) {
+    return 1000;
+}
+
+void furi_delay_tick(uint32_t ticks) {
+    sim_check_blocking(ticks);
+    sim_sleep_ns(ticks * SIM_NS_PER_MS);
+}
+
+void furi_delay_ms(uint32_t milliseconds) {
+    furi_delay_tick(milliseconds);
+}
+
+void furi_delay_us(uint32_t microseconds) {
+    sim_sleep_ns(microseconds * 1000ULL);
+}
+
+// Threads
+
+static void* sim_thread_main(void* arg) {
+    FuriThread* thread = arg;
+    sim_self = thread;
+    pthread_mutex_lock(&sim_lock);
+    sim_run();
+    pthread_mutex_unlock(&sim_lock);
+
+    int32_t return_code = thread->callback(thread->context);
+
+    pthread_mutex_lock(&sim_lock);
+    thread->return_code = return_code;
+    thread->finished = true;
+    sim_notify(thread);
+    sim_dispatch();
+    pthread_mutex_unlock(&sim_lock);
+    return NULL;
+}
+
+// Start a simulated thread, with sim_lock held; it runs once the caller gives up the CPU.
+static void sim_spawn(FuriThread* thread) {
+    thread->started = true;
+    pthread_cond_init(&thread->waiter.cond, NULL);
+    sim_ready(&thread->waiter);
+    if(pthread_create(&thread->pthread, NULL, sim_thread_main, thread) != 0) {
+        furi_crash("pthread_create failed");
+    }
+}
+
+// Kernel threads (timer service, ISR) are not on the app's heap, with sim_lock held.
+static FuriThread* sim_spawn_service(const char* name, FuriThreadCallback callback) {
+    FuriThread* thread = calloc(1, sizeof(FuriThread));
+    thread->name = strdup(name);
+    thread->callback = callback;
+    sim_spawn(thread);
+    return thread;
+}
+
+FuriThread* furi_thread_alloc_ex(
+    const char* name,
+    uint32_t stack_size,
+    FuriThreadCallback callback,
+    void* context) {
+    UNUSED(stack_size); // Host stacks are larger anyway
+    FuriThread* thread = sim_malloc(sizeof(FuriThread));
+    thread->name = sim_strdup(name ? name : "thread");
+    thread->callback = callback;
+    thread->context = context;
+    return thread;
+}
+
+void furi_thread_free(FuriThread* thread) {
+    furi_check(!thread->adopted);
+    furi_check(!thread->started || thread->finished);
+    if(thread->started) {
+        pthread_join(thread->pthread, NULL);
+        pthread_cond_destroy(&thread->waiter.cond);
+    }
+    sim_free(thread->name);
+    sim_free(thread);
+}
+
+void furi_thread_set_priority(FuriThread* thread, FuriThreadPriority priority) {
+    UNUSED(thread);
+    UNUSED(priority);
+}
+
+void furi_thread_start(FuriThread* thread) {
+    pthread_mutex_lock(&sim_lock);
+    furi_check(!thread->started);
+    sim_spawn(thread);
+    pthread_mutex_unlock(&sim_lock);
+}
+
+bool furi_thread_join(FuriThread* thread) {
+    furi_check(thread != sim_self);
+    sim_check_blocking(FuriWaitForever);
+    pthread_mutex_lock(&sim_lock);
+    while(thread->started && !thread->finished) {
+        sim_block(thread, SIM_FOREVER);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return true;
+}
+
+int32_t furi_thread_get_return_code(FuriThread* thread) {
+    return thread->return_code;
+}
+
+FuriThreadId furi_thread_get_id(FuriThread* thread) {
+    return thread;
+}
+
+static FuriThread* sim_current_thread(void) {
+    return sim_self;
+}
+
+FuriThreadId furi_thread_get_current_id(void) {
+    return sim_current_thread();
+}
+
+uint32_t furi_thread_flags_set(FuriThreadId thread_id, uint32_t flags) {
+    FuriThread* thread = thread_id;
+    furi_check(thread);
+    pthread_mutex_lock(&sim_lock);
+    thread->flags |= flags;
+    uint32_t result = thread->flags;
+    sim_notify(&thread->flags);
+    pthread_mutex_unlock(&sim_lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_clear(uint32_t flags) {
+    FuriThread* thread = sim_current_thread();
+    pthread_mutex_lock(&sim_lock);
+    uint32_t result = thread->flags;
+    thread->flags &= ~flags;
+    pthread_mutex_unlock(&sim_lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_get(void) {
+    FuriThread* thread = sim_current_thread();
+    pthread_mutex_lock(&sim_lock);
+    uint32_t result = thread->flags;
+    pthread_mutex_unlock(&sim_lock);
+    return result;
+}
+
+uint32_t furi_thread_flags_wait(uint32_t flags, uint32_t options, uint32_t timeout) {
+    sim_check_blocking(timeout);
+    FuriThread* thread = sim_current_thread();
+    pthread_mutex_lock(&sim_lock);
+    uint64_t deadline = sim_deadline(timeout);
+    uint32_t result;
+    while(true) {
+        uint32_t have = thread->flags & flags;
+        if((options & FuriFlagWaitAll) ? have == flags : have != 0) {
+            result = thread->flags;
+            if(!(options & FuriFlagNoClear)) {
+                thread->flags &= ~flags;
+            }
+            break;
+        }
+        if(timeout == 0) {
+            result = FuriFlagErrorResource;
+            break;
+        }
+        if(!sim_block(&thread->flags, deadline) && !(thread->flags & flags)) {
+            result = FuriFlagErrorTimeout;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return result;
+}
+
+// Mutex
+
+struct FuriMutex {
+    FuriMutexType type;
+    FuriThread* owner;
+    uint32_t count;
+};
+
+FuriMutex* furi_mutex_alloc(FuriMutexType type) {
+    FuriMutex* mutex = sim_malloc(sizeof(FuriMutex));
+    mutex->type = type;
+    return mutex;
+}
+
+void furi_mutex_free(FuriMutex* mutex) {
+    furi_check(mutex->owner == NULL);
+    sim_free(mutex);
+}
+
+FuriStatus furi_mutex_acquire(FuriMutex* mutex, uint32_t timeout) {
+    furi_check(!sim_self->waiter.in_irq);
+    sim_check_blocking(timeout);
+    FuriThread* self = sim_current_thread();
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&sim_lock);
+    if(mutex->owner == self) {
+        furi_check(mutex->type == FuriMutexTypeRecursive);
+        mutex->count++;
+    } else {
+        uint64_t deadline = sim_deadline(timeout);
+        while(mutex->owner) {
+            if(timeout == 0) {
+                status = FuriStatusErrorResource;
+                break;
+            }
+            if(!sim_block(mutex, deadline) && mutex->owner) {
+                status = FuriStatusErrorTimeout;
+                break;
+            }
+        }
+        if(status == FuriStatusOk) {
+            mutex->owner = self;
+            mutex->count = 1;
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return status;
+}
+
+FuriStatus furi_mutex_release(FuriMutex* mutex) {
+    pthread_mutex_lock(&sim_lock);
+    furi_check(mutex->owner == sim_current_thread());
+    if(--mutex->count == 0) {
+        mutex->owner = NULL;
+        sim_notify(mutex);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return FuriStatusOk;
+}
+
+// Semaphore
+
+struct FuriSemaphore {
+    uint32_t max_count;
+    uint32_t count;
+};
+
+FuriSemaphore* furi_semaphore_alloc(uint32_t max_count, uint32_t initial_count) {
+    furi_check(max_count > 0 && initial_count <= max_count);
+    FuriSemaphore* semaphore = sim_malloc(sizeof(FuriSemaphore));
+    semaphore->max_count = max_count;
+    semaphore->count = initial_count;
+    return semaphore;
+}
+
+void furi_semaphore_free(FuriSemaphore* semaphore) {
+    sim_free(semaphore);
+}
+
+FuriStatus furi_semaphore_acquire(FuriSemaphore* semaphore, uint32_t timeout) {
+    sim_check_blocking(timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&sim_lock);
+    uint64_t deadline = sim_deadline(timeout);
+    while(semaphore->count == 0) {
+        if(timeout == 0) {
+            status = FuriStatusErrorResource;
+            break;
+        }
+        if(!sim_block(semaphore, deadline) && semaphore->count == 0) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        semaphore->count--;
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return status;
+}
+
+FuriStatus furi_semaphore_release(FuriSemaphore* semaphore) {
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&sim_lock);
+    if(semaphore->count < semaphore->max_count) {
+        semaphore->count++;
+        sim_notify(semaphore);
+    } else {
+        status = FuriStatusErrorResource;
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return status;
+}
+
+uint32_t furi_semaphore_get_count(FuriSemaphore* semaphore) {
+    pthread_mutex_lock(&sim_lock);
+    uint32_t count = semaphore->count;
+    pthread_mutex_unlock(&sim_lock);
+    return count;
+}
+
+// Message queue
+
+struct FuriMessageQueue {
+    uint32_t capacity;
+    uint32_t size;
+    uint32_t head;
+    uint32_t count;
+    uint8_t* data;
+};
+
+FuriMessageQueue* furi_message_queue_alloc(uint32_t msg_count, uint32_t msg_size) {
+    furi_check(msg_count > 0 && msg_size > 0);
+    FuriMessageQueue* queue = sim_malloc(sizeof(FuriMessageQueue));
+    queue->capacity = msg_count;
+    queue->size = msg_size;
+    queue->data = sim_malloc((size_t)msg_count * msg_size);
+    return queue;
+}
+
+void furi_message_queue_free(FuriMessageQueue* queue) {
+    sim_free(queue->data);
+    sim_free(queue);
+}
+
+FuriStatus furi_message_queue_put(FuriMessageQueue* queue, const void* msg, uint32_t timeout) {
+    sim_check_blocking(timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&sim_lock);
+    uint64_t deadline = sim_deadline(timeout);
+    while(queue->count == queue->capacity) {
+        if(timeout == 0) {
+            status = FuriStatusErrorResource;
+            break;
+        }
+        if(!sim_block(queue, deadline) && queue->count == queue->capacity) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        uint32_t slot = (queue->head + queue->count) % queue->capacity;
+        memcpy(&queue->data[slot * queue->size], msg, queue->size);
+        queue->count++;
+        sim_notify(queue);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return status;
+}
+
+FuriStatus furi_message_queue_get(FuriMessageQueue* queue, void* msg, uint32_t timeout) {
+    sim_check_blocking(timeout);
+    FuriStatus status = FuriStatusOk;
+    pthread_mutex_lock(&sim_lock);
+    uint64_t deadline = sim_deadline(timeout);
+    while(queue->count == 0) {
+        if(timeout == 0) {
+            status = FuriStatusErrorResource;
+            break;
+        }
+        if(!sim_block(queue, deadline) && queue->count == 0) {
+            status = FuriStatusErrorTimeout;
+            break;
+        }
+    }
+    if(status == FuriStatusOk) {
+        memcpy(msg, &queue->data[queue->head * queue->size], queue->size);
+        queue->head = (queue->head + 1) % queue->capacity;
+        queue->count--;
+        sim_notify(queue);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return status;
+}
+
+uint32_t furi_message_queue_get_count(FuriMessageQueue* queue) {
+    pthread_mutex_lock(&sim_lock);
+    uint32_t count = queue->count;
+    pthread_mutex_unlock(&sim_lock);
+    return count;
+}
+
+// Stream buffer
+
+struct FuriStreamBuffer {
+    size_t size;
+    size_t trigger_level;
+    size_t head;
+    size_t count;
+    uint8_t* data;
+};
+
+FuriStreamBuffer* furi_stream_buffer_alloc(size_t size, size_t trigger_level) {
+    furi_check(size > 0);
+    FuriStreamBuffer* stream = sim_malloc(sizeof(FuriStreamBuffer));
+    stream->size = size;
+    stream->trigger_level = MAX(trigger_level, (size_t)1);
+    stream->data = sim_malloc(size);
+    return stream;
+}
+
+void furi_stream_buffer_free(FuriStreamBuffer* stream_buffer) {
+    sim_free(stream_buffer->data);
+    sim_free(stream_buffer);
+}
+
+size_t furi_stream_buffer_send(
+    FuriStreamBuffer* stream_buffer,
+    const void* data,
+    size_t length,
+    uint32_t timeout) {
+    sim_check_blocking(timeout);
+    FuriStreamBuffer* stream = stream_buffer;
+    const uint8_t* bytes = data;
+    size_t sent = 0;
+    pthread_mutex_lock(&sim_lock);
+    uint64_t deadline = sim_deadline(timeout);
+    while(true) {
+        while(sent < length && stream->count < stream->size) {
+            stream->data[(stream->head + stream->count) % stream->size] = bytes[sent++];
+            stream->count++;
+        }
+        if(sent) {
+            sim_notify(stream);
+        }
+        if(sent == length || timeout == 0 || !sim_block(stream, deadline)) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return sent;
+}
+
+size_t furi_stream_buffer_receive(
+    FuriStreamBuffer* stream_buffer,
+    void* data,
+    size_t length,
+    uint32_t timeout) {
+    sim_check_blocking(timeout);
+    FuriStreamBuffer* stream = stream_buffer;
+    uint8_t* bytes = data;
+    pthread_mutex_lock(&sim_lock);
+    uint64_t deadline = sim_deadline(timeout);
+    while(stream->count < MIN(stream->trigger_level, length) && timeout != 0 &&
+          sim_block(stream, deadline)) {
+    }
+    size_t received = MIN(stream->count, length);
+    for(size_t i = 0; i < received; i++) {
+        bytes[i] = stream->data[stream->head];
+        stream->head = (stream->head + 1) % stream->size;
+    }
+    stream->count -= received;
+    if(received) {
+        sim_notify(stream);
+    }
+    pthread_mutex_unlock(&sim_lock);
+    return received;
+}
+
+size_t furi_stream_buffer_bytes_available(FuriStreamBuffer* stream_buffer) {
+    pthread_mutex_lock(&sim_lock);
+    size_t count = stream_buffer->count;
+    pthread_mutex_unlock(&sim_lock);
+    return count;
+}
+
+FuriStatus furi_stream_buffer_reset(FuriStreamBuffer* stream_buffer) {
+    pthread_mutex_lock(&sim_lock);
+    stream_buffer->head = 0;
+    stream_buffer->count = 0;
+    sim_notify(stream_buffer);
+    pthread_mutex_unlock(&sim_lock);
+    return FuriStatusOk;
+}
+
+// Timers, serviced by one thread like the FreeRTOS timer task
+
+struct FuriTimer {
+    FuriTimerCallback callback;
+    FuriTimerType type;
+    void* context;
+    uint32_t period; // ticks
+    uint64_t expiry;
+    bool active;
+    bool calling; // The callback is running
+    FuriTimer* next;
+};
+
+typedef struct SimPending {
+    FuriTimerPendigCallback callback;
+    void* context;
+    uint32_t arg;
+    struct SimPending* next;
+} SimPending;
+
+static FuriTimer* sim_timers;
+static SimPending* sim_pending_head;
+static SimPending** sim_pending_tail = &sim_pending_head;
+static FuriThread* sim_timer_thread;
+
+static int32_t sim_timer_service(void* context) {
+    UNUSED(context);
+    pthread_mutex_lock(&sim_lock);
+    while(true) {
+        SimPending* pending = sim_pending_head;
+        if(pending) {
+            sim_pending_head = pending->next;
+            if(!sim_pending_head) {
+                sim_pending_tail = &sim_pending_head;
+            }
+            pthread_mutex_unlock(&sim_lock);
+            pending->callback(pending->context, pending->arg);
+            free(pending);
+            pthread_mutex_lock(&sim_lock);
+            continue;
+        }
+
+        FuriTimer* due = NULL;
+        for(FuriTimer* timer = sim_timers; timer; timer = timer->next) {
+            if(timer->active && (!due || timer->expiry < due->expiry)) {
+                due = timer;
+            }
+        }
+        if(!due || due->expiry > sim_now) {
+            sim_block(&sim_timers, due ? due->expiry : SIM_FOREVER);
+            continue;
+        }
+        if(due->type == FuriTimerTypePeriodic) {
+            due->expiry += due->period * SIM_NS_PER_MS;
+        } else {
+            due->active = false;
+        }
+        due->calling = true;
+        pthread_mutex_unlock(&sim_lock);
+        due->callback(due->context);
+        pthread_mutex_lock(&sim_lock);
+        due->calling = false;
+        sim_notify(due);
+    }
+    return 0;
+}
+
+// With sim_lock held.
+static void sim_timer_service_start(void) {
+    if(!sim_timer_thread) {
+        sim_timer_thread = sim_spawn_service("TimerService", sim_timer_service);
+    }
+}
+
+FuriTimer* furi_timer_alloc(FuriTimerCallback callback, FuriTimerType type, void* context) {
+    furi_check(callback);
+    FuriTimer* timer = sim_malloc(sizeof(FuriTimer));
+    timer->callback = callback;
+    timer->type = type;
+    timer->context = context;
+    pthread_mutex_lock(&sim_lock);
+    sim_timer_service_start();
+    timer->next = sim_timers;
+    sim_timers = timer;
+    pthread_mutex_unlock(&sim_lock);
+    return timer;
+}
+
+void furi_timer_free(FuriTimer* timer) {
+    furi_check(!furi_kernel_is_irq_or_masked());
+    bool service = sim_self == sim_timer_thread;
+    pthread_mutex_lock(&sim_lock);
+    timer->active = false;
+    while(timer->calling && !service) {
+        sim_block(timer, SIM_FOREVER);
+    }
+    furi_check(!timer->calling || timer->type == FuriTimerTypeOnce);
+    for(FuriTimer** link = &sim_timers; *link; link = &(*link)->next) {
+        if(*link == timer) {
+            *link = timer->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+    sim_free(timer);
+}
+
+FuriStatus furi_timer_start(FuriTimer* timer, uint32_t ticks) {
+    furi_check(!furi_kernel_is_irq_or_masked());
+    furi_check(ticks > 0 && ticks < FuriWaitForever); // FreeRTOS asserts on a zero period
+    pthread_mutex_lock(&sim_lock);
+    timer->period = ticks;
+    timer->expiry = sim_now + ticks * SIM_NS_PER_MS;
+    timer->active = true;
+    sim_notify(&sim_timers);
+    pthread_mutex_unlock(&sim_lock);
+    return FuriStatusOk;
+}
+
+FuriStatus furi_timer_restart(FuriTimer* timer, uint32_t ticks) {
+    return furi_timer_start(timer, ticks);
+}
+
+FuriStatus furi_timer_stop(FuriTimer* timer) {
+    furi_check(!furi_kernel_is_irq_or_masked());
+    pthread_mutex_lock(&sim_lock);
+    timer->active = false;
+    sim_notify(&sim_timers);
+    pthread_mutex_unlock(&sim_lock);
+    return FuriStatusOk;
+}
+
+uint32_t furi_timer_is_running(FuriTimer* timer) {
+    pthread_mutex_lock(&sim_lock);
+    uint32_t running = timer->active;
+    pthread_mutex_unlock(&sim_lock);
+    return running;
+}
+
+void furi_timer_pending_callback(FuriTimerPendigCallback callback, void* context, uint32_t arg) {
+    SimPending* pending = calloc(1, sizeof(SimPending));
+    pending->callback = callback;
+    pending->context = context;
+    pending->arg = arg;
+    pthread_mutex_lock(&sim_lock);
+    sim_timer_service_start();
+    *sim_pending_tail = pending;
+    sim_pending_tail = &pending->next;
+    sim_notify(&sim_timers);
+    pthread_mutex_unlock(&sim_lock);
+}
+
+// Interrupts: handlers run one at a time on the ISR thread, ahead of every other thread
+
+typedef struct SimIrq {
+    uint64_t at;
+    SimIrqHandler handler;
+    void* context;
+    uint32_t arg;
+    struct SimIrq* next;
+} SimIrq;
+
+static SimIrq* sim_irqs; // Sorted by time, then by scheduling order
+static int32_t sim_isr_service(void* context) {
+    UNUSED(context);
+    pthread_mutex_lock(&sim_lock);
+    while(true) {
+        SimIrq* irq = sim_irqs;
+        if(!irq || irq->at > sim_now) {
+            sim_block(&sim_irqs, irq ? irq->at : SIM_FOREVER);
+            continue;
+        }
+        sim_irqs = irq->next;
+        pthread_mutex_unlock(&sim_lock);
+
+        sim_self->waiter.in_irq = true;
+        irq->handler(irq->context, irq->arg);
+        sim_self->waiter.in_irq = false;
+        free(irq);
+
+        pthread_mutex_lock(&sim_lock);
+    }
+    return 0;
+}
+
+void sim_irq_at(uint64_t at_ns, SimIrqHandler handler, void* context, uint32_t arg) {
+    SimIrq* irq = calloc(1, sizeof(SimIrq));
+    irq->handler = handler;
+    irq->context = context;
+    irq->arg = arg;
+    pthread_mutex_lock(&sim_lock);
+    if(!sim_isr_thread) {
+        sim_isr_thread = sim_spawn_service("ISR", sim_isr_service);
+    }
+    irq->at = MAX(at_ns, sim_now);
+    SimIrq** link = &sim_irqs;
+    while(*link && (*link)->at <= irq->at) {
+        link = &(*link)->next;
+    }
+    irq->next = *link;
+    *link = irq;
+    sim_notify(&sim_irqs);
+    pthread_mutex_unlock(&sim_lock);
+}
+
+// String
+
+struct FuriString {
+    char* data;
+    size_t length;
+    size_t capacity;
+};
+
+static void furi_string_reserve(FuriString* string, size_t length) {
+    if(length + 1 <= string->capacity) {
+        return;
+    }
+    size_t capacity = MAX(length + 1, string->capacity * 2);
+    char* data = sim_malloc(capacity);
+    memcpy(data, string->data, string->length + 1);
+    sim_free(string->data);
+    string->data = data;
+    string->capacity = capacity;
+}
+
+FuriString* furi_string_alloc(void) {
+    FuriString* string = sim_malloc(sizeof(FuriString));
+    string->capacity = 16;
+    string->data = sim_malloc(string->capacity);
+    return string;
+}
+
+FuriString* furi_string_alloc_set_str(const char* str) {
+    FuriString* string = furi_string_alloc();
+    furi_string_set_str(string, str);
+    return string;
+}
+
+void furi_string_free(FuriString* string) {
+    sim_free(string->data);
+    sim_free(string);
+}
+
+void furi_string_reset(FuriString* string) {
+    string->length = 0;
+    string->data[0] = '\0';
+}
+
+void furi_string_set_str(FuriString* string, const char* str) {
+    size_t length = strlen(str);
+    furi_string_reserve(string, length);
+    memmove(string->data, str, length + 1);
+    string->length = length;
+}
+
+void furi_string_set(FuriString* string, const char* str) {
+    furi_string_set_str(string, str);
+}
+
+void furi_string_cat_str(FuriString* string, const char* str) {
+    size_t length = strlen(str);
+    furi_string_reserve(string, string->length + length);
+    memcpy(&string->data[string->length], str, length + 1);
+    string->length += length;
+}
+
+static int furi_string_cat_vprintf(FuriString* string, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+    if(length > 0) {
+        furi_string_reserve(string, string->length + length);
+        vsnprintf(&string->data[string->length], length + 1, format, args);
+        string->length += length;
+    }
+    return length;
+}
+
+int furi_string_printf(FuriString* string, const char* format, ...) {
+    furi_string_reset(string);
+    va_list args;
+    va_start(args, format);
+    int length = furi_string_cat_vprintf(string, format, args);
+    va_end(args);
+    return length;
+}
+
+int furi_string_cat_printf(FuriString* string, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = furi_string_cat_vprintf(string, format, args);
+    va_end(args);
+    return length;
+}
+
+const char* furi_string_get_cstr(const FuriString* string) {
+    return string->data;
+}
+
+size_t furi_string_size(const FuriString* string) {
+    return string->length;
+}
+
+// Records: services are stateless in the simulator; each name gets its own token.
+
+#define SIM_RECORDS 8
+
+static struct {
+    const char* name;
+    uint32_t open;
+} sim_records[SIM_RECORDS];
+
+void* furi_record_open(const char* name) {
+    pthread_mutex_lock(&sim_lock);
+    size_t i = 0;
+    while(i < SIM_RECORDS && sim_records[i].name && strcmp(sim_records[i].name, name) != 0) {
+        i++;
+    }
+    furi_check(i < SIM_RECORDS);
+    sim_records[i].name = sim_records[i].name ? sim_records[i].name : strdup(name);
+    sim_records[i].open++;
+    pthread_mutex_unlock(&sim_lock);
+    return &sim_records[i];
+}
+
+void furi_record_close(const char* name) {
+    pthread_mutex_lock(&sim_lock);
+    for(size_t i = 0; i < SIM_RECORDS && sim_records[i].name; i++) {
+        if(strcmp(sim_records[i].name, name) == 0) {
+            furi_check(sim_records[i].open > 0);
+            sim_records[i].open--;
+        }
+    }
+    pthread_mutex_unlock(&sim_lock);
+}
@@ -0,0 +1,958 @@
+/*
+ -- sim_gui.c
+ -- View, ViewDispatcher, canvas and the GUI modules the app uses
+ --
+ -- The dispatcher follows the firmware: one queue of input, custom and draw
+ -- events handled on the thread in view_dispatcher_run(), Back falling through
+ -- to the previous or navigation callback, and key releases going to the view
+ -- that saw the press.  Frames are drawn on that thread too (the firmware uses
+ -- the GUI service thread) and recorded as the text passed to the canvas.
+*/
+
+#include <stdio.h>
+#include <gui/gui.h>
+#include <gui/view_dispatcher.h>
+#include <gui/modules/submenu.h>
+#include <gui/modules/text_box.h>
+#include <gui/modules/text_input.h>
+#include <gui/modules/variable_item_list.h>
+#include <gui/modules/widget.h>
+#include "sim.h"
+
+#define SIM_GUI_VIEWS   16
+#define SIM_GUI_QUEUE   32
+#define SIM_GUI_TEXT    1024
+#define SIM_GUI_POLL_MS 10
+#define SIM_GUI_ITEMS   16
+#define SIM_GUI_LABEL   32
+
+// Canvas: the text of one frame, one line per string drawn.
+
+struct Canvas {
+    char text[SIM_GUI_TEXT];
+    size_t length;
+};
+
+static Canvas sim_canvas;
+static char sim_frame[SIM_GUI_TEXT];
+static uint32_t sim_frames;
+
+static void sim_canvas_add(Canvas* canvas, const char* str) {
+    int written = snprintf(
+        &canvas->text[canvas->length], sizeof(canvas->text) - canvas->length, "%s\n", str);
+    if(written > 0) {
+        canvas->length = MIN(canvas->length + written, sizeof(canvas->text) - 1);
+    }
+}
+
+void canvas_set_font(Canvas* canvas, Font font) {
+    UNUSED(canvas);
+    UNUSED(font);
+}
+
+void canvas_set_color(Canvas* canvas, Color color) {
+    UNUSED(canvas);
+    UNUSED(color);
+}
+
+void canvas_draw_str(Canvas* canvas, int32_t x, int32_t y, const char* str) {
+    UNUSED(x);
+    UNUSED(y);
+    sim_canvas_add(canvas, str);
+}
+
+void canvas_draw_str_aligned(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    Align horizontal,
+    Align vertical,
+    const char* str) {
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(horizontal);
+    UNUSED(vertical);
+    sim_canvas_add(canvas, str);
+}
+
+void canvas_draw_xbm(
+    Canvas* canvas,
+    int32_t x,
+    int32_t y,
+    size_t width,
+    size_t height,
+    const uint8_t* bitmap) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(width);
+    UNUSED(height);
+    UNUSED(bitmap);
+}
+
+void canvas_draw_box(Canvas* canvas, int32_t x, int32_t y, size_t width, size_t height) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(width);
+    UNUSED(height);
+}
+
+void canvas_draw_line(Canvas* canvas, int32_t x1, int32_t y1, int32_t x2, int32_t y2) {
+    UNUSED(canvas);
+    UNUSED(x1);
+    UNUSED(y1);
+    UNUSED(x2);
+    UNUSED(y2);
+}
+
+void canvas_draw_dot(Canvas* canvas, int32_t x, int32_t y) {
+    UNUSED(canvas);
+    UNUSED(x);
+    UNUSED(y);
+}
+
+// View
+
+struct View {
+    ViewDrawCallback draw_callback;
+    ViewInputCallback input_callback;
+    ViewCustomCallback custom_callback;
+    ViewNavigationCallback previous_callback;
+    ViewCallback enter_callback;
+    ViewCallback exit_callback;
+    void* context;
+    ViewModelType model_type;
+    void* model;
+    FuriMutex* model_mutex; // ViewModelTypeLocking
+    ViewDispatcher* view_dispatcher; // Redrawn through it while it shows the view
+};
+
+static void view_dispatcher_update(ViewDispatcher* view_dispatcher, View* view);
+
+View* view_alloc(void) {
+    return malloc(sizeof(View));
+}
+
+void view_free(View* view) {
+    furi_check(view->view_dispatcher == NULL);
+    view_free_model(view);
+    free(view);
+}
+
+void view_set_context(View* view, void* context) {
+    view->context = context;
+}
+
+void view_set_draw_callback(View* view, ViewDrawCallback callback) {
+    view->draw_callback = callback;
+}
+
+void view_set_input_callback(View* view, ViewInputCallback callback) {
+    view->input_callback = callback;
+}
+
+void view_set_custom_callback(View* view, ViewCustomCallback callback) {
+    view->custom_callback = callback;
+}
+
+void view_set_previous_callback(View* view, ViewNavigationCallback callback) {
+    view->previous_callback = callback;
+}
+
+void view_set_enter_callback(View* view, ViewCallback callback) {
+    view->enter_callback = callback;
+}
+
+void view_set_exit_callback(View* view, ViewCallback callback) {
+    view->exit_callback = callback;
+}
+
+void view_allocate_model(View* view, ViewModelType type, size_t size) {
+    furi_check(view->model_type == ViewModelTypeNone && type != ViewModelTypeNone);
+    view->model_type = type;
+    view->model = malloc(size);
+    if(type == ViewModelTypeLocking) {
+        view->model_mutex = furi_mutex_alloc(FuriMutexTypeRecursive);
+    }
+}
+
+void view_free_model(View* view) {
+    if(view->model_mutex) {
+        furi_mutex_free(view->model_mutex);
+        view->model_mutex = NULL;
+    }
+    free(view->model);
+    view->model = NULL;
+    view->model_type = ViewModelTypeNone;
+}
+
+void* view_get_model(View* view) {
+    if(view->model_mutex) {
+        furi_check(furi_mutex_acquire(view->model_mutex, FuriWaitForever) == FuriStatusOk);
+    }
+    return view->model;
+}
+
+void view_commit_model(View* view, bool update) {
+    if(view->model_mutex) {
+        furi_check(furi_mutex_release(view->model_mutex) == FuriStatusOk);
+    }
+    if(update && view->view_dispatcher) {
+        view_dispatcher_update(view->view_dispatcher, view);
+    }
+}
+
+// ViewDispatcher
+
+typedef enum {
+    SimGuiEventInput,
+    SimGuiEventCustom,
+    SimGuiEventDraw,
+    SimGuiEventStop,
+} SimGuiEventType;
+
+typedef struct {
+    SimGuiEventType type;
+    InputEvent input;
+    uint32_t custom;
+} SimGuiEvent;
+
+struct ViewDispatcher {
+    FuriMessageQueue* queue;
+    struct {
+        uint32_t id;
+        View* view;
+    } views[SIM_GUI_VIEWS];
+    View* current_view;
+    View* ongoing_input_view;
+    uint32_t ongoing_input; // Bit per key between press and release
+    bool draw_pending;
+    bool attached;
+    void* context;
+    ViewDispatcherCustomEventCallback custom_event_callback;
+    ViewDispatcherNavigationEventCallback navigation_event_callback;
+};
+
+static ViewDispatcher* sim_view_dispatcher; // The one attached to the GUI
+static uint32_t sim_input_sequence;
+
+ViewDispatcher* view_dispatcher_alloc(void) {
+    ViewDispatcher* view_dispatcher = malloc(sizeof(ViewDispatcher));
+    view_dispatcher->queue = furi_message_queue_alloc(SIM_GUI_QUEUE, sizeof(SimGuiEvent));
+    return view_dispatcher;
+}
+
+void view_dispatcher_free(ViewDispatcher* view_dispatcher) {
+    // Like the firmware, every view must have been removed first.
+    for(size_t i = 0; i < SIM_GUI_VIEWS; i++) {
+        furi_check(view_dispatcher->views[i].view == NULL);
+    }
+    if(sim_view_dispatcher == view_dispatcher) {
+        sim_view_dispatcher = NULL;
+    }
+    furi_message_queue_free(view_dispatcher->queue);
+    free(view_dispatcher);
+}
+
+void view_dispatcher_attach_to_gui(
+    ViewDispatcher* view_dispatcher,
+    Gui* gui,
+    ViewDispatcherType type) {
+    UNUSED(gui);
+    UNUSED(type);
+    furi_check(sim_view_dispatcher == NULL);
+    view_dispatcher->attached = true;
+    sim_view_dispatcher = view_dispatcher;
+}
+
+void view_dispatcher_set_event_callback_context(ViewDispatcher* view_dispatcher, void* context) {
+    view_dispatcher->context = context;
+}
+
+void view_dispatcher_set_custom_event_callback(
+    ViewDispatcher* view_dispatcher,
+    ViewDispatcherCustomEventCallback callback) {
+    view_dispatcher->custom_event_callback = callback;
+}
+
+void view_dispatcher_set_navigation_event_callback(
+    ViewDispatcher* view_dispatcher,
+    ViewDispatcherNavigationEventCallback callback) {
+    view_dispatcher->navigation_event_callback = callback;
+}
+
+static void view_dispatcher_post(ViewDispatcher* view_dispatcher, const SimGuiEvent* event) {
+    furi_check(
+        furi_message_queue_put(view_dispatcher->queue, event, FuriWaitForever) == FuriStatusOk);
+}
+
+// Called from any thread; redraws collapse until the frame is drawn.
+static void view_dispatcher_update(ViewDispatcher* view_dispatcher, View* view) {
+    if(view != view_dispatcher->current_view || view_dispatcher->draw_pending) {
+        return;
+    }
+    view_dispatcher->draw_pending = true;
+    SimGuiEvent event = {.type = SimGuiEventDraw};
+    view_dispatcher_post(view_dispatcher, &event);
+}
+
+static View* view_dispatcher_find(ViewDispatcher* view_dispatcher, uint32_t view_id) {
+    for(size_t i = 0; i < SIM_GUI_VIEWS; i++) {
+        if(view_dispatcher->views[i].view && view_dispatcher->views[i].id == view_id) {
+            return view_dispatcher->views[i].view;
+        }
+    }
+    return NULL;
+}
+
+void view_dispatcher_add_view(ViewDispatcher* view_dispatcher, uint32_t view_id, View* view) {
+    furi_check(view_dispatcher_find(view_dispatcher, view_id) == NULL);
+    furi_check(view->view_dispatcher == NULL);
+    size_t i = 0;
+    while(i < SIM_GUI_VIEWS && view_dispatcher->views[i].view) {
+        i++;
+    }
+    furi_check(i < SIM_GUI_VIEWS);
+    view_dispatcher->views[i].id = view_id;
+    view_dispatcher->views[i].view = view;
+    view->view_dispatcher = view_dispatcher;
+}
+
+static void view_dispatcher_set_current_view(ViewDispatcher* view_dispatcher, View* view) {
+    View* previous = view_dispatcher->current_view;
+    if(previous && previous->exit_callback) {
+        previous->exit_callback(previous->context);
+    }
+    view_dispatcher->current_view = view;
+    if(view) {
+        if(view->enter_callback) {
+            view->enter_callback(view->context);
+        }
+        view_dispatcher_update(view_dispatcher, view);
+    }
+}
+
+void view_dispatcher_remove_view(ViewDispatcher* view_dispatcher, uint32_t view_id) {
+    View* view = view_dispatcher_find(view_dispatcher, view_id);
+    furi_check(view);
+    if(view_dispatcher->current_view == view) {
+        view_dispatcher_set_current_view(view_dispatcher, NULL);
+    }
+    if(view_dispatcher->ongoing_input_view == view) {
+        view_dispatcher->ongoing_input_view = NULL;
+        view_dispatcher->ongoing_input = 0;
+    }
+    for(size_t i = 0; i < SIM_GUI_VIEWS; i++) {
+        if(view_dispatcher->views[i].view == view) {
+            view_dispatcher->views[i].view = NULL;
+        }
+    }
+    view->view_dispatcher = NULL;
+}
+
+void view_dispatcher_switch_to_view(ViewDispatcher* view_dispatcher, uint32_t view_id) {
+    View* view = NULL;
+    if(view_id != VIEW_NONE) {
+        view = view_dispatcher_find(view_dispatcher, view_id);
+        furi_check(view);
+    }
+    view_dispatcher_set_current_view(view_dispatcher, view);
+}
+
+void view_dispatcher_send_custom_event(ViewDispatcher* view_dispatcher, uint32_t event) {
+    SimGuiEvent message = {.type = SimGuiEventCustom, .custom = event};
+    view_dispatcher_post(view_dispatcher, &message);
+}
+
+void view_dispatcher_stop(ViewDispatcher* view_dispatcher) {
+    SimGuiEvent event = {.type = SimGuiEventStop};
+    view_dispatcher_post(view_dispatcher, &event);
+}
+
+static void view_dispatcher_draw(ViewDispatcher* view_dispatcher) {
+    view_dispatcher->draw_pending = false;
+    View* view = view_dispatcher->current_view;
+    if(!view) {
+        return;
+    }
+    sim_canvas.length = 0;
+    sim_canvas.text[0] = '\0';
+    if(view->draw_callback) {
+        void* model = view_get_model(view);
+        view->draw_callback(&sim_canvas, model);
+        if(view->model_mutex) {
+            furi_mutex_release(view->model_mutex);
+        }
+    }
+    memcpy(sim_frame, sim_canvas.text, sim_canvas.length + 1);
+    sim_frames++;
+}
+
+static void view_dispatcher_handle_back(ViewDispatcher* view_dispatcher) {
+    View* view = view_dispatcher->current_view;
+    if(view && view->previous_callback) {
+        view_dispatcher_switch_to_view(view_dispatcher, view->previous_callback(view->context));
+        if(view_dispatcher->current_view == NULL) {
+            view_dispatcher_stop(view_dispatcher);
+        }
+        return;
+    }
+    bool consumed = view_dispatcher->navigation_event_callback &&
+                    view_dispatcher->navigation_event_callback(view_dispatcher->context);
+    if(!consumed) {
+        view_dispatcher_stop(view_dispatcher);
+    }
+}
+
+static void view_dispatcher_handle_input(ViewDispatcher* view_dispatcher, InputEvent* event) {
+    uint32_t key_bit = 1U << event->key;
+    if(event->type == InputTypePress) {
+        view_dispatcher->ongoing_input_view = view_dispatcher->current_view;
+        view_dispatcher->ongoing_input |= key_bit;
+    } else if(event->type == InputTypeRelease) {
+        view_dispatcher->ongoing_input &= ~key_bit;
+    } else if(!(view_dispatcher->ongoing_input & key_bit)) {
+        return; // Pressed before the dispatcher saw it
+    }
+
+    View* view = view_dispatcher->current_view;
+    if(view && view == view_dispatcher->ongoing_input_view) {
+        bool consumed = view->input_callback && view->input_callback(event, view->context);
+        if(!consumed && event->key == InputKeyBack && event->type == InputTypeShort) {
+            view_dispatcher_handle_back(view_dispatcher);
+        }
+    } else if(view_dispatcher->ongoing_input_view && event->type == InputTypeRelease) {
+        // The view changed mid-press: it still gets its release, nothing else.
+        View* ongoing = view_dispatcher->ongoing_input_view;
+        if(ongoing->input_callback) {
+            ongoing->input_callback(event, ongoing->context);
+        }
+    }
+    if(view_dispatcher->ongoing_input == 0) {
+        view_dispatcher->ongoing_input_view = NULL;
+    }
+}
+
+static void view_dispatcher_handle_custom(ViewDispatcher* view_dispatcher, uint32_t event) {
+    View* view = view_dispatcher->current_view;
+    bool consumed = view && view->custom_callback && view->custom_callback(event, view->context);
+    if(!consumed && view_dispatcher->custom_event_callback) {
+        view_dispatcher->custom_event_callback(view_dispatcher->context, event);
+    }
+}
+
+void view_dispatcher_run(ViewDispatcher* view_dispatcher) {
+    furi_check(view_dispatcher->attached);
+    view_dispatcher_draw(view_dispatcher); // The GUI draws the first frame on attach
+    SimGuiEvent event;
+    do {
+        furi_check(
+            furi_message_queue_get(view_dispatcher->queue, &event, FuriWaitForever) ==
+            FuriStatusOk);
+        switch(event.type) {
+        case SimGuiEventInput:
+            view_dispatcher_handle_input(view_dispatcher, &event.input);
+            break;
+        case SimGuiEventCustom:
+            view_dispatcher_handle_custom(view_dispatcher, event.custom);
+            break;
+        case SimGuiEventDraw:
+            view_dispatcher_draw(view_dispatcher);
+            break;
+        case SimGuiEventStop:
+            break;
+        }
+    } while(event.type != SimGuiEventStop);
+
+    // Deliver the releases of keys still held, as the firmware does.
+    while(view_dispatcher->ongoing_input &&
+          furi_message_queue_get(view_dispatcher->queue, &event, 0) == FuriStatusOk) {
+        if(event.type == SimGuiEventInput && event.input.type == InputTypeRelease) {
+            view_dispatcher_handle_input(view_dispatcher, &event.input);
+        }
+    }
+}
+
+// Test side
+
+static void sim_gui_input(InputKey key, InputType type) {
+    furi_check(sim_view_dispatcher);
+    SimGuiEvent event = {
+        .type = SimGuiEventInput,
+        .input = {.sequence = ++sim_input_sequence, .key = key, .type = type},
+    };
+    view_dispatcher_post(sim_view_dispatcher, &event);
+}
+
+void sim_gui_press(uint8_t key) {
+    sim_gui_input(key, InputTypePress);
+    sim_gui_input(key, InputTypeShort);
+    sim_gui_input(key, InputTypeRelease);
+}
+
+void sim_gui_long_press(uint8_t key) {
+    sim_gui_input(key, InputTypePress);
+    sim_gui_input(key, InputTypeLong);
+    sim_gui_input(key, InputTypeRelease);
+}
+
+void sim_gui_screen_text(char* out, size_t size) {
+    strlcpy(out, sim_frame, size);
+}
+
+uint32_t sim_gui_frames(void) {
+    return sim_frames;
+}
+
+bool sim_gui_wait_text(const char* text, uint32_t timeout_ms) {
+    uint32_t start = furi_get_tick();
+    while(strstr(sim_frame, text) == NULL) {
+        if(furi_get_tick() - start >= timeout_ms) {
+            return false;
+        }
+        furi_delay_ms(SIM_GUI_POLL_MS);
+    }
+    return true;
+}
+
+// Modules keep their state in the module and a pointer to it as the view model, so the
+// draw callback (which only gets the model) can reach it.
+
+static void* sim_module_alloc_view(View** view, void* module, ViewDrawCallback draw) {
+    *view = view_alloc();
+    view_set_context(*view, module);
+    view_set_draw_callback(*view, draw);
+    view_allocate_model(*view, ViewModelTypeLockFree, sizeof(void*));
+    *(void**)view_get_model(*view) = module;
+    view_commit_model(*view, false);
+    return module;
+}
+
+static void sim_module_update(View* view) {
+    view_get_model(view);
+    view_commit_model(view, true);
+}
+
+// Submenu
+
+typedef struct {
+    char label[SIM_GUI_LABEL];
+    uint32_t index;
+    SubmenuItemCallback callback;
+    void* callback_context;
+} SubmenuItem;
+
+struct Submenu {
+    View* view;
+    SubmenuItem items[SIM_GUI_ITEMS];
+    size_t count;
+    size_t selected;
+};
+
+static void submenu_draw_callback(Canvas* canvas, void* model) {
+    Submenu* submenu = *(Submenu**)model;
+    char line[SIM_GUI_LABEL + 2];
+    for(size_t i = 0; i < submenu->count; i++) {
+        snprintf(
+            line,
+            sizeof(line),
+            "%s%s",
+            i == submenu->selected ? "> " : "  ",
+            submenu->items[i].label);
+        canvas_draw_str(canvas, 0, 0, line);
+    }
+}
+
+static bool submenu_input_callback(InputEvent* event, void* context) {
+    Submenu* submenu = context;
+    if(submenu->count == 0 || (event->type != InputTypeShort && event->type != InputTypeRepeat)) {
+        return false;
+    }
+    switch(event->key) {
+    case InputKeyUp:
+        submenu->selected = (submenu->selected + submenu->count - 1) % submenu->count;
+        break;
+    case InputKeyDown:
+        submenu->selected = (submenu->selected + 1) % submenu->count;
+        break;
+    case InputKeyOk: {
+        SubmenuItem* item = &submenu->items[submenu->selected];
+        if(event->type == InputTypeShort && item->callback) {
+            item->callback(item->callback_context, item->index);
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+    sim_module_update(submenu->view);
+    return true;
+}
+
+Submenu* submenu_alloc(void) {
+    Submenu* submenu = malloc(sizeof(Submenu));
+    sim_module_alloc_view(&submenu->view, submenu, submenu_draw_callback);
+    view_set_input_callback(submenu->view, submenu_input_callback);
+    return submenu;
+}
+
+void submenu_free(Submenu* submenu) {
+    view_free(submenu->view);
+    free(submenu);
+}
+
+View* submenu_get_view(Submenu* submenu) {
+    return submenu->view;
+}
+
+void submenu_add_item(
+    Submenu* submenu,
+    const char* label,
+    uint32_t index,
+    SubmenuItemCallback callback,
+    void* callback_context) {
+    furi_check(submenu->count < SIM_GUI_ITEMS);
+    SubmenuItem* item = &submenu->items[submenu->count++];
+    strlcpy(item->label, label, sizeof(item->label));
+    item->index = index;
+    item->callback = callback;
+    item->callback_context = callback_context;
+    sim_module_update(submenu->view);
+}
+
+void submenu_change_item_label(Submenu* submenu, uint32_t index, const char* label) {
+    for(size_t i = 0; i < submenu->count; i++) {
+        if(submenu->items[i].index == index) {
+            strlcpy(submenu->items[i].label, label, sizeof(submenu->items[i].label));
+        }
+    }
+    sim_module_update(submenu->view);
+}
+
+void submenu_reset(Submenu* submenu) {
+    submenu->count = 0;
+    submenu->selected = 0;
+    sim_module_update(submenu->view);
+}
+
+void submenu_set_selected_item(Submenu* submenu, uint32_t index) {
+    for(size_t i = 0; i < submenu->count; i++) {
+        if(submenu->items[i].index == index) {
+            submenu->selected = i;
+        }
+    }
+    sim_module_update(submenu->view);
+}
+
+// VariableItemList
+
+struct VariableItem {
+    char label[SIM_GUI_LABEL];
+    char value_text[SIM_GUI_LABEL];
+    uint8_t values_count;
+    uint8_t current_value_index;
+    VariableItemChangeCallback change_callback;
+    void* context;
+};
+
+struct VariableItemList {
+    View* view;
+    VariableItem items[SIM_GUI_ITEMS];
+    size_t count;
+    size_t selected;
+    VariableItemListEnterCallback enter_callback;
+    void* enter_context;
+};
+
+static void variable_item_list_draw_callback(Canvas* canvas, void* model) {
+    VariableItemList* list = *(VariableItemList**)model;
+    char line[2 * SIM_GUI_LABEL + 4];
+    for(size_t i = 0; i < list->count; i++) {
+        VariableItem* item = &list->items[i];
+        snprintf(
+            line,
+            sizeof(line),
+            "%s%s: %s",
+            i == list->selected ? "> " : "  ",
+            item->label,
+            item->value_text);
+        canvas_draw_str(canvas, 0, 0, line);
+    }
+}
+
+static bool variable_item_list_input_callback(InputEvent* event, void* context) {
+    VariableItemList* list = context;
+    if(list->count == 0 || (event->type != InputTypeShort && event->type != InputTypeRepeat)) {
+        return false;
+    }
+    VariableItem* item = &list->items[list->selected];
+    switch(event->key) {
+    case InputKeyUp:
+        list->selected = (list->selected + list->count - 1) % list->count;
+        break;
+    case InputKeyDown:
+        list->selected = (list->selected + 1) % list->count;
+        break;
+    case InputKeyLeft:
+    case InputKeyRight: {
+        uint8_t index = item->current_value_index;
+        if(event->key == InputKeyLeft && index > 0) {
+            index--;
+        } else if(event->key == InputKeyRight && index + 1 < item->values_count) {
+            index++;
+        }
+        if(index != item->current_value_index) {
+            item->current_value_index = index;
+            if(item->change_callback) {
+                item->change_callback(item);
+            }
+        }
+        break;
+    }
+    case InputKeyOk:
+        if(event->type == InputTypeShort && list->enter_callback) {
+            list->enter_callback(list->enter_context, list->selected);
+        }
+        return true;
+    default:
+        return false;
+    }
+    sim_module_update(list->view);
+    return true;
+}
+
+VariableItemList* variable_item_list_alloc(void) {
+    VariableItemList* list = malloc(sizeof(VariableItemList));
+    sim_module_alloc_view(&list->view, list, variable_item_list_draw_callback);
+    view_set_input_callback(list->view, variable_item_list_input_callback);
+    return list;
+}
+
+void variable_item_list_free(VariableItemList* variable_item_list) {
+    view_free(variable_item_list->view);
+    free(variable_item_list);
+}
+
+void variable_item_list_reset(VariableItemList* variable_item_list) {
+    variable_item_list->count = 0;
+    variable_item_list->selected = 0;
+    sim_module_update(variable_item_list->view);
+}
+
+View* variable_item_list_get_view(VariableItemList* variable_item_list) {
+    return variable_item_list->view;
+}
+
+VariableItem* variable_item_list_add(
+    VariableItemList* variable_item_list,
+    const char* label,
+    uint8_t values_count,
+    VariableItemChangeCallback change_callback,
+    void* context) {
+    furi_check(variable_item_list->count < SIM_GUI_ITEMS);
+    VariableItem* item = &variable_item_list->items[variable_item_list->count++];
+    memset(item, 0, sizeof(*item));
+    strlcpy(item->label, label, sizeof(item->label));
+    item->values_count = values_count;
+    item->change_callback = change_callback;
+    item->context = context;
+    return item;
+}
+
+void variable_item_list_set_enter_callback(
+    VariableItemList* variable_item_list,
+    VariableItemListEnterCallback callback,
+    void* context) {
+    variable_item_list->enter_callback = callback;
+    variable_item_list->enter_context = context;
+}
+
+void variable_item_set_current_value_index(VariableItem* item, uint8_t current_value_index) {
+    item->current_value_index = current_value_index;
+}
+
+void variable_item_set_values_count(VariableItem* item, uint8_t values_count) {
+    item->values_count = values_count;
+}
+
+void variable_item_set_current_value_text(VariableItem* item, const char* current_value_text) {
+    strlcpy(item->value_text, current_value_text, sizeof(item->value_text));
+}
+
+uint8_t variable_item_get_current_value_index(VariableItem* item) {
+    return item->current_value_index;
+}
+
+void* variable_item_get_context(VariableItem* item) {
+    return item->context;
+}
+
+// TextInput
+
+struct TextInput {
+    View* view;
+    char header[SIM_GUI_LABEL];
+    TextInputCallback callback;
+    void* callback_context;
+    char* text_buffer;
+    size_t text_buffer_size;
+};
+
+static void text_input_draw_callback(Canvas* canvas, void* model) {
+    TextInput* text_input = *(TextInput**)model;
+    canvas_draw_str(canvas, 0, 0, text_input->header);
+    canvas_draw_str(canvas, 0, 0, text_input->text_buffer ? text_input->text_buffer : "");
+}
+
+static bool text_input_input_callback(InputEvent* event, void* context) {
+    TextInput* text_input = context;
+    if(event->key != InputKeyOk) {
+        return false;
+    }
+    if(event->type == InputTypeShort && text_input->callback) {
+        text_input->callback(text_input->callback_context);
+    }
+    return true;
+}
+
+TextInput* text_input_alloc(void) {
+    TextInput* text_input = malloc(sizeof(TextInput));
+    sim_module_alloc_view(&text_input->view, text_input, text_input_draw_callback);
+    view_set_input_callback(text_input->view, text_input_input_callback);
+    return text_input;
+}
+
+void text_input_free(TextInput* text_input) {
+    view_free(text_input->view);
+    free(text_input);
+}
+
+View* text_input_get_view(TextInput* text_input) {
+    return text_input->view;
+}
+
+void text_input_set_header_text(TextInput* text_input, const char* text) {
+    strlcpy(text_input->header, text, sizeof(text_input->header));
+}
+
+void text_input_set_result_callback(
+    TextInput* text_input,
+    TextInputCallback callback,
+    void* callback_context,
+    char* text_buffer,
+    size_t text_buffer_size,
+    bool clear_default_text) {
+    UNUSED(clear_default_text);
+    text_input->callback = callback;
+    text_input->callback_context = callback_context;
+    text_input->text_buffer = text_buffer;
+    text_input->text_buffer_size = text_buffer_size;
+}
+
+bool sim_gui_text_input(const char* text) {
+    View* view = sim_view_dispatcher ? sim_view_dispatcher->current_view : NULL;
+    if(!view || view->draw_callback != text_input_draw_callback) {
+        return false;
+    }
+    TextInput* text_input = view->context;
+    strlcpy(text_input->text_buffer, text, text_input->text_buffer_size);
+    sim_gui_press(InputKeyOk);
+    return true;
+}
+
+// Widget: only text scroll elements, drawn whole.
+
+struct Widget {
+    View* view;
+    char* text;
+};
+
+static void widget_draw_callback(Canvas* canvas, void* model) {
+    Widget* widget = *(Widget**)model;
+    if(widget->text) {
+        canvas_draw_str(canvas, 0, 0, widget->text);
+    }
+}
+
+Widget* widget_alloc(void) {
+    Widget* widget = malloc(sizeof(Widget));
+    sim_module_alloc_view(&widget->view, widget, widget_draw_callback);
+    return widget;
+}
+
+void widget_reset(Widget* widget) {
+    free(widget->text);
+    widget->text = NULL;
+    sim_module_update(widget->view);
+}
+
+void widget_free(Widget* widget) {
+    widget_reset(widget);
+    view_free(widget->view);
+    free(widget);
+}
+
+View* widget_get_view(Widget* widget) {
+    return widget->view;
+}
+
+void widget_add_text_scroll_element(
+    Widget* widget,
+    uint8_t x,
+    uint8_t y,
+    uint8_t width,
+    uint8_t height,
+    const char* text) {
+    UNUSED(x);
+    UNUSED(y);
+    UNUSED(width);
+    UNUSED(height);
+    free(widget->text);
+    widget->text = strdup(text);
+    sim_module_update(widget->view);
+}
+
+// TextBox
+
+struct TextBox {
+    View* view;
+    const char* text;
+};
+
+static void text_box_draw_callback(Canvas* canvas, void* model) {
+    TextBox* text_box = *(TextBox**)model;
+    if(text_box->text) {
+        canvas_draw_str(canvas, 0, 0, text_box->text);
+    }
+}
+
+TextBox* text_box_alloc(void) {
+    TextBox* text_box = malloc(sizeof(TextBox));
+    sim_module_alloc_view(&text_box->view, text_box, text_box_draw_callback);
+    return text_box;
+}
+
+void text_box_free(TextBox* text_box) {
+    view_free(text_box->view);
+    free(text_box);
+}
+
+View* text_box_get_view(TextBox* text_box) {
+    return text_box->view;
+}
+
+void text_box_reset(TextBox* text_box) {
+    text_box->text = NULL;
+    sim_module_update(text_box->view);
+}
+
+void text_box_set_text(TextBox* text_box, const char* text) {
+    text_box->text = text;
+    sim_module_update(text_box->view);
+}
+
+void text_box_set_font(TextBox* text_box, TextBoxFont font) {
+    UNUSED(text_box);
+    UNUSED(font);
+}
@@ -0,0 +1,746 @@
+/*
+ -- sim_hal.c
+ -- Board and HAL stand-ins: SPI, GPIO, UART, timers, PWM, ADC, USB CDC and RTC
+ --
+ -- The GPIO lines, SPI bus and UARTs lead to the module model in sim_dra818.c,
+ -- wired like the board (see dra_port.c).  Everything here runs on the one
+ -- simulated CPU, so no state needs a lock.
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <furi.h>
+#include <furi_hal.h>
+#include <gpio.h>
+#include <spi.h>
+#include <stm32wbxx_ll_lptim.h>
+#include <stm32wbxx_ll_tim.h>
+#include <notification/notification_messages.h>
+#include "sim.h"
+#include "sim_dra818.h"
+
+#define SIM_KERNEL_HZ    64000000ULL // SPI1, TIM1, TIM2 and LPTIM2 clock
+#define SIM_NS_PER_S     1000000000ULL
+#define SIM_GPIO_PINS    10
+#define SIM_RTC_EPOCH    1767225600 // 2026-01-01 00:00:00 UTC
+#define SIM_CDC_PORTS    2
+
+// GPIO, wired like dra_port.c: slot 0 on pins 0-3 and 8, slot 1 on pins 4-7 and 9.
+
+static const struct {
+    uint8_t slot;
+    Dra818Pin pin;
+} sim_board[SIM_GPIO_PINS] = {
+    {0, Dra818PinCs},
+    {0, Dra818PinRst},
+    {0, Dra818PinInt},
+    {0, Dra818PinSq},
+    {1, Dra818PinCs},
+    {1, Dra818PinRst},
+    {1, Dra818PinInt},
+    {1, Dra818PinSq},
+    {0, Dra818PinPd},
+    {1, Dra818PinPd},
+};
+
+static struct {
+    uint32_t mode;
+    bool low; // Lines idle high (pull-ups)
+} sim_gpio[SIM_GPIO_PINS];
+
+void gpio_init(uint16_t pin, uint32_t mode) {
+    furi_check(pin < SIM_GPIO_PINS);
+    sim_gpio[pin].mode = mode;
+}
+
+void gpio_set(uint16_t pin, uint8_t level) {
+    furi_check(pin < SIM_GPIO_PINS);
+    if(sim_gpio[pin].mode != GPIO_MODE_OUTPUT || sim_gpio[pin].low == !level) {
+        return;
+    }
+    sim_gpio[pin].low = !level;
+    sim_dra818_pin_write(sim_board[pin].slot, sim_board[pin].pin, level);
+}
+
+uint8_t gpio_read(uint16_t pin) {
+    furi_check(pin < SIM_GPIO_PINS);
+    return !sim_gpio[pin].low;
+}
+
+static void sim_gpio_exti(void* context, uint32_t pin) {
+    UNUSED(context);
+    HAL_GPIO_EXTI_Callback(pin);
+}
+
+void sim_gpio_drive(uint16_t pin, bool level) {
+    furi_check(pin < SIM_GPIO_PINS);
+    if(sim_gpio[pin].low == !level) {
+        return;
+    }
+    sim_gpio[pin].low = !level;
+    uint32_t mode = sim_gpio[pin].mode;
+    if(mode == GPIO_MODE_IT_RISING_FALLING || (mode == GPIO_MODE_IT_RISING && level) ||
+       (mode == GPIO_MODE_IT_FALLING && !level)) {
+        sim_irq_at(sim_now_ns(), sim_gpio_exti, NULL, pin);
+    }
+}
+
+bool sim_gpio_level(uint16_t pin) {
+    return gpio_read(pin);
+}
+
+static uint16_t sim_board_pin(uint8_t slot, Dra818Pin pin) {
+    for(uint16_t i = 0; i < SIM_GPIO_PINS; i++) {
+        if(sim_board[i].slot == slot && sim_board[i].pin == pin) {
+            return i;
+        }
+    }
+    furi_crash("pin not wired");
+}
+
+void sim_board_drive(uint8_t slot, Dra818Pin pin, bool level) {
+    sim_gpio_drive(sim_board_pin(slot, pin), level);
+}
+
+const GpioPin gpio_ext_pc3 = {.port = NULL, .pin = 3};
+
+void furi_hal_gpio_init(const GpioPin* gpio, GpioMode mode, GpioPull pull, GpioSpeed speed) {
+    UNUSED(gpio);
+    UNUSED(mode);
+    UNUSED(pull);
+    UNUSED(speed);
+}
+
+// SPI: bytes go to every module whose chip select is low; an idle MISO reads 0xFF.
+
+static SimSpiStats sim_spi_stats;
+static uint32_t sim_spi_hz = SIM_KERNEL_HZ / 16;
+static uint32_t sim_spi_fail_count;
+
+static struct {
+    SPI_HandleTypeDef* hspi;
+    uint8_t* tx;
+    uint8_t* rx;
+    uint16_t size;
+    bool failed;
+} sim_spi_dma;
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef* hspi) {
+    sim_spi_hz = SIM_KERNEL_HZ / (2U << (hspi->Init.BaudRatePrescaler >> 3));
+    return HAL_OK;
+}
+
+static void sim_spi_exchange(const uint8_t* tx, uint8_t* rx, size_t size) {
+    for(size_t i = 0; i < size; i++) {
+        uint8_t miso = 0xFF;
+        for(uint8_t slot = 0; slot < DRA818_PORT_SLOTS; slot++) {
+            if(!gpio_read(sim_board_pin(slot, Dra818PinCs))) {
+                miso &= sim_dra818_spi_byte(slot, tx[i], sim_spi_hz);
+            }
+        }
+        rx[i] = miso;
+    }
+}
+
+// Account one transfer; returns its time on the wire and whether it was made to fail.
+static uint64_t sim_spi_account(size_t size, bool* failed) {
+    uint64_t ns = size * 8ULL * SIM_NS_PER_S / sim_spi_hz + SIM_SPI_SETUP_NS;
+    sim_spi_stats.transactions++;
+    sim_spi_stats.bytes += size;
+    sim_spi_stats.bus_ns += ns;
+    sim_spi_stats.hz = sim_spi_hz;
+    *failed = sim_spi_fail_count > 0;
+    if(*failed) {
+        sim_spi_fail_count--;
+        sim_spi_stats.failures++;
+    }
+    return ns;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(
+    SPI_HandleTypeDef* hspi,
+    uint8_t* pTxData,
+    uint8_t* pRxData,
+    uint16_t Size,
+    uint32_t Timeout) {
+    UNUSED(hspi);
+    UNUSED(Timeout);
+    furi_check(!sim_spi_dma.hspi);
+    furi_check(!FURI_IS_IRQ_MODE()); // A polled transfer would stall the interrupt
+    bool failed;
+    uint64_t ns = sim_spi_account(Size, &failed);
+    if(!failed) {
+        sim_spi_exchange(pTxData, pRxData, Size);
+    }
+    sim_sleep_ns(ns); // The HAL polls until the last byte is clocked
+    return failed ? HAL_ERROR : HAL_OK;
+}
+
+static void sim_spi_dma_done(void* context, uint32_t arg) {
+    UNUSED(context);
+    UNUSED(arg);
+    SPI_HandleTypeDef* hspi = sim_spi_dma.hspi;
+    sim_spi_dma.hspi = NULL;
+    if(sim_spi_dma.failed) {
+        HAL_SPI_ErrorCallback(hspi);
+    } else {
+        sim_spi_exchange(sim_spi_dma.tx, sim_spi_dma.rx, sim_spi_dma.size);
+        HAL_SPI_TxRxCpltCallback(hspi);
+    }
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(
+    SPI_HandleTypeDef* hspi,
+    uint8_t* pTxData,
+    uint8_t* pRxData,
+    uint16_t Size) {
+    if(sim_spi_dma.hspi) {
+        return HAL_BUSY;
+    }
+    sim_spi_stats.dma_transactions++;
+    uint64_t ns = sim_spi_account(Size, &sim_spi_dma.failed);
+    sim_spi_dma.hspi = hspi;
+    sim_spi_dma.tx = pTxData;
+    sim_spi_dma.rx = pRxData;
+    sim_spi_dma.size = Size;
+    sim_irq_at(sim_now_ns() + ns, sim_spi_dma_done, NULL, 0);
+    return HAL_OK;
+}
+
+void sim_spi_get_stats(SimSpiStats* stats) {
+    *stats = sim_spi_stats;
+}
+
+void sim_spi_reset_stats(void) {
+    memset(&sim_spi_stats, 0, sizeof(sim_spi_stats));
+}
+
+void sim_spi_fail(uint32_t count) {
+    sim_spi_fail_count = count;
+}
+
+// UART: the Usart leads to slot 0, the Lpuart to slot 1.  Bytes take ten bit times each.
+
+struct FuriHalSerialHandle {
+    FuriHalSerialId id;
+    bool acquired;
+    bool enabled;
+    uint32_t baud;
+    FuriHalSerialAsyncRxCallback callback;
+    void* context;
+    uint8_t rx_byte;
+    uint64_t rx_busy_until; // The last queued reply byte is on the wire until then
+    SimSerialStats stats;
+};
+
+static FuriHalSerialHandle sim_serial[FuriHalSerialIdMax] = {
+    {.id = FuriHalSerialIdUsart, .baud = 9600},
+    {.id = FuriHalSerialIdLpuart, .baud = 9600},
+};
+
+static uint64_t sim_serial_byte_ns(FuriHalSerialHandle* handle) {
+    return 10ULL * SIM_NS_PER_S / handle->baud;
+}
+
+FuriHalSerialHandle* furi_hal_serial_control_acquire(FuriHalSerialId serial_id) {
+    furi_check(serial_id < FuriHalSerialIdMax);
+    FuriHalSerialHandle* handle = &sim_serial[serial_id];
+    if(handle->acquired) {
+        return NULL;
+    }
+    handle->acquired = true;
+    return handle;
+}
+
+void furi_hal_serial_control_release(FuriHalSerialHandle* handle) {
+    furi_check(handle->acquired && !handle->enabled);
+    handle->acquired = false;
+}
+
+void furi_hal_serial_init(FuriHalSerialHandle* handle, uint32_t baud) {
+    furi_check(handle->acquired && baud > 0);
+    handle->baud = baud;
+    handle->enabled = true;
+}
+
+void furi_hal_serial_deinit(FuriHalSerialHandle* handle) {
+    handle->callback = NULL;
+    handle->enabled = false;
+}
+
+void furi_hal_serial_tx(FuriHalSerialHandle* handle, const uint8_t* buffer, size_t buffer_size) {
+    furi_check(handle->enabled);
+    uint64_t ns = buffer_size * sim_serial_byte_ns(handle);
+    handle->stats.tx_bytes += buffer_size;
+    handle->stats.tx_ns += ns;
+    sim_sleep_ns(ns);
+    sim_dra818_uart_receive(handle->id, buffer, buffer_size);
+}
+
+void furi_hal_serial_async_rx_start(
+    FuriHalSerialHandle* handle,
+    FuriHalSerialAsyncRxCallback callback,
+    void* context,
+    bool report_errors) {
+    UNUSED(report_errors);
+    furi_check(handle->enabled && callback);
+    handle->context = context;
+    handle->callback = callback;
+}
+
+void furi_hal_serial_async_rx_stop(FuriHalSerialHandle* handle) {
+    handle->callback = NULL;
+}
+
+uint8_t furi_hal_serial_async_rx(FuriHalSerialHandle* handle) {
+    furi_check(FURI_IS_IRQ_MODE());
+    return handle->rx_byte;
+}
+
+static void sim_serial_rx_irq(void* context, uint32_t byte) {
+    FuriHalSerialHandle* handle = context;
+    if(!handle->enabled || !handle->callback) {
+        return; // Receiver off: the byte is lost
+    }
+    handle->stats.rx_bytes++;
+    handle->rx_byte = byte;
+    handle->callback(handle, FuriHalSerialRxEventData, handle->context);
+}
+
+void sim_serial_reply(uint8_t serial_id, const char* data, size_t size, uint64_t delay_ns) {
+    furi_check(serial_id < FuriHalSerialIdMax);
+    FuriHalSerialHandle* handle = &sim_serial[serial_id];
+    uint64_t at = MAX(sim_now_ns() + delay_ns, handle->rx_busy_until);
+    for(size_t i = 0; i < size; i++) {
+        at += sim_serial_byte_ns(handle);
+        sim_irq_at(at, sim_serial_rx_irq, handle, (uint8_t)data[i]);
+    }
+    handle->rx_busy_until = at;
+}
+
+void sim_serial_get_stats(uint8_t serial_id, SimSerialStats* stats) {
+    furi_check(serial_id < FuriHalSerialIdMax);
+    *stats = sim_serial[serial_id].stats;
+}
+
+// Interrupts and timers.  An enabled counter raises UPDATE every (PSC+1)*(ARR+1) clocks.
+
+static struct {
+    FuriHalInterruptISR isr;
+    void* context;
+} sim_isr[FuriHalInterruptIdMax];
+
+void furi_hal_interrupt_set_isr(FuriHalInterruptId index, FuriHalInterruptISR isr, void* context) {
+    furi_check(index < FuriHalInterruptIdMax);
+    sim_isr[index].isr = isr;
+    sim_isr[index].context = context;
+}
+
+struct TIM_TypeDef {
+    FuriHalInterruptId irq;
+    uint32_t prescaler;
+    uint32_t auto_reload;
+    bool enabled;
+    bool it_update;
+    bool flag_update;
+    uint32_t generation; // Bumped on every start and stop; stale updates are dropped
+    uint64_t start_ns;
+    uint64_t updates;
+};
+
+static TIM_TypeDef sim_tim1 = {.irq = FuriHalInterruptIdTim1UpTim16};
+static TIM_TypeDef sim_tim2 = {.irq = FuriHalInterruptIdTIM2};
+TIM_TypeDef* const TIM1 = &sim_tim1;
+TIM_TypeDef* const TIM2 = &sim_tim2;
+
+static uint64_t sim_tim_update_at(TIM_TypeDef* tim, uint64_t update) {
+    uint64_t clocks = (uint64_t)(tim->prescaler + 1) * (tim->auto_reload + 1);
+    return tim->start_ns + update * clocks * SIM_NS_PER_S / SIM_KERNEL_HZ;
+}
+
+static void sim_tim_update(void* context, uint32_t generation) {
+    TIM_TypeDef* tim = context;
+    if(!tim->enabled || tim->generation != generation) {
+        return;
+    }
+    tim->flag_update = true;
+    if(tim->it_update && sim_isr[tim->irq].isr) {
+        sim_isr[tim->irq].isr(sim_isr[tim->irq].context);
+    }
+    if(tim->enabled && tim->generation == generation) {
+        sim_irq_at(sim_tim_update_at(tim, ++tim->updates), sim_tim_update, tim, generation);
+    }
+}
+
+void LL_TIM_SetPrescaler(TIM_TypeDef* tim, uint32_t prescaler) {
+    tim->prescaler = prescaler;
+}
+
+void LL_TIM_SetAutoReload(TIM_TypeDef* tim, uint32_t auto_reload) {
+    tim->auto_reload = auto_reload;
+}
+
+void LL_TIM_SetCounter(TIM_TypeDef* tim, uint32_t counter) {
+    UNUSED(tim);
+    furi_check(counter == 0); // Only restarts are modelled
+}
+
+void LL_TIM_EnableCounter(TIM_TypeDef* tim) {
+    if(tim->enabled) {
+        return;
+    }
+    tim->enabled = true;
+    tim->generation++;
+    tim->start_ns = sim_now_ns();
+    tim->updates = 1;
+    sim_irq_at(sim_tim_update_at(tim, 1), sim_tim_update, tim, tim->generation);
+}
+
+void LL_TIM_DisableCounter(TIM_TypeDef* tim) {
+    tim->enabled = false;
+    tim->generation++;
+}
+
+void LL_TIM_EnableIT_UPDATE(TIM_TypeDef* tim) {
+    tim->it_update = true;
+}
+
+void LL_TIM_DisableIT_UPDATE(TIM_TypeDef* tim) {
+    tim->it_update = false;
+}
+
+uint32_t LL_TIM_IsActiveFlag_UPDATE(TIM_TypeDef* tim) {
+    return tim->flag_update;
+}
+
+void LL_TIM_ClearFlag_UPDATE(TIM_TypeDef* tim) {
+    tim->flag_update = false;
+}
+
+// PWM: LPTIM2 on PA4 carries the tone; its compare values can be captured.
+
+struct LPTIM_TypeDef {
+    uint32_t auto_reload;
+    uint32_t compare;
+    bool running;
+};
+
+static LPTIM_TypeDef sim_lptim2;
+LPTIM_TypeDef* const LPTIM2 = &sim_lptim2;
+
+static struct {
+    uint32_t* buffer;
+    size_t size;
+    size_t count;
+} sim_pwm;
+
+void furi_hal_pwm_start(FuriHalPwmOutputId channel, uint32_t freq, uint8_t duty) {
+    furi_check(channel == FuriHalPwmOutputIdLptim2PA4 && freq > 0 && duty <= 100);
+    sim_lptim2.auto_reload = SIM_KERNEL_HZ / freq - 1;
+    sim_lptim2.compare = (sim_lptim2.auto_reload + 1) * duty / 100;
+    sim_lptim2.running = true;
+}
+
+void furi_hal_pwm_stop(FuriHalPwmOutputId channel) {
+    furi_check(channel == FuriHalPwmOutputIdLptim2PA4);
+    sim_lptim2.running = false;
+}
+
+bool furi_hal_pwm_is_running(FuriHalPwmOutputId channel) {
+    return channel == FuriHalPwmOutputIdLptim2PA4 && sim_lptim2.running;
+}
+
+void LL_LPTIM_SetCompare(LPTIM_TypeDef* lptim, uint32_t value) {
+    lptim->compare = value;
+    if(lptim == LPTIM2 && sim_pwm.buffer && sim_pwm.count < sim_pwm.size) {
+        sim_pwm.buffer[sim_pwm.count++] = value;
+    }
+}
+
+uint32_t LL_LPTIM_GetAutoReload(LPTIM_TypeDef* lptim) {
+    return lptim->auto_reload;
+}
+
+void sim_pwm_capture(uint32_t* buffer, size_t size) {
+    sim_pwm.buffer = buffer;
+    sim_pwm.size = size;
+    sim_pwm.count = 0;
+}
+
+size_t sim_pwm_captured(void) {
+    return sim_pwm.count;
+}
+
+// Bus clocks
+
+static bool sim_bus[FuriHalBusCount];
+
+void furi_hal_bus_enable(FuriHalBus bus) {
+    furi_check(!sim_bus[bus]); // The HAL crashes on a double enable too
+    sim_bus[bus] = true;
+}
+
+void furi_hal_bus_disable(FuriHalBus bus) {
+    furi_check(sim_bus[bus]);
+    sim_bus[bus] = false;
+}
+
+bool furi_hal_bus_is_enabled(FuriHalBus bus) {
+    return sim_bus[bus];
+}
+
+// ADC
+
+struct FuriHalAdcHandle {
+    bool acquired;
+};
+
+static FuriHalAdcHandle sim_adc;
+static SimAdcSource sim_adc_source;
+static void* sim_adc_context;
+
+FuriHalAdcHandle* furi_hal_adc_acquire(void) {
+    furi_check(!sim_adc.acquired);
+    sim_adc.acquired = true;
+    return &sim_adc;
+}
+
+void furi_hal_adc_release(FuriHalAdcHandle* handle) {
+    furi_check(handle->acquired);
+    handle->acquired = false;
+}
+
+void furi_hal_adc_configure_ex(
+    FuriHalAdcHandle* handle,
+    FuriHalAdcScale scale,
+    FuriHalAdcClock clock,
+    FuriHalAdcOversample oversample,
+    FuriHalAdcSamplingTime sampling_time) {
+    UNUSED(scale);
+    UNUSED(clock);
+    UNUSED(oversample);
+    UNUSED(sampling_time);
+    furi_check(handle->acquired);
+}
+
+uint16_t furi_hal_adc_read(FuriHalAdcHandle* handle, FuriHalAdcChannel channel) {
+    UNUSED(channel);
+    furi_check(handle->acquired);
+    return sim_adc_source ? sim_adc_source(sim_now_ns(), sim_adc_context) : 2048;
+}
+
+void sim_adc_set_source(SimAdcSource source, void* context) {
+    sim_adc_source = source;
+    sim_adc_context = context;
+}
+
+// USB.  A packet from the host that the device has not read holds back the next one.
+
+struct FuriHalUsbInterface {
+    const char* name;
+};
+
+FuriHalUsbInterface usb_cdc_single = {.name = "cdc_single"};
+FuriHalUsbInterface usb_cdc_dual = {.name = "cdc_dual"};
+
+static FuriHalUsbInterface* sim_usb_config = &usb_cdc_single;
+static bool sim_usb_locked;
+static bool sim_usb_fail;
+
+FuriHalUsbInterface* furi_hal_usb_get_config(void) {
+    return sim_usb_config;
+}
+
+bool furi_hal_usb_set_config(FuriHalUsbInterface* new_if, void* ctx) {
+    UNUSED(ctx);
+    if(sim_usb_locked || sim_usb_fail) {
+        return false;
+    }
+    sim_usb_config = new_if;
+    return true;
+}
+
+void furi_hal_usb_lock(void) {
+    sim_usb_locked = true;
+}
+
+void furi_hal_usb_unlock(void) {
+    sim_usb_locked = false;
+}
+
+bool furi_hal_usb_is_locked(void) {
+    return sim_usb_locked;
+}
+
+void sim_usb_fail_set_config(bool fail) {
+    sim_usb_fail = fail;
+}
+
+typedef struct SimUsbPacket {
+    uint8_t data[CDC_DATA_SZ];
+    size_t size;
+    struct SimUsbPacket* next;
+} SimUsbPacket;
+
+static struct {
+    CdcCallbacks* callbacks;
+    void* context;
+    // Host to device
+    SimUsbPacket* out_head; // Sent by the host, not yet taken by the device
+    SimUsbPacket** out_tail;
+    bool out_ready; // out_head has arrived and waits to be read
+    bool out_moving; // out_head is on the wire
+    // Device to host
+    uint64_t in_busy_until;
+    uint8_t* host_fifo;
+    size_t host_fill;
+    size_t host_capacity;
+    uint32_t zlp;
+} sim_cdc[SIM_CDC_PORTS];
+
+#define SIM_USB_HOST_PORT 1 // The dual configuration's second port, used by the host link
+
+void furi_hal_cdc_set_callbacks(uint8_t if_num, CdcCallbacks* cb, void* context) {
+    furi_check(if_num < SIM_CDC_PORTS);
+    sim_cdc[if_num].callbacks = cb;
+    sim_cdc[if_num].context = context;
+}
+
+static void sim_usb_out_arrived(void* context, uint32_t if_num) {
+    UNUSED(context);
+    sim_cdc[if_num].out_moving = false;
+    sim_cdc[if_num].out_ready = true;
+    CdcCallbacks* callbacks = sim_cdc[if_num].callbacks;
+    if(callbacks && callbacks->rx_ep_callback) {
+        callbacks->rx_ep_callback(sim_cdc[if_num].context);
+    }
+}
+
+// Put the next host packet on the wire once the endpoint is free.
+static void sim_usb_out_next(uint8_t if_num) {
+    if(sim_cdc[if_num].out_head && !sim_cdc[if_num].out_ready && !sim_cdc[if_num].out_moving) {
+        sim_cdc[if_num].out_moving = true;
+        sim_irq_at(sim_now_ns() + SIM_USB_PACKET_NS, sim_usb_out_arrived, NULL, if_num);
+    }
+}
+
+int32_t furi_hal_cdc_receive(uint8_t if_num, uint8_t* buf, uint16_t max_len) {
+    furi_check(if_num < SIM_CDC_PORTS);
+    if(!sim_cdc[if_num].out_ready) {
+        return 0;
+    }
+    SimUsbPacket* packet = sim_cdc[if_num].out_head;
+    size_t size = MIN(packet->size, (size_t)max_len);
+    memcpy(buf, packet->data, size);
+    sim_cdc[if_num].out_head = packet->next;
+    sim_cdc[if_num].out_ready = false;
+    (free)(packet);
+    sim_usb_out_next(if_num);
+    return size;
+}
+
+static void sim_usb_in_done(void* context, uint32_t if_num) {
+    SimUsbPacket* packet = context;
+    if(packet->size == 0) {
+        sim_cdc[if_num].zlp++;
+    } else {
+        if(sim_cdc[if_num].host_fill + packet->size > sim_cdc[if_num].host_capacity) {
+            sim_cdc[if_num].host_capacity = MAX(sim_cdc[if_num].host_capacity * 2, 4096U);
+            sim_cdc[if_num].host_fifo =
+                realloc(sim_cdc[if_num].host_fifo, sim_cdc[if_num].host_capacity);
+        }
+        memcpy(&sim_cdc[if_num].host_fifo[sim_cdc[if_num].host_fill], packet->data, packet->size);
+        sim_cdc[if_num].host_fill += packet->size;
+        sim_signal(&sim_cdc[if_num].host_fifo);
+    }
+    (free)(packet);
+    CdcCallbacks* callbacks = sim_cdc[if_num].callbacks;
+    if(callbacks && callbacks->tx_ep_callback) {
+        callbacks->tx_ep_callback(sim_cdc[if_num].context);
+    }
+}
+
+void furi_hal_cdc_send(uint8_t if_num, uint8_t* buf, uint16_t len) {
+    furi_check(if_num < SIM_CDC_PORTS && len <= CDC_DATA_SZ);
+    SimUsbPacket* packet = calloc(1, sizeof(SimUsbPacket));
+    memcpy(packet->data, buf, len);
+    packet->size = len;
+    uint64_t at = MAX(sim_now_ns(), sim_cdc[if_num].in_busy_until) + SIM_USB_PACKET_NS;
+    sim_cdc[if_num].in_busy_until = at;
+    sim_irq_at(at, sim_usb_in_done, packet, if_num);
+}
+
+void sim_usb_host_send(const uint8_t* data, size_t size) {
+    uint8_t if_num = SIM_USB_HOST_PORT;
+    if(!sim_cdc[if_num].out_head) {
+        sim_cdc[if_num].out_tail = &sim_cdc[if_num].out_head;
+    }
+    for(size_t offset = 0; offset < size; offset += CDC_DATA_SZ) {
+        SimUsbPacket* packet = calloc(1, sizeof(SimUsbPacket));
+        packet->size = MIN(size - offset, (size_t)CDC_DATA_SZ);
+        memcpy(packet->data, &data[offset], packet->size);
+        *sim_cdc[if_num].out_tail = packet;
+        sim_cdc[if_num].out_tail = &packet->next;
+    }
+    sim_usb_out_next(if_num);
+}
+
+size_t sim_usb_host_receive(uint8_t* data, size_t size, uint32_t timeout_ms) {
+    uint8_t if_num = SIM_USB_HOST_PORT;
+    uint64_t deadline = sim_now_ns() + timeout_ms * SIM_NS_PER_MS;
+    while(sim_cdc[if_num].host_fill == 0) {
+        if(!sim_wait(&sim_cdc[if_num].host_fifo, deadline)) {
+            return 0;
+        }
+    }
+    size_t taken = MIN(size, sim_cdc[if_num].host_fill);
+    memcpy(data, sim_cdc[if_num].host_fifo, taken);
+    sim_cdc[if_num].host_fill -= taken;
+    memmove(
+        sim_cdc[if_num].host_fifo,
+        &sim_cdc[if_num].host_fifo[taken],
+        sim_cdc[if_num].host_fill);
+    return taken;
+}
+
+size_t sim_usb_host_pending(void) {
+    return sim_cdc[SIM_USB_HOST_PORT].host_fill;
+}
+
+uint32_t sim_usb_zlp_count(void) {
+    return sim_cdc[SIM_USB_HOST_PORT].zlp;
+}
+
+// RTC, random numbers and notifications
+
+void furi_hal_rtc_get_datetime(DateTime* datetime) {
+    time_t now = SIM_RTC_EPOCH + (time_t)(sim_now_ns() / SIM_NS_PER_S);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    datetime->year = tm.tm_year + 1900;
+    datetime->month = tm.tm_mon + 1;
+    datetime->day = tm.tm_mday;
+    datetime->hour = tm.tm_hour;
+    datetime->minute = tm.tm_min;
+    datetime->second = tm.tm_sec;
+    datetime->weekday = (tm.tm_wday + 6) % 7 + 1;
+}
+
+uint32_t furi_hal_random_get(void) {
+    static uint32_t state = 0x2545F491;
+    state = state * 1664525 + 1013904223;
+    return state;
+}
+
+struct NotificationSequence {
+    uint8_t unused;
+};
+
+const NotificationSequence sequence_display_backlight_on = {0};
+const NotificationSequence sequence_display_backlight_enforce_on = {0};
+const NotificationSequence sequence_display_backlight_enforce_auto = {0};
+
+void notification_message(NotificationApp* app, const NotificationSequence* sequence) {
+    UNUSED(app);
+    UNUSED(sequence);
+}
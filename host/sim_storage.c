@@ -0,0 +1,215 @@
+/*
+ -- sim_storage.c
+ -- Storage on a host directory
+ --
+ -- "/ext/x" and "/int/x" live at <root>/ext/x and <root>/int/x.  Files are
+ -- unbuffered descriptors, so what the app wrote is on disk when a call
+ -- returns, as with the SD card.  Storage takes no simulated time unless a
+ -- test sets a write time.  Call sim_storage_root() before the app runs.
+*/
+
+#define _XOPEN_SOURCE 700
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <storage/storage.h>
+#include "sim.h"
+
+#define SIM_STORAGE_PATH 512
+
+static char sim_storage_dir[SIM_STORAGE_PATH] = "sim_storage";
+static uint32_t sim_storage_read_ms;
+static uint32_t sim_storage_write_ms;
+
+struct File {
+    int fd; // -1 while closed
+};
+
+void sim_storage_path(const char* path, char* out, size_t size) {
+    furi_check(strncmp(path, "/ext", 4) == 0 || strncmp(path, "/int", 4) == 0);
+    furi_check(path[4] == '\0' || path[4] == '/');
+    furi_check((size_t)snprintf(out, size, "%s%s", sim_storage_dir, path) < size);
+}
+
+static int sim_storage_remove_entry(
+    const char* path,
+    const struct stat* stat,
+    int type,
+    struct FTW* ftw) {
+    UNUSED(stat);
+    UNUSED(type);
+    return ftw->level > 0 ? remove(path) : 0;
+}
+
+static bool sim_storage_mkdir(const char* host_path) {
+    char dir[SIM_STORAGE_PATH];
+    strlcpy(dir, host_path, sizeof(dir));
+    for(char* slash = strchr(dir + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(dir, 0755);
+        *slash = '/';
+    }
+    return mkdir(dir, 0755) == 0 || errno == EEXIST;
+}
+
+void sim_storage_root(const char* path) {
+    strlcpy(sim_storage_dir, path, sizeof(sim_storage_dir));
+    furi_check(sim_storage_mkdir(sim_storage_dir));
+    nftw(sim_storage_dir, sim_storage_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    // The loader creates the app's data directory before the app starts.
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    furi_check(storage_simply_mkdir(storage, APP_DATA_PATH("")));
+    furi_record_close(RECORD_STORAGE);
+}
+
+File* storage_file_alloc(Storage* storage) {
+    UNUSED(storage);
+    File* file = malloc(sizeof(File));
+    file->fd = -1;
+    return file;
+}
+
+void storage_file_free(File* file) {
+    if(file->fd >= 0) {
+        storage_file_close(file);
+    }
+    free(file);
+}
+
+bool storage_file_open(
+    File* file,
+    const char* path,
+    FS_AccessMode access_mode,
+    FS_OpenMode open_mode) {
+    furi_check(file->fd < 0);
+    char host_path[SIM_STORAGE_PATH];
+    sim_storage_path(path, host_path, sizeof(host_path));
+
+    int flags = access_mode == FSAM_READ_WRITE ? O_RDWR :
+                access_mode == FSAM_WRITE      ? O_WRONLY :
+                                                 O_RDONLY;
+    switch(open_mode) {
+    case FSOM_OPEN_EXISTING:
+        break;
+    case FSOM_OPEN_ALWAYS:
+        flags |= O_CREAT;
+        break;
+    case FSOM_OPEN_APPEND:
+        flags |= O_CREAT | O_APPEND;
+        break;
+    case FSOM_CREATE_NEW:
+        flags |= O_CREAT | O_EXCL;
+        break;
+    case FSOM_CREATE_ALWAYS:
+        flags |= O_CREAT | O_TRUNC;
+        break;
+    }
+    file->fd = open(host_path, flags, 0644);
+    return file->fd >= 0;
+}
+
+bool storage_file_close(File* file) {
+    if(file->fd < 0) {
+        return false;
+    }
+    bool ok = close(file->fd) == 0;
+    file->fd = -1;
+    return ok;
+}
+
+bool storage_file_is_open(File* file) {
+    return file->fd >= 0;
+}
+
+size_t storage_file_read(File* file, void* buff, size_t bytes_to_read) {
+    furi_check(file->fd >= 0);
+    sim_sleep_ns(sim_storage_read_ms * SIM_NS_PER_MS);
+    ssize_t done = read(file->fd, buff, bytes_to_read);
+    return done > 0 ? (size_t)done : 0;
+}
+
+void sim_storage_set_read_ms(uint32_t ms) {
+    sim_storage_read_ms = ms;
+}
+
+void sim_storage_set_write_ms(uint32_t ms) {
+    sim_storage_write_ms = ms;
+}
+
+size_t storage_file_write(File* file, const void* buff, size_t bytes_to_write) {
+    furi_check(file->fd >= 0);
+    sim_sleep_ns(sim_storage_write_ms * SIM_NS_PER_MS);
+    ssize_t done = write(file->fd, buff, bytes_to_write);
+    return done > 0 ? (size_t)done : 0;
+}
+
+bool storage_file_seek(File* file, uint32_t offset, bool from_start) {
+    furi_check(file->fd >= 0);
+    return lseek(file->fd, offset, from_start ? SEEK_SET : SEEK_CUR) >= 0;
+}
+
+uint64_t storage_file_tell(File* file) {
+    furi_check(file->fd >= 0);
+    return lseek(file->fd, 0, SEEK_CUR);
+}
+
+uint64_t storage_file_size(File* file) {
+    furi_check(file->fd >= 0);
+    struct stat st;
+    return fstat(file->fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+bool storage_file_sync(File* file) {
+    furi_check(file->fd >= 0);
+    return true;
+}
+
+bool storage_file_eof(File* file) {
+    return storage_file_tell(file) >= storage_file_size(file);
+}
+
+FS_Error storage_common_remove(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host_path[SIM_STORAGE_PATH];
+    sim_storage_path(path, host_path, sizeof(host_path));
+    if(remove(host_path) == 0) {
+        return FSE_OK;
+    }
+    return errno == ENOENT ? FSE_NOT_EXIST : FSE_DENIED;
+}
+
+// Like the firmware, an existing file at `new_path` is replaced.
+FS_Error storage_common_rename(Storage* storage, const char* old_path, const char* new_path) {
+    UNUSED(storage);
+    char from[SIM_STORAGE_PATH];
+    char to[SIM_STORAGE_PATH];
+    sim_storage_path(old_path, from, sizeof(from));
+    sim_storage_path(new_path, to, sizeof(to));
+    if(rename(from, to) == 0) {
+        return FSE_OK;
+    }
+    return errno == ENOENT ? FSE_INVALID_NAME : FSE_DENIED;
+}
+
+bool storage_file_exists(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host_path[SIM_STORAGE_PATH];
+    sim_storage_path(path, host_path, sizeof(host_path));
+    struct stat st;
+    return stat(host_path, &st) == 0 && S_ISREG(st.st_mode);
+}
+
+bool storage_simply_mkdir(Storage* storage, const char* path) {
+    UNUSED(storage);
+    char host_path[SIM_STORAGE_PATH];
+    sim_storage_path(path, host_path, sizeof(host_path));
+    return sim_storage_mkdir(host_path);
+}
+
+bool storage_simply_remove(Storage* storage, const char* path) {
+    FS_Error error = storage_common_remove(storage, path);
+    return error == FSE_OK || error == FSE_NOT_EXIST;
+}
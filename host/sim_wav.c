@@ -0,0 +1,83 @@
+/*
+ -- sim_wav.c
+ -- PCM WAV files for the demodulator tests
+ --
+ -- Reads 8- or 16-bit PCM, keeps the first channel and converts it to signed
+ -- 16-bit.  Chunks other than "fmt " and "data" are skipped, so files saved
+ -- by audio editors (LIST, fact) load as well.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+static uint32_t sim_wav_u32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t sim_wav_u16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+bool sim_wav_read(const char* path, SimWav* wav) {
+    memset(wav, 0, sizeof(*wav));
+    FILE* file = fopen(path, "rb");
+    if(!file) {
+        return false;
+    }
+
+    uint8_t header[12];
+    uint16_t channels = 0;
+    uint16_t bits = 0;
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+              memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0;
+    while(ok) {
+        uint8_t chunk[8];
+        if(fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk)) {
+            ok = false;
+            break;
+        }
+        uint32_t size = sim_wav_u32(chunk + 4);
+        if(memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t format[16];
+            ok = size >= sizeof(format) && fread(format, 1, sizeof(format), file) == sizeof(format);
+            ok = ok && sim_wav_u16(format) == 1; // PCM
+            channels = sim_wav_u16(format + 2);
+            wav->sample_rate = sim_wav_u32(format + 4);
+            bits = sim_wav_u16(format + 14);
+            ok = ok && channels > 0 && (bits == 8 || bits == 16);
+            ok = ok && fseek(file, (size - sizeof(format)) + (size & 1), SEEK_CUR) == 0;
+        } else if(memcmp(chunk, "data", 4) == 0) {
+            if(!channels) {
+                ok = false; // "fmt " must come first
+                break;
+            }
+            size_t stride = channels * (bits / 8);
+            size_t count = size / stride;
+            uint8_t* data = malloc(count * stride);
+            wav->samples = malloc(count * sizeof(int16_t));
+            ok = data && wav->samples && fread(data, stride, count, file) == count;
+            for(size_t i = 0; ok && i < count; i++) {
+                const uint8_t* p = data + i * stride;
+                wav->samples[i] = bits == 16 ? (int16_t)sim_wav_u16(p) : (p[0] - 128) * 256;
+            }
+            wav->count = count;
+            free(data);
+            break;
+        } else {
+            ok = fseek(file, size + (size & 1), SEEK_CUR) == 0;
+        }
+    }
+    fclose(file);
+
+    if(!ok) {
+        sim_wav_free(wav);
+    }
+    return ok;
+}
+
+void sim_wav_free(SimWav* wav) {
+    free(wav->samples);
+    memset(wav, 0, sizeof(*wav));
+}
@@ -0,0 +1,34 @@
+/*
+ -- test.h
+ -- Checks shared by the host tests
+ --
+ -- A failed check prints where it failed and at what simulated time, and the
+ -- test carries on; test_result() sets the exit code ctest looks at.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "sim.h"
+
+static int test_failures;
+
+#define test_check(x) test_check_at(__FILE__, __LINE__, (x), #x)
+
+static inline void test_check_at(const char* file, int line, bool ok, const char* what) {
+    if(!ok) {
+        printf(
+            "FAIL %s:%d at %llu ms: %s\n",
+            file,
+            line,
+            (unsigned long long)(sim_now_ns() / SIM_NS_PER_MS),
+            what);
+        test_failures++;
+    }
+}
+
+static inline int test_result(const char* name) {
+    printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+    return test_failures ? 1 : 0;
+}
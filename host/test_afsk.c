@@ -0,0 +1,266 @@
+/*
+ -- test_afsk.c
+ -- AFSK1200 modem: modulator into demodulator at each supported RX rate with
+ -- noise added, the FCS and frame limits, a frame sent through the tone
+ -- engine's PWM output and received back through the ADC worker, then the
+ -- WAV captures in vectors/ with the number of frames each must yield.
+ --
+ --   test_afsk <file.wav> <frames>   decodes another capture
+*/
+
+#include <furi.h>
+#include "dra_adc.h"
+#include "dra_afsk.h"
+#include "dra_crc.h"
+#include "test.h"
+
+#define FRAMES     50
+#define FRAME_SIZE 60
+#define BLOCK      256
+#define NOISE      100 // Peak noise added to 12-bit samples
+
+typedef struct {
+    uint8_t expect[FRAME_SIZE];
+    uint32_t good;
+    uint32_t bad; // Passed the FCS but differ from what was sent
+} AfskLog;
+
+static void frame_callback(const uint8_t* frame, size_t size, void* context) {
+    AfskLog* log = context;
+    if(size == FRAME_SIZE && memcmp(frame, log->expect, size) == 0) {
+        log->good++;
+    } else {
+        log->bad++;
+    }
+}
+
+// An APRS position report with a sequence number, so every frame differs.
+static void frame_build(uint8_t* frame, uint32_t sequence) {
+    static const char text[] = "APRS  NOCALL0\x03\xf0!4903.50N/07201.75W-Test 0000 hello";
+    for(size_t i = 0; i < FRAME_SIZE; i++) {
+        frame[i] = text[i % (sizeof(text) - 1)];
+    }
+    for(size_t i = 0; i < 4; i++) {
+        frame[41 + 3 - i] = '0' + sequence % 10;
+        sequence /= 10;
+    }
+}
+
+static uint32_t noise_state = 1;
+
+static int16_t noise(void) {
+    noise_state = noise_state * 1664525 + 1013904223;
+    return (int16_t)((noise_state >> 16) % (2 * NOISE + 1)) - NOISE;
+}
+
+static void test_loopback(uint32_t rate) {
+    static Dra818AfskMod mod;
+    static Dra818AfskDemod demod;
+    static AfskLog log;
+    memset(&log, 0, sizeof(log));
+    dra818_afsk_demod_init(&demod, rate, frame_callback, &log);
+
+    int16_t block[BLOCK];
+    size_t fill = 0;
+    uint32_t samples = 0;
+    uint64_t cpu_ns = 0;
+    for(uint32_t sequence = 0; sequence < FRAMES; sequence++) {
+        frame_build(log.expect, sequence);
+        test_check(dra818_afsk_mod_init(&mod, log.expect, FRAME_SIZE, rate));
+        int16_t sample;
+        bool more = true;
+        while(more) {
+            more = dra818_afsk_mod_next(&mod, &sample);
+            if(more) {
+                block[fill++] = (sample >> 4) + noise(); // Full scale to 12 bits
+            }
+            if(fill == BLOCK || (!more && fill)) {
+                uint64_t start = sim_cpu_ns();
+                dra818_afsk_demod_process(&demod, block, fill);
+                cpu_ns += sim_cpu_ns() - start;
+                samples += fill;
+                fill = 0;
+            }
+        }
+        // The frame is checked before the next one overwrites `expect`.
+        test_check(log.good == sequence + 1);
+    }
+    test_check(log.good == FRAMES && log.bad == 0);
+    test_check(demod.stats.frames == FRAMES && demod.stats.fcs_errors == 0);
+    test_check(demod.stats.samples == samples);
+    printf(
+        "afsk: %lu S/s, %lu/%u frames, %lu FCS errors, %.1f ns per sample\n",
+        (unsigned long)rate,
+        (unsigned long)log.good,
+        FRAMES,
+        (unsigned long)demod.stats.fcs_errors,
+        (double)cpu_ns / samples);
+}
+
+static void test_framing(void) {
+    // The FCS is CRC-16/X.25: check value 0x906E.
+    test_check(dra818_crc16_x25((const uint8_t*)"123456789", 9) == 0x906E);
+
+    static Dra818AfskMod mod;
+    uint8_t frame[DRA818_AFSK_FRAME_MAX + 1] = {0};
+    test_check(!dra818_afsk_mod_init(&mod, frame, DRA818_AFSK_FRAME_MIN - 1, 13200));
+    test_check(!dra818_afsk_mod_init(&mod, frame, DRA818_AFSK_FRAME_MAX + 1, 13200));
+
+    // All ones: the most stuffing a frame can need still fits the bit buffer.
+    memset(frame, 0xFF, sizeof(frame));
+    test_check(dra818_afsk_mod_init(&mod, frame, DRA818_AFSK_FRAME_MAX, 13200));
+    test_check(mod.bit_count <= DRA818_AFSK_TX_BITS_MAX);
+}
+
+// Captures from vectors/make_vectors.py: band-limited, twisted and noisy
+// audio with a baud clock off by up to 1%; two frames in each are damaged.
+typedef struct {
+    const char* name;
+    uint32_t frames;
+} AfskVector;
+
+static const AfskVector afsk_vectors[] = {
+    {"aprs_9600.wav", 20},
+    {"aprs_13200.wav", 20},
+};
+
+// Counts frames that pass the FCS and look like AX.25 UI frames.
+static void wav_callback(const uint8_t* frame, size_t size, void* context) {
+    uint32_t* frames = context;
+    size_t address = 0;
+    while(address < size && !(frame[address] & 1)) {
+        address++;
+    }
+    if(address + 3 <= size && (address + 1) % 7 == 0 && frame[address + 1] == 0x03 &&
+       frame[address + 2] == 0xF0) {
+        (*frames)++;
+    } else {
+        test_check(false);
+    }
+}
+
+static void test_wav(const char* path, uint32_t expect) {
+    SimWav wav;
+    test_check(sim_wav_read(path, &wav));
+    if(!wav.count) {
+        printf("afsk: cannot read %s\n", path);
+        return;
+    }
+    test_check(wav.sample_rate >= 9600 && wav.sample_rate <= 19200);
+
+    static Dra818AfskDemod demod;
+    uint32_t frames = 0;
+    dra818_afsk_demod_init(&demod, wav.sample_rate, wav_callback, &frames);
+    int16_t block[BLOCK];
+    uint64_t cpu_ns = 0;
+    for(size_t i = 0; i < wav.count; i += BLOCK) {
+        size_t count = MIN((size_t)BLOCK, wav.count - i);
+        for(size_t j = 0; j < count; j++) {
+            block[j] = wav.samples[i + j] >> 4; // 16 to 12 bits, as from the ADC
+        }
+        uint64_t start = sim_cpu_ns();
+        dra818_afsk_demod_process(&demod, block, count);
+        cpu_ns += sim_cpu_ns() - start;
+    }
+    test_check(frames == expect);
+    test_check(demod.stats.frames == frames);
+    const char* name = strrchr(path, '/');
+    printf(
+        "afsk: %s, %lu S/s, %lu/%lu frames, %lu FCS errors, %.1f ns per sample\n",
+        name ? name + 1 : path,
+        (unsigned long)wav.sample_rate,
+        (unsigned long)frames,
+        (unsigned long)expect,
+        (unsigned long)demod.stats.fcs_errors,
+        (double)cpu_ns / wav.count);
+    sim_wav_free(&wav);
+}
+
+typedef struct {
+    const uint32_t* capture;
+    size_t count;
+    uint32_t half;
+    uint64_t start_ns;
+} PwmReplay;
+
+// The PWM compare values as the ADC sees them after the RC low-pass, which is
+// roughly a straight line between 8 kHz samples.
+static uint16_t replay_source(uint64_t now_ns, void* context) {
+    PwmReplay* replay = context;
+    uint64_t position = (now_ns - replay->start_ns) * DRA818_TONE_SAMPLE_RATE;
+    size_t index = position / (1000 * SIM_NS_PER_MS);
+    if(index + 1 >= replay->count) {
+        return 2048;
+    }
+    int32_t fraction = (position % (1000 * SIM_NS_PER_MS)) / SIM_NS_PER_MS; // 0..999
+    int32_t a = (int32_t)replay->capture[index] - (int32_t)replay->half;
+    int32_t b = (int32_t)replay->capture[index + 1] - (int32_t)replay->half;
+    return 2048 + a + (b - a) * fraction / 1000;
+}
+
+static void done_callback(bool completed, void* context) {
+    UNUSED(completed);
+    furi_semaphore_release(context);
+}
+
+static void test_over_the_air(void) {
+    static uint32_t capture[DRA818_TONE_SAMPLE_RATE * 2];
+    static AfskLog log;
+    memset(&log, 0, sizeof(log));
+    frame_build(log.expect, 1234);
+
+    FuriSemaphore* done = furi_semaphore_alloc(1, 0);
+    sim_pwm_capture(capture, COUNT_OF(capture));
+    uint64_t start = sim_now_ns();
+    test_check(dra818_afsk_transmit(log.expect, FRAME_SIZE, done_callback, done));
+    test_check(furi_semaphore_acquire(done, 2000) == FuriStatusOk);
+    uint64_t airtime_ms = (sim_now_ns() - start) / SIM_NS_PER_MS;
+    furi_semaphore_free(done);
+    size_t captured = sim_pwm_captured();
+    sim_pwm_capture(NULL, 0);
+
+    // 40 flags of preamble, 62 stuffed bytes, tail: a little over 0.7 s at 1200 bd.
+    test_check(airtime_ms > 700 && airtime_ms < 800);
+    PwmReplay replay = {
+        .capture = capture,
+        .count = captured,
+        .half = capture[0],
+        .start_ns = sim_now_ns(),
+    };
+    sim_adc_set_source(replay_source, &replay);
+    test_check(dra818_afsk_rx_start(frame_callback, &log));
+    test_check(!dra818_afsk_rx_start(frame_callback, &log));
+    furi_delay_ms(airtime_ms + 100);
+    dra818_afsk_rx_stop();
+    sim_adc_set_source(NULL, NULL);
+
+    Dra818AfskStats stats;
+    dra818_afsk_rx_get_stats(&stats);
+    test_check(log.good == 1 && log.bad == 0);
+    test_check(stats.frames == 1 && stats.fcs_errors == 0);
+    test_check(dra818_adc_overruns() == 0);
+    printf(
+        "afsk: %llu ms on air through PWM and ADC, %lu samples received\n",
+        (unsigned long long)airtime_ms,
+        (unsigned long)stats.samples);
+}
+
+int main(int argc, char** argv) {
+    if(argc == 3) {
+        test_wav(argv[1], strtoul(argv[2], NULL, 10));
+        return test_result("afsk");
+    }
+
+    const uint32_t rates[] = {9600, DRA818_AFSK_RX_RATE, 19200};
+    for(size_t i = 0; i < COUNT_OF(rates); i++) {
+        test_loopback(rates[i]);
+    }
+    test_framing();
+    test_over_the_air();
+    for(size_t i = 0; i < COUNT_OF(afsk_vectors); i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", DRA_VECTORS_DIR, afsk_vectors[i].name);
+        test_wav(path, afsk_vectors[i].frames);
+    }
+    return test_result("afsk");
+}
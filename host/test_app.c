@@ -0,0 +1,64 @@
+/*
+ -- test_app.c
+ -- Runs the whole app against the simulator: start, open Play, receive a
+ -- carrier, leave, and check that every allocation was returned.
+*/
+
+#include <stdio.h>
+#include <furi.h>
+#include <gui/view.h>
+#include "sim.h"
+#include "sim_dra818.h"
+
+int32_t main_dra_flipper_app(void* p);
+
+static int failures;
+
+static void check(bool ok, const char* what) {
+    if(!ok) {
+        char screen[512];
+        sim_gui_screen_text(screen, sizeof(screen));
+        printf("FAIL %s at %llu ms, screen:\n%s", what, sim_now_ns() / SIM_NS_PER_MS, screen);
+        failures++;
+    }
+}
+
+int main(void) {
+    sim_storage_root("test_app_storage");
+    size_t heap_before = sim_heap_used();
+
+    FuriThread* thread = furi_thread_alloc_ex("DraFlipper", 4 * 1024, main_dra_flipper_app, NULL);
+    furi_thread_start(thread);
+    check(sim_gui_wait_text("> Config", 100), "menu shown");
+
+    sim_gui_press(InputKeyDown);
+    sim_gui_press(InputKeyOk);
+    check(sim_gui_wait_text("radio: idle", 3000), "radio up");
+    uint64_t ready_ms = sim_now_ns() / SIM_NS_PER_MS;
+
+    // The channel goes out right after the module answers.
+    for(uint32_t i = 0; i < 100 && sim_dra818_rx_freq(0) == 0; i++) {
+        furi_delay_ms(10);
+    }
+    Dra818Freq freq = sim_dra818_rx_freq(0);
+    check(freq != 0, "channel set");
+    sim_dra818_set_signal(0, freq, 120, DRA818_TONE_NONE);
+    check(sim_gui_wait_text("RX rssi: 120", 2000), "carrier shown");
+    sim_dra818_clear_signals(0);
+    check(sim_gui_wait_text("radio: idle", 2000), "carrier gone");
+
+    sim_gui_press(InputKeyBack);
+    check(sim_gui_wait_text("> Play", 1000), "back to menu");
+    sim_gui_press(InputKeyBack);
+    furi_thread_join(thread);
+    check(furi_thread_get_return_code(thread) == 0, "app exit code");
+    furi_thread_free(thread);
+    check(sim_heap_used() == heap_before, "heap returned");
+
+    printf(
+        "app: ready after %llu ms, %lu frames, %s\n",
+        (unsigned long long)ready_ms,
+        (unsigned long)sim_gui_frames(),
+        failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
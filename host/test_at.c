@@ -0,0 +1,240 @@
+/*
+ -- test_at.c
+ -- AT engine against the module model: answers, error codes, timeouts,
+ -- cancellation (of commits too), the queue limit, held commands, and command
+ -- rate and latency at 9600 baud.  The module model sits behind the simulated
+ -- UART rather than a pseudo-terminal, so timings are simulated and repeatable.
+*/
+
+#include <furi.h>
+#include "dra_at.h"
+#include "sim_dra818.h"
+#include "test.h"
+
+#define SLOT          0
+#define RATE_COMMANDS 100
+
+typedef struct {
+    FuriSemaphore* done;
+    Dra818AtResult result;
+    char response[DRA818_AT_LINE_MAX];
+    uint32_t calls;
+    uint64_t at_ns; // Simulated time of the last callback
+} AtWait;
+
+static void at_callback(Dra818AtResult result, const char* response, void* context) {
+    AtWait* wait = context;
+    wait->result = result;
+    strlcpy(wait->response, response, sizeof(wait->response));
+    wait->calls++;
+    wait->at_ns = sim_now_ns();
+    furi_semaphore_release(wait->done);
+}
+
+static Dra818AtResult at_wait(AtWait* wait) {
+    test_check(furi_semaphore_acquire(wait->done, 5000) == FuriStatusOk);
+    return wait->result;
+}
+
+static void test_answers(Dra818At* at, AtWait* wait) {
+    test_check(dra818_at_connect(at, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultOk);
+    test_check(strcmp(wait->response, "+DMOCONNECT:0") == 0);
+
+    Dra818AtGroup group = {
+        .tx_freq = DRA818_FREQ_MHZ(145, 5000),
+        .rx_freq = DRA818_FREQ_MHZ(145, 5000),
+        .squelch = 2,
+    };
+    test_check(dra818_at_set_group(at, &group, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultOk);
+    test_check(sim_dra818_rx_freq(SLOT) == group.rx_freq);
+
+    // "+DMOxxx:1" is a failure code.
+    test_check(
+        dra818_at_submit(at, "AT+DMOSETVOLUME=9", "+DMOSETVOLUME", 1000, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultError);
+    test_check(strcmp(wait->response, "+DMOSETVOLUME:1") == 0);
+    test_check(dra818_at_set_volume(at, 6, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultOk);
+    test_check(sim_dra818_volume(SLOT) == 6);
+
+    uint8_t rssi = 0;
+    sim_dra818_set_signal(SLOT, group.rx_freq, 87, DRA818_TONE_NONE);
+    test_check(dra818_at_read_rssi(at, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultOk);
+    test_check(dra818_at_parse_rssi(wait->response, &rssi) && rssi == 87);
+    sim_dra818_clear_signals(SLOT);
+    test_check(!dra818_at_parse_rssi("+DMOCONNECT:0", &rssi));
+
+    // Lines that do not match the command in flight are skipped.
+    test_check(dra818_at_submit(at, "AT+DMOCONNECT", "+DMOSETVOLUME", 200, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultTimeout);
+}
+
+static void test_timeout(Dra818At* at, AtWait* wait) {
+    SimDra818Config config;
+    sim_dra818_get_config(SLOT, &config);
+    config.mute = true;
+    sim_dra818_set_config(SLOT, &config);
+
+    uint64_t start = sim_now_ns();
+    test_check(dra818_at_submit(at, "AT+DMOCONNECT", "+DMOCONNECT", 150, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultTimeout);
+    test_check(wait->response[0] == '\0');
+    // The timeout runs from when the command starts out, in whole ticks.
+    uint64_t elapsed_ms = (wait->at_ns - start) / SIM_NS_PER_MS;
+    test_check(elapsed_ms >= 149 && elapsed_ms <= 151);
+
+    config.mute = false;
+    sim_dra818_set_config(SLOT, &config);
+    test_check(dra818_at_connect(at, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultOk);
+}
+
+static void test_queue(Dra818At* at, AtWait* wait) {
+    AtWait other = {.done = furi_semaphore_alloc(DRA818_AT_QUEUE_SIZE + 1, 0)};
+    size_t accepted = 0;
+    while(dra818_at_submit(at, "AT+DMOCONNECT", "+DMOCONNECT", 1000, at_callback, &other)) {
+        accepted++;
+        furi_check(accepted <= 2 * DRA818_AT_QUEUE_SIZE);
+    }
+    // The worker has not run yet, so every command is still in the queue.
+    test_check(accepted == DRA818_AT_QUEUE_SIZE);
+    test_check(dra818_at_pending(at) == accepted);
+
+    // Cancelling drops all of them without a callback.
+    dra818_at_cancel(at, &other);
+    test_check(dra818_at_pending(at) == 0);
+    furi_delay_ms(200);
+    test_check(other.calls == 0);
+
+    // Only the cancelled context is dropped.
+    test_check(dra818_at_connect(at, at_callback, &other));
+    test_check(dra818_at_connect(at, at_callback, wait));
+    test_check(dra818_at_connect(at, at_callback, &other));
+    dra818_at_cancel(at, &other);
+    test_check(at_wait(wait) == Dra818AtResultOk);
+    furi_delay_ms(200);
+    test_check(other.calls == 0);
+    furi_semaphore_free(other.done);
+
+    char too_long[DRA818_AT_CMD_MAX];
+    memset(too_long, 'A', sizeof(too_long) - 1);
+    too_long[sizeof(too_long) - 1] = '\0';
+    test_check(!dra818_at_submit(at, too_long, "+X", 1000, at_callback, wait));
+}
+
+// Cancelling with a commit's context: the command in flight still lands in the shadow,
+// the queued one is dropped, and the owner hears nothing.
+static void test_commit_cancel(Dra818At* at, AtWait* wait) {
+    AtWait owner = {.done = furi_semaphore_alloc(1, 0)};
+    Dra818AtGroup group = {
+        .tx_freq = DRA818_FREQ_MHZ(145, 6250),
+        .rx_freq = DRA818_FREQ_MHZ(145, 6250),
+        .squelch = 3,
+    };
+    uint8_t volume = sim_dra818_volume(SLOT);
+    dra818_at_stage_group(at, &group);
+    dra818_at_stage_volume(at, volume == 2 ? 3 : 2);
+    test_check(dra818_at_commit(at, at_callback, &owner));
+    furi_delay_ms(10); // DMOSETGROUP on the wire, DMOSETVOLUME queued
+    dra818_at_cancel(at, &owner);
+    test_check(dra818_at_pending(at) == 1);
+    furi_delay_ms(500);
+    test_check(owner.calls == 0);
+    test_check(sim_dra818_rx_freq(SLOT) == group.rx_freq);
+    test_check(sim_dra818_volume(SLOT) == volume);
+
+    // Only the volume is left to send.
+    test_check(dra818_at_is_dirty(at));
+    test_check(dra818_at_commit(at, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultOk);
+    test_check(sim_dra818_volume(SLOT) != volume);
+    test_check(!dra818_at_is_dirty(at));
+    furi_semaphore_free(owner.done);
+}
+
+// A held DMOSETGROUP goes out without its line ending and waits, untimed, for release.
+static void test_held(Dra818At* at, AtWait* wait) {
+    AtWait held = {.done = furi_semaphore_alloc(1, 0)};
+    Dra818AtGroup group = {
+        .tx_freq = DRA818_FREQ_MHZ(146, 5000),
+        .rx_freq = DRA818_FREQ_MHZ(146, 5000),
+        .squelch = 1,
+    };
+    Dra818Freq before = sim_dra818_rx_freq(SLOT);
+    test_check(before != group.rx_freq);
+    uint32_t calls = wait->calls;
+    test_check(dra818_at_set_group_held(at, &group, at_callback, &held));
+    test_check(dra818_at_connect(at, at_callback, wait));
+    furi_delay_ms(DRA818_AT_TIMEOUT_DEFAULT + 500);
+    test_check(held.calls == 0 && wait->calls == calls);
+    test_check(sim_dra818_rx_freq(SLOT) == before);
+
+    uint64_t start = sim_now_ns();
+    dra818_at_release(at, &held);
+    test_check(at_wait(&held) == Dra818AtResultOk);
+    test_check(sim_dra818_rx_freq(SLOT) == group.rx_freq);
+    // Two bytes of line ending, 25 ms in the module and 15 bytes back.
+    test_check((held.at_ns - start) / SIM_NS_PER_MS < 50);
+    test_check(at_wait(wait) == Dra818AtResultOk);
+
+    // Cancelled, it still gets its line ending so the next command is whole.
+    group.rx_freq = group.tx_freq = DRA818_FREQ_MHZ(146, 5250);
+    test_check(dra818_at_set_group_held(at, &group, at_callback, &held));
+    furi_delay_ms(100);
+    dra818_at_cancel(at, &held);
+    test_check(dra818_at_connect(at, at_callback, wait));
+    test_check(at_wait(wait) == Dra818AtResultOk);
+    test_check(held.calls == 1);
+    test_check(sim_dra818_rx_freq(SLOT) == group.rx_freq);
+    furi_semaphore_free(held.done);
+}
+
+// Commands kept queued back to back, then one at a time from idle.
+static void test_rate(Dra818At* at, AtWait* wait) {
+    AtWait rate = {.done = furi_semaphore_alloc(RATE_COMMANDS, 0)};
+    uint32_t submitted = 0;
+    uint64_t start = sim_now_ns();
+    while(rate.calls < RATE_COMMANDS) {
+        while(submitted < RATE_COMMANDS && dra818_at_connect(at, at_callback, &rate)) {
+            submitted++;
+        }
+        furi_semaphore_acquire(rate.done, FuriWaitForever);
+    }
+    uint64_t elapsed_ns = rate.at_ns - start;
+    furi_semaphore_free(rate.done);
+
+    uint64_t worst_ns = 0;
+    for(uint32_t i = 0; i < 10; i++) {
+        start = sim_now_ns();
+        test_check(dra818_at_connect(at, at_callback, wait));
+        test_check(at_wait(wait) == Dra818AtResultOk);
+        worst_ns = MAX(worst_ns, wait->at_ns - start);
+    }
+
+    // 15 bytes out, 5 ms in the module, 15 bytes back: about 36 ms per command.
+    double per_second = RATE_COMMANDS * 1e9 / elapsed_ns;
+    printf("at: %.1f commands/s pipelined, worst latency %.1f ms\n", per_second, worst_ns / 1e6);
+    test_check(per_second > 26.0 && per_second < 29.0);
+    test_check(worst_ns < 40 * SIM_NS_PER_MS);
+}
+
+int main(void) {
+    Dra818At* at = dra818_at_alloc(FuriHalSerialIdUsart, DRA818_AT_BAUD);
+    test_check(at != NULL);
+    test_check(dra818_at_alloc(FuriHalSerialIdUsart, DRA818_AT_BAUD) == NULL);
+    AtWait wait = {.done = furi_semaphore_alloc(1, 0)};
+
+    test_answers(at, &wait);
+    test_timeout(at, &wait);
+    test_queue(at, &wait);
+    test_held(at, &wait);
+    test_commit_cancel(at, &wait);
+    test_rate(at, &wait);
+
+    furi_semaphore_free(wait.done);
+    dra818_at_free(at);
+    return test_result("at");
+}
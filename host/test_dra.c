@@ -0,0 +1,192 @@
+/*
+ -- test_dra.c
+ -- Register transfers: frames and chip-select cycles per operation, the read
+ -- flag, the shadow cache and the DMA path, checked against the module model.
+*/
+
+#include <furi.h>
+#include "dra.h"
+#include "sim_dra818.h"
+#include "test.h"
+
+#define SLOT 0
+
+static const uint8_t defaults[] = {0x57, 0x80, 0x02, 0x0F, 0x00};
+
+static uint32_t frames_since(const SimSpiStats* before) {
+    SimSpiStats now;
+    sim_spi_get_stats(&now);
+    return now.transactions - before->transactions;
+}
+
+static uint32_t cs_cycles(void) {
+    SimDra818Stats stats;
+    sim_dra818_get_stats(SLOT, &stats);
+    return stats.frames;
+}
+
+static void test_init_frames(Dra818* dra) {
+    // One register at a time: a frame and a CS cycle for each default register.
+    SimSpiStats before;
+    sim_spi_get_stats(&before);
+    uint32_t cs = cs_cycles();
+    for(uint8_t reg = 0; reg < COUNT_OF(defaults); reg++) {
+        dra818_write(dra, reg, defaults[reg]);
+    }
+    test_check(frames_since(&before) == 5);
+    test_check(cs_cycles() - cs == 5);
+
+    // Init writes them as one burst once the module is out of reset.
+    Dra818InitConfig config = {
+        .reset_ms = DRA818_RESET_MS,
+        .boot_ms = DRA818_BOOT_MS,
+        .probe_interval_ms = DRA818_PROBE_INTERVAL_MS,
+        .probe_timeout_ms = DRA818_PROBE_TIMEOUT_MS,
+    };
+    test_check(dra818_init_async(dra, &config, NULL, NULL));
+    furi_delay_ms(DRA818_RESET_MS + DRA818_BOOT_MS + 1);
+    sim_spi_get_stats(&before);
+    cs = cs_cycles();
+    test_check(dra818_init_configure(dra));
+    test_check(frames_since(&before) == 1);
+    test_check(cs_cycles() - cs == 1);
+    for(uint8_t reg = 0; reg < COUNT_OF(defaults); reg++) {
+        test_check(sim_dra818_reg(SLOT, reg) == defaults[reg]);
+    }
+}
+
+static void test_bursts(Dra818* dra) {
+    SimSpiStats before;
+    uint8_t values[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    sim_spi_get_stats(&before);
+    test_check(dra818_write_burst(dra, 0x06, values, sizeof(values)));
+    test_check(frames_since(&before) == 1);
+    for(uint8_t i = 0; i < sizeof(values); i++) {
+        test_check(sim_dra818_reg(SLOT, 0x06 + i) == values[i]);
+    }
+
+    Dra818RegValue list[] = {{0x02, 0xA2}, {0x09, 0xA9}, {0x04, 0xA4}};
+    sim_spi_get_stats(&before);
+    test_check(dra818_write_list(dra, list, COUNT_OF(list)));
+    test_check(frames_since(&before) == 1);
+    for(size_t i = 0; i < COUNT_OF(list); i++) {
+        test_check(sim_dra818_reg(SLOT, list[i].reg) == list[i].value);
+    }
+
+    // Reads carry DRA818_REG_READ: the dummy bytes must not overwrite the registers.
+    uint8_t read[8];
+    sim_spi_get_stats(&before);
+    test_check(dra818_read_burst(dra, 0x06, read, sizeof(read)));
+    test_check(frames_since(&before) == 1);
+    test_check(read[3] == 0xA9 && read[0] == 1 && read[7] == 8);
+    test_check(sim_dra818_reg(SLOT, 0x09) == 0xA9);
+
+    dra818_invalidate(dra);
+    test_check(dra818_read(dra, 0x02) == 0xA2);
+    test_check(sim_dra818_reg(SLOT, 0x02) == 0xA2);
+    test_check(!dra818_write_burst(dra, 0, values, 0));
+    test_check(!dra818_read_burst(dra, 0, read, DRA818_BURST_MAX + 1));
+}
+
+static void test_shadow(Dra818* dra) {
+    SimSpiStats before;
+    test_check(dra818_resync(dra));
+
+    sim_spi_get_stats(&before);
+    for(uint8_t reg = 0; reg < DRA818_REG_COUNT; reg++) {
+        test_check(dra818_read(dra, reg) == sim_dra818_reg(SLOT, reg));
+    }
+    dra818_write(dra, 0x02, sim_dra818_reg(SLOT, 0x02));
+    test_check(frames_since(&before) == 0);
+
+    dra818_write(dra, 0x02, 0x33);
+    test_check(frames_since(&before) == 1);
+    test_check(sim_dra818_reg(SLOT, 0x02) == 0x33);
+
+    // Two registers far apart: address/value pairs (4 bytes) beat a 10-byte burst.
+    SimSpiStats after;
+    sim_spi_get_stats(&before);
+    dra818_set(dra, 0x01, 0x11);
+    dra818_set(dra, 0x09, 0x19);
+    test_check(dra818_is_dirty(dra));
+    test_check(frames_since(&before) == 0);
+    test_check(dra818_commit(dra));
+    sim_spi_get_stats(&after);
+    test_check(after.transactions - before.transactions == 1);
+    test_check(after.bytes - before.bytes == 4);
+    test_check(!dra818_is_dirty(dra));
+    test_check(sim_dra818_reg(SLOT, 0x01) == 0x11 && sim_dra818_reg(SLOT, 0x09) == 0x19);
+
+    // A contiguous range goes as one burst.
+    sim_spi_get_stats(&before);
+    for(uint8_t reg = 0; reg < 4; reg++) {
+        dra818_set(dra, reg, 0x40 + reg);
+    }
+    test_check(dra818_commit(dra));
+    sim_spi_get_stats(&after);
+    test_check(after.transactions - before.transactions == 1);
+    test_check(after.bytes - before.bytes == 5);
+    test_check(sim_dra818_reg(SLOT, 0x03) == 0x43);
+
+    // A failed frame leaves the change staged.
+    sim_spi_fail(1);
+    dra818_set(dra, 0x05, 0x55);
+    test_check(!dra818_commit(dra));
+    test_check(dra818_is_dirty(dra));
+    test_check(dra818_commit(dra));
+    test_check(sim_dra818_reg(SLOT, 0x05) == 0x55);
+}
+
+typedef struct {
+    FuriSemaphore* done;
+    bool success;
+    bool in_irq;
+} DmaWait;
+
+static void dma_callback(bool success, void* context) {
+    DmaWait* wait = context;
+    wait->success = success;
+    wait->in_irq = FURI_IS_IRQ_MODE();
+    furi_semaphore_release(wait->done);
+}
+
+static void test_dma(Dra818* dra) {
+    DmaWait wait = {.done = furi_semaphore_alloc(1, 0)};
+    uint8_t values[6] = {0x61, 0x62, 0x63, 0x64, 0x65, 0x66};
+    uint64_t start = sim_now_ns();
+    test_check(dra818_write_burst_dma(dra, 0x0A, values, sizeof(values), dma_callback, &wait));
+    test_check(sim_now_ns() == start); // Returned before the frame went out
+    test_check(dra818_dma_busy(dra));
+    test_check(!dra818_write_burst(dra, 0x0A, values, 1)); // The bus is still ours
+    furi_semaphore_acquire(wait.done, FuriWaitForever);
+    test_check(wait.success && wait.in_irq);
+    test_check(!dra818_dma_busy(dra));
+    test_check(sim_dra818_reg(SLOT, 0x0C) == 0x63);
+
+    uint8_t read[6] = {0};
+    test_check(dra818_read_burst_dma(dra, 0x0A, read, sizeof(read), dma_callback, &wait));
+    furi_semaphore_acquire(wait.done, FuriWaitForever);
+    test_check(wait.success && memcmp(read, values, sizeof(values)) == 0);
+    test_check(sim_dra818_reg(SLOT, 0x0A) == 0x61);
+
+    sim_spi_fail(1);
+    test_check(dra818_read_burst_dma(dra, 0x0A, read, sizeof(read), dma_callback, &wait));
+    furi_semaphore_acquire(wait.done, FuriWaitForever);
+    test_check(!wait.success);
+    test_check(!dra818_dma_busy(dra));
+    furi_semaphore_free(wait.done);
+}
+
+int main(void) {
+    Dra818Bus* bus = dra818_bus_alloc();
+    Dra818* dra = dra818_alloc(bus, SLOT);
+
+    test_init_frames(dra);
+    test_bursts(dra);
+    test_shadow(dra);
+    test_dma(dra);
+
+    dra818_free(dra);
+    dra818_bus_free(bus);
+    return test_result("dra");
+}
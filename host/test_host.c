@@ -0,0 +1,574 @@
+/*
+ -- test_host.c
+ -- Host control protocol: framing, CRC and resync, the USB port switch-over,
+ -- then the service over the simulated CDC link: ping round trips, pipelined
+ -- throughput, a bulk memory upload and download, the status stream and
+ -- passthrough to the module.
+*/
+
+#include <furi.h>
+#include <furi_hal_usb.h>
+#include <storage/storage.h>
+#include "dra_crc.h"
+#include "dra_host.h"
+#include "sim_dra818.h"
+#include "test.h"
+
+#define SLOT         0
+#define FRAMES_MAX   512
+#define PINGS        200
+#define MEMORIES     2000
+#define MEMORIES_DIR APP_DATA_PATH("memories")
+#define UPLOAD_PATH  APP_DATA_PATH("upload.csv")
+
+typedef struct {
+    uint8_t seq;
+    uint8_t cmd;
+    uint8_t payload[DRA818_HOST_PAYLOAD_MAX];
+    size_t size;
+} Frame;
+
+static Frame frames[FRAMES_MAX];
+static size_t frame_count;
+static Dra818HostParser parser;
+
+static void frame_callback(
+    uint8_t seq,
+    uint8_t cmd,
+    const uint8_t* payload,
+    size_t size,
+    void* context) {
+    UNUSED(context);
+    if(frame_count < FRAMES_MAX) {
+        Frame* frame = &frames[frame_count];
+        frame->seq = seq;
+        frame->cmd = cmd;
+        memcpy(frame->payload, payload, size);
+        frame->size = size;
+    }
+    frame_count++;
+}
+
+static void test_frames(void) {
+    const uint8_t check[] = "123456789";
+    test_check(dra818_crc16_ccitt(DRA818_CRC16_INIT, check, 9) == 0x29B1);
+    test_check(dra818_crc16_x25(check, 9) == 0x906E);
+
+    // Garbage, a frame with a bad CRC, an impossible length, then two good frames
+    // fed a byte at a time.
+    uint8_t stream[3 * DRA818_HOST_FRAME_MAX];
+    size_t fill = 0;
+    const uint8_t garbage[] = {0x00, 0x13, 0x37, 0xFF};
+    memcpy(stream, garbage, sizeof(garbage));
+    fill += sizeof(garbage);
+    size_t bad = dra818_host_frame(stream + fill, 1, Dra818HostCmdPing, check, 9);
+    stream[fill + 6] ^= 0x01;
+    fill += bad;
+    const uint8_t too_long[] = {DRA818_HOST_SYNC, 0xFF, 0xFF, 0x00};
+    memcpy(stream + fill, too_long, sizeof(too_long));
+    fill += sizeof(too_long);
+    fill += dra818_host_frame(stream + fill, 2, Dra818HostCmdInfo, NULL, 0);
+    uint8_t big[DRA818_HOST_PAYLOAD_MAX];
+    for(size_t i = 0; i < sizeof(big); i++) {
+        big[i] = i == 0 ? DRA818_HOST_SYNC : i;
+    }
+    fill += dra818_host_frame(stream + fill, 3, Dra818HostCmdPing, big, sizeof(big));
+
+    dra818_host_parser_reset(&parser);
+    frame_count = 0;
+    for(size_t i = 0; i < fill; i++) {
+        dra818_host_parse(&parser, &stream[i], 1, frame_callback, NULL);
+    }
+    test_check(frame_count == 2);
+    test_check(frames[0].seq == 2 && frames[0].cmd == Dra818HostCmdInfo && !frames[0].size);
+    test_check(frames[1].seq == 3 && frames[1].size == sizeof(big));
+    test_check(memcmp(frames[1].payload, big, sizeof(big)) == 0);
+    test_check(parser.stats.frames == 2 && parser.stats.crc_errors == 2);
+    test_check(parser.stats.skipped == sizeof(garbage) + bad - 1 + sizeof(too_long) - 1);
+
+    // The same stream in one go.
+    dra818_host_parser_reset(&parser);
+    frame_count = 0;
+    dra818_host_parse(&parser, stream, fill, frame_callback, NULL);
+    test_check(frame_count == 2 && parser.stats.crc_errors == 2);
+
+    Dra818Memory memory = {
+        .number = 77,
+        .rx_freq = DRA818_FREQ_MHZ(146, 940),
+        .tx_freq = DRA818_FREQ_MHZ(146, 3400),
+        .rx_tone = DRA818_TONE_DCS_I(0754),
+        .tx_tone = 12,
+        .bank = 3,
+        .wide = true,
+        .name = "Wire \"test\", 1",
+    };
+    uint8_t wire[DRA818_HOST_MEM_RECORD];
+    Dra818Memory back;
+    dra818_host_put_memory(wire, &memory);
+    dra818_host_take_memory(wire, &back);
+    test_check(memcmp(&memory, &back, sizeof(memory)) == 0);
+}
+
+static void test_link(void) {
+    // The USB configuration is put back the way it was, lock included.
+    furi_hal_usb_lock();
+    sim_usb_fail_set_config(true);
+    Dra818HostConfig config = {0};
+    test_check(dra818_host_alloc(&config) == NULL);
+    sim_usb_fail_set_config(false);
+    test_check(furi_hal_usb_get_config() == &usb_cdc_single && furi_hal_usb_is_locked());
+
+    Dra818Host* host = dra818_host_alloc(&config);
+    test_check(host && furi_hal_usb_get_config() == &usb_cdc_dual);
+    dra818_host_free(host);
+    test_check(furi_hal_usb_get_config() == &usb_cdc_single && furi_hal_usb_is_locked());
+    furi_hal_usb_unlock();
+}
+
+static Dra818Host* service;
+static volatile bool radio_ready;
+static const char* volatile import_path;
+
+static void radio_callback(const Dra818RadioEvent* event, void* context) {
+    UNUSED(context);
+    if(event->type == Dra818RadioEventReady) {
+        radio_ready = true;
+    } else if(event->type == Dra818RadioEventPass) {
+        dra818_host_pass_done(service, event->value, &event->pass);
+    }
+}
+
+// Runs on the service thread; the test imports once the commit is answered.
+static bool import_callback(const char* csv_path, void* context) {
+    UNUSED(context);
+    import_path = csv_path;
+    return true;
+}
+
+static size_t request_build(
+    uint8_t* out,
+    uint8_t seq,
+    uint8_t cmd,
+    const void* payload,
+    size_t size) {
+    return dra818_host_frame(out, seq, cmd, payload, size);
+}
+
+static void request(uint8_t seq, uint8_t cmd, const void* payload, size_t size) {
+    uint8_t frame[DRA818_HOST_FRAME_MAX];
+    sim_usb_host_send(frame, request_build(frame, seq, cmd, payload, size));
+}
+
+// Reads until `count` frames have come in, or nothing does for `timeout_ms`.
+static bool receive(size_t count, uint32_t timeout_ms) {
+    uint8_t data[256];
+    while(frame_count < count) {
+        size_t size = sim_usb_host_receive(data, sizeof(data), timeout_ms);
+        if(size == 0) {
+            return false;
+        }
+        dra818_host_parse(&parser, data, size, frame_callback, NULL);
+    }
+    return frame_count == count;
+}
+
+// One request and its response, which must be Ok.
+static Frame* exchange(uint8_t seq, uint8_t cmd, const void* payload, size_t size) {
+    frame_count = 0;
+    request(seq, cmd, payload, size);
+    bool ok = receive(1, 1000);
+    test_check(ok && frames[0].seq == seq && frames[0].cmd == (cmd | DRA818_HOST_RESPONSE));
+    test_check(frames[0].size > 0 && frames[0].payload[0] == Dra818HostResultOk);
+    return &frames[0];
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void test_ping(void) {
+    static const size_t sizes[] = {16, 250};
+    for(size_t s = 0; s < COUNT_OF(sizes); s++) {
+        static uint64_t rtt[100];
+        uint8_t payload[250];
+        for(size_t i = 0; i < COUNT_OF(rtt); i++) {
+            memset(payload, i, sizes[s]);
+            uint64_t start = sim_now_ns();
+            Frame* frame = exchange(i, Dra818HostCmdPing, payload, sizes[s]);
+            rtt[i] = sim_now_ns() - start;
+            test_check(frame->size == sizes[s] + 1);
+            test_check(memcmp(frame->payload + 1, payload, sizes[s]) == 0);
+        }
+        qsort(rtt, COUNT_OF(rtt), sizeof(rtt[0]), compare_u64);
+        // A packet each way at the least, SIM_USB_PACKET_NS apiece.
+        size_t packets = 2 * ((sizes[s] + DRA818_HOST_OVERHEAD + 1) / 64 + 1);
+        test_check(rtt[0] >= packets * SIM_USB_PACKET_NS);
+        test_check(rtt[COUNT_OF(rtt) - 1] < 5 * SIM_NS_PER_MS);
+        printf(
+            "host: ping %u B round trip p50 %llu us, max %llu us\n",
+            (unsigned)sizes[s],
+            (unsigned long long)rtt[COUNT_OF(rtt) / 2] / 1000,
+            (unsigned long long)rtt[COUNT_OF(rtt) - 1] / 1000);
+    }
+
+    // A response of exactly one packet needs a zero-length packet to end the transfer.
+    uint8_t payload[64 - DRA818_HOST_OVERHEAD - 1] = {0};
+    uint32_t zlp = sim_usb_zlp_count();
+    exchange(1, Dra818HostCmdPing, payload, sizeof(payload));
+    furi_delay_ms(1);
+    test_check(sim_usb_zlp_count() == zlp + 1);
+}
+
+static void test_pipelined(void) {
+    static const size_t sizes[] = {16, 250};
+    static uint8_t stream[PINGS * DRA818_HOST_FRAME_MAX];
+    for(size_t s = 0; s < COUNT_OF(sizes); s++) {
+        uint8_t payload[250];
+        size_t fill = 0;
+        for(size_t i = 0; i < PINGS; i++) {
+            memset(payload, i, sizes[s]);
+            fill += request_build(stream + fill, i, Dra818HostCmdPing, payload, sizes[s]);
+        }
+        Dra818HostStats before, after;
+        dra818_host_get_stats(service, &before);
+        frame_count = 0;
+        uint64_t start = sim_now_ns();
+        sim_usb_host_send(stream, fill);
+        test_check(receive(PINGS, 1000));
+        uint64_t elapsed = sim_now_ns() - start;
+        furi_delay_ms(1);
+        dra818_host_get_stats(service, &after);
+
+        uint32_t wrong = 0;
+        for(size_t i = 0; i < PINGS; i++) {
+            wrong += frames[i].seq != (uint8_t)i || frames[i].size != sizes[s] + 1 ||
+                     frames[i].payload[1] != (uint8_t)i;
+        }
+        test_check(wrong == 0);
+        // Small requests arrive several to a packet and their responses go out together;
+        // large ones arrive slower than they are answered.
+        uint32_t transfers = after.transfers - before.transfers;
+        test_check(sizes[s] > 64 || (transfers < PINGS / 2 && after.batch_max > 1));
+        double frames_per_s = PINGS * 1e9 / elapsed;
+        double bytes_per_s = frames_per_s * (sizes[s] + DRA818_HOST_OVERHEAD);
+        printf(
+            "host: %u pipelined %u B pings, %.0f frames/s, %.0f KB/s each way, %lu transfers\n",
+            PINGS,
+            (unsigned)sizes[s],
+            frames_per_s,
+            bytes_per_s / 1024,
+            (unsigned long)transfers);
+        // At least a quarter of the packet rate each way.
+        test_check(bytes_per_s > 64 * 1e9 / SIM_USB_PACKET_NS / 4);
+    }
+}
+
+static void make_memory(Dra818Memory* memory, uint32_t i) {
+    memset(memory, 0, sizeof(Dra818Memory));
+    memory->number = i;
+    bool uhf = i % 2;
+    memory->rx_freq = uhf ? DRA818_FREQ_MHZ(440, 0) + (i % 800) * DRA818_STEP_NARROW :
+                            DRA818_FREQ_MHZ(145, 0) + (i % 160) * DRA818_STEP_NARROW;
+    memory->tx_freq = memory->rx_freq - (i % 3 == 0 ? 0 : uhf ? DRA818_FREQ_MHZ(5, 0) : 6000);
+    if(i % 5 == 1) {
+        memory->tx_tone = 1 + i % DRA818_CTCSS_COUNT;
+        memory->rx_tone = memory->tx_tone;
+    } else if(i % 5 == 2) {
+        memory->tx_tone = DRA818_TONE_DCS(dra818_dcs_codes[i % DRA818_DCS_COUNT]);
+        memory->rx_tone = DRA818_TONE_DCS_I(dra818_dcs_codes[i % DRA818_DCS_COUNT]);
+    }
+    memory->bank = i % 4;
+    memory->wide = i % 7 != 0;
+    if(i % 10 == 0) {
+        snprintf(memory->name, sizeof(memory->name), "Club \"%lu\", west", (unsigned long)i);
+    } else {
+        snprintf(memory->name, sizeof(memory->name), "MEM%04lu", (unsigned long)i);
+    }
+}
+
+static bool memory_equal(const Dra818Memory* a, const Dra818Memory* b) {
+    return a->number == b->number && a->rx_freq == b->rx_freq && a->tx_freq == b->tx_freq &&
+           a->rx_tone == b->rx_tone && a->tx_tone == b->tx_tone && a->bank == b->bank &&
+           a->wide == b->wide && strcmp(a->name, b->name) == 0;
+}
+
+static void test_bank(void) {
+    Frame* frame = exchange(1, Dra818HostCmdInfo, NULL, 0);
+    test_check(frame->size == 8 && frame->payload[1] == DRA818_HOST_VERSION);
+    test_check((frame->payload[2] | frame->payload[3] << 8) == DRA818_HOST_PAYLOAD_MAX);
+
+    // Data before a begin, and a memory with a tone the module does not have.
+    static uint8_t stream[(MEMORIES / DRA818_HOST_MEM_PER_FRAME + 2) * DRA818_HOST_FRAME_MAX];
+    uint8_t payload[DRA818_HOST_MEM_PER_FRAME * DRA818_HOST_MEM_RECORD];
+    Dra818Memory memory;
+    make_memory(&memory, 0);
+    dra818_host_put_memory(payload, &memory);
+    frame_count = 0;
+    request(2, Dra818HostCmdUploadData, payload, DRA818_HOST_MEM_RECORD);
+    test_check(receive(1, 1000) && frames[0].payload[0] == Dra818HostResultBadRequest);
+    exchange(3, Dra818HostCmdUploadBegin, NULL, 0);
+    memory.rx_tone = DRA818_CTCSS_COUNT + 1;
+    dra818_host_put_memory(payload, &memory);
+    frame_count = 0;
+    request(4, Dra818HostCmdUploadData, payload, DRA818_HOST_MEM_RECORD);
+    test_check(receive(1, 1000) && frames[0].payload[0] == Dra818HostResultBadRequest);
+
+    // The whole upload pipelined, then the commit.
+    size_t fill = 0;
+    size_t requests = 0;
+    for(uint32_t first = 0; first < MEMORIES; first += DRA818_HOST_MEM_PER_FRAME) {
+        size_t count = MIN(MEMORIES - first, (uint32_t)DRA818_HOST_MEM_PER_FRAME);
+        for(size_t i = 0; i < count; i++) {
+            make_memory(&memory, first + i);
+            dra818_host_put_memory(payload + i * DRA818_HOST_MEM_RECORD, &memory);
+        }
+        fill += request_build(
+            stream + fill,
+            requests++,
+            Dra818HostCmdUploadData,
+            payload,
+            count * DRA818_HOST_MEM_RECORD);
+    }
+    fill += request_build(stream + fill, requests++, Dra818HostCmdUploadCommit, NULL, 0);
+    frame_count = 0;
+    import_path = NULL;
+    uint64_t start = sim_now_ns();
+    sim_usb_host_send(stream, fill);
+    test_check(receive(requests, 2000));
+    uint64_t upload_ns = sim_now_ns() - start;
+    uint32_t errors = 0;
+    for(size_t i = 0; i < requests; i++) {
+        errors += frames[i].payload[0] != Dra818HostResultOk;
+    }
+    test_check(errors == 0);
+    const uint8_t* received = frames[requests - 2].payload + 1;
+    test_check((received[0] | received[1] << 8) == MEMORIES);
+    test_check(import_path && strcmp(import_path, UPLOAD_PATH) == 0);
+
+    // The app's side of the commit: the bank is busy while the import runs.
+    dra818_host_set_bank_busy(service, true);
+    uint8_t read[5] = {0, 0, 0, 0, DRA818_HOST_MEM_PER_FRAME};
+    frame_count = 0;
+    request(5, Dra818HostCmdMemRead, read, sizeof(read));
+    test_check(receive(1, 1000) && frames[0].payload[0] == Dra818HostResultBusy);
+    Dra818MemImportStats stats;
+    test_check(dra818_mem_import(UPLOAD_PATH, MEMORIES_DIR, &stats));
+    test_check(stats.imported == MEMORIES && stats.skipped == 0);
+    dra818_host_set_bank_busy(service, false);
+
+    frame = exchange(6, Dra818HostCmdInfo, NULL, 0);
+    test_check((frame->payload[4] | frame->payload[5] << 8) == MEMORIES);
+
+    // Download it all back, pipelined.
+    fill = 0;
+    requests = 0;
+    for(uint32_t first = 0; first < MEMORIES + 1; first += DRA818_HOST_MEM_PER_FRAME) {
+        read[0] = first;
+        read[1] = first >> 8;
+        fill += request_build(stream + fill, requests++, Dra818HostCmdMemRead, read, 5);
+    }
+    frame_count = 0;
+    start = sim_now_ns();
+    sim_usb_host_send(stream, fill);
+    test_check(receive(requests, 2000));
+    uint64_t download_ns = sim_now_ns() - start;
+    uint32_t mismatches = 0;
+    uint32_t count = 0;
+    for(size_t r = 0; r < requests; r++) {
+        const uint8_t* p = frames[r].payload;
+        mismatches += p[0] != Dra818HostResultOk;
+        for(size_t i = 0; i < p[1]; i++) {
+            Dra818Memory expect;
+            dra818_host_take_memory(p + 2 + i * DRA818_HOST_MEM_RECORD, &memory);
+            make_memory(&expect, count++);
+            mismatches += !memory_equal(&memory, &expect);
+        }
+    }
+    test_check(mismatches == 0 && count == MEMORIES);
+
+    // A read from a slow card: status updates do not wait for it, marking the bank
+    // busy waits for the batch to close its handle.
+    Dra818HostStatus status = {.init = Dra818InitStateReady};
+    sim_storage_set_read_ms(20);
+    frame_count = 0;
+    request(7, Dra818HostCmdMemRead, read, 5);
+    furi_delay_ms(5);
+    start = sim_now_ns();
+    dra818_host_set_status(service, &status);
+    test_check(sim_now_ns() == start);
+    dra818_host_set_bank_busy(service, true);
+    test_check(sim_now_ns() - start >= 10 * SIM_NS_PER_MS);
+    test_check(receive(1, 1000) && frames[0].payload[0] == Dra818HostResultOk);
+    sim_storage_set_read_ms(0);
+    request(8, Dra818HostCmdMemRead, read, 5);
+    test_check(receive(2, 1000) && frames[1].payload[0] == Dra818HostResultBusy);
+    dra818_host_set_bank_busy(service, false);
+    printf(
+        "host: %u memories uploaded in %llu ms, downloaded in %llu ms\n",
+        MEMORIES,
+        (unsigned long long)upload_ns / SIM_NS_PER_MS,
+        (unsigned long long)download_ns / SIM_NS_PER_MS);
+}
+
+static uint32_t status_events(void) {
+    uint32_t events = 0;
+    for(size_t i = 0; i < MIN(frame_count, (size_t)FRAMES_MAX); i++) {
+        events += frames[i].cmd ==
+                  (Dra818HostCmdStatus | DRA818_HOST_RESPONSE | DRA818_HOST_EVENT);
+    }
+    return events;
+}
+
+static void test_status(void) {
+    Dra818HostStatus status = {
+        .init = Dra818InitStateReady,
+        .rssi = 87,
+        .rx_freq = DRA818_FREQ_MHZ(146, 5200),
+        .tx_freq = DRA818_FREQ_MHZ(146, 5200),
+        .power_duty = 230,
+    };
+    dra818_host_set_status(service, &status);
+    Frame* frame = exchange(1, Dra818HostCmdStatus, NULL, 0);
+    const uint8_t* p = frame->payload + 1;
+    test_check(frame->size == 1 + 17);
+    test_check(p[4] == Dra818InitStateReady && p[5] == DRA818_HOST_STATUS_RSSI && p[6] == 87);
+    test_check((p[7] | p[8] << 8 | p[9] << 16 | (uint32_t)p[10] << 24) == status.rx_freq);
+    test_check((p[15] | p[16] << 8) == 230);
+
+    // 50 ms: 20 events a second, plus one straight away when the squelch opens.
+    uint16_t period = 50;
+    exchange(2, Dra818HostCmdSubscribe, &period, 2);
+    frame_count = 0;
+    uint64_t start = sim_now_ns();
+    while(sim_now_ns() - start < 1000 * SIM_NS_PER_MS) {
+        receive(frame_count + 1, 100);
+    }
+    uint32_t events = status_events();
+    test_check(events >= 19 && events <= 21);
+
+    frame_count = 0;
+    start = sim_now_ns();
+    status.squelch_open = true;
+    dra818_host_set_status(service, &status);
+    test_check(receive(1, 10));
+    test_check(frames[0].payload[6] & DRA818_HOST_STATUS_SQUELCH);
+    test_check(sim_now_ns() - start < 2 * SIM_NS_PER_MS);
+    printf("host: status stream %lu events in 1 s at 50 ms\n", (unsigned long)events);
+
+    period = 0;
+    frame_count = 0;
+    request(3, Dra818HostCmdSubscribe, &period, 2);
+    receive(1, 100);
+    uint32_t late = frame_count;
+    furi_delay_ms(300);
+    receive(late + 1, 10);
+    test_check(frame_count == late || status_events() <= 1);
+    test_check(sim_usb_host_pending() == 0);
+}
+
+static void test_resync(void) {
+    Dra818HostStats before, after;
+    dra818_host_get_stats(service, &before);
+    uint8_t stream[64 + 2 * DRA818_HOST_FRAME_MAX];
+    memset(stream, DRA818_HOST_SYNC, 16); // Syncs with no frame behind them
+    memset(stream + 16, 0x55, 16);
+    size_t fill = 32;
+    const uint8_t payload[] = {1, 2, 3};
+    size_t bad = request_build(stream + fill, 9, Dra818HostCmdPing, payload, 3);
+    stream[fill + bad - 1] ^= 0x80;
+    fill += bad;
+    fill += request_build(stream + fill, 10, Dra818HostCmdPing, payload, 3);
+    frame_count = 0;
+    sim_usb_host_send(stream, fill);
+    test_check(receive(1, 1000));
+    test_check(frames[0].seq == 10 && frames[0].size == 4 && frames[0].payload[3] == 3);
+    furi_delay_ms(1);
+    dra818_host_get_stats(service, &after);
+    test_check(after.parser.frames == before.parser.frames + 1);
+    test_check(after.parser.crc_errors > before.parser.crc_errors);
+
+    // Unknown commands and bad payloads are answered, not dropped.
+    frame_count = 0;
+    request(11, 0x7F, NULL, 0);
+    test_check(receive(1, 1000) && frames[0].payload[0] == Dra818HostResultUnknown);
+    frame_count = 0;
+    request(12, Dra818HostCmdMemRead, payload, 3);
+    test_check(receive(1, 1000) && frames[0].payload[0] == Dra818HostResultBadRequest);
+}
+
+static void test_passthrough(void) {
+    // Registers: a write, then a read of the same two.
+    const uint8_t write[] = {0x09, 0x5A, 0x5B};
+    exchange(1, Dra818HostCmdRegWrite, write, sizeof(write));
+    test_check(sim_dra818_reg(SLOT, 0x09) == 0x5A && sim_dra818_reg(SLOT, 0x0A) == 0x5B);
+    const uint8_t read[] = {0x09, 2};
+    Frame* frame = exchange(2, Dra818HostCmdRegRead, read, sizeof(read));
+    test_check(frame->size == 3 && frame->payload[1] == 0x5A && frame->payload[2] == 0x5B);
+    const uint8_t bad_read[] = {0x09, 0};
+    frame_count = 0;
+    request(3, Dra818HostCmdRegRead, bad_read, sizeof(bad_read));
+    test_check(receive(1, 1000) && frames[0].payload[0] == Dra818HostResultBadRequest);
+
+    // An AT command: timeout, expect length, expect, command.
+    uint8_t at[64] = {0xF4, 0x01, 11};
+    memcpy(at + 3, "+DMOCONNECT", 11);
+    memcpy(at + 14, "AT+DMOCONNECT", 13);
+    frame = exchange(4, Dra818HostCmdAt, at, 27);
+    test_check(frame->payload[1] == Dra818AtResultOk);
+    test_check(frame->size == 2 + 13 && memcmp(frame->payload + 2, "+DMOCONNECT:0", 13) == 0);
+
+    // A ping sent behind an AT command is answered first.
+    frame_count = 0;
+    request(5, Dra818HostCmdAt, at, 27);
+    request(6, Dra818HostCmdPing, NULL, 0);
+    test_check(receive(2, 1000));
+    test_check(frames[0].seq == 6 && frames[1].seq == 5);
+}
+
+static void test_service(void) {
+    size_t heap_before = sim_heap_used();
+    Dra818Bus* bus = dra818_bus_alloc();
+    Dra818* dra = dra818_alloc(bus, SLOT);
+    Dra818At* at = dra818_at_alloc(FuriHalSerialIdUsart, DRA818_AT_BAUD);
+    Dra818Radio* radio = dra818_radio_alloc(dra, at, radio_callback, NULL);
+    Dra818HostConfig config = {
+        .radio = radio,
+        .memories_dir = MEMORIES_DIR,
+        .upload_path = UPLOAD_PATH,
+        .import = import_callback,
+    };
+    service = dra818_host_alloc(&config);
+    test_check(service != NULL);
+    dra818_radio_start(radio);
+    for(uint32_t i = 0; i < 100 && !radio_ready; i++) {
+        furi_delay_ms(10);
+    }
+    test_check(radio_ready);
+    dra818_host_parser_reset(&parser);
+
+    test_ping();
+    test_pipelined();
+    test_bank();
+    test_status();
+    test_resync();
+    test_passthrough();
+
+    Dra818HostStats stats;
+    dra818_host_get_stats(service, &stats);
+    test_check(stats.tx_timeouts == 0 && stats.dropped == 0);
+    dra818_host_free(service);
+    dra818_radio_free(radio);
+    dra818_free(dra);
+    dra818_bus_free(bus);
+    test_check(sim_heap_used() == heap_before);
+}
+
+int main(void) {
+    sim_storage_root("test_host_storage");
+    test_frames();
+    test_link();
+    test_service();
+    return test_result("host");
+}
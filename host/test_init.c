@@ -0,0 +1,156 @@
+/*
+ -- test_init.c
+ -- Non-blocking init: the fixed boot delay against the DMOCONNECT probe,
+ -- a module that never answers, and cancelling at each step.
+*/
+
+#include <furi.h>
+#include "dra.h"
+#include "dra_at.h"
+#include "sim_dra818.h"
+#include "test.h"
+
+#define SLOT 0
+
+typedef struct {
+    FuriSemaphore* done;
+    bool ready;
+    uint32_t calls;
+    uint64_t at_ns;
+} InitWait;
+
+static void ready_callback(bool ready, void* context) {
+    InitWait* wait = context;
+    wait->ready = ready;
+    wait->calls++;
+    wait->at_ns = sim_now_ns();
+    furi_semaphore_release(wait->done);
+}
+
+static void at_callback(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(result);
+    UNUSED(response);
+    furi_semaphore_release(context);
+}
+
+static const Dra818InitConfig fixed_config = {
+    .reset_ms = DRA818_RESET_MS,
+    .boot_ms = DRA818_BOOT_MS,
+    .probe = NULL,
+    .probe_interval_ms = DRA818_PROBE_INTERVAL_MS,
+    .probe_timeout_ms = DRA818_PROBE_TIMEOUT_MS,
+};
+
+// Runs init to the end and returns the time from the call to the ready callback (ms).
+static uint64_t init_run(Dra818* dra, const Dra818InitConfig* config, InitWait* wait) {
+    uint64_t start = sim_now_ns();
+    test_check(dra818_init_async(dra, config, ready_callback, wait));
+    test_check(sim_now_ns() == start); // Returned at once
+    test_check(dra818_init_state(dra) == Dra818InitStateReset);
+    test_check(!dra818_init_async(dra, config, ready_callback, wait)); // Already running
+    test_check(furi_semaphore_acquire(wait->done, 5000) == FuriStatusOk);
+    return (wait->at_ns - start) / SIM_NS_PER_MS;
+}
+
+static void test_fixed_boot(Dra818* dra, InitWait* wait) {
+    uint64_t elapsed_ms = init_run(dra, &fixed_config, wait);
+    test_check(wait->ready);
+    test_check(elapsed_ms == DRA818_RESET_MS + DRA818_BOOT_MS);
+    test_check(dra818_init_state(dra) == Dra818InitStateConfigure);
+
+    // The callback leaves the bus alone; configuring is the owner's step.
+    test_check(sim_dra818_reg(SLOT, 0x00) != 0x57);
+    test_check(dra818_init_configure(dra));
+    test_check(dra818_init_state(dra) == Dra818InitStateReady);
+    test_check(sim_dra818_reg(SLOT, 0x00) == 0x57);
+    test_check(!dra818_init_configure(dra));
+    printf("init: fixed boot delay ready after %llu ms\n", (unsigned long long)elapsed_ms);
+}
+
+static void test_probe(Dra818* dra, Dra818At* at, InitWait* wait) {
+    // Tune the module, so init has something to resend.
+    FuriSemaphore* sent = furi_semaphore_alloc(1, 0);
+    Dra818AtGroup group = {
+        .tx_freq = DRA818_FREQ_MHZ(145, 5000),
+        .rx_freq = DRA818_FREQ_MHZ(145, 5000),
+    };
+    dra818_at_stage_group(at, &group);
+    test_check(dra818_at_commit(at, at_callback, sent));
+    furi_semaphore_acquire(sent, FuriWaitForever);
+    test_check(!dra818_at_is_dirty(at));
+
+    Dra818InitConfig config = fixed_config;
+    config.probe = at;
+    uint64_t elapsed_ms = init_run(dra, &config, wait);
+    test_check(wait->ready);
+    test_check(sim_dra818_ready(SLOT));
+    // Reset, 60 ms boot, and the first probe timing out while the module boots.
+    test_check(elapsed_ms > DRA818_RESET_MS + 60);
+    test_check(elapsed_ms < DRA818_RESET_MS + DRA818_BOOT_MS);
+    test_check(dra818_init_configure(dra));
+    test_check(dra818_at_is_dirty(at));
+    test_check(dra818_at_commit(at, at_callback, sent));
+    furi_semaphore_acquire(sent, FuriWaitForever);
+    test_check(sim_dra818_rx_freq(SLOT) == group.rx_freq);
+    furi_semaphore_free(sent);
+    printf("init: DMOCONNECT probe ready after %llu ms\n", (unsigned long long)elapsed_ms);
+
+    // A module that never answers fails once the probe runs out of time.
+    SimDra818Config model;
+    sim_dra818_get_config(SLOT, &model);
+    model.mute = true;
+    sim_dra818_set_config(SLOT, &model);
+    config.probe_timeout_ms = 300;
+    elapsed_ms = init_run(dra, &config, wait);
+    test_check(!wait->ready);
+    test_check(dra818_init_state(dra) == Dra818InitStateFailed);
+    test_check(elapsed_ms >= DRA818_RESET_MS + 300);
+    test_check(elapsed_ms <= DRA818_RESET_MS + 300 + DRA818_PROBE_INTERVAL_MS + 1);
+    test_check(!dra818_init_configure(dra));
+    model.mute = false;
+    sim_dra818_set_config(SLOT, &model);
+}
+
+// Cancel while RST is held and while a probe is in flight: no callback follows.
+static void test_cancel(Dra818* dra, Dra818At* at, InitWait* wait) {
+    Dra818InitConfig config = fixed_config;
+    config.probe = at;
+    const uint32_t cancel_after_ms[] = {50, DRA818_RESET_MS + 20};
+    for(size_t i = 0; i < COUNT_OF(cancel_after_ms); i++) {
+        uint32_t calls = wait->calls;
+        test_check(dra818_init_async(dra, &config, ready_callback, wait));
+        furi_delay_ms(cancel_after_ms[i]);
+        Dra818InitState state = i == 0 ? Dra818InitStateReset : Dra818InitStateProbe;
+        test_check(dra818_init_state(dra) == state);
+        dra818_init_cancel(dra);
+        test_check(dra818_init_state(dra) == Dra818InitStateIdle);
+        // A probe in flight runs out quietly.
+        furi_delay_ms(500);
+        test_check(wait->calls == calls);
+        test_check(dra818_at_pending(at) == 0);
+        test_check(!dra818_init_configure(dra));
+    }
+
+    // The next sequence runs normally.
+    init_run(dra, &config, wait);
+    test_check(wait->ready && dra818_init_configure(dra));
+}
+
+int main(void) {
+    size_t heap_before = sim_heap_used();
+    Dra818Bus* bus = dra818_bus_alloc();
+    Dra818* dra = dra818_alloc(bus, SLOT);
+    Dra818At* at = dra818_at_alloc(FuriHalSerialIdUsart, DRA818_AT_BAUD);
+    InitWait wait = {.done = furi_semaphore_alloc(1, 0)};
+
+    test_fixed_boot(dra, &wait);
+    test_probe(dra, at, &wait);
+    test_cancel(dra, at, &wait);
+
+    furi_semaphore_free(wait.done);
+    dra818_at_free(at);
+    dra818_free(dra);
+    dra818_bus_free(bus);
+    test_check(sim_heap_used() == heap_before);
+    return test_result("init");
+}
@@ -0,0 +1,356 @@
+/*
+ -- test_mem.c
+ -- Memory bank: a 50k-row CHIRP export imported onto simulated SD, every record
+ -- checked against what was written, and paged lookups by frequency, name and
+ -- bank compared with a brute-force scan, in both directions.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <furi.h>
+#include <storage/storage.h>
+#include "dra_mem.h"
+#include "test.h"
+
+#define ROWS      50000
+#define QUERIES   300
+#define PAGE      8
+#define CSV_PATH  APP_DATA_PATH("memories.csv")
+#define BANK_DIR  APP_DATA_PATH("bank")
+#define RUN_SIZE  1024 // Index entries sorted in RAM per run
+#define KEY_SIZE  DRA818_MEM_KEY_SIZE
+#define CSV_BLOCK 4096
+
+static Dra818Memory expect[ROWS];
+static uint32_t expect_count;
+static uint32_t matches[ROWS];
+
+static uint32_t rand_state = 1;
+
+static uint32_t rand_below(uint32_t n) {
+    rand_state = rand_state * 1664525 + 1013904223;
+    return (rand_state >> 8) % n;
+}
+
+static char upper(char c) {
+    return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+}
+
+typedef struct {
+    File* file;
+    char buffer[CSV_BLOCK];
+    size_t fill;
+} CsvWriter;
+
+static void csv_printf(CsvWriter* writer, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(writer->buffer + writer->fill, CSV_BLOCK - writer->fill, format, args);
+    va_end(args);
+    furi_check(length > 0 && writer->fill + length < CSV_BLOCK);
+    writer->fill += length;
+    if(writer->fill > CSV_BLOCK / 2) {
+        storage_file_write(writer->file, writer->buffer, writer->fill);
+        writer->fill = 0;
+    }
+}
+
+static void format_mhz(char* out, Dra818Freq freq) {
+    sprintf(out, "%lu.%04lu00", (unsigned long)(freq / 10000), (unsigned long)(freq % 10000));
+}
+
+// A CHIRP export with a Bank column added.  The memories the import should make
+// are kept in `expect`, in file order.
+static void write_csv(void) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_simply_mkdir(storage, APP_DATA_PATH(""));
+    static CsvWriter writer;
+    writer.file = storage_file_alloc(storage);
+    writer.fill = 0;
+    test_check(storage_file_open(writer.file, CSV_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS));
+    csv_printf(
+        &writer,
+        "Location,Name,Frequency,Duplex,Offset,Tone,rToneFreq,cToneFreq,DtcsCode,"
+        "DtcsPolarity,Mode,TStep,Skip,Comment,Bank\r\n");
+
+    static const char* const tone_modes[] = {"", "Tone", "TSQL", "DTCS"};
+    static const char* const polarities[] = {"NN", "NR", "RN", "RR"};
+    for(uint32_t row = 0; row < ROWS; row++) {
+        Dra818Memory memory = {.number = expect_count};
+        bool usable = true;
+        bool uhf = rand_below(2);
+        memory.rx_freq = uhf ? DRA818_FREQ_MHZ(420, 0) + rand_below(1600) * DRA818_STEP_NARROW :
+                               DRA818_FREQ_MHZ(144, 0) + rand_below(320) * DRA818_STEP_NARROW;
+        if(rand_below(50) == 0) {
+            memory.rx_freq = DRA818_FREQ_MHZ(222, 1000); // 1.25 m, not for this module
+            usable = false;
+        }
+        Dra818Freq offset = uhf ? DRA818_FREQ_MHZ(5, 0) : DRA818_FREQ_MHZ(0, 6000);
+        uint32_t duplex = rand_below(3);
+        memory.tx_freq = memory.rx_freq + (duplex == 0 ? offset : 0) -
+                         (duplex == 1 ? offset : 0);
+
+        uint32_t tone_mode = rand_below(4);
+        uint32_t r_tone = rand_below(DRA818_CTCSS_COUNT);
+        uint32_t c_tone = rand_below(DRA818_CTCSS_COUNT);
+        uint16_t dcs = dra818_dcs_codes[rand_below(DRA818_DCS_COUNT)];
+        uint32_t polarity = rand_below(4);
+        if(tone_mode == 1) {
+            memory.tx_tone = r_tone + 1;
+        } else if(tone_mode == 2) {
+            memory.tx_tone = memory.rx_tone = c_tone + 1;
+        } else if(tone_mode == 3) {
+            memory.tx_tone = polarity & 2 ? DRA818_TONE_DCS_I(dcs) : DRA818_TONE_DCS(dcs);
+            memory.rx_tone = polarity & 1 ? DRA818_TONE_DCS_I(dcs) : DRA818_TONE_DCS(dcs);
+        }
+
+        uint32_t mode = rand_below(20);
+        usable = usable && mode != 0; // DV
+        memory.wide = mode > 10;
+        memory.bank = rand_below(4);
+
+        // Quoted names with commas and doubled quotes; some longer than a record holds.
+        char quoted[48];
+        uint32_t kind = rand_below(10);
+        uint32_t digit = rand_below(10);
+        char suffix[4] = {'A' + rand_below(26), 'A' + rand_below(26), 'A' + rand_below(26)};
+        if(kind == 0) {
+            snprintf(memory.name, sizeof(memory.name), "Club \"%c%s\"", 'A' + digit, suffix);
+            snprintf(quoted, sizeof(quoted), "\"Club \"\"%c%s\"\"\"", 'A' + digit, suffix);
+        } else if(kind == 1) {
+            strlcpy(memory.name, "k1abc repeater network west", sizeof(memory.name));
+            strlcpy(quoted, "k1abc repeater network west", sizeof(quoted));
+        } else {
+            snprintf(
+                memory.name, sizeof(memory.name), "K%lu%s, rpt", (unsigned long)digit, suffix);
+            snprintf(quoted, sizeof(quoted), "\"%s\"", memory.name);
+        }
+
+        char rx[16], off[16];
+        format_mhz(rx, memory.rx_freq);
+        format_mhz(off, offset);
+        csv_printf(
+            &writer,
+            "%lu,%s,%s,%s,%s,%s,%u.%u,%u.%u,%03o,%s,%s,5.00,,\"Comment, with comma\",%u\r\n",
+            (unsigned long)row,
+            quoted,
+            rx,
+            duplex == 0 ? "+" : duplex == 1 ? "-" : "",
+            off,
+            tone_modes[tone_mode],
+            dra818_ctcss_tones[r_tone] / 10,
+            dra818_ctcss_tones[r_tone] % 10,
+            dra818_ctcss_tones[c_tone] / 10,
+            dra818_ctcss_tones[c_tone] % 10,
+            dcs,
+            polarities[polarity],
+            mode == 0 ? "DV" : memory.wide ? "FM" : "NFM",
+            memory.bank);
+        if(usable) {
+            expect[expect_count++] = memory;
+        }
+    }
+    storage_file_write(writer.file, writer.buffer, writer.fill);
+    storage_file_close(writer.file);
+    storage_file_free(writer.file);
+    furi_record_close(RECORD_STORAGE);
+}
+
+static bool memory_equal(const Dra818Memory* a, const Dra818Memory* b) {
+    return a->number == b->number && a->rx_freq == b->rx_freq && a->tx_freq == b->tx_freq &&
+           a->rx_tone == b->rx_tone && a->tx_tone == b->tx_tone && a->bank == b->bank &&
+           a->wide == b->wide && strcmp(a->name, b->name) == 0;
+}
+
+static void key_of(const char* name, char* key) {
+    memset(key, 0, KEY_SIZE);
+    for(size_t i = 0; i < KEY_SIZE && name[i]; i++) {
+        key[i] = upper(name[i]);
+    }
+}
+
+static bool by_name;
+
+// The index orders: frequency or name key, then record number.
+static int match_compare(const void* a, const void* b) {
+    const Dra818Memory* ma = &expect[*(const uint32_t*)a];
+    const Dra818Memory* mb = &expect[*(const uint32_t*)b];
+    if(by_name) {
+        char ka[KEY_SIZE], kb[KEY_SIZE];
+        key_of(ma->name, ka);
+        key_of(mb->name, kb);
+        int c = memcmp(ka, kb, KEY_SIZE);
+        if(c != 0) {
+            return c;
+        }
+    } else if(ma->rx_freq != mb->rx_freq) {
+        return ma->rx_freq < mb->rx_freq ? -1 : 1;
+    }
+    return ma->number < mb->number ? -1 : ma->number > mb->number;
+}
+
+static bool query_match(const Dra818MemQuery* query, const Dra818Memory* memory) {
+    if(memory->rx_freq < query->min || memory->rx_freq > query->max) {
+        return false;
+    }
+    if(query->bank != DRA818_MEM_BANK_ANY && memory->bank != query->bank) {
+        return false;
+    }
+    for(size_t i = 0; query->name[i]; i++) {
+        if(upper(query->name[i]) != upper(memory->name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t brute_force(const Dra818MemQuery* query) {
+    uint32_t count = 0;
+    for(uint32_t i = 0; i < expect_count; i++) {
+        if(query_match(query, &expect[i])) {
+            matches[count++] = i;
+        }
+    }
+    by_name = query->name[0] != '\0';
+    qsort(matches, count, sizeof(uint32_t), match_compare);
+    return count;
+}
+
+static void random_query(Dra818MemQuery* query, uint32_t n) {
+    dra818_mem_query_all(query);
+    switch(n % 4) {
+    case 0:
+        query->min = DRA818_FREQ_MHZ(144, 0) + rand_below(4000) * DRA818_STEP_NARROW / 10;
+        query->max = query->min + DRA818_FREQ_MHZ(0, 2000);
+        break;
+    case 1:
+        snprintf(query->name, sizeof(query->name), "K%lu%c", n % 10, 'A' + rand_below(26));
+        break;
+    case 2:
+        query->min = DRA818_FREQ_MHZ(420, 0);
+        query->max = DRA818_FREQ_MHZ(450, 0);
+        query->bank = rand_below(4);
+        snprintf(query->name, sizeof(query->name), "k%lu%cq", n % 10, 'a' + rand_below(26));
+        break;
+    default:
+        // Longer than the index key, so the rest is checked on the records.
+        strlcpy(query->name, rand_below(2) ? "k1abc repeater" : "Club \"", sizeof(query->name));
+        query->bank = rand_below(2) ? DRA818_MEM_BANK_ANY : rand_below(4);
+        break;
+    }
+}
+
+static void test_queries(Dra818Mem* mem) {
+    static Dra818Memory page[PAGE];
+    uint64_t first_ns = 0;
+    uint64_t next_ns = 0;
+    uint32_t next_pages = 0;
+    uint32_t wrong = 0;
+    uint32_t found = 0;
+    for(uint32_t n = 0; n < QUERIES; n++) {
+        Dra818MemQuery query;
+        random_query(&query, n);
+        uint32_t count = brute_force(&query);
+        found += count;
+
+        Dra818MemCursor cursor;
+        uint64_t start = sim_cpu_ns();
+        dra818_mem_find(mem, &query, &cursor);
+        size_t got = dra818_mem_page(mem, &cursor, true, page, PAGE);
+        first_ns += sim_cpu_ns() - start;
+
+        // Forward to the end: exactly the brute-force matches, in index order.
+        uint32_t seen = 0;
+        size_t last_page = 0;
+        while(got) {
+            for(size_t i = 0; i < got; i++) {
+                wrong += seen >= count || !memory_equal(&page[i], &expect[matches[seen]]);
+                seen++;
+            }
+            last_page = got;
+            start = sim_cpu_ns();
+            got = dra818_mem_page(mem, &cursor, true, page, PAGE);
+            next_ns += sim_cpu_ns() - start;
+            next_pages++;
+        }
+        wrong += seen != count;
+
+        // And back to the start, page by page.
+        uint32_t back = seen - last_page;
+        while((got = dra818_mem_page(mem, &cursor, false, page, PAGE)) > 0) {
+            back -= got;
+            for(size_t i = 0; i < got; i++) {
+                wrong += !memory_equal(&page[i], &expect[matches[back + i]]);
+            }
+        }
+        wrong += back != 0;
+    }
+    test_check(wrong == 0);
+    test_check(found > QUERIES);
+    printf(
+        "mem: %u queries, %lu matches, first page %.1f us, next page %.1f us\n",
+        QUERIES,
+        (unsigned long)found,
+        (double)first_ns / QUERIES / 1000,
+        (double)next_ns / next_pages / 1000);
+}
+
+static void test_import(void) {
+    size_t heap_before = sim_heap_used();
+    Dra818MemImportStats stats;
+    test_check(dra818_mem_alloc(BANK_DIR) == NULL);
+    uint64_t start = sim_cpu_ns();
+    test_check(dra818_mem_import(CSV_PATH, BANK_DIR, &stats));
+    uint64_t import_ns = sim_cpu_ns() - start;
+    test_check(stats.rows == ROWS && stats.imported == expect_count);
+    test_check(stats.skipped == ROWS - expect_count && !stats.truncated);
+    test_check(stats.runs == (expect_count + RUN_SIZE - 1) / RUN_SIZE);
+    printf(
+        "mem: %lu of %u rows, %lu runs per index, import %.0f ms CPU\n",
+        (unsigned long)stats.imported,
+        ROWS,
+        (unsigned long)stats.runs,
+        (double)import_ns / SIM_NS_PER_MS);
+
+    Dra818Mem* mem = dra818_mem_alloc(BANK_DIR);
+    test_check(mem && dra818_mem_count(mem) == expect_count);
+    static Dra818Memory records[256];
+    uint32_t mismatches = 0;
+    for(uint32_t first = 0; first < expect_count; first += COUNT_OF(records)) {
+        size_t got = dra818_mem_read_run(mem, first, records, COUNT_OF(records));
+        test_check(got == MIN(COUNT_OF(records), expect_count - first));
+        for(size_t i = 0; i < got; i++) {
+            mismatches += !memory_equal(&records[i], &expect[first + i]);
+        }
+    }
+    test_check(mismatches == 0);
+    Dra818Memory memory;
+    test_check(dra818_mem_read(mem, expect_count - 1, &memory));
+    test_check(memory_equal(&memory, &expect[expect_count - 1]));
+    test_check(!dra818_mem_read(mem, expect_count, &memory));
+
+    test_queries(mem);
+    dra818_mem_free(mem);
+
+    // A file without a frequency column fails and leaves the bank as it was.
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    test_check(storage_file_open(file, CSV_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS));
+    const char* bad = "Location,Name\n1,K1ABC\n";
+    storage_file_write(file, bad, strlen(bad));
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    test_check(!dra818_mem_import(CSV_PATH, BANK_DIR, &stats));
+    mem = dra818_mem_alloc(BANK_DIR);
+    test_check(mem && dra818_mem_count(mem) == expect_count);
+    dra818_mem_free(mem);
+    test_check(sim_heap_used() == heap_before);
+}
+
+int main(void) {
+    sim_storage_root("test_mem_storage");
+    write_csv();
+    test_import();
+    return test_result("mem");
+}
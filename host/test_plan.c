@@ -0,0 +1,142 @@
+/*
+ -- test_plan.c
+ -- Channel plan formatters against snprintf for every channel and tone, the
+ -- validity checks, and the cost of building AT+DMOSETGROUP both ways.
+*/
+
+#include <stdio.h>
+#include <furi.h>
+#include "dra_at.h"
+#include "dra_plan.h"
+#include "test.h"
+
+#define FORMAT_REPS 200000
+
+static void test_freqs(void) {
+    uint32_t channels = 0;
+    uint32_t mismatches = 0;
+    for(size_t band = 0; band < DRA818_BAND_COUNT; band++) {
+        for(Dra818Freq freq = dra818_bands[band].min; freq <= dra818_bands[band].max;
+            freq += DRA818_STEP_NARROW) {
+            char out[10] = {0};
+            char expect[16];
+            size_t length = dra818_plan_format_freq(out, freq);
+            snprintf(
+                expect,
+                sizeof(expect),
+                "%lu.%04lu",
+                (unsigned long)(freq / 10000),
+                (unsigned long)(freq % 10000));
+            mismatches += length != strlen(expect) || memcmp(out, expect, length) != 0;
+            channels++;
+            test_check(dra818_plan_freq_valid(freq, false));
+            test_check(dra818_plan_freq_valid(freq, true) == (freq % DRA818_STEP_WIDE == 0));
+        }
+    }
+    test_check(mismatches == 0);
+    test_check(channels == 3201 + 6401);
+
+    test_check(!dra818_plan_freq_valid(DRA818_FREQ_MHZ(133, 9875), false));
+    test_check(!dra818_plan_freq_valid(DRA818_FREQ_MHZ(174, 125), false));
+    test_check(!dra818_plan_freq_valid(DRA818_FREQ_MHZ(250, 0), false));
+    test_check(!dra818_plan_freq_valid(DRA818_FREQ_MHZ(146, 5100), false)); // Off the grid
+    test_check(DRA818_FREQ_HZ(146520000) == DRA818_FREQ_MHZ(146, 5200));
+    test_check(DRA818_FREQ_TO_HZ(DRA818_FREQ_KHZ(446006)) == 446006000);
+}
+
+static void test_tones(void) {
+    char out[5] = {0};
+    char expect[8];
+    test_check(dra818_plan_tone_valid(DRA818_TONE_NONE));
+    dra818_plan_format_tone(out, DRA818_TONE_NONE);
+    test_check(strcmp(out, "0000") == 0);
+    for(Dra818Tone tone = 1; tone <= DRA818_CTCSS_COUNT; tone++) {
+        test_check(dra818_plan_tone_valid(tone));
+        dra818_plan_format_tone(out, tone);
+        snprintf(expect, sizeof(expect), "%04u", tone);
+        test_check(strcmp(out, expect) == 0);
+    }
+    test_check(!dra818_plan_tone_valid(DRA818_CTCSS_COUNT + 1));
+
+    for(size_t i = 0; i < DRA818_DCS_COUNT; i++) {
+        uint16_t code = dra818_dcs_codes[i];
+        test_check(dra818_plan_tone_valid(DRA818_TONE_DCS(code)));
+        dra818_plan_format_tone(out, DRA818_TONE_DCS(code));
+        snprintf(expect, sizeof(expect), "%03oN", code);
+        test_check(strcmp(out, expect) == 0);
+        dra818_plan_format_tone(out, DRA818_TONE_DCS_I(code));
+        snprintf(expect, sizeof(expect), "%03oI", code);
+        test_check(strcmp(out, expect) == 0);
+    }
+    test_check(!dra818_plan_tone_valid(DRA818_TONE_DCS(0024))); // Not a standard code
+    test_check(dra818_ctcss_tones[0] == 670 && dra818_ctcss_tones[DRA818_CTCSS_COUNT - 1] == 2503);
+}
+
+// What the engine did before: snprintf with the frequencies in MHz as floats.
+static int format_group_snprintf(char* out, size_t size, const Dra818AtGroup* group) {
+    return snprintf(
+        out,
+        size,
+        "AT+DMOSETGROUP=%d,%.4f,%.4f,%04d,%d,%04d",
+        group->wide,
+        group->tx_freq / 10000.0,
+        group->rx_freq / 10000.0,
+        group->tx_tone,
+        group->squelch,
+        group->rx_tone);
+}
+
+static void test_group(void) {
+    Dra818AtGroup group = {
+        .wide = true,
+        .tx_freq = DRA818_FREQ_MHZ(146, 5200),
+        .rx_freq = DRA818_FREQ_MHZ(146, 5200),
+        .squelch = 1,
+    };
+    char out[DRA818_AT_CMD_MAX];
+    char expect[DRA818_AT_CMD_MAX];
+    size_t length = dra818_at_format_group(out, sizeof(out), &group);
+    test_check(strcmp(out, "AT+DMOSETGROUP=1,146.5200,146.5200,0000,1,0000") == 0);
+    test_check(length == strlen(out));
+    test_check(dra818_at_format_group(out, 16, &group) == 0);
+
+    group = (Dra818AtGroup){
+        .tx_freq = DRA818_FREQ_MHZ(446, 6125),
+        .rx_freq = DRA818_FREQ_MHZ(440, 125),
+        .tx_tone = 12,
+        .squelch = 9, // Clamped to 8
+        .rx_tone = DRA818_TONE_DCS_I(0754),
+    };
+    dra818_at_format_group(out, sizeof(out), &group);
+    test_check(strcmp(out, "AT+DMOSETGROUP=0,446.6125,440.0125,0012,8,754I") == 0);
+
+    // Same text as snprintf, at a fraction of the cost.
+    group.rx_tone = 5;
+    group.squelch = 3;
+    volatile size_t sink = 0;
+    uint64_t start = sim_cpu_ns();
+    for(uint32_t i = 0; i < FORMAT_REPS; i++) {
+        group.rx_freq = DRA818_FREQ_MHZ(430, 0) + (i % 4000) * DRA818_STEP_NARROW;
+        sink += dra818_at_format_group(out, sizeof(out), &group);
+    }
+    uint64_t plan_ns = sim_cpu_ns() - start;
+    start = sim_cpu_ns();
+    for(uint32_t i = 0; i < FORMAT_REPS; i++) {
+        group.rx_freq = DRA818_FREQ_MHZ(430, 0) + (i % 4000) * DRA818_STEP_NARROW;
+        sink += format_group_snprintf(expect, sizeof(expect), &group);
+    }
+    uint64_t snprintf_ns = sim_cpu_ns() - start;
+    test_check(strcmp(out, expect) == 0);
+    printf(
+        "plan: DMOSETGROUP formatter %.0f ns, snprintf %.0f ns\n",
+        (double)plan_ns / FORMAT_REPS,
+        (double)snprintf_ns / FORMAT_REPS);
+    test_check(plan_ns < snprintf_ns);
+}
+
+int main(void) {
+    test_freqs();
+    test_tones();
+    test_group();
+    return test_result("plan");
+}
@@ -0,0 +1,209 @@
+/*
+ -- test_power.c
+ -- Power-save schedule: state changes, wake and wrap-around, then a day of
+ -- random traffic at each sleep time with current, detection latency and missed
+ -- transmissions compared with the analytic estimate.
+*/
+
+#include <furi.h>
+#include <math.h>
+#include "dra_power.h"
+#include "test.h"
+
+#define WINDOW_MS   150
+#define DAY_MS      (24UL * 3600 * 1000)
+#define MEAN_GAP_MS 60000 // Poisson transmission starts
+
+static const Dra818PowerConfig base_config = {
+    .on_ms = WINDOW_MS,
+    .off_ms = 1000,
+    .settle_ms = DRA818_POWER_SETTLE_MS,
+    .hang_ms = DRA818_POWER_HANG_MS,
+};
+
+static void test_schedule(void) {
+    Dra818PowerSchedule schedule;
+    uint32_t now = UINT32_MAX - 2000; // The tick counter wraps during this test
+    dra818_power_init(&schedule, &base_config, now);
+    test_check(dra818_power_on(&schedule) && dra818_power_listening(&schedule, now));
+    test_check(dra818_power_update(&schedule, now, false) == DRA818_POWER_HANG_MS);
+
+    // Asleep after the hang time, then a window that only listens once settled.
+    now += DRA818_POWER_HANG_MS;
+    test_check(dra818_power_update(&schedule, now, false) == 1000);
+    test_check(!dra818_power_on(&schedule) && !dra818_power_listening(&schedule, now));
+    now += 1000;
+    test_check(dra818_power_update(&schedule, now, true) == DRA818_POWER_SETTLE_MS);
+    test_check(schedule.state == Dra818PowerStateListen);
+    test_check(dra818_power_on(&schedule) && !dra818_power_listening(&schedule, now));
+    now += DRA818_POWER_SETTLE_MS;
+    test_check(dra818_power_update(&schedule, now, false) == WINDOW_MS - DRA818_POWER_SETTLE_MS);
+    test_check(dra818_power_listening(&schedule, now));
+
+    // Activity late in the window wakes it; it was not there at the first look.
+    now += 50;
+    test_check(dra818_power_update(&schedule, now, true) == DRA818_POWER_HANG_MS);
+    test_check(schedule.state == Dra818PowerStateAwake);
+    test_check(schedule.stats.windows == 1 && schedule.stats.wakes == 1);
+    test_check(schedule.stats.late == 0);
+
+    // Asleep again, then a command: powered at once.
+    now += DRA818_POWER_HANG_MS;
+    dra818_power_update(&schedule, now, false);
+    test_check(!dra818_power_on(&schedule));
+    now += 400;
+    test_check(dra818_power_wake(&schedule, now));
+    test_check(!dra818_power_wake(&schedule, now));
+    test_check(dra818_power_on(&schedule));
+
+    // Every millisecond is accounted for.
+    now += DRA818_POWER_HANG_MS;
+    dra818_power_update(&schedule, now, false);
+    const Dra818PowerStats* stats = &schedule.stats;
+    test_check(stats->awake_ms == 3 * DRA818_POWER_HANG_MS);
+    test_check(stats->listen_ms == DRA818_POWER_SETTLE_MS + 50);
+    test_check(stats->sleep_ms == 1000 + 400);
+
+    // Power save off: never sleeps, nothing to wait for.
+    Dra818PowerConfig config = base_config;
+    config.off_ms = 0;
+    dra818_power_init(&schedule, &config, 0);
+    test_check(dra818_power_update(&schedule, 1000000, false) == UINT32_MAX);
+    test_check(dra818_power_on(&schedule));
+}
+
+static uint32_t rand_state = 1;
+
+static float rand_uniform(void) {
+    rand_state = rand_state * 1664525 + 1013904223;
+    return ((rand_state >> 8) + 0.5f) / (1 << 24);
+}
+
+typedef struct {
+    uint32_t transmissions;
+    uint32_t missed;
+    uint32_t latency_max_ms;
+    uint64_t latency_sum_ms;
+    uint32_t seen;
+    uint64_t charge; // uA ms
+    Dra818PowerStats stats;
+} PowerRun;
+
+// A day of transmissions min_ms..max_ms long, driven the way the radio thread does:
+// the squelch is only looked at while its output is valid.
+static void
+    power_run(const Dra818PowerConfig* config, uint32_t min_ms, uint32_t max_ms, PowerRun* run) {
+    memset(run, 0, sizeof(PowerRun));
+    rand_state = 1;
+    Dra818PowerSchedule schedule;
+    dra818_power_init(&schedule, config, 0);
+    uint32_t now = 0;
+    uint32_t wake_at = dra818_power_update(&schedule, 0, false);
+    uint32_t next_start = 1000 - MEAN_GAP_MS * logf(rand_uniform());
+    uint32_t start = 0, end = 0;
+    bool on_air = false, detected = false;
+
+    while(now < DAY_MS) {
+        uint32_t next = MIN(wake_at, next_start);
+        if(on_air) {
+            next = MIN(next, end);
+        }
+        next = MIN(next, DAY_MS);
+        uint32_t ua = dra818_power_on(&schedule) ? DRA818_POWER_RX_UA : DRA818_POWER_SLEEP_UA;
+        run->charge += (uint64_t)(next - now) * ua;
+        now = next;
+
+        if(on_air && now >= end) {
+            run->missed += !detected;
+            on_air = false;
+        }
+        if(now >= next_start) {
+            if(!on_air) {
+                start = now;
+                end = now + min_ms + (uint32_t)(rand_uniform() * (max_ms - min_ms + 1));
+                on_air = true;
+                detected = false;
+                run->transmissions++;
+            }
+            next_start = now + 1 - MEAN_GAP_MS * logf(rand_uniform());
+        }
+        bool squelch = on_air && dra818_power_listening(&schedule, now);
+        uint32_t delay = dra818_power_update(&schedule, now, squelch);
+        if(on_air && !detected && schedule.state == Dra818PowerStateAwake &&
+           dra818_power_listening(&schedule, now)) {
+            detected = true;
+            uint32_t latency = now - start;
+            run->latency_sum_ms += latency;
+            run->latency_max_ms = MAX(run->latency_max_ms, latency);
+            run->seen++;
+        }
+        wake_at = delay == UINT32_MAX ? DAY_MS : now + MAX(delay, 1UL);
+    }
+    run->stats = schedule.stats;
+}
+
+static void test_day(void) {
+    static const uint32_t sleeps[] = {0, 500, 1000, 2000};
+    PowerRun runs[COUNT_OF(sleeps)][2];
+    printf("power: sleep  avg mA  latency mean/max  missed 1-6 s / 0.3-0.8 s\n");
+    for(size_t i = 0; i < COUNT_OF(sleeps); i++) {
+        Dra818PowerConfig config = base_config;
+        config.off_ms = sleeps[i];
+        power_run(&config, 1000, 6000, &runs[i][0]);
+        power_run(&config, 300, 800, &runs[i][1]);
+        PowerRun* run = &runs[i][0];
+        PowerRun* brief = &runs[i][1];
+
+        Dra818PowerModel model = {
+            .rx_ua = DRA818_POWER_RX_UA,
+            .sleep_ua = DRA818_POWER_SLEEP_UA,
+            .burst_ms = 1000,
+        };
+        Dra818PowerEstimate estimate;
+        dra818_power_estimate(&config, &model, &estimate);
+        uint32_t latency_mean = run->latency_sum_ms / run->seen;
+        uint32_t missed = run->missed * 1000 / run->transmissions;
+        uint32_t missed_brief = brief->missed * 1000 / brief->transmissions;
+        printf(
+            "power: %4lu ms  %6.1f  %5lu / %4lu ms     %4.1f%% / %4.1f%%\n",
+            (unsigned long)sleeps[i],
+            (double)run->charge / DAY_MS / 1000,
+            (unsigned long)latency_mean,
+            (unsigned long)run->latency_max_ms,
+            missed / 10.0,
+            missed_brief / 10.0);
+
+        test_check(run->transmissions > 1300 && run->transmissions < 1600);
+        test_check(run->seen + run->missed == run->transmissions);
+        // Traffic keeps it awake for a while, so the average is above the idle estimate.
+        const Dra818PowerStats* stats = &run->stats;
+        test_check(
+            run->charge == (uint64_t)(stats->awake_ms + stats->listen_ms) * DRA818_POWER_RX_UA +
+                               (uint64_t)stats->sleep_ms * DRA818_POWER_SLEEP_UA);
+        test_check(run->charge / DAY_MS >= estimate.current_ua);
+        test_check(run->charge / DAY_MS < estimate.current_ua + 8000);
+        test_check(run->latency_max_ms <= estimate.latency_max_ms);
+        test_check(latency_mean * 100 >= estimate.latency_mean_ms * 95);
+        test_check(latency_mean * 100 <= estimate.latency_mean_ms * 105 + 100);
+        test_check(missed <= estimate.miss_permille);
+        // Transmissions longer than the dead time are never missed.
+        if(sleeps[i] + DRA818_POWER_SETTLE_MS < 1000) {
+            test_check(run->missed == 0);
+        }
+        if(i > 0) {
+            test_check(run->charge < runs[i - 1][0].charge);
+            test_check(missed_brief > runs[i - 1][1].missed * 1000 / runs[i - 1][1].transmissions);
+            test_check(run->stats.windows >= run->stats.wakes && run->stats.wakes > 0);
+        }
+    }
+    test_check(runs[0][0].charge == DRA818_POWER_RX_UA * (uint64_t)DAY_MS);
+    test_check(runs[0][0].latency_max_ms == 0 && runs[0][0].missed == 0);
+    test_check(runs[0][1].missed == 0);
+    test_check(runs[1][0].charge / DAY_MS < 20000); // 0.5 s sleep: under a third
+}
+
+int main(void) {
+    test_schedule();
+    test_day();
+    return test_result("power");
+}
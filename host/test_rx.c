@@ -0,0 +1,169 @@
+/*
+ -- test_rx.c
+ -- Interrupt-driven receive: bytes arriving over the air reach the ring in
+ -- order through DMA reads (the simulated HAL refuses a polled transfer from an
+ -- interrupt), INT during a frame is read once the frame lets go of the bus,
+ -- bursts longer than one INT's reads arrive whole, and a full ring counts
+ -- what it drops.
+*/
+
+#include <furi.h>
+#include "dra.h"
+#include "sim_dra818.h"
+#include "test.h"
+
+#define SLOT         0
+#define STREAM_BYTES 20000
+#define STREAM_CHUNK 24 // Bytes per burst over the air
+#define STREAM_GAP   3 // ms between bursts
+
+typedef struct {
+    FuriSemaphore* data;
+    uint32_t notifies;
+} RxWait;
+
+static void rx_callback(void* context) {
+    RxWait* wait = context;
+    wait->notifies++;
+    furi_semaphore_release(wait->data);
+}
+
+static uint8_t stream_byte(uint32_t index) {
+    return (uint8_t)(index * 7 + (index >> 8));
+}
+
+static int32_t producer(void* context) {
+    UNUSED(context);
+    uint8_t chunk[STREAM_CHUNK];
+    for(uint32_t sent = 0; sent < STREAM_BYTES; sent += STREAM_CHUNK) {
+        for(uint32_t i = 0; i < STREAM_CHUNK; i++) {
+            chunk[i] = stream_byte(sent + i);
+        }
+        sim_dra818_air_receive(SLOT, chunk, MIN(STREAM_CHUNK, STREAM_BYTES - sent));
+        furi_delay_ms(STREAM_GAP);
+    }
+    return 0;
+}
+
+// A producer thread feeds the module while this thread reads and keeps the bus busy.
+static void test_stream(Dra818* dra, RxWait* wait) {
+    FuriThread* thread = furi_thread_alloc_ex("Air", 1024, producer, NULL);
+    furi_thread_start(thread);
+
+    uint8_t data[64];
+    uint8_t regs[8] = {0};
+    uint32_t received = 0;
+    uint32_t mismatches = 0;
+    uint64_t start = sim_now_ns();
+    uint64_t cpu_start = sim_cpu_ns();
+    while(received < STREAM_BYTES) {
+        if(furi_semaphore_acquire(wait->data, 1000) != FuriStatusOk) {
+            break;
+        }
+        size_t length;
+        while((length = dra818_rx_read(dra, data, sizeof(data))) > 0) {
+            for(size_t i = 0; i < length; i++) {
+                mismatches += data[i] != stream_byte(received + i);
+            }
+            received += length;
+        }
+        // Frames of our own, so some INTs land while the bus is held.
+        dra818_write_burst(dra, 0x10, regs, sizeof(regs));
+        regs[0]++;
+    }
+    uint64_t elapsed_ns = sim_now_ns() - start;
+    uint64_t cpu_ns = sim_cpu_ns() - cpu_start;
+    furi_thread_join(thread);
+    furi_thread_free(thread);
+
+    test_check(received == STREAM_BYTES);
+    test_check(mismatches == 0);
+    test_check(dra818_rx_overflows(dra) == 0);
+    test_check(dra818_rx_available(dra) == 0);
+    printf(
+        "rx: %lu bytes in %llu ms, %lu notifies, %.2f us CPU per byte\n",
+        (unsigned long)received,
+        (unsigned long long)(elapsed_ns / SIM_NS_PER_MS),
+        (unsigned long)wait->notifies,
+        cpu_ns / 1e3 / received);
+}
+
+typedef struct {
+    FuriSemaphore* done;
+} DmaWait;
+
+static void dma_callback(bool success, void* context) {
+    UNUSED(success);
+    furi_semaphore_release(((DmaWait*)context)->done);
+}
+
+// INT while a DMA frame owns the bus: nothing is read until the frame completes.
+static void test_deferred(Dra818* dra, RxWait* wait) {
+    DmaWait dma = {.done = furi_semaphore_alloc(1, 0)};
+    uint8_t values[16] = {0};
+    const uint8_t air[] = {0xA1, 0xA2, 0xA3};
+    test_check(dra818_write_burst_dma(dra, 0x10, values, sizeof(values), dma_callback, &dma));
+    sim_dra818_air_receive(SLOT, air, sizeof(air));
+    furi_delay_tick(0); // Let the EXTI run
+    test_check(dra818_rx_available(dra) == 0);
+    furi_semaphore_acquire(dma.done, FuriWaitForever);
+    test_check(furi_semaphore_acquire(wait->data, 100) == FuriStatusOk);
+    uint8_t data[8];
+    test_check(dra818_rx_read(dra, data, sizeof(data)) == sizeof(air));
+    test_check(memcmp(data, air, sizeof(air)) == 0);
+    furi_semaphore_free(dma.done);
+}
+
+// A burst longer than one interrupt drains, then more than the ring holds.
+static void test_long_burst(Dra818* dra, RxWait* wait) {
+    uint8_t air[200];
+    for(size_t i = 0; i < sizeof(air); i++) {
+        air[i] = i;
+    }
+    sim_dra818_air_receive(SLOT, air, sizeof(air));
+    uint8_t data[256];
+    size_t received = 0;
+    while(received < sizeof(air) && furi_semaphore_acquire(wait->data, 100) == FuriStatusOk) {
+        size_t length;
+        while((length = dra818_rx_read(dra, &data[received], 16)) > 0) {
+            received += length;
+        }
+    }
+    test_check(received == sizeof(air));
+    test_check(memcmp(data, air, sizeof(air)) == 0);
+
+    // Bursts of 30 with nobody reading: the ring keeps the first 256 bytes.
+    for(size_t i = 0; i < 10; i++) {
+        sim_dra818_air_receive(SLOT, &air[i * 10], 30);
+        furi_delay_ms(5);
+    }
+    test_check(dra818_rx_available(dra) == 256);
+    test_check(dra818_rx_overflows(dra) == 300 - 256);
+    test_check(dra818_rx_read(dra, data, sizeof(data)) == 256);
+    test_check(data[0] == 0 && data[30] == 10 && data[255] == 8 * 10 + 15);
+    while(furi_semaphore_acquire(wait->data, 0) == FuriStatusOk) {
+    }
+
+    // Stopped: bytes stay in the module.
+    dra818_rx_stop(dra);
+    sim_dra818_air_receive(SLOT, air, 4);
+    furi_delay_ms(10);
+    test_check(dra818_rx_read(dra, data, sizeof(data)) == 0);
+    test_check(wait->notifies > 0 && furi_semaphore_acquire(wait->data, 0) != FuriStatusOk);
+}
+
+int main(void) {
+    Dra818Bus* bus = dra818_bus_alloc();
+    Dra818* dra = dra818_alloc(bus, SLOT);
+    RxWait wait = {.data = furi_semaphore_alloc(1, 0)};
+    dra818_rx_start(dra, rx_callback, &wait);
+
+    test_stream(dra, &wait);
+    test_deferred(dra, &wait);
+    test_long_burst(dra, &wait);
+
+    furi_semaphore_free(wait.data);
+    dra818_free(dra);
+    dra818_bus_free(bus);
+    return test_result("rx");
+}
@@ -0,0 +1,268 @@
+/*
+ -- test_scan.c
+ -- Scanner against the module model: which channels show active, RSSI
+ -- samples, lockout, priority revisits, parking on a busy channel, the
+ -- achieved channel rate against the module's DMOSETGROUP time, a full AT
+ -- queue, and stop/free with other AT clients around.
+*/
+
+#include <furi.h>
+#include "dra_scan.h"
+#include "sim_dra818.h"
+#include "test.h"
+
+#define SLOT        0
+#define CHANNELS    20
+#define MAX_SAMPLES 256
+
+#define BUSY_STRONG 8 // 146.1000 MHz
+#define BUSY_WEAK   15 // 146.1875 MHz, just above the squelch 1 threshold
+
+typedef struct {
+    Dra818ScanSample samples[MAX_SAMPLES];
+    uint32_t count;
+} ScanLog;
+
+static void scan_callback(const Dra818ScanSample* sample, void* context) {
+    ScanLog* log = context;
+    if(log->count < MAX_SAMPLES) {
+        log->samples[log->count] = *sample;
+    }
+    log->count++;
+}
+
+static const Dra818ScanConfig range_config = {
+    .start = DRA818_FREQ_MHZ(146, 0),
+    .stop = DRA818_FREQ_MHZ(146, 2375),
+    .step = DRA818_STEP_NARROW,
+    .group = {.squelch = 1},
+    .dwell_ms = 20,
+    .priority = DRA818_SCAN_NO_PRIORITY,
+};
+
+static Dra818Freq channel_freq(size_t channel) {
+    return range_config.start + channel * range_config.step;
+}
+
+// Starts once the previous run's last retune is out of the way.
+static void scan_begin(Dra818Scan* scan, const Dra818ScanConfig* config, ScanLog* log) {
+    log->count = 0;
+    bool started = false;
+    for(uint32_t i = 0; i < 20 && !started; i++) {
+        started = dra818_scan_start(scan, config, scan_callback, log);
+        if(!started) {
+            furi_delay_ms(10);
+        }
+    }
+    test_check(started);
+}
+
+// Runs until `samples` were reported and returns the achieved rate.
+static float
+    scan_run(Dra818Scan* scan, const Dra818ScanConfig* config, ScanLog* log, uint32_t samples) {
+    scan_begin(scan, config, log);
+    test_check(dra818_scan_is_running(scan));
+    test_check(!dra818_scan_start(scan, config, scan_callback, log));
+    for(uint32_t i = 0; i < 1000 && log->count < samples; i++) {
+        furi_delay_ms(10);
+    }
+    dra818_scan_stop(scan);
+    test_check(!dra818_scan_is_running(scan));
+    test_check(log->count >= samples);
+    Dra818ScanStats stats;
+    dra818_scan_get_stats(scan, &stats);
+    return stats.rate;
+}
+
+static void test_range(Dra818Scan* scan, ScanLog* log) {
+    test_check(dra818_scan_channel_count(scan) == 0);
+    float rate = scan_run(scan, &range_config, log, CHANNELS);
+    test_check(dra818_scan_channel_count(scan) == CHANNELS);
+    test_check(dra818_scan_channel_freq(scan, BUSY_WEAK) == channel_freq(BUSY_WEAK));
+    for(size_t i = 0; i < CHANNELS; i++) {
+        const Dra818ScanSample* sample = &log->samples[i];
+        test_check(sample->channel == i && sample->freq == channel_freq(i));
+        test_check(sample->active == (i == BUSY_STRONG || i == BUSY_WEAK));
+        test_check(!sample->has_rssi);
+    }
+    // 48-byte DMOSETGROUP, 25 ms in the module and 15 bytes back.  The 20 ms dwell
+    // is hidden behind the next command's text going out.
+    printf("scan: %.1f channels/s squelch only\n", rate);
+    test_check(rate > 10.5f && rate < 11.5f);
+
+    Dra818ScanConfig config = range_config;
+    config.sample_rssi = true;
+    rate = scan_run(scan, &config, log, CHANNELS);
+    for(size_t i = 0; i < CHANNELS; i++) {
+        const Dra818ScanSample* sample = &log->samples[i];
+        test_check(sample->has_rssi);
+        test_check(sample->active == (i == BUSY_STRONG || i == BUSY_WEAK));
+    }
+    test_check(log->samples[BUSY_STRONG].rssi == 90);
+    test_check(log->samples[BUSY_WEAK].rssi == 45);
+    test_check(log->samples[0].rssi == SIM_DRA818_NOISE_RSSI);
+    printf("scan: %.1f channels/s with RSSI?\n", rate);
+    test_check(rate > 7.0f && rate < 8.0f);
+}
+
+// The rate follows the module's DMOSETGROUP time: 48 + 15 bytes at 9600 baud plus
+// group_ms per channel, the dwell being shorter than the command's text.
+static void test_group_time(Dra818Scan* scan, ScanLog* log) {
+    SimDra818Config sim;
+    sim_dra818_get_config(SLOT, &sim);
+    uint32_t group_ms = sim.group_ms;
+    static const uint32_t times[] = {5, 50, 100};
+    for(size_t i = 0; i < COUNT_OF(times); i++) {
+        sim.group_ms = times[i];
+        sim_dra818_set_config(SLOT, &sim);
+        float rate = scan_run(scan, &range_config, log, CHANNELS);
+        float expect = 1000.0f / (66.0f + times[i]);
+        printf("scan: %.1f channels/s with DMOSETGROUP taking %lu ms\n", rate, times[i]);
+        test_check(rate > expect * 0.95f && rate < expect * 1.05f);
+        for(size_t c = 0; c < CHANNELS; c++) {
+            test_check(log->samples[c].active == (c == BUSY_STRONG || c == BUSY_WEAK));
+        }
+    }
+    sim.group_ms = group_ms;
+    sim_dra818_set_config(SLOT, &sim);
+}
+
+static void test_lockout_priority(Dra818Scan* scan, ScanLog* log) {
+    dra818_scan_set_lockout(scan, BUSY_STRONG, true);
+    dra818_scan_set_lockout(scan, 3, true);
+    scan_run(scan, &range_config, log, 2 * CHANNELS);
+    for(size_t i = 0; i < 2 * CHANNELS; i++) {
+        test_check(log->samples[i].channel != BUSY_STRONG && log->samples[i].channel != 3);
+    }
+    dra818_scan_set_lockout(scan, BUSY_STRONG, false);
+    dra818_scan_set_lockout(scan, 3, false);
+
+    // The priority channel comes round after every 4 others.
+    Dra818ScanConfig config = range_config;
+    config.priority = BUSY_WEAK;
+    config.priority_every = 4;
+    scan_run(scan, &config, log, 2 * CHANNELS);
+    uint32_t since = 0;
+    uint32_t visits = 0;
+    for(size_t i = 0; i < 2 * CHANNELS; i++) {
+        if(log->samples[i].channel == BUSY_WEAK) {
+            test_check(since <= 4);
+            since = 0;
+            visits++;
+        } else {
+            since++;
+        }
+    }
+    test_check(visits >= 2 * CHANNELS / 5);
+}
+
+static void test_hang(Dra818Scan* scan, ScanLog* log) {
+    // Parked on the busy channel until it goes quiet.
+    Dra818ScanConfig config = range_config;
+    config.start = channel_freq(BUSY_STRONG);
+    config.hang_ms = 100;
+    scan_begin(scan, &config, log);
+    furi_delay_ms(1000);
+    uint32_t parked = log->count;
+    for(uint32_t i = 0; i < parked; i++) {
+        test_check(log->samples[i].channel == 0 && log->samples[i].active);
+    }
+    test_check(parked >= 8 && parked <= 10);
+    sim_dra818_set_signal(SLOT, channel_freq(BUSY_STRONG), 0, DRA818_TONE_NONE);
+    furi_delay_ms(1000);
+    dra818_scan_stop(scan);
+    test_check(log->count > parked + 3);
+    test_check(log->samples[parked].channel == 0 && !log->samples[parked].active);
+    test_check(log->samples[parked + 1].channel == 1);
+    sim_dra818_set_signal(SLOT, channel_freq(BUSY_STRONG), 90, DRA818_TONE_NONE);
+
+    // A memory list instead of a range.
+    const Dra818Freq list[] = {channel_freq(BUSY_WEAK), DRA818_FREQ_MHZ(145, 5000)};
+    config = range_config;
+    config.list = list;
+    config.list_count = COUNT_OF(list);
+    scan_run(scan, &config, log, 4);
+    test_check(dra818_scan_channel_count(scan) == COUNT_OF(list));
+    test_check(log->samples[0].freq == list[0] && log->samples[0].active);
+    test_check(log->samples[1].freq == list[1] && !log->samples[1].active);
+    test_check(log->samples[2].channel == 0);
+
+    config.list_count = 0;
+    test_check(!dra818_scan_start(scan, &config, scan_callback, log));
+}
+
+static void at_callback(Dra818AtResult result, const char* response, void* context) {
+    UNUSED(response);
+    *(Dra818AtResult*)context = result;
+}
+
+// Another client fills the AT queue: the first retune is retried, not counted as an error.
+static void test_queue_full(Dra818Scan* scan, Dra818At* at, ScanLog* log) {
+    while(dra818_at_pending(at) > 0) {
+        furi_delay_ms(10); // The last run's retune
+    }
+    Dra818AtResult other = Dra818AtResultOk;
+    size_t submitted = 0;
+    while(submitted <= DRA818_AT_QUEUE_SIZE &&
+          dra818_at_submit(at, "AT+DMOCONNECT", "+NEVER", 50, at_callback, &other)) {
+        submitted++;
+    }
+    test_check(submitted >= DRA818_AT_QUEUE_SIZE);
+    scan_begin(scan, &range_config, log);
+    furi_delay_ms(100);
+    dra818_at_cancel(at, &other);
+    for(uint32_t i = 0; i < 100 && log->count < 2; i++) {
+        furi_delay_ms(10);
+    }
+    dra818_scan_stop(scan);
+    Dra818ScanStats stats;
+    dra818_scan_get_stats(scan, &stats);
+    test_check(stats.retries >= 1 && stats.errors == 0);
+    test_check(log->count >= 2 && log->samples[0].channel == 0);
+}
+
+// Stopping mid-retune, then freeing with another client's command still queued.
+static void test_free(Dra818* dra, Dra818At* at, ScanLog* log) {
+    Dra818Scan* scan = dra818_scan_alloc(dra, at);
+    log->count = 0;
+    test_check(dra818_scan_start(scan, &range_config, scan_callback, log));
+    furi_delay_ms(30); // First DMOSETGROUP still in flight
+    dra818_scan_stop(scan);
+    test_check(!dra818_scan_start(scan, &range_config, scan_callback, log));
+
+    Dra818AtResult other = Dra818AtResultCancelled;
+    test_check(dra818_at_submit(at, "AT+DMOCONNECT", "+NEVER", 2000, at_callback, &other));
+    uint64_t start = sim_now_ns();
+    dra818_scan_free(scan);
+    uint64_t waited_ms = (sim_now_ns() - start) / SIM_NS_PER_MS;
+    test_check(waited_ms < 100);
+    uint32_t count = log->count;
+    furi_delay_ms(2500);
+    test_check(log->count == count);
+    test_check(other == Dra818AtResultTimeout);
+}
+
+int main(void) {
+    Dra818Bus* bus = dra818_bus_alloc();
+    Dra818* dra = dra818_alloc(bus, SLOT);
+    Dra818At* at = dra818_at_alloc(FuriHalSerialIdUsart, DRA818_AT_BAUD);
+    sim_dra818_set_signal(SLOT, channel_freq(BUSY_STRONG), 90, DRA818_TONE_NONE);
+    sim_dra818_set_signal(SLOT, channel_freq(BUSY_WEAK), 45, DRA818_TONE_NONE);
+    size_t heap_before = sim_heap_used();
+
+    static ScanLog log;
+    Dra818Scan* scan = dra818_scan_alloc(dra, at);
+    test_range(scan, &log);
+    test_group_time(scan, &log);
+    test_lockout_priority(scan, &log);
+    test_hang(scan, &log);
+    test_queue_full(scan, at, &log);
+    dra818_scan_free(scan);
+    test_free(dra, at, &log);
+    test_check(sim_heap_used() == heap_before);
+
+    dra818_at_free(at);
+    dra818_free(dra);
+    dra818_bus_free(bus);
+    return test_result("scan");
+}
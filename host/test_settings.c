@@ -0,0 +1,198 @@
+/*
+ -- test_settings.c
+ -- Settings record: round trip, corruption, older versions and per-field
+ -- fallback, then the store on simulated storage with debounced writes and a
+ -- slow card.
+*/
+
+#include <furi.h>
+#include <storage/storage.h>
+#include "dra_crc.h"
+#include "dra_settings.h"
+#include "test.h"
+
+#define SETTINGS_PATH APP_DATA_PATH("settings.bin")
+
+static void sample_settings(Dra818Settings* settings) {
+    dra818_settings_defaults(settings);
+    settings->pl_mode = 2;
+    settings->wide = false;
+    settings->squelch = 4;
+    settings->volume = 3;
+    settings->tx_freq = DRA818_FREQ_MHZ(446, 6125);
+    settings->rx_freq = DRA818_FREQ_MHZ(446, 1000);
+    settings->tx_tone = 12;
+    settings->rx_tone = DRA818_TONE_DCS_I(0754);
+    strlcpy(settings->callsign, "KD2XYZ", sizeof(settings->callsign));
+    settings->bus_speed = 2;
+    settings->power_on_ms = 200;
+    settings->power_off_ms = 1000;
+}
+
+static bool settings_equal(const Dra818Settings* a, const Dra818Settings* b) {
+    return memcmp(a, b, sizeof(Dra818Settings)) == 0;
+}
+
+// Re-seal a record after editing it, as an older or buggy writer would have.
+static void record_seal(uint8_t* record, size_t size) {
+    uint16_t crc = dra818_crc16_ccitt(DRA818_CRC16_INIT, record, size - 2);
+    record[size - 2] = crc;
+    record[size - 1] = crc >> 8;
+}
+
+static void test_record(void) {
+    Dra818Settings settings, decoded, defaults;
+    sample_settings(&settings);
+    dra818_settings_defaults(&defaults);
+    uint8_t record[DRA818_SETTINGS_RECORD_SIZE];
+    test_check(dra818_settings_encode(&settings, record, sizeof(record)) == sizeof(record));
+    test_check(dra818_settings_encode(&settings, record, sizeof(record) - 1) == 0);
+    test_check(dra818_settings_decode(record, sizeof(record), &decoded));
+    test_check(settings_equal(&settings, &decoded));
+    // The trailer is the catalogue CRC-16/CCITT-FALSE (check value 0x29B1).
+    test_check(dra818_crc16_ccitt(DRA818_CRC16_INIT, (const uint8_t*)"123456789", 9) == 0x29B1);
+    uint16_t trailer = record[sizeof(record) - 2] | record[sizeof(record) - 1] << 8;
+    test_check(dra818_crc16_ccitt(DRA818_CRC16_INIT, record, sizeof(record) - 2) == trailer);
+
+    // Every single-bit error is caught and leaves the defaults.
+    uint32_t accepted = 0;
+    for(size_t bit = 0; bit < sizeof(record) * 8; bit++) {
+        record[bit / 8] ^= 1 << (bit % 8);
+        accepted += dra818_settings_decode(record, sizeof(record), &decoded);
+        accepted += !settings_equal(&decoded, &defaults);
+        record[bit / 8] ^= 1 << (bit % 8);
+    }
+    test_check(accepted == 0);
+    test_check(!dra818_settings_decode(record, sizeof(record) - 1, &decoded));
+    test_check(!dra818_settings_decode(record, 0, &decoded));
+
+    // Fields out of range keep their defaults; the rest load.
+    record[8 + 2] = 9; // squelch
+    record[8 + 3] = 0; // volume
+    record[8 + 4] = 0; // tx_freq 0x...00 is off the grid
+    record_seal(record, sizeof(record));
+    test_check(dra818_settings_decode(record, sizeof(record), &decoded));
+    test_check(decoded.squelch == defaults.squelch && decoded.volume == defaults.volume);
+    test_check(decoded.tx_freq == defaults.tx_freq);
+    test_check(decoded.rx_freq == settings.rx_freq && decoded.rx_tone == settings.rx_tone);
+    test_check(strcmp(decoded.callsign, "KD2XYZ") == 0);
+
+    // A version 1 record: no bus speed and no power-save fields.
+    size_t size_v1 = 8 + DRA818_SETTINGS_PAYLOAD_SIZE_V1 + 2;
+    test_check(dra818_settings_encode(&settings, record, sizeof(record)) == sizeof(record));
+    record[4] = 1;
+    record[6] = DRA818_SETTINGS_PAYLOAD_SIZE_V1;
+    record_seal(record, size_v1);
+    test_check(dra818_settings_decode(record, size_v1, &decoded));
+    test_check(decoded.rx_freq == settings.rx_freq);
+    test_check(decoded.bus_speed == DRA818_SETTINGS_BUS_SPEED_NONE);
+    test_check(decoded.power_on_ms == defaults.power_on_ms && decoded.power_off_ms == 0);
+
+    size_t size_v2 = 8 + DRA818_SETTINGS_PAYLOAD_SIZE_V2 + 2;
+    test_check(dra818_settings_encode(&settings, record, sizeof(record)) == sizeof(record));
+    record[4] = 2;
+    record[6] = DRA818_SETTINGS_PAYLOAD_SIZE_V2;
+    record_seal(record, size_v2);
+    test_check(dra818_settings_decode(record, size_v2, &decoded));
+    test_check(decoded.bus_speed == 2 && decoded.power_off_ms == 0);
+
+    // A record from a newer version is not guessed at.
+    test_check(dra818_settings_encode(&settings, record, sizeof(record)) == sizeof(record));
+    record[4] = DRA818_SETTINGS_VERSION + 1;
+    record_seal(record, sizeof(record));
+    test_check(!dra818_settings_decode(record, sizeof(record), &decoded));
+}
+
+static void test_store(void) {
+    size_t heap_before = sim_heap_used();
+    Dra818SettingsStats stats;
+    Dra818Settings settings, defaults;
+    dra818_settings_defaults(&defaults);
+
+    Dra818SettingsStore* store = dra818_settings_alloc(SETTINGS_PATH);
+    dra818_settings_get_stats(store, &stats);
+    test_check(!stats.loaded);
+    dra818_settings_get(store, &settings);
+    test_check(settings_equal(&settings, &defaults));
+
+    // Scrolling through 30 values at 5 keypresses a second: one write after the pause.
+    for(uint8_t i = 0; i < 30; i++) {
+        settings.rx_freq = DRA818_FREQ_MHZ(146, 0) + i * DRA818_STEP_WIDE;
+        dra818_settings_set(store, &settings);
+        furi_delay_ms(200);
+    }
+    dra818_settings_set(store, &settings); // Unchanged
+    dra818_settings_get_stats(store, &stats);
+    test_check(stats.changes == 30 && stats.writes == 0);
+    furi_delay_ms(DRA818_SETTINGS_DEBOUNCE_MS - 200 - 10);
+    dra818_settings_get_stats(store, &stats);
+    test_check(stats.writes == 0);
+    furi_delay_ms(20);
+    dra818_settings_get_stats(store, &stats);
+    test_check(stats.writes == 1);
+
+    // Pending on exit: free writes it.
+    sample_settings(&settings);
+    dra818_settings_set(store, &settings);
+    dra818_settings_free(store);
+
+    store = dra818_settings_alloc(SETTINGS_PATH);
+    dra818_settings_get_stats(store, &stats);
+    test_check(stats.loaded && stats.writes == 0);
+    Dra818Settings loaded;
+    dra818_settings_get(store, &loaded);
+    test_check(settings_equal(&settings, &loaded));
+    test_check(dra818_settings_flush(store)); // Nothing to write
+    dra818_settings_free(store);
+
+    // A directory that does not exist: the write fails and is counted.
+    store = dra818_settings_alloc(APP_DATA_PATH("missing/settings.bin"));
+    dra818_settings_set(store, &settings);
+    test_check(!dra818_settings_flush(store));
+    dra818_settings_get_stats(store, &stats);
+    test_check(stats.write_errors == 1 && stats.writes == 0);
+    dra818_settings_free(store);
+    test_check(sim_heap_used() == heap_before);
+}
+
+// A slow card: get and set do not wait for a write in progress, and a change made
+// during the write is not lost when it completes.
+static void test_slow_write(void) {
+    Dra818SettingsStats stats;
+    Dra818Settings settings, loaded;
+    sim_storage_set_write_ms(50);
+    Dra818SettingsStore* store = dra818_settings_alloc(SETTINGS_PATH);
+    dra818_settings_get(store, &settings);
+
+    settings.volume = 5;
+    dra818_settings_set(store, &settings);
+    furi_delay_ms(DRA818_SETTINGS_DEBOUNCE_MS + 10); // The writer is in the middle of it
+    uint64_t start = sim_now_ns();
+    settings.volume = 6;
+    dra818_settings_set(store, &settings);
+    dra818_settings_get(store, &loaded);
+    test_check(sim_now_ns() == start && loaded.volume == 6);
+
+    furi_delay_ms(100);
+    dra818_settings_get_stats(store, &stats);
+    test_check(stats.writes == 1);
+    furi_delay_ms(DRA818_SETTINGS_DEBOUNCE_MS);
+    dra818_settings_get_stats(store, &stats);
+    test_check(stats.writes == 2);
+    test_check(dra818_settings_flush(store)); // Nothing left to write
+    dra818_settings_free(store);
+
+    store = dra818_settings_alloc(SETTINGS_PATH);
+    dra818_settings_get(store, &loaded);
+    test_check(loaded.volume == 6);
+    dra818_settings_free(store);
+    sim_storage_set_write_ms(0);
+}
+
+int main(void) {
+    sim_storage_root("test_settings_storage");
+    test_record();
+    test_store();
+    test_slow_write();
+    return test_result("settings");
+}
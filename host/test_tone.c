@@ -0,0 +1,149 @@
+/*
+ -- test_tone.c
+ -- Tone engine: oscillator frequency accuracy and per-sample cost, then
+ -- playback through the TIM1 interrupt into the captured LPTIM2 compare
+ -- values, with sequence timing, stop and the done callback.
+*/
+
+#include <furi.h>
+#include "dra_tone.h"
+#include "test.h"
+
+#define CAPTURE_MAX (DRA818_TONE_SAMPLE_RATE * 2)
+
+// Positive-going zero crossings: a negative sample followed by one at or above zero.
+static uint32_t rising_crossings(const int32_t* samples, size_t count) {
+    uint32_t crossings = 0;
+    for(size_t i = 1; i < count; i++) {
+        crossings += samples[i - 1] < 0 && samples[i] >= 0;
+    }
+    return crossings;
+}
+
+static uint32_t osc_crossings(uint32_t freq, uint32_t seconds, int16_t* peak) {
+    Dra818ToneStep step = {.f1 = freq, .level = DRA818_TONE_LEVEL_AUDIO};
+    Dra818ToneOsc osc;
+    dra818_tone_osc_set(&osc, &step, DRA818_TONE_SAMPLE_RATE);
+    uint32_t crossings = 0;
+    int32_t last = 0;
+    *peak = 0;
+    for(uint32_t i = 0; i < seconds * DRA818_TONE_SAMPLE_RATE; i++) {
+        int16_t sample = dra818_tone_osc_next(&osc);
+        crossings += last < 0 && sample >= 0;
+        last = sample;
+        *peak = MAX(*peak, sample);
+    }
+    return crossings;
+}
+
+static void test_osc(void) {
+    int16_t peak;
+    // 17500 cycles in 10 s; the first starts at phase 0, not from below zero.
+    test_check(osc_crossings(DRA818_TONE_BURST_HZ10, 10, &peak) == 17499);
+    test_check(peak > 32767 * DRA818_TONE_LEVEL_AUDIO / 256 - 200);
+    test_check(peak <= 32767 * DRA818_TONE_LEVEL_AUDIO / 256);
+    // CTCSS 67.0 Hz and 250.3 Hz, the ends of the table.
+    uint32_t low = osc_crossings(dra818_ctcss_tones[0], 10, &peak);
+    test_check(low >= 669 && low <= 670);
+    uint32_t high = osc_crossings(dra818_ctcss_tones[DRA818_CTCSS_COUNT - 1], 10, &peak);
+    test_check(high >= 2502 && high <= 2503);
+
+    // Dual tone: both oscillators at full level never exceed the single-tone peak.
+    Dra818ToneStep dtmf = {.f1 = 9410, .f2 = 16330, .level = 255};
+    Dra818ToneOsc osc;
+    dra818_tone_osc_set(&osc, &dtmf, DRA818_TONE_SAMPLE_RATE);
+    int32_t max = 0;
+    volatile int32_t sink = 0;
+    uint64_t start = sim_cpu_ns();
+    for(uint32_t i = 0; i < 10 * DRA818_TONE_SAMPLE_RATE; i++) {
+        int16_t sample = dra818_tone_osc_next(&osc);
+        max = MAX(max, abs(sample));
+        sink += sample;
+    }
+    uint64_t cpu_ns = sim_cpu_ns() - start;
+    test_check(max > 30000 && max <= 32767);
+    printf(
+        "tone: 1750 Hz gives 17499 crossings in 10 s, %.1f ns per dual-tone sample\n",
+        (double)cpu_ns / (10 * DRA818_TONE_SAMPLE_RATE));
+}
+
+typedef struct {
+    FuriSemaphore* done;
+    bool completed;
+    uint64_t at_ns;
+} ToneWait;
+
+static void done_callback(bool completed, void* context) {
+    ToneWait* wait = context;
+    wait->completed = completed;
+    wait->at_ns = sim_now_ns();
+    furi_semaphore_release(wait->done);
+}
+
+// Compare values back to signed samples around the 50 % duty point.
+static size_t capture_samples(const uint32_t* capture, size_t count, int32_t* samples) {
+    uint32_t half = capture[0];
+    for(size_t i = 0; i < count; i++) {
+        samples[i] = (int32_t)capture[i] - (int32_t)half;
+    }
+    return count;
+}
+
+static void test_playback(void) {
+    static uint32_t capture[CAPTURE_MAX];
+    static int32_t samples[CAPTURE_MAX];
+    ToneWait wait = {.done = furi_semaphore_alloc(1, 0)};
+
+    sim_pwm_capture(capture, CAPTURE_MAX);
+    uint64_t start = sim_now_ns();
+    test_check(dra818_tone_play_burst(500, done_callback, &wait));
+    test_check(dra818_tone_busy());
+    test_check(!dra818_tone_play_tone(10000, 100, done_callback, &wait));
+    test_check(furi_semaphore_acquire(wait.done, 2000) == FuriStatusOk);
+    test_check(wait.completed);
+    test_check(!dra818_tone_busy());
+    uint64_t played_ms = (wait.at_ns - start) / SIM_NS_PER_MS;
+    test_check(played_ms >= 500 && played_ms <= 502);
+
+    // One compare write to silence, then a sample per tick.
+    size_t count = sim_pwm_captured();
+    test_check(count >= 500 * DRA818_TONE_SAMPLE_RATE / 1000);
+    test_check(count <= 500 * DRA818_TONE_SAMPLE_RATE / 1000 + 2);
+    capture_samples(capture, count, samples);
+    uint32_t crossings = rising_crossings(samples, count);
+    test_check(crossings >= 874 && crossings <= 875);
+    test_check(samples[count - 1] == 0); // Left silent
+    printf(
+        "tone: 500 ms burst, %lu samples, %lu crossings on LPTIM2\n",
+        (unsigned long)count,
+        (unsigned long)crossings);
+
+    // A DTMF string: 3 digits of 80 ms, each followed by a 40 ms gap.
+    sim_pwm_capture(capture, CAPTURE_MAX);
+    start = sim_now_ns();
+    test_check(dra818_tone_play_dtmf("1x2#", 80, 40, done_callback, &wait));
+    test_check(furi_semaphore_acquire(wait.done, 2000) == FuriStatusOk);
+    played_ms = (wait.at_ns - start) / SIM_NS_PER_MS;
+    test_check(wait.completed && played_ms >= 3 * 120 && played_ms <= 3 * 120 + 2);
+    capture_samples(capture, sim_pwm_captured(), samples);
+    uint32_t gap_start = 80 * DRA818_TONE_SAMPLE_RATE / 1000 + 10;
+    test_check(samples[gap_start] == 0 && samples[gap_start + 100] == 0);
+
+    // Stopped before its end: the callback reports it.
+    sim_pwm_capture(NULL, 0);
+    test_check(dra818_tone_play_ctcss(1, DRA818_TONE_FOREVER, done_callback, &wait));
+    furi_delay_ms(300);
+    test_check(dra818_tone_busy());
+    dra818_tone_stop();
+    test_check(furi_semaphore_acquire(wait.done, 100) == FuriStatusOk);
+    test_check(!wait.completed && !dra818_tone_busy());
+    test_check(dra818_tone_play_tone(10000, 20, done_callback, &wait));
+    test_check(furi_semaphore_acquire(wait.done, 100) == FuriStatusOk && wait.completed);
+    furi_semaphore_free(wait.done);
+}
+
+int main(void) {
+    test_osc();
+    test_playback();
+    return test_result("tone");
+}
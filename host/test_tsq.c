@@ -0,0 +1,378 @@
+/*
+ -- test_tsq.c
+ -- Tone squelch detector: every CTCSS tone and DCS code under voice and noise,
+ -- detect and lose latency, the target filter, per-block cost, the ADC feed on
+ -- the simulated receive audio, then the WAV capture in vectors/ against its
+ -- timeline.
+ --
+ --   test_tsq <file.wav>   prints the tones found in another capture
+*/
+
+#include <furi.h>
+#include <math.h>
+#include "dra_adc.h"
+#include "dra_tsq.h"
+#include "test.h"
+
+#define RATE       8000
+#define BLOCK      256
+#define LEVEL      300 // Sub-audio peak, 12-bit
+#define VOICE      800 // 1 kHz voice stand-in
+#define NOISE      100
+#define GOLAY_POLY 0xC75
+
+typedef enum {
+    SignalNone,
+    SignalCtcss,
+    SignalDcs,
+} SignalKind;
+
+typedef struct {
+    SignalKind kind;
+    bool inverted;
+    float freq; // CTCSS, Hz
+    uint32_t word; // DCS codeword, LSB first
+    uint32_t sample; // Samples since the start
+} Signal;
+
+typedef struct {
+    Dra818Tone tone;
+    bool present;
+    uint32_t events;
+    uint32_t at; // Sample of the last event
+    uint32_t sample; // Samples fed so far
+} TsqLog;
+
+static uint32_t noise_state = 1;
+
+static int16_t noise(void) {
+    noise_state = noise_state * 1664525 + 1013904223;
+    return (int16_t)((noise_state >> 16) % (2 * NOISE + 1)) - NOISE;
+}
+
+// Known answers, LSB first as sent: 023 is 763813 in the DCS tables.  A
+// generator copied from the detector would share its mistakes.
+typedef struct {
+    uint16_t code;
+    uint32_t word;
+} DcsAnswer;
+
+static const DcsAnswer dcs_answers[] = {
+    {023, 0x763813},
+    {025, 0x6B7815},
+    {047, 0x0FD827},
+    {0116, 0x7C184E},
+    {0627, 0x01F997},
+    {0754, 0x20F9EC},
+};
+
+// The sweep's codewords, built independently: 9 code bits, 100, 11 parity bits.
+static uint32_t dcs_word(uint16_t code) {
+    uint32_t data = (code & 0x1FF) | 0x800;
+    uint32_t rem = data << 11;
+    for(int bit = 22; bit >= 11; bit--) {
+        if(rem & (1UL << bit)) {
+            rem ^= (uint32_t)GOLAY_POLY << (bit - 11);
+        }
+    }
+    return data | (rem << 12);
+}
+
+static int16_t signal_next(Signal* signal) {
+    uint32_t n = signal->sample++;
+    float t = (float)n / RATE;
+    int32_t value = VOICE * sinf(2 * (float)M_PI * 1000 * t) + noise();
+    if(signal->kind == SignalCtcss) {
+        value += LEVEL * sinf(2 * (float)M_PI * signal->freq * t);
+    } else if(signal->kind == SignalDcs) {
+        uint32_t bit = (uint64_t)n * DRA818_TSQ_DCS_BAUD10 / (10 * RATE) % 23;
+        bool one = ((signal->word >> bit) & 1) != signal->inverted;
+        value += one ? LEVEL : -LEVEL;
+    }
+    return value;
+}
+
+static void tsq_callback(Dra818Tone tone, bool present, void* context) {
+    TsqLog* log = context;
+    log->tone = tone;
+    log->present = present;
+    log->events++;
+    log->at = log->sample;
+}
+
+static uint32_t timed_blocks;
+
+static void feed(Dra818Tsq* tsq, Signal* signal, TsqLog* log, uint32_t ms, uint64_t* cpu_ns) {
+    int16_t block[BLOCK];
+    for(uint32_t left = ms * RATE / 1000; left > 0;) {
+        size_t count = MIN(left, BLOCK);
+        for(size_t i = 0; i < count; i++) {
+            block[i] = signal_next(signal);
+        }
+        uint64_t start = sim_cpu_ns();
+        dra818_tsq_process(tsq, block, count);
+        if(cpu_ns) {
+            *cpu_ns += sim_cpu_ns() - start;
+            timed_blocks++;
+        }
+        log->sample += count;
+        left -= count;
+    }
+}
+
+// One tone after lead_ms of voice only: returns the detect latency in ms, or 0.
+static uint32_t detect(Signal signal, Dra818Tone tone, uint32_t lead_ms, uint64_t* cpu_ns) {
+    TsqLog log = {0};
+    Dra818Tsq* tsq = dra818_tsq_alloc(RATE, NULL, tsq_callback, &log);
+    Signal voice = {.kind = SignalNone};
+    feed(tsq, &voice, &log, lead_ms, cpu_ns);
+    bool quiet = log.events == 0;
+
+    uint32_t onset = log.sample;
+    signal.sample = voice.sample;
+    feed(tsq, &signal, &log, 2000, cpu_ns);
+    // detect_ms runs from the start of the first agreeing window: two decisions 250 ms
+    // apart on 500 ms windows.
+    Dra818TsqStats stats;
+    dra818_tsq_get_stats(tsq, &stats);
+    uint32_t latency_ms = 0;
+    if(quiet && log.events == 1 && log.present && log.tone == tone &&
+       stats.detect_ms >= 745 && stats.detect_ms <= 755) {
+        latency_ms = (log.at - onset) * 1000 / RATE;
+    }
+
+    // Lost once the tone stops, and only then.
+    voice.sample = signal.sample;
+    uint32_t stop = log.sample;
+    feed(tsq, &voice, &log, 2000, cpu_ns);
+    if(log.events != 2 || log.present || log.tone != tone ||
+       (log.at - stop) * 1000 / RATE > 1500 || dra818_tsq_current(tsq) != DRA818_TONE_NONE) {
+        latency_ms = 0;
+    }
+    dra818_tsq_free(tsq);
+    return latency_ms;
+}
+
+static void test_ctcss(void) {
+    uint32_t worst = 0;
+    uint32_t total = 0;
+    uint64_t cpu_ns = 0;
+    for(size_t i = 0; i < DRA818_CTCSS_COUNT; i++) {
+        Signal signal = {.kind = SignalCtcss, .freq = dra818_ctcss_tones[i] / 10.0f};
+        // Onsets spread over a decision interval.
+        uint32_t latency = detect(signal, (Dra818Tone)(i + 1), 1000 + i * 7, &cpu_ns);
+        test_check(latency > 0);
+        worst = MAX(worst, latency);
+        total += latency;
+    }
+    // The first agreeing window can start before the tone does.
+    test_check(worst <= 750);
+    printf(
+        "tsq: 38 CTCSS tones, detect %lu ms mean, %lu ms worst after onset, %.1f us per %u "
+        "samples\n",
+        (unsigned long)(total / DRA818_CTCSS_COUNT),
+        (unsigned long)worst,
+        (double)cpu_ns / timed_blocks / 1000,
+        BLOCK);
+    test_check(total / DRA818_CTCSS_COUNT >= 250);
+}
+
+static void test_dcs(void) {
+    for(size_t i = 0; i < COUNT_OF(dcs_answers); i++) {
+        test_check(dcs_word(dcs_answers[i].code) == dcs_answers[i].word);
+    }
+
+    uint32_t worst = 0;
+    uint32_t missed = 0;
+    for(size_t i = 0; i < DRA818_DCS_COUNT; i++) {
+        uint16_t code = dra818_dcs_codes[i];
+        Signal signal = {.kind = SignalDcs, .word = dcs_word(code)};
+        uint32_t latency = detect(signal, DRA818_TONE_DCS(code), 1000 + i * 7 % 250, NULL);
+        missed += latency == 0;
+        worst = MAX(worst, latency);
+    }
+    test_check(missed == 0);
+    test_check(worst <= 1000);
+    printf(
+        "tsq: %u DCS codes, detect %lu ms worst after onset\n",
+        DRA818_DCS_COUNT,
+        (unsigned long)worst);
+
+    // Every inverted code in the table is a rotation of a normal one, which is what
+    // comes out: 047I is the bit stream of 023N, 754I that of 116N.
+    Signal signal = {.kind = SignalDcs, .word = 0x0FD827, .inverted = true};
+    test_check(detect(signal, DRA818_TONE_DCS(023), 1000, NULL) > 0);
+    signal.word = 0x20F9EC;
+    test_check(detect(signal, DRA818_TONE_DCS(0116), 1000, NULL) > 0);
+    signal = (Signal){.kind = SignalDcs, .word = 0x763813};
+    test_check(detect(signal, DRA818_TONE_DCS(023), 1000, NULL) > 0);
+}
+
+static void test_target(void) {
+    TsqLog log = {0};
+    Dra818TsqStats stats;
+    Dra818Tsq* tsq = dra818_tsq_alloc(RATE, NULL, tsq_callback, &log);
+    test_check(!dra818_tsq_alloc(2 * DRA818_TSQ_DECIMATED_HZ - 1, NULL, NULL, NULL));
+    test_check(!dra818_tsq_alloc(DRA818_ADC_RATE_MAX + 1, NULL, NULL, NULL));
+
+    // Another tone on the channel: nothing reported.
+    dra818_tsq_set_target(tsq, 12);
+    Signal signal = {.kind = SignalCtcss, .freq = dra818_ctcss_tones[19] / 10.0f};
+    feed(tsq, &signal, &log, 3000, NULL);
+    test_check(log.events == 0);
+    dra818_tsq_get_stats(tsq, &stats);
+    test_check(stats.decisions >= 11 && stats.detects == 0);
+    test_check(stats.samples == 3 * RATE);
+
+    // The wanted one is.
+    signal.freq = dra818_ctcss_tones[11] / 10.0f;
+    feed(tsq, &signal, &log, 2000, NULL);
+    test_check(log.events == 1 && log.present && log.tone == 12);
+    dra818_tsq_get_stats(tsq, &stats);
+    test_check(stats.detects == 1 && stats.detect_ms >= 500 && stats.detect_ms <= 1000);
+
+    // DCS targets match either polarity, so the inverted code is reported as such.
+    dra818_tsq_set_target(tsq, DRA818_TONE_DCS(0754));
+    signal = (Signal){.kind = SignalDcs, .word = dcs_word(0754), .inverted = true};
+    feed(tsq, &signal, &log, 3000, NULL);
+    test_check(log.events == 3 && log.present && log.tone == DRA818_TONE_DCS_I(0754));
+    dra818_tsq_get_stats(tsq, &stats);
+    test_check(stats.losses == 1 && stats.dcs_words > 0);
+    dra818_tsq_free(tsq);
+
+    // Voice and noise alone for a minute: no false detects.
+    log = (TsqLog){0};
+    tsq = dra818_tsq_alloc(RATE, NULL, tsq_callback, &log);
+    signal = (Signal){.kind = SignalNone};
+    feed(tsq, &signal, &log, 60000, NULL);
+    test_check(log.events == 0);
+    dra818_tsq_free(tsq);
+}
+
+static uint16_t adc_source(uint64_t now_ns, void* context) {
+    UNUSED(context);
+    float t = (float)(now_ns / 1000) / 1000000;
+    return 2048 + LEVEL * sinf(2 * (float)M_PI * 100.0f * t);
+}
+
+static void test_adc(void) {
+    TsqLog log = {0};
+    Dra818Tsq* tsq = dra818_tsq_alloc(RATE, NULL, tsq_callback, &log);
+    sim_adc_set_source(adc_source, NULL);
+    test_check(dra818_tsq_rx_start(tsq));
+    test_check(!dra818_tsq_rx_start(tsq));
+    furi_delay_ms(1500);
+    dra818_tsq_rx_stop();
+    sim_adc_set_source(NULL, NULL);
+    // 100.0 Hz is tone 12.
+    test_check(log.events == 1 && log.present && log.tone == 12);
+    test_check(dra818_adc_overruns() == 0);
+    dra818_tsq_free(tsq);
+}
+
+// vectors/tsq_8000.wav: voice with tones off frequency and off baud, squelch-open
+// hiss between transmissions.  754I is the bit stream of 116N.
+typedef struct {
+    Dra818Tone tone;
+    uint32_t start_ms;
+    uint32_t end_ms;
+} TsqSegment;
+
+static const TsqSegment tsq_timeline[] = {
+    {12, 2000, 7000}, // 100.0 Hz
+    {DRA818_TONE_DCS(023), 9000, 14000},
+    {24, 16000, 21000}, // 151.4 Hz
+    {DRA818_TONE_DCS(0116), 23000, 28000},
+    {38, 30000, 35000}, // 250.3 Hz
+};
+
+typedef struct {
+    uint32_t rate;
+    uint32_t sample; // Samples fed so far
+    const TsqSegment* timeline; // NULL: print what is found
+    size_t count;
+    size_t next;
+    bool in_order;
+} TsqReplay;
+
+static void replay_callback(Dra818Tone tone, bool present, void* context) {
+    TsqReplay* replay = context;
+    uint32_t at_ms = replay->sample * 1000ULL / replay->rate;
+    if(!replay->timeline) {
+        printf("tsq: %lu ms %s %04x\n", (unsigned long)at_ms, present ? "on " : "off", tone);
+        return;
+    }
+    // Detect within a second of the onset, lose within 1.5 s of the end.
+    size_t index = MIN(replay->next / 2, replay->count - 1);
+    const TsqSegment* segment = &replay->timeline[index];
+    uint32_t from = present ? segment->start_ms : segment->end_ms;
+    uint32_t to = from + (present ? 1000 : 1500);
+    if(replay->next / 2 >= replay->count || tone != segment->tone ||
+       present != !(replay->next & 1) || at_ms < from || at_ms > to) {
+        printf(
+            "tsq: unexpected %s %04x at %lu ms\n",
+            present ? "on" : "off",
+            tone,
+            (unsigned long)at_ms);
+        replay->in_order = false;
+    }
+    replay->next++;
+}
+
+static void test_wav(const char* path, const TsqSegment* timeline, size_t count) {
+    SimWav wav;
+    test_check(sim_wav_read(path, &wav));
+    if(!wav.count) {
+        printf("tsq: cannot read %s\n", path);
+        return;
+    }
+    TsqReplay replay = {
+        .rate = wav.sample_rate,
+        .timeline = timeline,
+        .count = count,
+        .in_order = true,
+    };
+    Dra818Tsq* tsq = dra818_tsq_alloc(wav.sample_rate, NULL, replay_callback, &replay);
+    test_check(tsq);
+    int16_t block[BLOCK];
+    uint64_t cpu_ns = 0;
+    for(size_t i = 0; tsq && i < wav.count; i += BLOCK) {
+        size_t n = MIN((size_t)BLOCK, wav.count - i);
+        for(size_t j = 0; j < n; j++) {
+            block[j] = wav.samples[i + j] >> 4; // 16 to 12 bits, as from the ADC
+        }
+        uint64_t start = sim_cpu_ns();
+        dra818_tsq_process(tsq, block, n);
+        cpu_ns += sim_cpu_ns() - start;
+        replay.sample += n;
+    }
+    if(timeline) {
+        test_check(replay.in_order && replay.next == 2 * count);
+        const char* name = strrchr(path, '/');
+        printf(
+            "tsq: %s, %lu S/s, %u/%u events, %.1f ns per sample\n",
+            name ? name + 1 : path,
+            (unsigned long)wav.sample_rate,
+            (unsigned)replay.next,
+            (unsigned)(2 * count),
+            (double)cpu_ns / wav.count);
+    }
+    if(tsq) {
+        dra818_tsq_free(tsq);
+    }
+    sim_wav_free(&wav);
+}
+
+int main(int argc, char** argv) {
+    if(argc == 2) {
+        test_wav(argv[1], NULL, 0);
+        return test_result("tsq");
+    }
+
+    test_ctcss();
+    test_dcs();
+    test_target();
+    test_adc();
+    test_wav(DRA_VECTORS_DIR "/tsq_8000.wav", tsq_timeline, COUNT_OF(tsq_timeline));
+    return test_result("tsq");
+}
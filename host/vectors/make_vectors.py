@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+#
+# make_vectors.py
+# Writes the WAV captures the host tests decode.
+#
+# No off-air recordings ship with the tree, so the captures are synthesised
+# with an implementation independent of dra_afsk.c. They carry what a radio's
+# audio output adds: band limiting, mark/space twist from (missing)
+# de-emphasis, a transmitter baud clock that is off by up to 1%, DC offset,
+# level changes between stations, hiss between and under the packets, and
+# frames damaged on the air. The intact frame counts are printed; test_afsk
+# keeps them in its vector table.
+#
+# The tone squelch capture is voice-like audio (a wandering pitch through
+# moving formants, in syllables) with CTCSS tones and DCS codes under it, off
+# by as much as real encoders are, through the receiver's AC coupling, with
+# squelch-open hiss between the transmissions. test_tsq keeps its timeline.
+#
+# Real recordings (e.g. a TNC test CD track) can be decoded the same way:
+#   test_afsk <file.wav> <frames>
+#   test_tsq <file.wav>
+#
+# Run from anywhere; the files land next to this script. The output is
+# deterministic.
+
+import math
+import os
+import random
+import struct
+import wave
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+# AX.25 / HDLC framing
+
+
+def ax25_address(call, last):
+    name, _, ssid = call.partition("-")
+    out = bytes((ord(c) << 1) for c in name.ljust(6)[:6])
+    return out + bytes([0x60 | (int(ssid or 0) << 1) | (1 if last else 0)])
+
+
+def ax25_ui(dest, source, path, info):
+    calls = [dest, source] + path
+    frame = b"".join(ax25_address(c, i == len(calls) - 1) for i, c in enumerate(calls))
+    return frame + b"\x03\xf0" + info.encode("ascii")
+
+
+def crc16_x25(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x8408 if crc & 1 else crc >> 1
+    return crc ^ 0xFFFF
+
+
+def hdlc_bits(frame, preamble, tail, damage=None):
+    """Flags, stuffed frame + FCS (LSB first) and flags, before NRZI."""
+    fcs = crc16_x25(frame)
+    body = []
+    for byte in frame + bytes([fcs & 0xFF, fcs >> 8]):
+        body += [(byte >> i) & 1 for i in range(8)]
+    if damage is not None:
+        body[damage % len(body)] ^= 1  # One bit hit on the air
+    stuffed = []
+    ones = 0
+    for bit in body:
+        stuffed.append(bit)
+        ones = ones + 1 if bit else 0
+        if ones == 5:
+            stuffed.append(0)
+            ones = 0
+    flag = [0, 1, 1, 1, 1, 1, 1, 0]
+    return flag * preamble + stuffed + flag * tail
+
+
+# Audio
+
+
+class Biquad:
+    """RBJ cookbook low/high pass, direct form I."""
+
+    def __init__(self, kind, freq, rate, q=0.7071):
+        w = 2 * math.pi * freq / rate
+        alpha = math.sin(w) / (2 * q)
+        cos = math.cos(w)
+        if kind == "low":
+            b = [(1 - cos) / 2, 1 - cos, (1 - cos) / 2]
+        else:
+            b = [(1 + cos) / 2, -(1 + cos), (1 + cos) / 2]
+        a = [1 + alpha, -2 * cos, 1 - alpha]
+        self.b = [x / a[0] for x in b]
+        self.a = [x / a[0] for x in a]
+        self.x = [0.0, 0.0]
+        self.y = [0.0, 0.0]
+
+    def __call__(self, x):
+        y = (self.b[0] * x + self.b[1] * self.x[0] + self.b[2] * self.x[1]
+             - self.a[1] * self.y[0] - self.a[2] * self.y[1])
+        self.x = [x, self.x[0]]
+        self.y = [y, self.y[0]]
+        return y
+
+
+class Coupling:
+    """First-order high pass: the coupling capacitor in front of the ADC."""
+
+    def __init__(self, freq, rate):
+        self.a = 1 / (1 + 2 * math.pi * freq / rate)
+        self.x = 0.0
+        self.y = 0.0
+
+    def __call__(self, x):
+        self.y = self.a * (self.y + x - self.x)
+        self.x = x
+        return self.y
+
+
+class Channel:
+    """Receiver audio path: 300..3000 Hz passband, hiss, DC offset."""
+
+    def __init__(self, rate, noise, dc, rng):
+        self.filters = [Biquad("high", 300, rate), Biquad("high", 300, rate),
+                        Biquad("low", 3000, rate), Biquad("low", 3000, rate)]
+        self.noise = noise
+        self.dc = dc
+        self.rng = rng
+
+    def __call__(self, x):
+        x += self.rng.gauss(0, self.noise)
+        for f in self.filters:
+            x = f(x)
+        return x + self.dc
+
+
+def afsk(bits, rate, baud, level, twist_db, phase):
+    """NRZI, phase-continuous 1200/2200 Hz. Mark starts; a 0 changes the tone."""
+    space_level = level * 10 ** (twist_db / 20)
+    mark = True
+    out = []
+    t = 0.0
+    per_bit = rate / baud
+    for bit in bits:
+        if bit == 0:
+            mark = not mark
+        t += per_bit
+        while len(out) < int(t):
+            freq = 1200 if mark else 2200
+            phase += 2 * math.pi * freq / rate
+            out.append((level if mark else space_level) * math.sin(phase))
+    return out, phase
+
+
+def capture(name, rate, frames, damaged, twist_db, snr_db, baud_error, dc, seed):
+    rng = random.Random(seed)
+    level = 9000.0
+    noise = level / math.sqrt(2) / 10 ** (snr_db / 20)
+    channel = Channel(rate, noise, dc, rng)
+    samples = []
+    phase = 0.0
+    good = 0
+    texts = ["!4903.50N/07201.75W-PHG2360/Digi", ">Net tonight 2000 local on 146.520",
+             "=4237.14N/07120.83W#W2, MAn, digi", "`c7=l!Xu/]\"4F}=", "T#479,100,048,002,500,000,10000001"]
+    for i in range(frames):
+        source = "N%dCALL-%d" % (rng.randrange(10), rng.randrange(16))
+        path = ["WIDE1-1", "WIDE2-%d" % rng.randrange(1, 3)][: rng.randrange(3)]
+        info = "%s #%03d" % (texts[i % len(texts)], i)
+        frame = ax25_ui("APRS", source, path, info)
+        hit = rng.randrange(1 << 16) if i in damaged else None
+        good += hit is None
+        bits = hdlc_bits(frame, rng.randrange(20, 45), rng.randrange(3, 7), hit)
+        station = level * rng.uniform(0.6, 1.1)
+        audio, phase = afsk(bits, rate, 1200 * (1 + baud_error * rng.uniform(-1, 1)),
+                            station, twist_db, phase)
+        gap = int(rate * rng.uniform(0.15, 0.4))
+        samples += [channel(0.0) for _ in range(gap)]
+        samples += [channel(x) for x in audio]
+    samples += [channel(0.0) for _ in range(int(rate * 0.2))]
+
+    path = os.path.join(HERE, "%s_%d.wav" % (name, rate))
+    with wave.open(path, "wb") as out:
+        out.setnchannels(1)
+        out.setsampwidth(2)
+        out.setframerate(rate)
+        clip = lambda x: max(-32768, min(32767, int(round(x))))
+        out.writeframes(struct.pack("<%dh" % len(samples), *map(clip, samples)))
+    print("%s: %d frames sent, %d intact, %.1f s" % (
+        os.path.basename(path), frames, good, len(samples) / rate))
+
+
+# Tone squelch
+
+
+class Resonator:
+    """Two-pole resonator for a formant."""
+
+    def __init__(self, rate):
+        self.rate = rate
+        self.y = [0.0, 0.0]
+
+    def __call__(self, x, freq, bandwidth):
+        r = math.exp(-math.pi * bandwidth / self.rate)
+        a1 = 2 * r * math.cos(2 * math.pi * freq / self.rate)
+        y = (1 - r) * x + a1 * self.y[0] - r * r * self.y[1]
+        self.y = [y, self.y[0]]
+        return y
+
+
+class Voice:
+    """Glottal pulses through two formants, gated into syllables and pauses."""
+
+    VOWELS = [(730, 1090), (270, 2290), (530, 1840), (570, 840), (300, 870), (660, 1720)]
+
+    def __init__(self, rate, rng):
+        self.rate = rate
+        self.rng = rng
+        self.f1 = Resonator(rate)
+        self.f2 = Resonator(rate)
+        self.voice_filter = [Biquad("high", 300, rate), Biquad("high", 300, rate)]
+        self.pitch_phase = 0.0
+        self.pitch = 140.0
+        self.left = 0
+        self.envelope = 0.0
+        self.target = 0.0
+        self.vowel = self.VOWELS[0]
+
+    def __call__(self):
+        if self.left == 0:
+            # Next syllable (or pause), 80..300 ms
+            self.left = int(self.rate * self.rng.uniform(0.08, 0.3))
+            self.target = 0.0 if self.rng.random() < 0.25 else self.rng.uniform(0.5, 1.0)
+            self.vowel = self.rng.choice(self.VOWELS)
+            self.pitch = min(220, max(90, self.pitch * self.rng.uniform(0.9, 1.1)))
+        self.left -= 1
+        self.envelope += (self.target - self.envelope) * 0.004
+        self.pitch_phase += self.pitch / self.rate
+        pulse = 1.0 if self.pitch_phase >= 1 else 0.0
+        self.pitch_phase %= 1
+        x = pulse + self.rng.gauss(0, 0.05)  # Breath
+        y = self.f1(x, self.vowel[0], 90) * 4 + self.f2(x, self.vowel[1], 120) * 2
+        # The transmitter's voice filter keeps speech out of the sub-audio band.
+        for f in self.voice_filter:
+            y = f(y)
+        return y * self.envelope
+
+
+def dcs_word(code):
+    """23 bits, LSB first: 9 code bits, 100, 11 Golay (23,12) parity bits."""
+    data = (code & 0x1FF) | 0x800
+    parity = 0
+    for i in range(11, -1, -1):
+        feedback = ((data >> i) & 1) ^ (parity >> 10)
+        parity = (parity << 1) & 0x7FF
+        if feedback:
+            parity ^= 0xC75 & 0x7FF
+    return data | (parity << 12)
+
+
+def tsq_capture(name, rate, timeline, seed):
+    rng = random.Random(seed)
+    voice = Voice(rate, rng)
+    coupling = Coupling(10, rate)
+    tail = Biquad("low", 3000, rate)
+    samples = []
+    phase = 0.0
+    for start, end, kind, value in timeline:
+        for n in range(int(start * rate), int(end * rate)):
+            t = n / rate
+            if kind is None:
+                # No carrier: squelch-open hiss only.
+                x = rng.gauss(0, 3000)
+            else:
+                x = 9000 * voice() + rng.gauss(0, 400)
+                if kind == "ctcss":
+                    phase += 2 * math.pi * value[0] / rate
+                    x += 3500 * math.sin(phase)
+                else:
+                    code, inverted, baud = value
+                    bit = int(t * baud) % 23
+                    x += 3000 if ((dcs_word(code) >> bit) & 1) != inverted else -3000
+            samples.append(tail(coupling(x)))
+    path = os.path.join(HERE, "%s_%d.wav" % (name, rate))
+    with wave.open(path, "wb") as out:
+        out.setnchannels(1)
+        out.setsampwidth(2)
+        out.setframerate(rate)
+        clip = lambda x: max(-32768, min(32767, int(round(x))))
+        out.writeframes(struct.pack("<%dh" % len(samples), *map(clip, samples)))
+    print("%s: %d transmissions, %.1f s" % (
+        os.path.basename(path), sum(k is not None for _, _, k, _ in timeline), len(samples) / rate))
+
+
+def main():
+    # De-emphasised receiver (space 4 dB down), clean-ish signal.
+    capture("aprs", 9600, 22, {6, 15}, -4.0, 20.0, 0.008, 400, 1)
+    # Flat audio tap (space 3 dB up), weaker stations.
+    capture("aprs", 13200, 22, {3, 18}, 3.0, 15.0, 0.008, -250, 2)
+    # Encoders off frequency (0.2 Hz) and off baud (0.5%).
+    tsq_capture("tsq", 8000, [
+        (0, 2, None, None),
+        (2, 7, "ctcss", (100.2,)),
+        (7, 9, None, None),
+        (9, 14, "dcs", (0o023, False, 134.4 * 1.005)),
+        (14, 16, None, None),
+        (16, 21, "ctcss", (151.2,)),
+        (21, 23, None, None),
+        (23, 28, "dcs", (0o754, True, 134.4 * 0.995)),
+        (28, 30, None, None),
+        (30, 35, "ctcss", (250.3,)),
+        (35, 37, None, None),
+    ], 3)
+
+
+if __name__ == "__main__":
+    main()